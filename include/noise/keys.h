@@ -25,5 +25,6 @@
 
 #include <noise/keys/certificate.h>
 #include <noise/keys/loader.h>
+#include <noise/keys/verify.h>
 
 #endif
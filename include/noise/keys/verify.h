@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef NOISE_KEYS_VERIFY_H
+#define NOISE_KEYS_VERIFY_H
+
+#include <noise/keys/certificate.h>
+#include <noise/protocol/verifycache.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    size_t cert_index;
+    size_t signature_index;
+    int signer_index;
+    int status;
+
+} NoiseSignatureStatus;
+
+size_t noise_certificate_count_signatures(const Noise_Certificate *cert);
+size_t noise_certificate_chain_count_signatures
+    (const Noise_CertificateChain *chain);
+
+int noise_certificate_verify
+    (const Noise_Certificate *cert, NoiseVerifyCache *cache,
+     NoiseSignatureStatus *status, size_t max_status, size_t *num_status);
+int noise_certificate_chain_verify
+    (const Noise_CertificateChain *chain, NoiseVerifyCache *cache,
+     NoiseSignatureStatus *status, size_t max_status, size_t *num_status,
+     int max_threads);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -118,6 +118,7 @@ int noise_protobuf_insert_into_array
     (void **array, size_t *count, size_t *max, size_t index,
      const void *value, size_t size);
 
+void *noise_protobuf_new_memory(size_t size);
 void noise_protobuf_free_memory(void *ptr, size_t size);
 
 #ifdef __cplusplus
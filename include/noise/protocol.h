@@ -30,7 +30,9 @@
 #include <noise/protocol/cipherstate.h>
 #include <noise/protocol/hashstate.h>
 #include <noise/protocol/dhstate.h>
+#include <noise/protocol/ephemeralpool.h>
 #include <noise/protocol/signstate.h>
+#include <noise/protocol/verifycache.h>
 #include <noise/protocol/randstate.h>
 #include <noise/protocol/symmetricstate.h>
 #include <noise/protocol/handshakestate.h>
@@ -48,6 +48,10 @@ int noise_cipherstate_decrypt_with_ad
      NoiseBuffer *buffer);
 int noise_cipherstate_encrypt(NoiseCipherState *state, NoiseBuffer *buffer);
 int noise_cipherstate_decrypt(NoiseCipherState *state, NoiseBuffer *buffer);
+int noise_cipherstate_encrypt_batch
+    (NoiseCipherState *state, NoiseBuffer *buffers, size_t count);
+int noise_cipherstate_decrypt_batch
+    (NoiseCipherState *state, NoiseBuffer *buffers, size_t count);
 int noise_cipherstate_set_nonce(NoiseCipherState *state, uint64_t nonce);
 int noise_cipherstate_get_max_key_length(void);
 int noise_cipherstate_get_max_mac_length(void);
@@ -127,6 +127,15 @@ extern "C" {
 #define NOISE_FINGERPRINT_BASIC         NOISE_ID('F', 1)
 #define NOISE_FINGERPRINT_FULL          NOISE_ID('F', 2)
 
+/* CPU features that enable accelerated implementations of primitives */
+#define NOISE_CPU_SSSE3                 0x0001
+#define NOISE_CPU_SSE41                 0x0002
+#define NOISE_CPU_AVX2                  0x0004
+#define NOISE_CPU_AVX512                0x0008
+#define NOISE_CPU_AESNI                 0x0010
+#define NOISE_CPU_PCLMUL                0x0020
+#define NOISE_CPU_SHA                   0x0040
+
 /* Error codes */
 #define NOISE_ERROR_NONE                0
 #define NOISE_ERROR_NO_MEMORY           NOISE_ID('E', 1)
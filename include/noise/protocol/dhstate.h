@@ -31,6 +31,8 @@ extern "C" {
 #endif
 
 typedef struct NoiseDHState_s NoiseDHState;
+typedef struct NoiseStaticKey_s NoiseStaticKey;
+typedef struct NoiseEphemeralPool_s NoiseEphemeralPool;
 
 int noise_dhstate_new_by_id(NoiseDHState **state, int id);
 int noise_dhstate_new_by_name(NoiseDHState **state, const char *name);
@@ -69,6 +71,14 @@ int noise_dhstate_format_fingerprint
     (const NoiseDHState *state, int fingerprint_type, char *buffer, size_t len);
 int noise_dhstate_get_role(const NoiseDHState *state);
 int noise_dhstate_set_role(NoiseDHState *state, int role);
+int noise_dhstate_set_ephemeral_pool
+    (NoiseDHState *state, NoiseEphemeralPool *pool);
+
+int noise_static_key_new(NoiseStaticKey **key, const NoiseDHState *state);
+int noise_static_key_ref(NoiseStaticKey *key);
+int noise_static_key_unref(NoiseStaticKey *key);
+int noise_static_key_get_dh_id(const NoiseStaticKey *key);
+const NoiseDHState *noise_static_key_get_dhstate(const NoiseStaticKey *key);
 
 #ifdef __cplusplus
 };
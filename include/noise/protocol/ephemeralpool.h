@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NOISE_EPHEMERALPOOL_H
+#define NOISE_EPHEMERALPOOL_H
+
+#include <noise/protocol/dhstate.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int noise_ephemeral_pool_new
+    (NoiseEphemeralPool **pool, int dh_id, size_t capacity);
+int noise_ephemeral_pool_free(NoiseEphemeralPool *pool);
+int noise_ephemeral_pool_get_dh_id(const NoiseEphemeralPool *pool);
+size_t noise_ephemeral_pool_get_capacity(const NoiseEphemeralPool *pool);
+size_t noise_ephemeral_pool_get_count(const NoiseEphemeralPool *pool);
+/* Refill is synchronous on the caller's thread; the library starts no
+   worker thread, so run this from a thread that the application owns. */
+int noise_ephemeral_pool_fill
+    (NoiseEphemeralPool *pool, size_t max_count, size_t *generated);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -36,12 +36,21 @@ int noise_handshakestate_new_by_id
     (NoiseHandshakeState **state, const NoiseProtocolId *protocol_id, int role);
 int noise_handshakestate_new_by_name
     (NoiseHandshakeState **state, const char *protocol_name, int role);
+int noise_handshakestate_get_arena_size
+    (const NoiseProtocolId *protocol_id, int role, size_t *size);
+int noise_handshakestate_new_in_arena
+    (NoiseHandshakeState **state, const NoiseProtocolId *protocol_id,
+     int role, void *arena, size_t arena_size);
 int noise_handshakestate_free(NoiseHandshakeState *state);
 int noise_handshakestate_get_role(const NoiseHandshakeState *state);
 int noise_handshakestate_get_protocol_id
     (const NoiseHandshakeState *state, NoiseProtocolId *id);
 NoiseDHState *noise_handshakestate_get_local_keypair_dh
     (const NoiseHandshakeState *state);
+int noise_handshakestate_set_static_key
+    (NoiseHandshakeState *state, NoiseStaticKey *key);
+int noise_handshakestate_set_ephemeral_pool
+    (NoiseHandshakeState *state, NoiseEphemeralPool *pool);
 NoiseDHState *noise_handshakestate_get_remote_public_key_dh
     (const NoiseHandshakeState *state);
 NoiseDHState *noise_handshakestate_get_fixed_ephemeral_dh
@@ -68,6 +77,9 @@ int noise_handshakestate_read_message
     (NoiseHandshakeState *state, NoiseBuffer *message, NoiseBuffer *payload);
 int noise_handshakestate_split
     (NoiseHandshakeState *state, NoiseCipherState **send, NoiseCipherState **receive);
+int noise_handshakestate_split_batch
+    (NoiseHandshakeState * const *states, NoiseCipherState **send,
+     NoiseCipherState **receive, size_t count);
 int noise_handshakestate_get_handshake_hash
     (const NoiseHandshakeState *state, uint8_t *hash, size_t max_len);
 
@@ -43,17 +43,28 @@ int noise_hashstate_update
     (NoiseHashState *state, const uint8_t *data, size_t data_len);
 int noise_hashstate_finalize
     (NoiseHashState *state, uint8_t *hash, size_t hash_len);
+int noise_hashstate_copy(NoiseHashState *state, const NoiseHashState *from);
+int noise_hashstate_clone(NoiseHashState **clone, const NoiseHashState *state);
 int noise_hashstate_hash_one
     (NoiseHashState *state, const uint8_t *data, size_t data_len,
      uint8_t *hash, size_t hash_len);
 int noise_hashstate_hash_two
     (NoiseHashState *state, const uint8_t *data1, size_t data1_len,
      const uint8_t *data2, size_t data2_len, uint8_t *hash, size_t hash_len);
+int noise_hashstate_hash_many
+    (NoiseHashState *state, const uint8_t * const *data,
+     const size_t *data_lens, uint8_t * const *hashes, size_t hash_len,
+     size_t count);
 int noise_hashstate_hkdf
     (NoiseHashState *state, const uint8_t *key, size_t key_len,
      const uint8_t *data, size_t data_len,
      uint8_t *output1, size_t output1_len,
      uint8_t *output2, size_t output2_len);
+int noise_hashstate_hkdf_batch
+    (NoiseHashState *state, const uint8_t * const *keys, size_t key_len,
+     const uint8_t * const *data, size_t data_len,
+     uint8_t * const *output1, size_t output1_len,
+     uint8_t * const *output2, size_t output2_len, size_t count);
 int noise_hashstate_pbkdf2
     (NoiseHashState *state, const uint8_t *passphrase, size_t passphrase_len,
      const uint8_t *salt, size_t salt_len, size_t iterations,
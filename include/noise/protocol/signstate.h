@@ -31,6 +31,7 @@ extern "C" {
 #endif
 
 typedef struct NoiseSignState_s NoiseSignState;
+typedef struct NoiseVerifyCache_s NoiseVerifyCache;
 
 int noise_signstate_new_by_id(NoiseSignState **state, int id);
 int noise_signstate_new_by_name(NoiseSignState **state, const char *name);
@@ -61,6 +62,12 @@ int noise_signstate_sign
 int noise_signstate_verify
     (const NoiseSignState *state, const uint8_t *message, size_t message_len,
      const uint8_t *signature, size_t signature_len);
+int noise_signstate_verify_batch
+    (const NoiseSignState *state, const uint8_t * const *public_keys,
+     const uint8_t * const *messages, const size_t *message_lens,
+     const uint8_t * const *signatures, size_t count, int *results);
+int noise_signstate_set_verify_cache
+    (NoiseSignState *state, NoiseVerifyCache *cache);
 int noise_signstate_copy(NoiseSignState *state, const NoiseSignState *from);
 int noise_signstate_format_fingerprint
     (const NoiseSignState *state, int fingerprint_type,
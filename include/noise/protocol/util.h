@@ -32,9 +32,41 @@ extern "C" {
 
 int noise_init(void);
 
+int noise_get_cpu_features(void);
+int noise_set_cpu_features(int features);
+
+typedef struct
+{
+    void *(*alloc)(void *ctx, size_t size);     /**< Allocates memory */
+    void *(*secure_alloc)(void *ctx, size_t size); /**< Memory for secrets */
+    void (*free)(void *ctx, void *ptr, size_t size); /**< Frees memory */
+    void *ctx;                                  /**< Passed to the functions */
+
+} NoiseAllocator;
+
+int noise_set_allocator(const NoiseAllocator *allocator);
+
+typedef struct
+{
+    size_t sizes;           /**< Number of object sizes that have a pool */
+    size_t cached;          /**< Number of objects held in the pools */
+    size_t cached_bytes;    /**< Number of bytes held in the pools */
+    size_t high_water;      /**< Highest value of cached since the last trim */
+    uint64_t hits;          /**< Allocations that were served by a pool */
+    uint64_t misses;        /**< Allocations that missed the pools */
+
+} NoiseObjectPoolStats;
+
+int noise_set_object_pool_limit(size_t limit);
+int noise_get_object_pool_stats(NoiseObjectPoolStats *stats);
+int noise_trim_object_pool(size_t limit);
+
 #define noise_new(type) ((type *)noise_new_object(sizeof(type)))
 void *noise_new_object(size_t size);
+void *noise_new_memory(size_t size);
+void *noise_new_secure_memory(size_t size);
 void noise_free(void *ptr, size_t size);
+void noise_free_object(void *ptr, size_t size);
 
 void noise_clean(void *data, size_t size);
 
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef NOISE_VERIFYCACHE_H
+#define NOISE_VERIFYCACHE_H
+
+#include <noise/protocol/signstate.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int noise_verify_cache_new(NoiseVerifyCache **cache, size_t capacity);
+int noise_verify_cache_free(NoiseVerifyCache *cache);
+int noise_verify_cache_clear(NoiseVerifyCache *cache);
+size_t noise_verify_cache_get_capacity(const NoiseVerifyCache *cache);
+int noise_verify_cache_get_stats
+    (NoiseVerifyCache *cache, size_t *count, uint64_t *hits, uint64_t *misses);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -169,9 +169,16 @@ static int noise_aesgcm_decrypt(NoiseCipherState *state, const uint8_t *ad, size
 
     /* Finalise the decryption. A positive return value indicates success,
      * anything else is a failure - the plaintext is not trustworthy.
+     * OpenSSL has already decrypted the data in place by then, so run the
+     * same counter mode keystream over it again to put the ciphertext back.
      */
     if (EVP_DecryptFinal_ex(st->ctx, data + len, &len) <= 0) {
         ERR_clear_error();
+        if (EVP_EncryptInit_ex(st->ctx, EVP_aes_256_gcm(), NULL, st->key, st->iv) != 1 ||
+                EVP_EncryptUpdate(st->ctx, data, &len, data, data_len) != 1) {
+            ERR_clear_error();
+            memset(data, 0, data_len);
+        }
         return NOISE_ERROR_MAC_FAILURE;
     }
 
@@ -21,32 +21,104 @@
  */
 
 #include "internal.h"
+#if defined(NOISE_AESGCM_BITSLICED)
+#include "crypto/aes/aes-bitsliced.h"
+#else
 #include "crypto/aes/rijndael-alg-fst.h"
+#endif
 #include "crypto/ghash/ghash.h"
+#include "crypto/aes/aesni-gcm.h"
 #include <string.h>
 
+/* The portable AES implementation is the T-table version in
+   rijndael-alg-fst.c, which is the fastest but may leak the key through
+   cache timing.  Configure with --enable-aes-bitsliced (which defines
+   NOISE_AESGCM_BITSLICED) to use the constant-time bitsliced version in
+   aes-bitsliced.c instead, at the cost of about a third of the throughput.
+   This only matters on CPUs without AES-NI */
+
 typedef struct
 {
     struct NoiseCipherState_s parent;
+#if defined(NOISE_AESGCM_BITSLICED)
+    aes_bs_key aes;
+#else
     uint32_t aes[4 * (MAXNR + 1)];
+#endif
     ghash_state ghash;
     uint8_t counter[16];
     uint8_t hash[16];
+#if defined(CPU_X86_DISPATCH)
+    aesni_gcm_key aesni;
+    int have_aesni;
+    int use_aesni;
+    int have_ghash_key;
+#endif
 
 } NoiseAESGCMState;
 
+/** CPU features that are needed by the accelerated implementation */
+#define NOISE_AESGCM_AESNI_FEATURES \
+    (CPU_FEATURE_AESNI | CPU_FEATURE_PCLMUL | CPU_FEATURE_SSSE3)
+
+/**
+ * \brief Encrypts a single block with the portable AES implementation.
+ *
+ * \param st The cipher state for AESGCM.
+ * \param in The input block.
+ * \param out The output block.
+ */
+static void noise_aesgcm_encrypt_block
+    (NoiseAESGCMState *st, const uint8_t *in, uint8_t *out)
+{
+#if defined(NOISE_AESGCM_BITSLICED)
+    aes_bs_encrypt_block(&(st->aes), in, out);
+#else
+    rijndaelEncrypt(st->aes, MAXNR, in, out);
+#endif
+}
+
+/**
+ * \brief Sets up the key for the portable GHASH implementation.
+ *
+ * \param st The cipher state for AESGCM.
+ */
+static void noise_aesgcm_init_ghash(NoiseAESGCMState *st)
+{
+    /* Construct the hashing key by encrypting a block of zeroes */
+    memset(st->counter, 0, 16);
+    noise_aesgcm_encrypt_block(st, st->counter, st->hash);
+    ghash_reset(&(st->ghash), st->hash);
+#if defined(CPU_X86_DISPATCH)
+    st->have_ghash_key = 1;
+#endif
+}
+
 static void noise_aesgcm_init_key
     (NoiseCipherState *state, const uint8_t *key)
 {
     NoiseAESGCMState *st = (NoiseAESGCMState *)state;
 
     /* Set the encryption key */
+#if defined(NOISE_AESGCM_BITSLICED)
+    aes_bs_keysetup(&(st->aes), key);
+#else
     rijndaelKeySetupEnc(st->aes, key, 256);
+#endif
 
-    /* Construct the hashing key by encrypting a block of zeroes */
-    memset(st->counter, 0, 16);
-    rijndaelEncrypt(st->aes, MAXNR, st->counter, st->hash);
-    ghash_reset(&(st->ghash), st->hash);
+#if defined(CPU_X86_DISPATCH)
+    /* Expand the key for the AES-NI implementation if the CPU has it.
+       Whether it is used for a packet is decided when the IV is set up,
+       so the portable GHASH key is only set up if a packet needs it */
+    st->have_aesni = (cpu_supported_features() & NOISE_AESGCM_AESNI_FEATURES)
+                        == NOISE_AESGCM_AESNI_FEATURES;
+    if (st->have_aesni) {
+        aesni_gcm_init(&(st->aesni), key);
+        st->have_ghash_key = 0;
+        return;
+    }
+#endif
+    noise_aesgcm_init_ghash(st);
 }
 
 #define PUT_UINT64(buf, value) \
@@ -71,6 +143,15 @@ static void noise_aesgcm_setup_iv(NoiseAESGCMState *st)
 {
     uint64_t n = st->parent.n;
 
+#if defined(CPU_X86_DISPATCH)
+    /* Decide whether to use AES-NI for this packet.  If not, then the
+       portable GHASH key may need to be set up for the first time */
+    st->use_aesni = st->have_aesni &&
+                    cpu_has_features(NOISE_AESGCM_AESNI_FEATURES);
+    if (!st->use_aesni && !st->have_ghash_key)
+        noise_aesgcm_init_ghash(st);
+#endif
+
     /* Set up the initial counter block */
     st->counter[0] = 0;
     st->counter[1] = 0;
@@ -83,12 +164,37 @@ static void noise_aesgcm_setup_iv(NoiseAESGCMState *st)
     st->counter[15] = 1;
 
     /* Encrypt the counter to create the value to XOR with the hash later */
-    rijndaelEncrypt(st->aes, MAXNR, st->counter, st->hash);
+#if defined(CPU_X86_DISPATCH)
+    if (st->use_aesni)
+        aesni_gcm_encrypt_block(&(st->aesni), st->counter, st->hash);
+    else
+#endif
+    noise_aesgcm_encrypt_block(st, st->counter, st->hash);
 
     /* Reset the GHASH state, but keep the same key as before */
     ghash_reset(&(st->ghash), 0);
 }
 
+/**
+ * \brief Adds data to the GHASH state and pads it to a 16-byte boundary.
+ *
+ * \param st The cipher state for AESGCM.
+ * \param data The data to be hashed.
+ * \param len The length of the data to be hashed in bytes.
+ */
+static void noise_aesgcm_hash_padded
+    (NoiseAESGCMState *st, const uint8_t *data, size_t len)
+{
+#if defined(CPU_X86_DISPATCH)
+    if (st->use_aesni) {
+        aesni_gcm_ghash(&(st->aesni), (uint8_t *)(st->ghash.Y), data, len);
+        return;
+    }
+#endif
+    ghash_update(&(st->ghash), data, len);
+    ghash_pad(&(st->ghash));
+}
+
 /**
  * \brief Encrypts or decrypts a block.
  *
@@ -99,8 +205,20 @@ static void noise_aesgcm_setup_iv(NoiseAESGCMState *st)
 static void noise_aesgcm_encrypt_or_decrypt
     (NoiseAESGCMState *st, uint8_t *data, size_t len)
 {
+#if !defined(NOISE_AESGCM_BITSLICED)
     uint8_t temp, index;
     uint8_t keystream[16];
+#endif
+#if defined(CPU_X86_DISPATCH)
+    if (st->use_aesni) {
+        aesni_gcm_ctr(&(st->aesni), st->counter, data, len);
+        return;
+    }
+#endif
+#if defined(NOISE_AESGCM_BITSLICED)
+    /* Encrypt the counter blocks 8 at a time with bitsliced AES */
+    aes_bs_ctr(&(st->aes), st->counter, data, len);
+#else
     while (len > 0) {
         /* Increment the counter block and encrypt to get keystream data.
            We only need to increment the last two bytes of the counter
@@ -122,6 +240,7 @@ static void noise_aesgcm_encrypt_or_decrypt
         len -= temp;
     }
     noise_clean(keystream, sizeof(keystream));
+#endif
 }
 
 /**
@@ -139,13 +258,10 @@ static void noise_aesgcm_finalize_hash
     uint8_t index;
     uint8_t block[16];
 
-    /* Pad the GHASH data to a 16-byte boundary */
-    ghash_pad(&(st->ghash));
-
     /* Add the sizes (in bits, not bytes) in a final block */
     PUT_UINT64(block, ((uint64_t)ad_len) * 8);
     PUT_UINT64(block + 8, ((uint64_t)data_len) * 8);
-    ghash_update(&(st->ghash), block, 16);
+    noise_aesgcm_hash_padded(st, block, 16);
 
     /* Read the result directly out of ghash.Y and XOR with the hash nonce */
     value = (uint8_t *)(st->ghash.Y);
@@ -159,12 +275,10 @@ static int noise_aesgcm_encrypt
 {
     NoiseAESGCMState *st = (NoiseAESGCMState *)state;
     noise_aesgcm_setup_iv(st);
-    if (ad_len) {
-        ghash_update(&(st->ghash), ad, ad_len);
-        ghash_pad(&(st->ghash));
-    }
+    if (ad_len)
+        noise_aesgcm_hash_padded(st, ad, ad_len);
     noise_aesgcm_encrypt_or_decrypt(st, data, len);
-    ghash_update(&(st->ghash), data, len);
+    noise_aesgcm_hash_padded(st, data, len);
     noise_aesgcm_finalize_hash(st, data + len, ad_len, len);
     return NOISE_ERROR_NONE;
 }
@@ -175,11 +289,9 @@ static int noise_aesgcm_decrypt
 {
     NoiseAESGCMState *st = (NoiseAESGCMState *)state;
     noise_aesgcm_setup_iv(st);
-    if (ad_len) {
-        ghash_update(&(st->ghash), ad, ad_len);
-        ghash_pad(&(st->ghash));
-    }
-    ghash_update(&(st->ghash), data, len);
+    if (ad_len)
+        noise_aesgcm_hash_padded(st, ad, ad_len);
+    noise_aesgcm_hash_padded(st, data, len);
     noise_aesgcm_finalize_hash(st, st->hash, ad_len, len);
     if (!noise_is_equal(data + len, st->hash, 16))
         return NOISE_ERROR_MAC_FAILURE;
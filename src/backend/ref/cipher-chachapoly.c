@@ -104,44 +104,239 @@ static void noise_chachapoly_auth_lengths
     poly1305_update(&(st->poly1305), st->block, 16);
 }
 
-static int noise_chachapoly_encrypt
-    (NoiseCipherState *state, const uint8_t *ad, size_t ad_len,
+/**
+ * \brief Size of the tiles that are encrypted and authenticated
+ * together in a single pass over long packets.
+ *
+ * The tile is small enough to stay in the L1 data cache between the
+ * ChaCha20 and Poly1305 passes over it.  It must be a multiple of 64
+ * so that the ChaCha20 block counter stays aligned between tiles.
+ */
+#define NOISE_CHACHAPOLY_TILE   8192
+
+/**
+ * \brief Encrypts data and adds the ciphertext to the MAC, one tile
+ * at a time.
+ *
+ * \param st The encryption state for ChaChaPoly.
+ * \param data Points to the plaintext on entry, and to the ciphertext
+ * on exit.
+ * \param len The length of the data.
+ */
+static void noise_chachapoly_encrypt_tiled
+    (NoiseChaChaPolyState *st, uint8_t *data, size_t len)
+{
+    while (len > NOISE_CHACHAPOLY_TILE) {
+        chacha_encrypt_bytes(&(st->chacha), data, data, NOISE_CHACHAPOLY_TILE);
+        poly1305_update(&(st->poly1305), data, NOISE_CHACHAPOLY_TILE);
+        data += NOISE_CHACHAPOLY_TILE;
+        len -= NOISE_CHACHAPOLY_TILE;
+    }
+    chacha_encrypt_bytes(&(st->chacha), data, data, len);
+    poly1305_update(&(st->poly1305), data, len);
+}
+
+/**
+ * \brief Adds ciphertext to the MAC and then decrypts it, one tile
+ * at a time.
+ *
+ * \param st The encryption state for ChaChaPoly.
+ * \param data Points to the ciphertext on entry, and to the plaintext
+ * on exit.
+ * \param len The length of the data.
+ *
+ * The caller must not release the plaintext until the MAC over the
+ * ciphertext has been checked.
+ */
+static void noise_chachapoly_decrypt_tiled
+    (NoiseChaChaPolyState *st, uint8_t *data, size_t len)
+{
+    while (len > NOISE_CHACHAPOLY_TILE) {
+        poly1305_update(&(st->poly1305), data, NOISE_CHACHAPOLY_TILE);
+        chacha_encrypt_bytes(&(st->chacha), data, data, NOISE_CHACHAPOLY_TILE);
+        data += NOISE_CHACHAPOLY_TILE;
+        len -= NOISE_CHACHAPOLY_TILE;
+    }
+    poly1305_update(&(st->poly1305), data, len);
+    chacha_encrypt_bytes(&(st->chacha), data, data, len);
+}
+
+/**
+ * \brief Encrypts and authenticates a packet once the context has been
+ * set up for its nonce.
+ *
+ * \param st The encryption state for ChaChaPoly.
+ * \param ad Points to the associated data.
+ * \param ad_len The length of the associated data; may be zero.
+ * \param data Points to the plaintext on entry, and to the ciphertext
+ * plus MAC on exit.
+ * \param len The length of the plaintext.
+ */
+static void noise_chachapoly_encrypt_packet
+    (NoiseChaChaPolyState *st, const uint8_t *ad, size_t ad_len,
      uint8_t *data, size_t len)
 {
-    NoiseChaChaPolyState *st = (NoiseChaChaPolyState *)state;
-    noise_chachapoly_setup(st, state->n);
     if (ad_len) {
         poly1305_update(&(st->poly1305), ad, ad_len);
         noise_chachapoly_pad_auth(st, ad_len);
     }
-    chacha_encrypt_bytes(&(st->chacha), data, data, len);
-    poly1305_update(&(st->poly1305), data, len);
+    noise_chachapoly_encrypt_tiled(st, data, len);
     noise_chachapoly_pad_auth(st, len);
     noise_chachapoly_auth_lengths(st, ad_len, len);
     poly1305_finish(&(st->poly1305), data + len);
-    return NOISE_ERROR_NONE;
 }
 
-static int noise_chachapoly_decrypt
-    (NoiseCipherState *state, const uint8_t *ad, size_t ad_len,
+/**
+ * \brief Authenticates and decrypts a packet once the context has been
+ * set up for its nonce.
+ *
+ * \param st The encryption state for ChaChaPoly.
+ * \param ad Points to the associated data.
+ * \param ad_len The length of the associated data; may be zero.
+ * \param data Points to the ciphertext plus MAC on entry, and to the
+ * plaintext on exit.
+ * \param len The length of the ciphertext, excluding the MAC.
+ *
+ * \return NOISE_ERROR_NONE on success, or NOISE_ERROR_MAC_FAILURE if
+ * the MAC check failed in which case \a data is left as-is.
+ */
+static int noise_chachapoly_decrypt_packet
+    (NoiseChaChaPolyState *st, const uint8_t *ad, size_t ad_len,
      uint8_t *data, size_t len)
 {
-    NoiseChaChaPolyState *st = (NoiseChaChaPolyState *)state;
-    noise_chachapoly_setup(st, state->n);
+    chacha_ctx saved;
     if (ad_len) {
         poly1305_update(&(st->poly1305), ad, ad_len);
         noise_chachapoly_pad_auth(st, ad_len);
     }
-    poly1305_update(&(st->poly1305), data, len);
+    if (len <= NOISE_CHACHAPOLY_TILE) {
+        /* Short packet: authenticate first and then decrypt */
+        poly1305_update(&(st->poly1305), data, len);
+        noise_chachapoly_pad_auth(st, len);
+        noise_chachapoly_auth_lengths(st, ad_len, len);
+        poly1305_finish(&(st->poly1305), st->block);
+        if (!noise_is_equal(st->block, data + len, 16))
+            return NOISE_ERROR_MAC_FAILURE;
+        chacha_encrypt_bytes(&(st->chacha), data, data, len);
+        return NOISE_ERROR_NONE;
+    }
+
+    /* Long packet: authenticate and decrypt each tile while it is still
+       in the cache.  The plaintext is not released to the caller until
+       the MAC has been checked; if the check fails, the keystream is
+       applied a second time to put the ciphertext back */
+    memcpy(&saved, &(st->chacha), sizeof(saved));
+    noise_chachapoly_decrypt_tiled(st, data, len);
     noise_chachapoly_pad_auth(st, len);
     noise_chachapoly_auth_lengths(st, ad_len, len);
     poly1305_finish(&(st->poly1305), st->block);
-    if (!noise_is_equal(st->block, data + len, 16))
+    if (!noise_is_equal(st->block, data + len, 16)) {
+        chacha_encrypt_bytes(&saved, data, data, len);
+        noise_clean(&saved, sizeof(saved));
         return NOISE_ERROR_MAC_FAILURE;
-    chacha_encrypt_bytes(&(st->chacha), data, data, len);
+    }
+    noise_clean(&saved, sizeof(saved));
     return NOISE_ERROR_NONE;
 }
 
+static int noise_chachapoly_encrypt
+    (NoiseCipherState *state, const uint8_t *ad, size_t ad_len,
+     uint8_t *data, size_t len)
+{
+    NoiseChaChaPolyState *st = (NoiseChaChaPolyState *)state;
+    noise_chachapoly_setup(st, state->n);
+    noise_chachapoly_encrypt_packet(st, ad, ad_len, data, len);
+    return NOISE_ERROR_NONE;
+}
+
+static int noise_chachapoly_decrypt
+    (NoiseCipherState *state, const uint8_t *ad, size_t ad_len,
+     uint8_t *data, size_t len)
+{
+    NoiseChaChaPolyState *st = (NoiseChaChaPolyState *)state;
+    noise_chachapoly_setup(st, state->n);
+    return noise_chachapoly_decrypt_packet(st, ad, ad_len, data, len);
+}
+
+/**
+ * \brief Maximum number of packets whose Poly1305 keys are generated
+ * together when processing a batch.
+ */
+#define NOISE_CHACHAPOLY_BATCH  8
+
+/**
+ * \brief Sets up a ChaChaPoly context for one packet in a batch.
+ *
+ * \param st The encryption state for ChaChaPoly.
+ * \param n The nonce for the packet.
+ * \param key The first keystream block for the nonce, as generated
+ * by chacha_first_blocks().
+ *
+ * The key block has already been generated so the ChaCha20 counter
+ * starts at 1, directly after the block that was used for Poly1305.
+ */
+static void noise_chachapoly_setup_batch
+    (NoiseChaChaPolyState *st, uint64_t n, const uint8_t *key)
+{
+    static uint8_t const counter[8] = {1, 0, 0, 0, 0, 0, 0, 0};
+    PUT_UINT64(st->block, n);
+    chacha_ivsetup(&(st->chacha), st->block, counter);
+    poly1305_init(&(st->poly1305), key);
+}
+
+static int noise_chachapoly_encrypt_batch
+    (NoiseCipherState *state, NoiseBuffer *buffers, size_t count)
+{
+    NoiseChaChaPolyState *st = (NoiseChaChaPolyState *)state;
+    uint8_t keys[NOISE_CHACHAPOLY_BATCH * 64];
+    uint64_t n = state->n;
+    size_t lanes, lane;
+    while (count > 0) {
+        lanes = (count < NOISE_CHACHAPOLY_BATCH) ? count : NOISE_CHACHAPOLY_BATCH;
+        chacha_first_blocks(&(st->chacha), n, keys, (uint32_t)lanes);
+        for (lane = 0; lane < lanes; ++lane) {
+            noise_chachapoly_setup_batch(st, n + lane, keys + lane * 64);
+            noise_chachapoly_encrypt_packet
+                (st, 0, 0, buffers[lane].data, buffers[lane].size);
+        }
+        buffers += lanes;
+        count -= lanes;
+        n += lanes;
+    }
+    noise_clean(keys, sizeof(keys));
+    return NOISE_ERROR_NONE;
+}
+
+static size_t noise_chachapoly_decrypt_batch
+    (NoiseCipherState *state, NoiseBuffer *buffers, size_t count)
+{
+    NoiseChaChaPolyState *st = (NoiseChaChaPolyState *)state;
+    uint8_t keys[NOISE_CHACHAPOLY_BATCH * 64];
+    uint64_t n = state->n;
+    size_t done = 0;
+    size_t lanes, lane;
+    while (done < count) {
+        lanes = count - done;
+        if (lanes > NOISE_CHACHAPOLY_BATCH)
+            lanes = NOISE_CHACHAPOLY_BATCH;
+        chacha_first_blocks(&(st->chacha), n, keys, (uint32_t)lanes);
+        for (lane = 0; lane < lanes; ++lane) {
+            NoiseBuffer *buffer = &(buffers[done]);
+            noise_chachapoly_setup_batch(st, n + lane, keys + lane * 64);
+            if (noise_chachapoly_decrypt_packet
+                    (st, 0, 0, buffer->data, buffer->size - 16)
+                        != NOISE_ERROR_NONE) {
+                noise_clean(keys, sizeof(keys));
+                return done;
+            }
+            ++done;
+        }
+        n += lanes;
+    }
+    noise_clean(keys, sizeof(keys));
+    return done;
+}
+
 NoiseCipherState *noise_chachapoly_new(void)
 {
     NoiseChaChaPolyState *state = noise_new(NoiseChaChaPolyState);
@@ -154,5 +349,7 @@ NoiseCipherState *noise_chachapoly_new(void)
     state->parent.init_key = noise_chachapoly_init_key;
     state->parent.encrypt = noise_chachapoly_encrypt;
     state->parent.decrypt = noise_chachapoly_decrypt;
+    state->parent.encrypt_batch = noise_chachapoly_encrypt_batch;
+    state->parent.decrypt_batch = noise_chachapoly_decrypt_batch;
     return &(state->parent);
 }
@@ -32,9 +32,6 @@ typedef struct
 
 } NoiseCurve448State;
 
-/* Curve448 base point from RFC 7748, 5 in little-endian order */
-static uint8_t const basepoint[56] = {5};
-
 static int noise_curve448_generate_keypair
     (NoiseDHState *state, const NoiseDHState *other)
 {
@@ -48,7 +45,7 @@ static int noise_curve448_generate_keypair
     st->private_key[55] |= 0x80;
 
     /* Evaluate the curve operation to derive the public key */
-    curve448_eval(st->public_key, st->private_key, basepoint);
+    curve448_eval_base(st->public_key, st->private_key);
     return NOISE_ERROR_NONE;
 }
 
@@ -60,7 +57,7 @@ static int noise_curve448_set_keypair
     NoiseCurve448State *st = (NoiseCurve448State *)state;
     uint8_t temp[56];
     int equal;
-    curve448_eval(temp, private_key, basepoint);
+    curve448_eval_base(temp, private_key);
     equal = noise_is_equal(temp, public_key, 56);
     memcpy(st->private_key, private_key, 56);
     memcpy(st->public_key, public_key, 56);
@@ -72,7 +69,7 @@ static int noise_curve448_set_keypair_private
 {
     NoiseCurve448State *st = (NoiseCurve448State *)state;
     memcpy(st->private_key, private_key, 56);
-    curve448_eval(st->public_key, st->private_key, basepoint);
+    curve448_eval_base(st->public_key, st->private_key);
     return NOISE_ERROR_NONE;
 }
 
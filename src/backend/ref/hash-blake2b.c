@@ -22,6 +22,7 @@
 
 #include "internal.h"
 #include "crypto/blake2/blake2b.h"
+#include <string.h>
 
 typedef struct
 {
@@ -48,6 +49,25 @@ static void noise_blake2b_finalize(NoiseHashState *state, uint8_t *hash)
     BLAKE2b_finish(&(st->blake2), hash);
 }
 
+static void noise_blake2b_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    NoiseBLAKE2bState *st = (NoiseBLAKE2bState *)state;
+    const NoiseBLAKE2bState *from_st = (const NoiseBLAKE2bState *)from;
+    memcpy(&(st->blake2), &(from_st->blake2), sizeof(st->blake2));
+}
+
+static void noise_blake2b_hash_many
+    (NoiseHashState *state, const uint8_t * const *data,
+     const size_t *data_lens, uint8_t * const *hashes, size_t count)
+{
+    BLAKE2b_hash_many(data, data_lens, hashes, count);
+}
+
+static size_t noise_blake2b_hash_many_lanes(const NoiseHashState *state)
+{
+    return BLAKE2b_hash_many_lanes();
+}
+
 NoiseHashState *noise_blake2b_new(void)
 {
     NoiseBLAKE2bState *state = noise_new(NoiseBLAKE2bState);
@@ -59,5 +79,8 @@ NoiseHashState *noise_blake2b_new(void)
     state->parent.reset = noise_blake2b_reset;
     state->parent.update = noise_blake2b_update;
     state->parent.finalize = noise_blake2b_finalize;
+    state->parent.copy = noise_blake2b_copy;
+    state->parent.hash_many = noise_blake2b_hash_many;
+    state->parent.hash_many_lanes = noise_blake2b_hash_many_lanes;
     return &(state->parent);
 }
@@ -22,6 +22,7 @@
 
 #include "internal.h"
 #include "crypto/sha2/sha256.h"
+#include <string.h>
 
 typedef struct
 {
@@ -48,6 +49,25 @@ static void noise_sha256_finalize(NoiseHashState *state, uint8_t *hash)
     sha256_finish(&(st->sha256), hash);
 }
 
+static void noise_sha256_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    NoiseSHA256State *st = (NoiseSHA256State *)state;
+    const NoiseSHA256State *from_st = (const NoiseSHA256State *)from;
+    memcpy(&(st->sha256), &(from_st->sha256), sizeof(st->sha256));
+}
+
+static void noise_sha256_hash_many
+    (NoiseHashState *state, const uint8_t * const *data,
+     const size_t *data_lens, uint8_t * const *hashes, size_t count)
+{
+    sha256_hash_many(data, data_lens, hashes, count);
+}
+
+static size_t noise_sha256_hash_many_lanes(const NoiseHashState *state)
+{
+    return sha256_hash_many_lanes();
+}
+
 NoiseHashState *noise_sha256_new(void)
 {
     NoiseSHA256State *state = noise_new(NoiseSHA256State);
@@ -59,5 +79,8 @@ NoiseHashState *noise_sha256_new(void)
     state->parent.reset = noise_sha256_reset;
     state->parent.update = noise_sha256_update;
     state->parent.finalize = noise_sha256_finalize;
+    state->parent.copy = noise_sha256_copy;
+    state->parent.hash_many = noise_sha256_hash_many;
+    state->parent.hash_many_lanes = noise_sha256_hash_many_lanes;
     return &(state->parent);
 }
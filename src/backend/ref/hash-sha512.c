@@ -22,6 +22,7 @@
 
 #include "internal.h"
 #include "crypto/sha2/sha512.h"
+#include <string.h>
 
 typedef struct
 {
@@ -48,6 +49,25 @@ static void noise_sha512_finalize(NoiseHashState *state, uint8_t *hash)
     sha512_finish(&(st->sha512), hash);
 }
 
+static void noise_sha512_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    NoiseSHA512State *st = (NoiseSHA512State *)state;
+    const NoiseSHA512State *from_st = (const NoiseSHA512State *)from;
+    memcpy(&(st->sha512), &(from_st->sha512), sizeof(st->sha512));
+}
+
+static void noise_sha512_hash_many
+    (NoiseHashState *state, const uint8_t * const *data,
+     const size_t *data_lens, uint8_t * const *hashes, size_t count)
+{
+    sha512_hash_many(data, data_lens, hashes, count);
+}
+
+static size_t noise_sha512_hash_many_lanes(const NoiseHashState *state)
+{
+    return sha512_hash_many_lanes();
+}
+
 NoiseHashState *noise_sha512_new(void)
 {
     NoiseSHA512State *state = noise_new(NoiseSHA512State);
@@ -59,5 +79,8 @@ NoiseHashState *noise_sha512_new(void)
     state->parent.reset = noise_sha512_reset;
     state->parent.update = noise_sha512_update;
     state->parent.finalize = noise_sha512_finalize;
+    state->parent.copy = noise_sha512_copy;
+    state->parent.hash_many = noise_sha512_hash_many;
+    state->parent.hash_many_lanes = noise_sha512_hash_many_lanes;
     return &(state->parent);
 }
@@ -87,6 +87,26 @@ static int noise_ed25519_verify
     return result ? NOISE_ERROR_INVALID_SIGNATURE : NOISE_ERROR_NONE;
 }
 
+static int noise_ed25519_verify_batch
+        (const NoiseSignState *state, const uint8_t * const *public_keys,
+         const uint8_t * const *messages, const size_t *message_lens,
+         const uint8_t * const *signatures, size_t count, int *results)
+{
+    /* ed25519-donna verifies up to 64 signatures at a time with a single
+       multi-scalar multiplication.  If the combined check fails, it falls
+       back to verifying each signature in that group individually. */
+    int result = ed25519_sign_open_batch
+        ((const unsigned char **)messages, (size_t *)message_lens,
+         (const unsigned char **)public_keys,
+         (const unsigned char **)signatures, count, results);
+    size_t index;
+    for (index = 0; index < count; ++index) {
+        results[index] = results[index] ? NOISE_ERROR_NONE
+                                        : NOISE_ERROR_INVALID_SIGNATURE;
+    }
+    return result ? NOISE_ERROR_INVALID_SIGNATURE : NOISE_ERROR_NONE;
+}
+
 NoiseSignState *noise_ed25519_new(void)
 {
     NoiseEd25519State *state = noise_new(NoiseEd25519State);
@@ -104,5 +124,6 @@ NoiseSignState *noise_ed25519_new(void)
     state->parent.derive_public_key = noise_ed25519_derive_public_key;
     state->parent.sign = noise_ed25519_sign;
     state->parent.verify = noise_ed25519_verify;
+    state->parent.verify_batch = noise_ed25519_verify_batch;
     return &(state->parent);
 }
@@ -23,6 +23,7 @@
 
 #include "internal.h"
 #include <sodium.h>
+#include <string.h>
 
 typedef struct
 {
@@ -49,6 +50,13 @@ static void noise_blake2b_finalize(NoiseHashState *state, uint8_t *hash)
     crypto_generichash_blake2b_final(&(st->blake2), hash, crypto_generichash_blake2b_BYTES_MAX);
 }
 
+static void noise_blake2b_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    NoiseBLAKE2bState *st = (NoiseBLAKE2bState *)state;
+    const NoiseBLAKE2bState *from_st = (const NoiseBLAKE2bState *)from;
+    memcpy(&(st->blake2), &(from_st->blake2), sizeof(st->blake2));
+}
+
 NoiseHashState *noise_blake2b_new(void)
 {
     NoiseBLAKE2bState *state = noise_new(NoiseBLAKE2bState);
@@ -60,5 +68,6 @@ NoiseHashState *noise_blake2b_new(void)
     state->parent.reset = noise_blake2b_reset;
     state->parent.update = noise_blake2b_update;
     state->parent.finalize = noise_blake2b_finalize;
+    state->parent.copy = noise_blake2b_copy;
     return &(state->parent);
 }
@@ -23,6 +23,7 @@
 
 #include "internal.h"
 #include <sodium.h>
+#include <string.h>
 
 typedef struct
 {
@@ -49,6 +50,13 @@ static void noise_sha256_finalize(NoiseHashState *state, uint8_t *hash)
     crypto_hash_sha256_final(&(st->sha256), hash);
 }
 
+static void noise_sha256_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    NoiseSHA256State *st = (NoiseSHA256State *)state;
+    const NoiseSHA256State *from_st = (const NoiseSHA256State *)from;
+    memcpy(&(st->sha256), &(from_st->sha256), sizeof(st->sha256));
+}
+
 NoiseHashState *noise_sha256_new(void)
 {
     NoiseSHA256State *state = noise_new(NoiseSHA256State);
@@ -60,5 +68,6 @@ NoiseHashState *noise_sha256_new(void)
     state->parent.reset = noise_sha256_reset;
     state->parent.update = noise_sha256_update;
     state->parent.finalize = noise_sha256_finalize;
+    state->parent.copy = noise_sha256_copy;
     return &(state->parent);
 }
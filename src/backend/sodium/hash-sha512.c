@@ -23,6 +23,7 @@
 
 #include "internal.h"
 #include <sodium.h>
+#include <string.h>
 
 typedef struct
 {
@@ -49,6 +50,13 @@ static void noise_sha512_finalize(NoiseHashState *state, uint8_t *hash)
     crypto_hash_sha512_final(&(st->sha512), hash);
 }
 
+static void noise_sha512_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    NoiseSHA512State *st = (NoiseSHA512State *)state;
+    const NoiseSHA512State *from_st = (const NoiseSHA512State *)from;
+    memcpy(&(st->sha512), &(from_st->sha512), sizeof(st->sha512));
+}
+
 NoiseHashState *noise_sha512_new(void)
 {
     NoiseSHA512State *state = noise_new(NoiseSHA512State);
@@ -60,5 +68,6 @@ NoiseHashState *noise_sha512_new(void)
     state->parent.reset = noise_sha512_reset;
     state->parent.update = noise_sha512_update;
     state->parent.finalize = noise_sha512_finalize;
+    state->parent.copy = noise_sha512_copy;
     return &(state->parent);
 }
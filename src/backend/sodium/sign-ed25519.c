@@ -92,6 +92,27 @@ static int noise_ed25519_verify
     return result ? NOISE_ERROR_INVALID_SIGNATURE : NOISE_ERROR_NONE;
 }
 
+static int noise_ed25519_verify_batch
+        (const NoiseSignState *state, const uint8_t * const *public_keys,
+         const uint8_t * const *messages, const size_t *message_lens,
+         const uint8_t * const *signatures, size_t count, int *results)
+{
+    /* libsodium has no batch verifier, so check each signature in turn */
+    int err = NOISE_ERROR_NONE;
+    size_t index;
+    for (index = 0; index < count; ++index) {
+        if (crypto_sign_ed25519_verify_detached
+                (signatures[index], messages[index], message_lens[index],
+                 public_keys[index]) == 0) {
+            results[index] = NOISE_ERROR_NONE;
+        } else {
+            results[index] = NOISE_ERROR_INVALID_SIGNATURE;
+            err = NOISE_ERROR_INVALID_SIGNATURE;
+        }
+    }
+    return err;
+}
+
 NoiseSignState *noise_ed25519_new(void)
 {
     NoiseEd25519State *state = noise_new(NoiseEd25519State);
@@ -109,5 +130,6 @@ NoiseSignState *noise_ed25519_new(void)
     state->parent.derive_public_key = noise_ed25519_derive_public_key;
     state->parent.sign = noise_ed25519_sign;
     state->parent.verify = noise_ed25519_verify;
+    state->parent.verify_batch = noise_ed25519_verify_batch;
     return &(state->parent);
 }
@@ -0,0 +1,564 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "aes-bitsliced.h"
+#include <string.h>
+
+/* Constant-time bitsliced AES-256, following the "ct64" design from
+   BearSSL by Thomas Pornin.  Four blocks are processed in parallel in
+   eight 64-bit words, with word i holding bit i of every byte of the
+   four blocks.  The S-box is evaluated as the Boyar-Peralta circuit
+   of 113 boolean gates, so there are no table lookups and no
+   data-dependent branches or memory accesses anywhere.
+
+   CTR mode encrypts AES_BS_CTR_BLOCKS counter blocks per iteration as
+   two 4-block slices.  When SSE2 vector math is available, the slices
+   are placed in the two halves of 128-bit vectors so that all eight
+   blocks go through the rounds together. */
+
+#if defined(__SSE2__) && defined(__GNUC__) && __GNUC__ >= 4
+#define AES_BS_VECTOR 1
+typedef uint64_t aes_bs_word __attribute__((__vector_size__(16)));
+#define AES_BS_SPLAT(x) ((aes_bs_word){(x), (x)})
+#define AES_BS_LANE0(x) ((x)[0])
+#else
+#undef AES_BS_VECTOR
+typedef uint64_t aes_bs_word;
+#define AES_BS_SPLAT(x) (x)
+#define AES_BS_LANE0(x) (x)
+#endif
+
+static uint32_t aes_bs_load32(const uint8_t *p)
+{
+    return ((uint32_t)(p[0])) |
+           (((uint32_t)(p[1])) << 8) |
+           (((uint32_t)(p[2])) << 16) |
+           (((uint32_t)(p[3])) << 24);
+}
+
+static void aes_bs_store32(uint8_t *p, uint32_t x)
+{
+    p[0] = (uint8_t)x;
+    p[1] = (uint8_t)(x >> 8);
+    p[2] = (uint8_t)(x >> 16);
+    p[3] = (uint8_t)(x >> 24);
+}
+
+/* Boyar and Peralta, "A new combinational logic minimization technique
+   with applications to cryptology", https://eprint.iacr.org/2009/191.
+   The inputs x0..x7 and outputs s0..s7 are numbered from the high bit */
+static void aes_bs_sbox(aes_bs_word *q)
+{
+    aes_bs_word x0, x1, x2, x3, x4, x5, x6, x7;
+    aes_bs_word y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    aes_bs_word y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    aes_bs_word y20, y21;
+    aes_bs_word z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    aes_bs_word z10, z11, z12, z13, z14, z15, z16, z17;
+    aes_bs_word t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    aes_bs_word t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    aes_bs_word t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    aes_bs_word t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    aes_bs_word t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    aes_bs_word t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    aes_bs_word t60, t61, t62, t63, t64, t65, t66, t67;
+    aes_bs_word s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* Top linear transformation */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* Non-linear section */
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* Bottom linear transformation */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/* Transpose between byte-oriented and bitsliced representations */
+#define AES_BS_SWAPN(cl, ch, s, x, y) \
+    do { \
+        uint64_t _a = (x); \
+        uint64_t _b = (y); \
+        (x) = (_a & (uint64_t)(cl)) | ((_b & (uint64_t)(cl)) << (s)); \
+        (y) = ((_a & (uint64_t)(ch)) >> (s)) | (_b & (uint64_t)(ch)); \
+    } while (0)
+#define AES_BS_SWAP2(x, y) \
+    AES_BS_SWAPN(0x5555555555555555ULL, 0xAAAAAAAAAAAAAAAAULL, 1, x, y)
+#define AES_BS_SWAP4(x, y) \
+    AES_BS_SWAPN(0x3333333333333333ULL, 0xCCCCCCCCCCCCCCCCULL, 2, x, y)
+#define AES_BS_SWAP8(x, y) \
+    AES_BS_SWAPN(0x0F0F0F0F0F0F0F0FULL, 0xF0F0F0F0F0F0F0F0ULL, 4, x, y)
+
+static void aes_bs_ortho(uint64_t *q)
+{
+    AES_BS_SWAP2(q[0], q[1]);
+    AES_BS_SWAP2(q[2], q[3]);
+    AES_BS_SWAP2(q[4], q[5]);
+    AES_BS_SWAP2(q[6], q[7]);
+
+    AES_BS_SWAP4(q[0], q[2]);
+    AES_BS_SWAP4(q[1], q[3]);
+    AES_BS_SWAP4(q[4], q[6]);
+    AES_BS_SWAP4(q[5], q[7]);
+
+    AES_BS_SWAP8(q[0], q[4]);
+    AES_BS_SWAP8(q[1], q[5]);
+    AES_BS_SWAP8(q[2], q[6]);
+    AES_BS_SWAP8(q[3], q[7]);
+}
+
+/* Spread the four 32-bit words of a block over two 64-bit words */
+static void aes_bs_interleave_in(uint64_t *q0, uint64_t *q1, const uint32_t *w)
+{
+    uint64_t x0, x1, x2, x3;
+
+    x0 = w[0];
+    x1 = w[1];
+    x2 = w[2];
+    x3 = w[3];
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+    x0 &= 0x0000FFFF0000FFFFULL;
+    x1 &= 0x0000FFFF0000FFFFULL;
+    x2 &= 0x0000FFFF0000FFFFULL;
+    x3 &= 0x0000FFFF0000FFFFULL;
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+    x0 &= 0x00FF00FF00FF00FFULL;
+    x1 &= 0x00FF00FF00FF00FFULL;
+    x2 &= 0x00FF00FF00FF00FFULL;
+    x3 &= 0x00FF00FF00FF00FFULL;
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+static void aes_bs_interleave_out(uint32_t *w, uint64_t q0, uint64_t q1)
+{
+    uint64_t x0, x1, x2, x3;
+
+    x0 = q0 & 0x00FF00FF00FF00FFULL;
+    x1 = q1 & 0x00FF00FF00FF00FFULL;
+    x2 = (q0 >> 8) & 0x00FF00FF00FF00FFULL;
+    x3 = (q1 >> 8) & 0x00FF00FF00FF00FFULL;
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+    x0 &= 0x0000FFFF0000FFFFULL;
+    x1 &= 0x0000FFFF0000FFFFULL;
+    x2 &= 0x0000FFFF0000FFFFULL;
+    x3 &= 0x0000FFFF0000FFFFULL;
+    w[0] = (uint32_t)x0 | (uint32_t)(x0 >> 16);
+    w[1] = (uint32_t)x1 | (uint32_t)(x1 >> 16);
+    w[2] = (uint32_t)x2 | (uint32_t)(x2 >> 16);
+    w[3] = (uint32_t)x3 | (uint32_t)(x3 >> 16);
+}
+
+static uint32_t aes_bs_sub_word(uint32_t x)
+{
+    uint64_t qa[8];
+    aes_bs_word q[8];
+    int i;
+
+    memset(qa, 0, sizeof(qa));
+    qa[0] = x;
+    aes_bs_ortho(qa);
+    for (i = 0; i < 8; ++i)
+        q[i] = AES_BS_SPLAT(qa[i]);
+    aes_bs_sbox(q);
+    for (i = 0; i < 8; ++i)
+        qa[i] = AES_BS_LANE0(q[i]);
+    aes_bs_ortho(qa);
+    x = (uint32_t)(qa[0]);
+    memset(qa, 0, sizeof(qa));
+    memset(q, 0, sizeof(q));
+    return x;
+}
+
+void aes_bs_keysetup(aes_bs_key *key, const uint8_t k[32])
+{
+    static uint8_t const rcon[7] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40
+    };
+    uint32_t w[60];
+    uint32_t tmp;
+    uint64_t q[8];
+    int i, j, r;
+
+    /* Standard AES-256 key expansion on little-endian words */
+    for (i = 0; i < 8; ++i)
+        w[i] = aes_bs_load32(k + i * 4);
+    tmp = w[7];
+    for (i = 8, j = 0, r = 0; i < 60; ++i) {
+        if (j == 0) {
+            tmp = (tmp << 24) | (tmp >> 8);
+            tmp = aes_bs_sub_word(tmp) ^ rcon[r];
+        } else if (j == 4) {
+            tmp = aes_bs_sub_word(tmp);
+        }
+        tmp ^= w[i - 8];
+        w[i] = tmp;
+        if (++j == 8) {
+            j = 0;
+            ++r;
+        }
+    }
+
+    /* Convert each round key into bitsliced form, replicated over all
+       four block positions */
+    for (i = 0; i < 15; ++i) {
+        aes_bs_interleave_in(&q[0], &q[4], w + i * 4);
+        q[1] = q[0];
+        q[2] = q[0];
+        q[3] = q[0];
+        q[5] = q[4];
+        q[6] = q[4];
+        q[7] = q[4];
+        aes_bs_ortho(q);
+        memcpy(key->sk + i * 8, q, sizeof(q));
+    }
+    memset(w, 0, sizeof(w));
+    memset(q, 0, sizeof(q));
+}
+
+static void aes_bs_add_round_key(aes_bs_word *q, const uint64_t *sk)
+{
+    q[0] ^= sk[0];
+    q[1] ^= sk[1];
+    q[2] ^= sk[2];
+    q[3] ^= sk[3];
+    q[4] ^= sk[4];
+    q[5] ^= sk[5];
+    q[6] ^= sk[6];
+    q[7] ^= sk[7];
+}
+
+static void aes_bs_shift_rows(aes_bs_word *q)
+{
+    int i;
+    for (i = 0; i < 8; ++i) {
+        aes_bs_word x = q[i];
+        q[i] = (x & 0x000000000000FFFFULL) |
+               ((x & 0x00000000FFF00000ULL) >> 4) |
+               ((x & 0x00000000000F0000ULL) << 12) |
+               ((x & 0x0000FF0000000000ULL) >> 8) |
+               ((x & 0x000000FF00000000ULL) << 8) |
+               ((x & 0xF000000000000000ULL) >> 12) |
+               ((x & 0x0FFF000000000000ULL) << 4);
+    }
+}
+
+#define AES_BS_ROTR32(x)    (((x) << 32) | ((x) >> 32))
+#define AES_BS_ROTR16(x)    (((x) >> 16) | ((x) << 48))
+
+static void aes_bs_mix_columns(aes_bs_word *q)
+{
+    aes_bs_word q0, q1, q2, q3, q4, q5, q6, q7;
+    aes_bs_word r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = AES_BS_ROTR16(q0);
+    r1 = AES_BS_ROTR16(q1);
+    r2 = AES_BS_ROTR16(q2);
+    r3 = AES_BS_ROTR16(q3);
+    r4 = AES_BS_ROTR16(q4);
+    r5 = AES_BS_ROTR16(q5);
+    r6 = AES_BS_ROTR16(q6);
+    r7 = AES_BS_ROTR16(q7);
+
+    q[0] = q7 ^ r7 ^ r0 ^ AES_BS_ROTR32(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ AES_BS_ROTR32(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ AES_BS_ROTR32(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ AES_BS_ROTR32(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ AES_BS_ROTR32(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ AES_BS_ROTR32(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ AES_BS_ROTR32(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ AES_BS_ROTR32(q7 ^ r7);
+}
+
+/* Encrypts the blocks in bitsliced form */
+static void aes_bs_encrypt(const uint64_t *sk, aes_bs_word *q)
+{
+    int round;
+    aes_bs_add_round_key(q, sk);
+    for (round = 1; round < 14; ++round) {
+        aes_bs_sbox(q);
+        aes_bs_shift_rows(q);
+        aes_bs_mix_columns(q);
+        aes_bs_add_round_key(q, sk + round * 8);
+    }
+    aes_bs_sbox(q);
+    aes_bs_shift_rows(q);
+    aes_bs_add_round_key(q, sk + 14 * 8);
+}
+
+/* Encrypts eight blocks of 4 words each in-place */
+static void aes_bs_encrypt_words(const aes_bs_key *key, uint32_t w[32])
+{
+    uint64_t qa[8], qb[8];
+    aes_bs_word q[8];
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        aes_bs_interleave_in(&qa[i], &qa[i + 4], w + i * 4);
+        aes_bs_interleave_in(&qb[i], &qb[i + 4], w + 16 + i * 4);
+    }
+    aes_bs_ortho(qa);
+    aes_bs_ortho(qb);
+#if defined(AES_BS_VECTOR)
+    for (i = 0; i < 8; ++i)
+        q[i] = (aes_bs_word){qa[i], qb[i]};
+    aes_bs_encrypt(key->sk, q);
+    for (i = 0; i < 8; ++i) {
+        qa[i] = q[i][0];
+        qb[i] = q[i][1];
+    }
+#else
+    memcpy(q, qa, sizeof(q));
+    aes_bs_encrypt(key->sk, q);
+    memcpy(qa, q, sizeof(q));
+    memcpy(q, qb, sizeof(q));
+    aes_bs_encrypt(key->sk, q);
+    memcpy(qb, q, sizeof(q));
+#endif
+    aes_bs_ortho(qa);
+    aes_bs_ortho(qb);
+    for (i = 0; i < 4; ++i) {
+        aes_bs_interleave_out(w + i * 4, qa[i], qa[i + 4]);
+        aes_bs_interleave_out(w + 16 + i * 4, qb[i], qb[i + 4]);
+    }
+    memset(qa, 0, sizeof(qa));
+    memset(qb, 0, sizeof(qb));
+    memset(q, 0, sizeof(q));
+}
+
+void aes_bs_encrypt_block(const aes_bs_key *key, const uint8_t in[16],
+                          uint8_t out[16])
+{
+    uint32_t w[32];
+    int i;
+    memset(w, 0, sizeof(w));
+    for (i = 0; i < 4; ++i)
+        w[i] = aes_bs_load32(in + i * 4);
+    aes_bs_encrypt_words(key, w);
+    for (i = 0; i < 4; ++i)
+        aes_bs_store32(out + i * 4, w[i]);
+    memset(w, 0, sizeof(w));
+}
+
+void aes_bs_ctr(const aes_bs_key *key, uint8_t counter[16],
+                uint8_t *data, size_t len)
+{
+    uint32_t iv[3];
+    uint32_t ctr;
+    uint32_t w[AES_BS_CTR_BLOCKS * 4];
+    uint8_t keystream[AES_BS_CTR_BLOCKS * 16];
+    size_t index, chunk;
+    int block;
+
+    iv[0] = aes_bs_load32(counter);
+    iv[1] = aes_bs_load32(counter + 4);
+    iv[2] = aes_bs_load32(counter + 8);
+    ctr = (((uint32_t)(counter[12])) << 24) |
+          (((uint32_t)(counter[13])) << 16) |
+          (((uint32_t)(counter[14])) << 8) |
+           ((uint32_t)(counter[15]));
+
+    while (len > 0) {
+        /* Set up the next counter blocks; the 32-bit counter is
+           big-endian within each block */
+        for (block = 0; block < AES_BS_CTR_BLOCKS; ++block) {
+            uint32_t c = ++ctr;
+            w[block * 4]     = iv[0];
+            w[block * 4 + 1] = iv[1];
+            w[block * 4 + 2] = iv[2];
+            w[block * 4 + 3] = (c >> 24) | ((c >> 8) & 0x0000FF00U) |
+                               ((c << 8) & 0x00FF0000U) | (c << 24);
+        }
+
+        aes_bs_encrypt_words(key, w);
+        for (index = 0; index < AES_BS_CTR_BLOCKS * 4; ++index)
+            aes_bs_store32(keystream + index * 4, w[index]);
+
+        /* XOR the keystream with the data */
+        chunk = sizeof(keystream);
+        if (chunk > len) {
+            /* Only count the blocks that were used */
+            chunk = len;
+            ctr -= AES_BS_CTR_BLOCKS - (uint32_t)((len + 15) / 16);
+        }
+        for (index = 0; index < chunk; ++index)
+            data[index] ^= keystream[index];
+        data += chunk;
+        len -= chunk;
+    }
+
+    counter[12] = (uint8_t)(ctr >> 24);
+    counter[13] = (uint8_t)(ctr >> 16);
+    counter[14] = (uint8_t)(ctr >> 8);
+    counter[15] = (uint8_t)ctr;
+    memset(w, 0, sizeof(w));
+    memset(keystream, 0, sizeof(keystream));
+}
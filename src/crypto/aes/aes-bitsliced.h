@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_AES_BITSLICED_h
+#define CRYPTO_AES_BITSLICED_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Number of counter blocks that are encrypted together in CTR mode */
+#define AES_BS_CTR_BLOCKS 8
+
+/* Bitsliced AES-256 key schedule: 8 words for each of the 15 round keys */
+typedef struct {
+    uint64_t sk[15 * 8];
+} aes_bs_key;
+
+void aes_bs_keysetup(aes_bs_key *key, const uint8_t k[32]);
+void aes_bs_encrypt_block(const aes_bs_key *key, const uint8_t in[16],
+                          uint8_t out[16]);
+void aes_bs_ctr(const aes_bs_key *key, uint8_t counter[16],
+                uint8_t *data, size_t len);
+
+#endif
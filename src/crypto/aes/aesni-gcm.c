@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "aesni-gcm.h"
+#include <string.h>
+
+#if defined(CPU_X86_DISPATCH)
+
+#include <immintrin.h>
+
+/* AES-GCM using the AES-NI and PCLMULQDQ instructions.
+
+   GHASH works on byte-reflected values so that the carry-less multiply
+   can be applied to the 128-bit field elements directly, following
+   Gueron and Kounavis, "Intel Carry-Less Multiplication Instruction
+   and its Usage for Computing the GCM Mode".  Full blocks are hashed
+   AESNI_GCM_AGGREGATE at a time: Y' = (Y + X1) * H^8 + X2 * H^7 + ...
+   + X8 * H, where the unreduced products are XOR'ed together and then
+   reduced modulo the GCM polynomial once per group.
+
+   All of the operations are free of secret-dependent table lookups and
+   branches. */
+
+#define AESNI_TARGET CPU_TARGET("aes,pclmul,ssse3")
+
+/* Reverse the bytes in a 128-bit value */
+#define BSWAP_MASK _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+
+/* Accumulate the unreduced product of "a" and "b" into lo, mid, and hi */
+#define CLMUL_ACCUM(a, b, lo, mid, hi) \
+    do { \
+        (lo) = _mm_xor_si128((lo), _mm_clmulepi64_si128((a), (b), 0x00)); \
+        (hi) = _mm_xor_si128((hi), _mm_clmulepi64_si128((a), (b), 0x11)); \
+        (mid) = _mm_xor_si128((mid), _mm_clmulepi64_si128((a), (b), 0x01)); \
+        (mid) = _mm_xor_si128((mid), _mm_clmulepi64_si128((a), (b), 0x10)); \
+    } while (0)
+
+/* Reduce an accumulated 256-bit product modulo x^128 + x^7 + x^2 + x + 1,
+   taking the bit reflection of the representation into account */
+AESNI_TARGET
+static inline __m128i aesni_gcm_reduce(__m128i lo, __m128i mid, __m128i hi)
+{
+    __m128i t1, t2, t3;
+
+    /* Fold the middle terms into the low and high halves */
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    /* Shift the 256-bit product left by 1 bit */
+    t1 = _mm_srli_epi32(lo, 31);
+    t2 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t3 = _mm_srli_si128(t1, 12);
+    t2 = _mm_slli_si128(t2, 4);
+    t1 = _mm_slli_si128(t1, 4);
+    lo = _mm_or_si128(lo, t1);
+    hi = _mm_or_si128(hi, t2);
+    hi = _mm_or_si128(hi, t3);
+
+    /* First phase of the reduction */
+    t1 = _mm_slli_epi32(lo, 31);
+    t2 = _mm_slli_epi32(lo, 30);
+    t3 = _mm_slli_epi32(lo, 25);
+    t1 = _mm_xor_si128(t1, t2);
+    t1 = _mm_xor_si128(t1, t3);
+    t2 = _mm_srli_si128(t1, 4);
+    t1 = _mm_slli_si128(t1, 12);
+    lo = _mm_xor_si128(lo, t1);
+
+    /* Second phase of the reduction */
+    t1 = _mm_srli_epi32(lo, 1);
+    t3 = _mm_srli_epi32(lo, 2);
+    t1 = _mm_xor_si128(t1, t3);
+    t3 = _mm_srli_epi32(lo, 7);
+    t1 = _mm_xor_si128(t1, t3);
+    t1 = _mm_xor_si128(t1, t2);
+    lo = _mm_xor_si128(lo, t1);
+    return _mm_xor_si128(hi, lo);
+}
+
+/* Multiply two byte-reflected field elements */
+AESNI_TARGET
+static inline __m128i aesni_gcm_mul(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_setzero_si128();
+    __m128i mid = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    CLMUL_ACCUM(a, b, lo, mid, hi);
+    return aesni_gcm_reduce(lo, mid, hi);
+}
+
+/* Encrypts a single block, for the hashing key and nonce */
+AESNI_TARGET
+void aesni_gcm_encrypt_block(const aesni_gcm_key *key, const uint8_t in[16],
+                             uint8_t out[16])
+{
+    __m128i b = _mm_loadu_si128((const __m128i *)in);
+    int round;
+    b = _mm_xor_si128(b, _mm_loadu_si128((const __m128i *)(key->rk[0])));
+    for (round = 1; round < 14; ++round)
+        b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)(key->rk[round])));
+    b = _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i *)(key->rk[14])));
+    _mm_storeu_si128((__m128i *)out, b);
+}
+
+/* AES-256 key expansion steps from Gueron, "Intel Advanced Encryption
+   Standard (AES) New Instructions Set" */
+AESNI_TARGET
+static inline __m128i aesni_key_assist_1(__m128i t1, __m128i t2)
+{
+    __m128i t4;
+    t2 = _mm_shuffle_epi32(t2, 0xff);
+    t4 = _mm_slli_si128(t1, 0x4);
+    t1 = _mm_xor_si128(t1, t4);
+    t4 = _mm_slli_si128(t4, 0x4);
+    t1 = _mm_xor_si128(t1, t4);
+    t4 = _mm_slli_si128(t4, 0x4);
+    t1 = _mm_xor_si128(t1, t4);
+    return _mm_xor_si128(t1, t2);
+}
+
+AESNI_TARGET
+static inline __m128i aesni_key_assist_2(__m128i t1, __m128i t3)
+{
+    __m128i t2, t4;
+    t4 = _mm_aeskeygenassist_si128(t1, 0x00);
+    t2 = _mm_shuffle_epi32(t4, 0xaa);
+    t4 = _mm_slli_si128(t3, 0x4);
+    t3 = _mm_xor_si128(t3, t4);
+    t4 = _mm_slli_si128(t4, 0x4);
+    t3 = _mm_xor_si128(t3, t4);
+    t4 = _mm_slli_si128(t4, 0x4);
+    t3 = _mm_xor_si128(t3, t4);
+    return _mm_xor_si128(t3, t2);
+}
+
+/* Two rounds of the key schedule with the round constant "rcon" */
+#define AESNI_KEY_ROUNDS(rk, index, t1, t3, rcon) \
+    do { \
+        (t1) = aesni_key_assist_1 \
+            ((t1), _mm_aeskeygenassist_si128((t3), (rcon))); \
+        _mm_storeu_si128((__m128i *)((rk)[(index)]), (t1)); \
+        if ((index) < 14) { \
+            (t3) = aesni_key_assist_2((t1), (t3)); \
+            _mm_storeu_si128((__m128i *)((rk)[(index) + 1]), (t3)); \
+        } \
+    } while (0)
+
+/* Expand an AES-256 key and precompute the powers of the hashing key */
+AESNI_TARGET
+void aesni_gcm_init(aesni_gcm_key *key, const uint8_t k[32])
+{
+    __m128i t1, t3, H, Hn;
+    uint8_t hkey[16];
+    int index;
+
+    t1 = _mm_loadu_si128((const __m128i *)k);
+    t3 = _mm_loadu_si128((const __m128i *)(k + 16));
+    _mm_storeu_si128((__m128i *)(key->rk[0]), t1);
+    _mm_storeu_si128((__m128i *)(key->rk[1]), t3);
+    AESNI_KEY_ROUNDS(key->rk, 2, t1, t3, 0x01);
+    AESNI_KEY_ROUNDS(key->rk, 4, t1, t3, 0x02);
+    AESNI_KEY_ROUNDS(key->rk, 6, t1, t3, 0x04);
+    AESNI_KEY_ROUNDS(key->rk, 8, t1, t3, 0x08);
+    AESNI_KEY_ROUNDS(key->rk, 10, t1, t3, 0x10);
+    AESNI_KEY_ROUNDS(key->rk, 12, t1, t3, 0x20);
+    AESNI_KEY_ROUNDS(key->rk, 14, t1, t3, 0x40);
+
+    /* The hashing key is the encryption of a block of zeroes */
+    memset(hkey, 0, sizeof(hkey));
+    aesni_gcm_encrypt_block(key, hkey, hkey);
+
+    /* H^1 to H^8 */
+    H = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)hkey), BSWAP_MASK);
+    Hn = H;
+    _mm_storeu_si128((__m128i *)(key->H[0]), Hn);
+    for (index = 1; index < AESNI_GCM_AGGREGATE; ++index) {
+        Hn = aesni_gcm_mul(Hn, H);
+        _mm_storeu_si128((__m128i *)(key->H[index]), Hn);
+    }
+    memset(hkey, 0, sizeof(hkey));
+}
+
+/* Encrypts or decrypts data in counter mode.  The 32-bit big-endian
+   counter in the last four bytes of "counter" is incremented before
+   each block is encrypted and the final value is written back */
+AESNI_TARGET
+void aesni_gcm_ctr(const aesni_gcm_key *key, uint8_t counter[16],
+                   uint8_t *data, size_t len)
+{
+    const __m128i bswap = BSWAP_MASK;
+    const __m128i one = _mm_setr_epi32(1, 0, 0, 0);
+    __m128i rk[15];
+    __m128i ctr, b[8];
+    uint8_t keystream[16];
+    int round, i;
+    size_t index;
+
+    for (round = 0; round < 15; ++round)
+        rk[round] = _mm_loadu_si128((const __m128i *)(key->rk[round]));
+
+    /* Byte-reflect the counter block so that the 32-bit counter is
+       in the lowest lane and can be incremented with a vector add */
+    ctr = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)counter), bswap);
+
+    while (len >= 128) {
+        for (i = 0; i < 8; ++i) {
+            ctr = _mm_add_epi32(ctr, one);
+            b[i] = _mm_xor_si128(_mm_shuffle_epi8(ctr, bswap), rk[0]);
+        }
+        for (round = 1; round < 14; ++round) {
+            for (i = 0; i < 8; ++i)
+                b[i] = _mm_aesenc_si128(b[i], rk[round]);
+        }
+        for (i = 0; i < 8; ++i) {
+            b[i] = _mm_aesenclast_si128(b[i], rk[14]);
+            b[i] = _mm_xor_si128
+                (b[i], _mm_loadu_si128((const __m128i *)(data + i * 16)));
+            _mm_storeu_si128((__m128i *)(data + i * 16), b[i]);
+        }
+        data += 128;
+        len -= 128;
+    }
+
+    while (len > 0) {
+        ctr = _mm_add_epi32(ctr, one);
+        b[0] = _mm_xor_si128(_mm_shuffle_epi8(ctr, bswap), rk[0]);
+        for (round = 1; round < 14; ++round)
+            b[0] = _mm_aesenc_si128(b[0], rk[round]);
+        b[0] = _mm_aesenclast_si128(b[0], rk[14]);
+        if (len >= 16) {
+            b[0] = _mm_xor_si128
+                (b[0], _mm_loadu_si128((const __m128i *)data));
+            _mm_storeu_si128((__m128i *)data, b[0]);
+            data += 16;
+            len -= 16;
+        } else {
+            _mm_storeu_si128((__m128i *)keystream, b[0]);
+            for (index = 0; index < len; ++index)
+                data[index] ^= keystream[index];
+            memset(keystream, 0, sizeof(keystream));
+            len = 0;
+        }
+    }
+
+    _mm_storeu_si128((__m128i *)counter, _mm_shuffle_epi8(ctr, bswap));
+}
+
+/* Adds data to the GHASH value "Y", which is in the normal GCM byte
+   order.  If the length is not a multiple of 16, the data is padded
+   with zeroes to the next block boundary */
+AESNI_TARGET
+void aesni_gcm_ghash(const aesni_gcm_key *key, uint8_t Y[16],
+                     const uint8_t *data, size_t len)
+{
+    const __m128i bswap = BSWAP_MASK;
+    __m128i H[AESNI_GCM_AGGREGATE];
+    __m128i y, x, lo, mid, hi;
+    uint8_t block[16];
+    int i;
+
+    for (i = 0; i < AESNI_GCM_AGGREGATE; ++i)
+        H[i] = _mm_loadu_si128((const __m128i *)(key->H[i]));
+    y = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)Y), bswap);
+
+    /* Aggregated reduction over groups of blocks */
+    while (len >= AESNI_GCM_AGGREGATE * 16) {
+        lo = _mm_setzero_si128();
+        mid = _mm_setzero_si128();
+        hi = _mm_setzero_si128();
+        x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), bswap);
+        x = _mm_xor_si128(x, y);
+        CLMUL_ACCUM(x, H[AESNI_GCM_AGGREGATE - 1], lo, mid, hi);
+        for (i = 1; i < AESNI_GCM_AGGREGATE; ++i) {
+            x = _mm_shuffle_epi8
+                (_mm_loadu_si128((const __m128i *)(data + i * 16)), bswap);
+            CLMUL_ACCUM(x, H[AESNI_GCM_AGGREGATE - 1 - i], lo, mid, hi);
+        }
+        y = aesni_gcm_reduce(lo, mid, hi);
+        data += AESNI_GCM_AGGREGATE * 16;
+        len -= AESNI_GCM_AGGREGATE * 16;
+    }
+
+    /* Left-over blocks, one at a time */
+    while (len >= 16) {
+        x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), bswap);
+        y = aesni_gcm_mul(_mm_xor_si128(y, x), H[0]);
+        data += 16;
+        len -= 16;
+    }
+    if (len > 0) {
+        memset(block, 0, sizeof(block));
+        memcpy(block, data, len);
+        x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)block), bswap);
+        y = aesni_gcm_mul(_mm_xor_si128(y, x), H[0]);
+    }
+
+    _mm_storeu_si128((__m128i *)Y, _mm_shuffle_epi8(y, bswap));
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_AESNI_GCM_h
+#define CRYPTO_AESNI_GCM_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../cpu/cpu.h"
+
+#if defined(CPU_X86_DISPATCH)
+
+/* Number of blocks that are hashed together before a single reduction */
+#define AESNI_GCM_AGGREGATE 8
+
+/* Expanded AES-256 key and GHASH key for the AES-NI/PCLMULQDQ
+   implementation of AES-GCM.  The round keys are in the byte order used
+   by the AES-NI instructions.  The powers of the hashing key H^1 to H^8
+   are stored byte-reflected, as used by the carry-less multiplications */
+typedef struct {
+    uint8_t rk[15][16];
+    uint8_t H[AESNI_GCM_AGGREGATE][16];
+} aesni_gcm_key;
+
+void aesni_gcm_init(aesni_gcm_key *key, const uint8_t k[32]);
+void aesni_gcm_encrypt_block(const aesni_gcm_key *key, const uint8_t in[16],
+                             uint8_t out[16]);
+void aesni_gcm_ctr(const aesni_gcm_key *key, uint8_t counter[16],
+                   uint8_t *data, size_t len);
+void aesni_gcm_ghash(const aesni_gcm_key *key, uint8_t Y[16],
+                     const uint8_t *data, size_t len);
+
+#endif
+
+#endif
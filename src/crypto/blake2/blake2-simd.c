@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "blake2s.h"
+#include "blake2b.h"
+
+#if defined(CPU_X86_DISPATCH)
+
+#include <immintrin.h>
+#include <string.h>
+
+/* BLAKE2 compression kernels for x86.
+
+   The single-stream kernels hold the 4x4 working state one row per
+   vector register and rotate the rows between the column and diagonal
+   steps.  The message words for each step are gathered from the sigma
+   permutation with lane inserts.
+
+   The multi-lane kernels compress one block for each of 4 or 8
+   independent hashes at once.  The state is transposed so that each
+   vector register holds the same word for every lane.  The chaining
+   values are stored transposed as h[word * lanes + lane], and each lane
+   has its own block pointer, byte counter "t" and finalization flag "f".
+   Since the lanes do not interact, the message permutation reduces to
+   indexing the transposed message words. */
+
+/* Message permutation for BLAKE2s, and for BLAKE2b modulo 10 rounds */
+static const uint8_t blake2_sigma[10][16] = {
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+    {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+    {11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+    { 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+    { 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+    { 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+    {12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+    {13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+    { 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+    {10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13 , 0}
+};
+
+/* Initialization vectors */
+static const uint32_t blake2s_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+static const uint64_t blake2b_iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+/* Generic G function on vector registers, with the arithmetic and
+   rotation operations supplied by the instruction set-specific code */
+#define BLAKE2_G(add, xor, rotr1, rotr2, rotr3, rotr4, a, b, c, d, m0, m1) \
+    do { \
+        (a) = add(add((a), (b)), (m0)); (d) = rotr1(xor((d), (a))); \
+        (c) = add((c), (d));             (b) = rotr2(xor((b), (c))); \
+        (a) = add(add((a), (b)), (m1)); (d) = rotr3(xor((d), (a))); \
+        (c) = add((c), (d));             (b) = rotr4(xor((b), (c))); \
+    } while (0)
+
+/* One round of the multi-lane kernels on the transposed state "v" */
+#define BLAKE2_LANES_ROUND(g, v, m, s) \
+    do { \
+        g(v[0], v[4], v[8],  v[12], m[s[0]],  m[s[1]]); \
+        g(v[1], v[5], v[9],  v[13], m[s[2]],  m[s[3]]); \
+        g(v[2], v[6], v[10], v[14], m[s[4]],  m[s[5]]); \
+        g(v[3], v[7], v[11], v[15], m[s[6]],  m[s[7]]); \
+        g(v[0], v[5], v[10], v[15], m[s[8]],  m[s[9]]); \
+        g(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]); \
+        g(v[2], v[7], v[8],  v[13], m[s[12]], m[s[13]]); \
+        g(v[3], v[4], v[9],  v[14], m[s[14]], m[s[15]]); \
+    } while (0)
+
+/* ------------------------ SSE4.1: BLAKE2s x 1, x 4 ----------------------- */
+
+#define SSE_ROTR(x, n) \
+    _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+#define SSE_ROTR16(x)   _mm_shuffle_epi8((x), rot16)
+#define SSE_ROTR12(x)   SSE_ROTR((x), 12)
+#define SSE_ROTR8(x)    _mm_shuffle_epi8((x), rot8)
+#define SSE_ROTR7(x)    SSE_ROTR((x), 7)
+#define SSE_G(a, b, c, d, m0, m1) \
+    BLAKE2_G(_mm_add_epi32, _mm_xor_si128, SSE_ROTR16, SSE_ROTR12, \
+             SSE_ROTR8, SSE_ROTR7, a, b, c, d, m0, m1)
+
+CPU_TARGET("sse4.1")
+void blake2s_compress_sse41(uint32_t *h, const uint8_t *block,
+                            uint64_t t, uint32_t f)
+{
+    const __m128i rot16 = _mm_setr_epi8
+        (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m128i rot8 = _mm_setr_epi8
+        (1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+    uint32_t m[16];
+    __m128i h0, h1, a, b, c, d;
+    const uint8_t *s;
+    int round;
+
+    memcpy(m, block, sizeof(m));
+    a = h0 = _mm_loadu_si128((const __m128i *)h);
+    b = h1 = _mm_loadu_si128((const __m128i *)(h + 4));
+    c = _mm_loadu_si128((const __m128i *)blake2s_iv);
+    d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(blake2s_iv + 4)),
+                      _mm_setr_epi32((int)(uint32_t)t, (int)(uint32_t)(t >> 32),
+                                     (int)f, 0));
+    for (round = 0; round < 10; ++round) {
+        s = blake2_sigma[round];
+
+        /* Column step */
+        SSE_G(a, b, c, d,
+              _mm_setr_epi32((int)m[s[0]], (int)m[s[2]],
+                             (int)m[s[4]], (int)m[s[6]]),
+              _mm_setr_epi32((int)m[s[1]], (int)m[s[3]],
+                             (int)m[s[5]], (int)m[s[7]]));
+
+        /* Rotate the rows so that the diagonals line up as columns */
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+        c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm_shuffle_epi32(d, _MM_SHUFFLE(2, 1, 0, 3));
+
+        /* Diagonal step */
+        SSE_G(a, b, c, d,
+              _mm_setr_epi32((int)m[s[8]],  (int)m[s[10]],
+                             (int)m[s[12]], (int)m[s[14]]),
+              _mm_setr_epi32((int)m[s[9]],  (int)m[s[11]],
+                             (int)m[s[13]], (int)m[s[15]]));
+
+        /* Rotate the rows back again */
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3));
+        c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm_shuffle_epi32(d, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+    _mm_storeu_si128((__m128i *)h, _mm_xor_si128(h0, _mm_xor_si128(a, c)));
+    _mm_storeu_si128((__m128i *)(h + 4),
+                     _mm_xor_si128(h1, _mm_xor_si128(b, d)));
+}
+
+CPU_TARGET("sse4.1")
+void blake2s_compress_x4_sse41(uint32_t *h, const uint8_t * const *blocks,
+                               const uint64_t *t, const uint32_t *f)
+{
+    const __m128i rot16 = _mm_setr_epi8
+        (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m128i rot8 = _mm_setr_epi8
+        (1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+    __m128i m[16];
+    __m128i v[16];
+    int index, round;
+
+    /* Transpose the message blocks, four words from each lane at a time */
+    for (index = 0; index < 16; index += 4) {
+        __m128i r0 = _mm_loadu_si128((const __m128i *)(blocks[0] + index * 4));
+        __m128i r1 = _mm_loadu_si128((const __m128i *)(blocks[1] + index * 4));
+        __m128i r2 = _mm_loadu_si128((const __m128i *)(blocks[2] + index * 4));
+        __m128i r3 = _mm_loadu_si128((const __m128i *)(blocks[3] + index * 4));
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        m[index]     = _mm_unpacklo_epi64(t0, t1);
+        m[index + 1] = _mm_unpackhi_epi64(t0, t1);
+        m[index + 2] = _mm_unpacklo_epi64(t2, t3);
+        m[index + 3] = _mm_unpackhi_epi64(t2, t3);
+    }
+
+    /* Format the working state */
+    for (index = 0; index < 8; ++index) {
+        v[index] = _mm_loadu_si128((const __m128i *)(h + index * 4));
+        v[index + 8] = _mm_set1_epi32((int)(blake2s_iv[index]));
+    }
+    v[12] = _mm_xor_si128(v[12], _mm_setr_epi32
+        ((int)(uint32_t)(t[0]), (int)(uint32_t)(t[1]),
+         (int)(uint32_t)(t[2]), (int)(uint32_t)(t[3])));
+    v[13] = _mm_xor_si128(v[13], _mm_setr_epi32
+        ((int)(uint32_t)(t[0] >> 32), (int)(uint32_t)(t[1] >> 32),
+         (int)(uint32_t)(t[2] >> 32), (int)(uint32_t)(t[3] >> 32)));
+    v[14] = _mm_xor_si128(v[14], _mm_loadu_si128((const __m128i *)f));
+
+    /* Perform the 10 BLAKE2s rounds */
+    for (round = 0; round < 10; ++round)
+        BLAKE2_LANES_ROUND(SSE_G, v, m, blake2_sigma[round]);
+
+    /* Combine the new and old hash values */
+    for (index = 0; index < 8; ++index) {
+        __m128i *hv = (__m128i *)(h + index * 4);
+        _mm_storeu_si128(hv, _mm_xor_si128
+            (_mm_loadu_si128(hv), _mm_xor_si128(v[index], v[index + 8])));
+    }
+}
+
+/* -------------------- AVX2: BLAKE2s x 8, BLAKE2b x 1, x 4 ---------------- */
+
+#define AVX2_ROTR32(x, n) \
+    _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define AVX2_ROTR32_16(x)   _mm256_shuffle_epi8((x), rot16)
+#define AVX2_ROTR32_12(x)   AVX2_ROTR32((x), 12)
+#define AVX2_ROTR32_8(x)    _mm256_shuffle_epi8((x), rot8)
+#define AVX2_ROTR32_7(x)    AVX2_ROTR32((x), 7)
+#define AVX2_G32(a, b, c, d, m0, m1) \
+    BLAKE2_G(_mm256_add_epi32, _mm256_xor_si256, AVX2_ROTR32_16, \
+             AVX2_ROTR32_12, AVX2_ROTR32_8, AVX2_ROTR32_7, \
+             a, b, c, d, m0, m1)
+
+#define AVX2_ROTR64_32(x)   _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define AVX2_ROTR64_24(x)   _mm256_shuffle_epi8((x), rot24)
+#define AVX2_ROTR64_16(x)   _mm256_shuffle_epi8((x), rot16)
+#define AVX2_ROTR64_63(x) \
+    _mm256_or_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+#define AVX2_G64(a, b, c, d, m0, m1) \
+    BLAKE2_G(_mm256_add_epi64, _mm256_xor_si256, AVX2_ROTR64_32, \
+             AVX2_ROTR64_24, AVX2_ROTR64_16, AVX2_ROTR64_63, \
+             a, b, c, d, m0, m1)
+
+CPU_TARGET("avx2")
+void blake2s_compress_x8_avx2(uint32_t *h, const uint8_t * const *blocks,
+                              const uint64_t *t, const uint32_t *f)
+{
+    const __m256i rot16 = _mm256_setr_epi8
+        (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+         2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8
+        (1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+         1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+    __m256i m[16];
+    __m256i v[16];
+    int index, round;
+
+    /* Transpose the message blocks, eight words from each lane at a time */
+    for (index = 0; index < 16; index += 8) {
+        __m256i r[8], t0, t1, t2, t3, u0, u1, u2, u3;
+        int lane;
+        for (lane = 0; lane < 8; ++lane) {
+            r[lane] = _mm256_loadu_si256
+                ((const __m256i *)(blocks[lane] + index * 4));
+        }
+        t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        u0 = _mm256_unpacklo_epi64(t0, t2);
+        u1 = _mm256_unpackhi_epi64(t0, t2);
+        u2 = _mm256_unpacklo_epi64(t1, t3);
+        u3 = _mm256_unpackhi_epi64(t1, t3);
+        t0 = _mm256_unpacklo_epi32(r[4], r[5]);
+        t1 = _mm256_unpackhi_epi32(r[4], r[5]);
+        t2 = _mm256_unpacklo_epi32(r[6], r[7]);
+        t3 = _mm256_unpackhi_epi32(r[6], r[7]);
+        r[4] = _mm256_unpacklo_epi64(t0, t2);
+        r[5] = _mm256_unpackhi_epi64(t0, t2);
+        r[6] = _mm256_unpacklo_epi64(t1, t3);
+        r[7] = _mm256_unpackhi_epi64(t1, t3);
+        m[index]     = _mm256_permute2x128_si256(u0, r[4], 0x20);
+        m[index + 1] = _mm256_permute2x128_si256(u1, r[5], 0x20);
+        m[index + 2] = _mm256_permute2x128_si256(u2, r[6], 0x20);
+        m[index + 3] = _mm256_permute2x128_si256(u3, r[7], 0x20);
+        m[index + 4] = _mm256_permute2x128_si256(u0, r[4], 0x31);
+        m[index + 5] = _mm256_permute2x128_si256(u1, r[5], 0x31);
+        m[index + 6] = _mm256_permute2x128_si256(u2, r[6], 0x31);
+        m[index + 7] = _mm256_permute2x128_si256(u3, r[7], 0x31);
+    }
+
+    /* Format the working state */
+    for (index = 0; index < 8; ++index) {
+        v[index] = _mm256_loadu_si256((const __m256i *)(h + index * 8));
+        v[index + 8] = _mm256_set1_epi32((int)(blake2s_iv[index]));
+    }
+    v[12] = _mm256_xor_si256(v[12], _mm256_setr_epi32
+        ((int)(uint32_t)(t[0]), (int)(uint32_t)(t[1]),
+         (int)(uint32_t)(t[2]), (int)(uint32_t)(t[3]),
+         (int)(uint32_t)(t[4]), (int)(uint32_t)(t[5]),
+         (int)(uint32_t)(t[6]), (int)(uint32_t)(t[7])));
+    v[13] = _mm256_xor_si256(v[13], _mm256_setr_epi32
+        ((int)(uint32_t)(t[0] >> 32), (int)(uint32_t)(t[1] >> 32),
+         (int)(uint32_t)(t[2] >> 32), (int)(uint32_t)(t[3] >> 32),
+         (int)(uint32_t)(t[4] >> 32), (int)(uint32_t)(t[5] >> 32),
+         (int)(uint32_t)(t[6] >> 32), (int)(uint32_t)(t[7] >> 32)));
+    v[14] = _mm256_xor_si256(v[14], _mm256_loadu_si256((const __m256i *)f));
+
+    /* Perform the 10 BLAKE2s rounds */
+    for (round = 0; round < 10; ++round)
+        BLAKE2_LANES_ROUND(AVX2_G32, v, m, blake2_sigma[round]);
+
+    /* Combine the new and old hash values */
+    for (index = 0; index < 8; ++index) {
+        __m256i *hv = (__m256i *)(h + index * 8);
+        _mm256_storeu_si256(hv, _mm256_xor_si256
+            (_mm256_loadu_si256(hv), _mm256_xor_si256(v[index], v[index + 8])));
+    }
+}
+
+CPU_TARGET("avx2")
+void blake2b_compress_avx2(uint64_t *h, const uint8_t *block,
+                           uint64_t t, uint64_t f)
+{
+    const __m256i rot24 = _mm256_setr_epi8
+        (3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+         3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i rot16 = _mm256_setr_epi8
+        (2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+         2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    uint64_t m[16];
+    __m256i h0, h1, a, b, c, d;
+    const uint8_t *s;
+    int round;
+
+    memcpy(m, block, sizeof(m));
+    a = h0 = _mm256_loadu_si256((const __m256i *)h);
+    b = h1 = _mm256_loadu_si256((const __m256i *)(h + 4));
+    c = _mm256_loadu_si256((const __m256i *)blake2b_iv);
+    d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(blake2b_iv + 4)),
+                         _mm256_setr_epi64x((long long)t, 0, (long long)f, 0));
+    for (round = 0; round < 12; ++round) {
+        s = blake2_sigma[round % 10];
+
+        /* Column step */
+        AVX2_G64(a, b, c, d,
+                 _mm256_setr_epi64x((long long)m[s[0]], (long long)m[s[2]],
+                                    (long long)m[s[4]], (long long)m[s[6]]),
+                 _mm256_setr_epi64x((long long)m[s[1]], (long long)m[s[3]],
+                                    (long long)m[s[5]], (long long)m[s[7]]));
+
+        /* Rotate the rows so that the diagonals line up as columns */
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+
+        /* Diagonal step */
+        AVX2_G64(a, b, c, d,
+                 _mm256_setr_epi64x((long long)m[s[8]],  (long long)m[s[10]],
+                                    (long long)m[s[12]], (long long)m[s[14]]),
+                 _mm256_setr_epi64x((long long)m[s[9]],  (long long)m[s[11]],
+                                    (long long)m[s[13]], (long long)m[s[15]]));
+
+        /* Rotate the rows back again */
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+    _mm256_storeu_si256((__m256i *)h,
+                        _mm256_xor_si256(h0, _mm256_xor_si256(a, c)));
+    _mm256_storeu_si256((__m256i *)(h + 4),
+                        _mm256_xor_si256(h1, _mm256_xor_si256(b, d)));
+}
+
+CPU_TARGET("avx2")
+void blake2b_compress_x4_avx2(uint64_t *h, const uint8_t * const *blocks,
+                              const uint64_t *t, const uint64_t *f)
+{
+    const __m256i rot24 = _mm256_setr_epi8
+        (3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+         3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+    const __m256i rot16 = _mm256_setr_epi8
+        (2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+         2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+    __m256i m[16];
+    __m256i v[16];
+    int index, round;
+
+    /* Transpose the message blocks, four words from each lane at a time */
+    for (index = 0; index < 16; index += 4) {
+        __m256i r0 = _mm256_loadu_si256((const __m256i *)(blocks[0] + index * 8));
+        __m256i r1 = _mm256_loadu_si256((const __m256i *)(blocks[1] + index * 8));
+        __m256i r2 = _mm256_loadu_si256((const __m256i *)(blocks[2] + index * 8));
+        __m256i r3 = _mm256_loadu_si256((const __m256i *)(blocks[3] + index * 8));
+        __m256i t0 = _mm256_unpacklo_epi64(r0, r1);
+        __m256i t1 = _mm256_unpackhi_epi64(r0, r1);
+        __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+        __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+        m[index]     = _mm256_permute2x128_si256(t0, t2, 0x20);
+        m[index + 1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+        m[index + 2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+        m[index + 3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+    }
+
+    /* Format the working state */
+    for (index = 0; index < 8; ++index) {
+        v[index] = _mm256_loadu_si256((const __m256i *)(h + index * 4));
+        v[index + 8] = _mm256_set1_epi64x((long long)(blake2b_iv[index]));
+    }
+    v[12] = _mm256_xor_si256(v[12], _mm256_loadu_si256((const __m256i *)t));
+    v[14] = _mm256_xor_si256(v[14], _mm256_loadu_si256((const __m256i *)f));
+
+    /* Perform the 12 BLAKE2b rounds */
+    for (round = 0; round < 12; ++round)
+        BLAKE2_LANES_ROUND(AVX2_G64, v, m, blake2_sigma[round % 10]);
+
+    /* Combine the new and old hash values */
+    for (index = 0; index < 8; ++index) {
+        __m256i *hv = (__m256i *)(h + index * 4);
+        _mm256_storeu_si256(hv, _mm256_xor_si256
+            (_mm256_loadu_si256(hv), _mm256_xor_si256(v[index], v[index + 8])));
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
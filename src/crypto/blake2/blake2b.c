@@ -89,6 +89,12 @@ static const uint8_t sigma[12][16] = {
 static void blake2b_transform
     (BLAKE2b_context_t *context, const uint8_t *data, uint64_t f0)
 {
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_AVX2)) {
+        blake2b_compress_avx2(context->h, data, context->length, f0);
+        return;
+    }
+#endif
     uint8_t index;
     uint64_t m[16];
     uint64_t v[16];
@@ -200,3 +206,131 @@ void BLAKE2b_finish(BLAKE2b_context_t *context, uint8_t *hash)
     }
 #endif
 }
+
+#if defined(CPU_X86_DISPATCH)
+
+/* Number of lanes in the multi-lane kernel */
+#define BLAKE2b_LANES 4
+
+/* Hash up to four inputs with the multi-lane kernel.  The lanes advance
+   through their inputs one block at a time in lockstep, and each lane's
+   counter and finalization flag are set individually so that inputs of
+   different lengths can share the kernel.  Unused lanes and lanes that
+   have already finished hash a block of zeroes, and their results are
+   discarded. */
+static void blake2b_hash_lanes
+    (const uint8_t * const *data, const size_t *sizes,
+     uint8_t * const *hashes, size_t count)
+{
+    static uint8_t const zero_block[128] = {0};
+    uint64_t h[8 * BLAKE2b_LANES];
+    uint64_t t[BLAKE2b_LANES];
+    uint64_t f[BLAKE2b_LANES];
+    const uint8_t *blocks[BLAKE2b_LANES];
+    uint8_t last[BLAKE2b_LANES][128];
+    size_t num_blocks[BLAKE2b_LANES];
+    size_t max_blocks = 0;
+    size_t lane, block, posn, len;
+    uint64_t word;
+
+    /* Initialize the chaining values for each lane */
+    for (lane = 0; lane < BLAKE2b_LANES; ++lane) {
+        h[lane]                     = BLAKE2b_IV0 ^ 0x01010040;
+        h[BLAKE2b_LANES + lane]     = BLAKE2b_IV1;
+        h[BLAKE2b_LANES * 2 + lane] = BLAKE2b_IV2;
+        h[BLAKE2b_LANES * 3 + lane] = BLAKE2b_IV3;
+        h[BLAKE2b_LANES * 4 + lane] = BLAKE2b_IV4;
+        h[BLAKE2b_LANES * 5 + lane] = BLAKE2b_IV5;
+        h[BLAKE2b_LANES * 6 + lane] = BLAKE2b_IV6;
+        h[BLAKE2b_LANES * 7 + lane] = BLAKE2b_IV7;
+        if (lane < count) {
+            /* An empty input is hashed as a single block of padding */
+            num_blocks[lane] = sizes[lane] ? (sizes[lane] + 127) / 128 : 1;
+            if (num_blocks[lane] > max_blocks)
+                max_blocks = num_blocks[lane];
+        } else {
+            num_blocks[lane] = 0;
+        }
+    }
+
+    /* Compress the blocks for all lanes in lockstep */
+    for (block = 0; block < max_blocks; ++block) {
+        for (lane = 0; lane < BLAKE2b_LANES; ++lane) {
+            posn = block * 128;
+            if (block >= num_blocks[lane]) {
+                blocks[lane] = zero_block;
+                t[lane] = 0;
+                f[lane] = 0;
+            } else if ((block + 1) < num_blocks[lane]) {
+                blocks[lane] = data[lane] + posn;
+                t[lane] = posn + 128;
+                f[lane] = 0;
+            } else {
+                /* Last block for this lane, padded with zeroes */
+                len = sizes[lane] - posn;
+                if (len == 128) {
+                    blocks[lane] = data[lane] + posn;
+                } else {
+                    if (len)
+                        memcpy(last[lane], data[lane] + posn, len);
+                    memset(last[lane] + len, 0, 128 - len);
+                    blocks[lane] = last[lane];
+                }
+                t[lane] = sizes[lane];
+                f[lane] = 0xFFFFFFFFFFFFFFFFULL;
+            }
+        }
+        blake2b_compress_x4_avx2(h, blocks, t, f);
+
+        /* Copy out the hash values for the lanes that just finished */
+        for (lane = 0; lane < count; ++lane) {
+            if ((block + 1) != num_blocks[lane])
+                continue;
+            for (posn = 0; posn < 8; ++posn) {
+                word = h[posn * BLAKE2b_LANES + lane];
+                memcpy(hashes[lane] + posn * 8, &word, 8);
+            }
+        }
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
+
+/* Hash "count" independent inputs, writing the 64-byte hash values to
+   the buffers in "hashes".  The inputs are hashed four at a time with
+   the multi-lane kernel where the CPU supports it.  This works best
+   when the inputs are of similar lengths, as the lanes advance through
+   their inputs in lockstep. */
+void BLAKE2b_hash_many(const uint8_t * const *data, const size_t *sizes,
+                       uint8_t * const *hashes, size_t count)
+{
+    BLAKE2b_context_t context;
+    size_t index;
+#if defined(CPU_X86_DISPATCH)
+    size_t lanes;
+    while (count >= 2 && cpu_has_features(CPU_FEATURE_AVX2)) {
+        lanes = count < BLAKE2b_LANES ? count : BLAKE2b_LANES;
+        blake2b_hash_lanes(data, sizes, hashes, lanes);
+        data += lanes;
+        sizes += lanes;
+        hashes += lanes;
+        count -= lanes;
+    }
+#endif
+    for (index = 0; index < count; ++index) {
+        BLAKE2b_reset(&context);
+        BLAKE2b_update(&context, data[index], sizes[index]);
+        BLAKE2b_finish(&context, hashes[index]);
+    }
+}
+
+/* Get the number of inputs that BLAKE2b_hash_many() hashes in parallel
+   with the current CPU features, or 1 if it hashes them one at a time */
+size_t BLAKE2b_hash_many_lanes(void)
+{
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_AVX2))
+        return BLAKE2b_LANES;
+#endif
+    return 1;
+}
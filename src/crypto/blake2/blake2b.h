@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../cpu/cpu.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,17 @@ typedef struct
 void BLAKE2b_reset(BLAKE2b_context_t *context);
 void BLAKE2b_update(BLAKE2b_context_t *context, const void *data, size_t size);
 void BLAKE2b_finish(BLAKE2b_context_t *context, uint8_t *hash);
+void BLAKE2b_hash_many(const uint8_t * const *data, const size_t *sizes,
+                       uint8_t * const *hashes, size_t count);
+size_t BLAKE2b_hash_many_lanes(void);
+
+#if defined(CPU_X86_DISPATCH)
+/* Compression kernels, selected at runtime; see blake2-simd.c */
+void blake2b_compress_avx2(uint64_t *h, const uint8_t *block,
+                           uint64_t t, uint64_t f);
+void blake2b_compress_x4_avx2(uint64_t *h, const uint8_t * const *blocks,
+                              const uint64_t *t, const uint64_t *f);
+#endif
 
 #ifdef __cplusplus
 };
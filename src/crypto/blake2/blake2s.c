@@ -116,6 +116,13 @@ static const uint8_t sigma[10][16] = {
 static void blake2s_transform
     (BLAKE2s_context_t *context, const uint8_t *data, uint32_t f0)
 {
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_SSE41)) {
+        blake2s_compress_sse41
+            ((uint32_t *)(context->h), data, context->length, f0);
+        return;
+    }
+#endif
 #if BLAKE2S_USE_VECTOR_MATH
     /* Assumption: CPU is little-endian and supports unaligned 32-bit loads */
     uint8_t index;
@@ -264,3 +271,145 @@ void BLAKE2s_finish(BLAKE2s_context_t *context, uint8_t *hash)
     }
 #endif
 }
+
+#if defined(CPU_X86_DISPATCH)
+
+/* Maximum number of lanes in the multi-lane kernels */
+#define BLAKE2s_MAX_LANES 8
+
+/* Hash "count" inputs with a multi-lane kernel that is "lanes" wide.
+   The lanes advance through their inputs one block at a time in lockstep,
+   and each lane's counter and finalization flag are set individually so
+   that inputs of different lengths can share the kernel.  Unused lanes
+   and lanes that have already finished hash a block of zeroes, and their
+   results are discarded. */
+static void blake2s_hash_lanes
+    (const uint8_t * const *data, const size_t *sizes,
+     uint8_t * const *hashes, size_t count, size_t lanes)
+{
+    static uint8_t const zero_block[64] = {0};
+    uint32_t h[8 * BLAKE2s_MAX_LANES];
+    uint64_t t[BLAKE2s_MAX_LANES];
+    uint32_t f[BLAKE2s_MAX_LANES];
+    const uint8_t *blocks[BLAKE2s_MAX_LANES];
+    uint8_t last[BLAKE2s_MAX_LANES][64];
+    size_t num_blocks[BLAKE2s_MAX_LANES];
+    size_t max_blocks = 0;
+    size_t lane, block, posn, len;
+    uint32_t word;
+
+    /* Initialize the chaining values for each lane */
+    for (lane = 0; lane < lanes; ++lane) {
+        h[lane]             = BLAKE2s_IV0 ^ 0x01010020;
+        h[lanes + lane]     = BLAKE2s_IV1;
+        h[lanes * 2 + lane] = BLAKE2s_IV2;
+        h[lanes * 3 + lane] = BLAKE2s_IV3;
+        h[lanes * 4 + lane] = BLAKE2s_IV4;
+        h[lanes * 5 + lane] = BLAKE2s_IV5;
+        h[lanes * 6 + lane] = BLAKE2s_IV6;
+        h[lanes * 7 + lane] = BLAKE2s_IV7;
+        if (lane < count) {
+            /* An empty input is hashed as a single block of padding */
+            num_blocks[lane] = sizes[lane] ? (sizes[lane] + 63) / 64 : 1;
+            if (num_blocks[lane] > max_blocks)
+                max_blocks = num_blocks[lane];
+        } else {
+            num_blocks[lane] = 0;
+        }
+    }
+
+    /* Compress the blocks for all lanes in lockstep */
+    for (block = 0; block < max_blocks; ++block) {
+        for (lane = 0; lane < lanes; ++lane) {
+            posn = block * 64;
+            if (block >= num_blocks[lane]) {
+                blocks[lane] = zero_block;
+                t[lane] = 0;
+                f[lane] = 0;
+            } else if ((block + 1) < num_blocks[lane]) {
+                blocks[lane] = data[lane] + posn;
+                t[lane] = posn + 64;
+                f[lane] = 0;
+            } else {
+                /* Last block for this lane, padded with zeroes */
+                len = sizes[lane] - posn;
+                if (len == 64) {
+                    blocks[lane] = data[lane] + posn;
+                } else {
+                    if (len)
+                        memcpy(last[lane], data[lane] + posn, len);
+                    memset(last[lane] + len, 0, 64 - len);
+                    blocks[lane] = last[lane];
+                }
+                t[lane] = sizes[lane];
+                f[lane] = 0xFFFFFFFF;
+            }
+        }
+        if (lanes == 8)
+            blake2s_compress_x8_avx2(h, blocks, t, f);
+        else
+            blake2s_compress_x4_sse41(h, blocks, t, f);
+
+        /* Copy out the hash values for the lanes that just finished */
+        for (lane = 0; lane < count; ++lane) {
+            if ((block + 1) != num_blocks[lane])
+                continue;
+            for (posn = 0; posn < 8; ++posn) {
+                word = h[posn * lanes + lane];
+                memcpy(hashes[lane] + posn * 4, &word, 4);
+            }
+        }
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
+
+/* Hash "count" independent inputs, writing the 32-byte hash values to
+   the buffers in "hashes".  The inputs are hashed several at a time with
+   the multi-lane kernels where the CPU supports them.  This works best
+   when the inputs are of similar lengths, as the lanes advance through
+   their inputs in lockstep. */
+void BLAKE2s_hash_many(const uint8_t * const *data, const size_t *sizes,
+                       uint8_t * const *hashes, size_t count)
+{
+    BLAKE2s_context_t context;
+    size_t index;
+#if defined(CPU_X86_DISPATCH)
+    size_t lanes;
+    while (count >= 2) {
+        if (count > 4 && cpu_has_features(CPU_FEATURE_AVX2))
+            lanes = 8;
+        else if (cpu_has_features(CPU_FEATURE_SSE41))
+            lanes = 4;
+        else
+            break;
+        if (lanes > count) {
+            blake2s_hash_lanes(data, sizes, hashes, count, lanes);
+            return;
+        }
+        blake2s_hash_lanes(data, sizes, hashes, lanes, lanes);
+        data += lanes;
+        sizes += lanes;
+        hashes += lanes;
+        count -= lanes;
+    }
+#endif
+    for (index = 0; index < count; ++index) {
+        BLAKE2s_reset(&context);
+        BLAKE2s_update(&context, data[index], sizes[index]);
+        BLAKE2s_finish(&context, hashes[index]);
+    }
+}
+
+/* Get the number of inputs that BLAKE2s_hash_many() hashes in parallel
+   with the current CPU features, or 1 if it hashes them one at a time */
+size_t BLAKE2s_hash_many_lanes(void)
+{
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_AVX2))
+        return 8;
+    if (cpu_has_features(CPU_FEATURE_SSE41))
+        return 4;
+#endif
+    return 1;
+}
@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../cpu/cpu.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -57,6 +58,19 @@ typedef struct
 void BLAKE2s_reset(BLAKE2s_context_t *context);
 void BLAKE2s_update(BLAKE2s_context_t *context, const void *data, size_t size);
 void BLAKE2s_finish(BLAKE2s_context_t *context, uint8_t *hash);
+void BLAKE2s_hash_many(const uint8_t * const *data, const size_t *sizes,
+                       uint8_t * const *hashes, size_t count);
+size_t BLAKE2s_hash_many_lanes(void);
+
+#if defined(CPU_X86_DISPATCH)
+/* Compression kernels, selected at runtime; see blake2-simd.c */
+void blake2s_compress_sse41(uint32_t *h, const uint8_t *block,
+                            uint64_t t, uint32_t f);
+void blake2s_compress_x4_sse41(uint32_t *h, const uint8_t * const *blocks,
+                               const uint64_t *t, const uint32_t *f);
+void blake2s_compress_x8_avx2(uint32_t *h, const uint8_t * const *blocks,
+                              const uint64_t *t, const uint32_t *f);
+#endif
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "chacha.h"
+
+#if defined(CPU_X86_DISPATCH)
+
+#include <immintrin.h>
+
+/* Multi-block ChaCha20 kernels for x86.  The state is transposed so that
+   each vector register holds the same word of the state for 4, 8, or 16
+   consecutive blocks, with one block per 32-bit lane.  The words at
+   "pos" and "pos + 1" form a 64-bit little-endian counter that is
+   incremented from one block to the next: words 12-13 for the block
+   counter, or words 14-15 when generating blocks for consecutive IV's.
+
+   The keystream is XOR'ed with "m" to produce "c", which may overlap
+   exactly for in-place encryption.  The number of blocks must be a
+   multiple of the kernel's width.  The caller's input words are not
+   modified; the caller advances the counter afterwards. */
+
+/* Load the 4/8/16 lane values for the counter words */
+#define CHACHA_LANE_LO(ctr, i)  ((int)(uint32_t)((ctr) + (i)))
+#define CHACHA_LANE_HI(ctr, i)  ((int)(uint32_t)(((ctr) + (i)) >> 32))
+
+/* Generic quarter round on vector registers, with the rotation
+   operations supplied by the instruction set-specific code */
+#define CHACHA_QR(add, xor, rotl16, rotl12, rotl8, rotl7, a, b, c, d) \
+    do { \
+        (a) = add((a), (b)); (d) = xor((d), (a)); (d) = rotl16(d); \
+        (c) = add((c), (d)); (b) = xor((b), (c)); (b) = rotl12(b); \
+        (a) = add((a), (b)); (d) = xor((d), (a)); (d) = rotl8(d); \
+        (c) = add((c), (d)); (b) = xor((b), (c)); (b) = rotl7(b); \
+    } while (0)
+
+#define CHACHA_DOUBLE_ROUND(qr, s) \
+    do { \
+        qr(s[0], s[4], s[8],  s[12]); \
+        qr(s[1], s[5], s[9],  s[13]); \
+        qr(s[2], s[6], s[10], s[14]); \
+        qr(s[3], s[7], s[11], s[15]); \
+        qr(s[0], s[5], s[10], s[15]); \
+        qr(s[1], s[6], s[11], s[12]); \
+        qr(s[2], s[7], s[8],  s[13]); \
+        qr(s[3], s[4], s[9],  s[14]); \
+    } while (0)
+
+/* ---------------------------- SSSE3: 4 blocks --------------------------- */
+
+#define SSE_ROTL(x, n) \
+    _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+#define SSE_ROTL16(x)   _mm_shuffle_epi8((x), rot16)
+#define SSE_ROTL12(x)   SSE_ROTL((x), 12)
+#define SSE_ROTL8(x)    _mm_shuffle_epi8((x), rot8)
+#define SSE_ROTL7(x)    SSE_ROTL((x), 7)
+#define SSE_QR(a, b, c, d) \
+    CHACHA_QR(_mm_add_epi32, _mm_xor_si128, SSE_ROTL16, SSE_ROTL12, \
+              SSE_ROTL8, SSE_ROTL7, a, b, c, d)
+
+CPU_TARGET("ssse3")
+void chacha_blocks_ssse3(const uint32_t input[16], int pos,
+                         const uint8_t *m, uint8_t *c, size_t blocks)
+{
+    const __m128i rot16 = _mm_setr_epi8
+        (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m128i rot8 = _mm_setr_epi8
+        (3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    uint64_t ctr = input[pos] | (((uint64_t)(input[pos + 1])) << 32);
+    __m128i in[16];
+    __m128i s[16];
+    int index, group;
+
+    for (index = 0; index < 16; ++index)
+        in[index] = _mm_set1_epi32((int)(input[index]));
+    while (blocks >= 4) {
+        in[pos] = _mm_setr_epi32
+            (CHACHA_LANE_LO(ctr, 0), CHACHA_LANE_LO(ctr, 1),
+             CHACHA_LANE_LO(ctr, 2), CHACHA_LANE_LO(ctr, 3));
+        in[pos + 1] = _mm_setr_epi32
+            (CHACHA_LANE_HI(ctr, 0), CHACHA_LANE_HI(ctr, 1),
+             CHACHA_LANE_HI(ctr, 2), CHACHA_LANE_HI(ctr, 3));
+        for (index = 0; index < 16; ++index)
+            s[index] = in[index];
+        for (index = 0; index < 10; ++index)
+            CHACHA_DOUBLE_ROUND(SSE_QR, s);
+        for (index = 0; index < 16; ++index)
+            s[index] = _mm_add_epi32(s[index], in[index]);
+
+        /* Transpose each group of four words back into block order */
+        for (group = 0; group < 4; ++group) {
+            __m128i t0 = _mm_unpacklo_epi32(s[group * 4], s[group * 4 + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(s[group * 4 + 2], s[group * 4 + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(s[group * 4], s[group * 4 + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(s[group * 4 + 2], s[group * 4 + 3]);
+            __m128i r[4];
+            int block;
+            r[0] = _mm_unpacklo_epi64(t0, t1);
+            r[1] = _mm_unpackhi_epi64(t0, t1);
+            r[2] = _mm_unpacklo_epi64(t2, t3);
+            r[3] = _mm_unpackhi_epi64(t2, t3);
+            for (block = 0; block < 4; ++block) {
+                size_t offset = block * 64 + group * 16;
+                __m128i v = _mm_loadu_si128((const __m128i *)(m + offset));
+                _mm_storeu_si128((__m128i *)(c + offset),
+                                 _mm_xor_si128(v, r[block]));
+            }
+        }
+        ctr += 4;
+        m += 256;
+        c += 256;
+        blocks -= 4;
+    }
+}
+
+/* ---------------------------- AVX2: 8 blocks ---------------------------- */
+
+#define AVX2_ROTL(x, n) \
+    _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+#define AVX2_ROTL16(x)  _mm256_shuffle_epi8((x), rot16)
+#define AVX2_ROTL12(x)  AVX2_ROTL((x), 12)
+#define AVX2_ROTL8(x)   _mm256_shuffle_epi8((x), rot8)
+#define AVX2_ROTL7(x)   AVX2_ROTL((x), 7)
+#define AVX2_QR(a, b, c, d) \
+    CHACHA_QR(_mm256_add_epi32, _mm256_xor_si256, AVX2_ROTL16, AVX2_ROTL12, \
+              AVX2_ROTL8, AVX2_ROTL7, a, b, c, d)
+
+CPU_TARGET("avx2")
+void chacha_blocks_avx2(const uint32_t input[16], int pos,
+                        const uint8_t *m, uint8_t *c, size_t blocks)
+{
+    const __m256i rot16 = _mm256_setr_epi8
+        (2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+         2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8
+        (3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+         3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    uint64_t ctr = input[pos] | (((uint64_t)(input[pos + 1])) << 32);
+    __m256i in[16];
+    __m256i s[16];
+    __m256i r[4][4];
+    int index, group, block;
+
+    for (index = 0; index < 16; ++index)
+        in[index] = _mm256_set1_epi32((int)(input[index]));
+    while (blocks >= 8) {
+        in[pos] = _mm256_setr_epi32
+            (CHACHA_LANE_LO(ctr, 0), CHACHA_LANE_LO(ctr, 1),
+             CHACHA_LANE_LO(ctr, 2), CHACHA_LANE_LO(ctr, 3),
+             CHACHA_LANE_LO(ctr, 4), CHACHA_LANE_LO(ctr, 5),
+             CHACHA_LANE_LO(ctr, 6), CHACHA_LANE_LO(ctr, 7));
+        in[pos + 1] = _mm256_setr_epi32
+            (CHACHA_LANE_HI(ctr, 0), CHACHA_LANE_HI(ctr, 1),
+             CHACHA_LANE_HI(ctr, 2), CHACHA_LANE_HI(ctr, 3),
+             CHACHA_LANE_HI(ctr, 4), CHACHA_LANE_HI(ctr, 5),
+             CHACHA_LANE_HI(ctr, 6), CHACHA_LANE_HI(ctr, 7));
+        for (index = 0; index < 16; ++index)
+            s[index] = in[index];
+        for (index = 0; index < 10; ++index)
+            CHACHA_DOUBLE_ROUND(AVX2_QR, s);
+        for (index = 0; index < 16; ++index)
+            s[index] = _mm256_add_epi32(s[index], in[index]);
+
+        /* Transpose within each 128-bit half: r[group][block] holds
+           words 4 * group .. 4 * group + 3 of "block" in the low half
+           and of "block + 4" in the high half */
+        for (group = 0; group < 4; ++group) {
+            __m256i t0 = _mm256_unpacklo_epi32(s[group * 4], s[group * 4 + 1]);
+            __m256i t1 = _mm256_unpacklo_epi32(s[group * 4 + 2], s[group * 4 + 3]);
+            __m256i t2 = _mm256_unpackhi_epi32(s[group * 4], s[group * 4 + 1]);
+            __m256i t3 = _mm256_unpackhi_epi32(s[group * 4 + 2], s[group * 4 + 3]);
+            r[group][0] = _mm256_unpacklo_epi64(t0, t1);
+            r[group][1] = _mm256_unpackhi_epi64(t0, t1);
+            r[group][2] = _mm256_unpacklo_epi64(t2, t3);
+            r[group][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+
+        /* Combine the halves to form 32 bytes of output at a time */
+        for (block = 0; block < 4; ++block) {
+            for (group = 0; group < 4; group += 2) {
+                __m256i lo = _mm256_permute2x128_si256
+                    (r[group][block], r[group + 1][block], 0x20);
+                __m256i hi = _mm256_permute2x128_si256
+                    (r[group][block], r[group + 1][block], 0x31);
+                size_t offset = block * 64 + group * 16;
+                __m256i v = _mm256_loadu_si256((const __m256i *)(m + offset));
+                _mm256_storeu_si256((__m256i *)(c + offset),
+                                    _mm256_xor_si256(v, lo));
+                offset += 4 * 64;
+                v = _mm256_loadu_si256((const __m256i *)(m + offset));
+                _mm256_storeu_si256((__m256i *)(c + offset),
+                                    _mm256_xor_si256(v, hi));
+            }
+        }
+        ctr += 8;
+        m += 512;
+        c += 512;
+        blocks -= 8;
+    }
+}
+
+/* -------------------------- AVX-512: 16 blocks -------------------------- */
+
+#define AVX512_ROTL16(x)    _mm512_rol_epi32((x), 16)
+#define AVX512_ROTL12(x)    _mm512_rol_epi32((x), 12)
+#define AVX512_ROTL8(x)     _mm512_rol_epi32((x), 8)
+#define AVX512_ROTL7(x)     _mm512_rol_epi32((x), 7)
+#define AVX512_QR(a, b, c, d) \
+    CHACHA_QR(_mm512_add_epi32, _mm512_xor_si512, AVX512_ROTL16, \
+              AVX512_ROTL12, AVX512_ROTL8, AVX512_ROTL7, a, b, c, d)
+
+CPU_TARGET("avx512f")
+void chacha_blocks_avx512(const uint32_t input[16], int pos,
+                          const uint8_t *m, uint8_t *c, size_t blocks)
+{
+    const __m512i lanes = _mm512_setr_epi32
+        (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    uint64_t ctr = input[pos] | (((uint64_t)(input[pos + 1])) << 32);
+    __m512i in[16];
+    __m512i s[16];
+    __m512i r[4][4];
+    int index, group, block;
+
+    for (index = 0; index < 16; ++index)
+        in[index] = _mm512_set1_epi32((int)(input[index]));
+    while (blocks >= 16) {
+        /* Carry into the high word for the lanes that wrap around */
+        __m512i lo = _mm512_add_epi32(_mm512_set1_epi32((int)(uint32_t)ctr), lanes);
+        __mmask16 carry = _mm512_cmplt_epu32_mask
+            (lo, _mm512_set1_epi32((int)(uint32_t)ctr));
+        in[pos] = lo;
+        in[pos + 1] = _mm512_mask_add_epi32
+            (_mm512_set1_epi32((int)(uint32_t)(ctr >> 32)), carry,
+             _mm512_set1_epi32((int)(uint32_t)(ctr >> 32)),
+             _mm512_set1_epi32(1));
+        for (index = 0; index < 16; ++index)
+            s[index] = in[index];
+        for (index = 0; index < 10; ++index)
+            CHACHA_DOUBLE_ROUND(AVX512_QR, s);
+        for (index = 0; index < 16; ++index)
+            s[index] = _mm512_add_epi32(s[index], in[index]);
+
+        /* Transpose within each 128-bit lane: r[group][block] holds
+           words 4 * group .. 4 * group + 3 of block "4 * L + block"
+           in 128-bit lane L */
+        for (group = 0; group < 4; ++group) {
+            __m512i t0 = _mm512_unpacklo_epi32(s[group * 4], s[group * 4 + 1]);
+            __m512i t1 = _mm512_unpacklo_epi32(s[group * 4 + 2], s[group * 4 + 3]);
+            __m512i t2 = _mm512_unpackhi_epi32(s[group * 4], s[group * 4 + 1]);
+            __m512i t3 = _mm512_unpackhi_epi32(s[group * 4 + 2], s[group * 4 + 3]);
+            r[group][0] = _mm512_unpacklo_epi64(t0, t1);
+            r[group][1] = _mm512_unpackhi_epi64(t0, t1);
+            r[group][2] = _mm512_unpacklo_epi64(t2, t3);
+            r[group][3] = _mm512_unpackhi_epi64(t2, t3);
+        }
+
+        /* Transpose the 128-bit lanes to gather whole blocks */
+        for (block = 0; block < 4; ++block) {
+            __m512i x0 = _mm512_shuffle_i32x4(r[0][block], r[1][block], 0x44);
+            __m512i x1 = _mm512_shuffle_i32x4(r[0][block], r[1][block], 0xEE);
+            __m512i y0 = _mm512_shuffle_i32x4(r[2][block], r[3][block], 0x44);
+            __m512i y1 = _mm512_shuffle_i32x4(r[2][block], r[3][block], 0xEE);
+            __m512i z[4];
+            int lane;
+            z[0] = _mm512_shuffle_i32x4(x0, y0, 0x88);
+            z[1] = _mm512_shuffle_i32x4(x0, y0, 0xDD);
+            z[2] = _mm512_shuffle_i32x4(x1, y1, 0x88);
+            z[3] = _mm512_shuffle_i32x4(x1, y1, 0xDD);
+            for (lane = 0; lane < 4; ++lane) {
+                size_t offset = (lane * 4 + block) * 64;
+                __m512i v = _mm512_loadu_si512((const void *)(m + offset));
+                _mm512_storeu_si512((void *)(c + offset),
+                                    _mm512_xor_si512(v, z[lane]));
+            }
+        }
+        ctr += 16;
+        m += 1024;
+        c += 1024;
+        blocks -= 16;
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
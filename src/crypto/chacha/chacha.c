@@ -132,6 +132,64 @@ void chacha_ivsetup(chacha_ctx *x, const uint8_t *iv, const uint8_t *counter)
 #endif
 }
 
+#if defined(CPU_X86_DISPATCH)
+
+/* Add "n" to the 64-bit counter formed by the words at "pos" */
+static void chacha_add_counter(uint32_t *words, int pos, uint32_t n)
+{
+    uint64_t ctr = words[pos] | (((uint64_t)(words[pos + 1])) << 32);
+    ctr += n;
+    words[pos] = (uint32_t)ctr;
+    words[pos + 1] = (uint32_t)(ctr >> 32);
+}
+
+/* Process as many whole blocks as possible with the widest multi-block
+   kernels that the CPU supports.  "words" is the 16-word state, and the
+   64-bit counter at "pos" is advanced past the blocks that were
+   processed.  Returns the number of blocks that were processed. */
+static uint32_t chacha_simd_blocks(uint32_t *words, int pos, const uint8_t *m, uint8_t *c, uint32_t blocks)
+{
+    uint32_t done = 0;
+    uint32_t n;
+    if (blocks >= 16 && cpu_has_features(CPU_FEATURE_AVX512)) {
+        n = blocks & ~15U;
+        chacha_blocks_avx512(words, pos, m, c, n);
+        chacha_add_counter(words, pos, n);
+        done += n;
+    }
+    if ((blocks - done) >= 8 && cpu_has_features(CPU_FEATURE_AVX2)) {
+        n = (blocks - done) & ~7U;
+        chacha_blocks_avx2(words, pos, m + done * 64, c + done * 64, n);
+        chacha_add_counter(words, pos, n);
+        done += n;
+    }
+    if ((blocks - done) >= 4 && cpu_has_features(CPU_FEATURE_SSSE3)) {
+        n = (blocks - done) & ~3U;
+        chacha_blocks_ssse3(words, pos, m + done * 64, c + done * 64, n);
+        chacha_add_counter(words, pos, n);
+        done += n;
+    }
+    return done;
+}
+
+/* Encrypt the leading whole blocks with a multi-block kernel and
+   adjust the pointers and length for the remaining data */
+static void chacha_encrypt_simd(chacha_ctx *x, const uint8_t **m, uint8_t **c, uint32_t *bytes)
+{
+    uint32_t words[16];
+    uint32_t done;
+    memcpy(words, x->input, sizeof(words));
+    done = chacha_simd_blocks(words, 12, *m, *c, *bytes / 64);
+    if (done) {
+        memcpy(x->input, words, sizeof(words));
+        *m += done * 64;
+        *c += done * 64;
+        *bytes -= done * 64;
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
+
 #ifdef USE_VECTOR_MATH
 
 #define shuffleLeft1(x) (VectorUInt32){(x)[1], (x)[2], (x)[3], (x)[0]}
@@ -145,6 +203,11 @@ void chacha_encrypt_bytes(chacha_ctx *x, const uint8_t *m, uint8_t *c, uint32_t
     uint8_t temp[64];
     uint8_t *t;
 
+#if defined(CPU_X86_DISPATCH)
+    if (bytes >= 256)
+        chacha_encrypt_simd(x, &m, &c, &bytes);
+#endif
+
     /* Encrypt all input blocks */
     while (bytes > 0) {
         /* Copy the "in" block to "out" */
@@ -216,6 +279,11 @@ void chacha_encrypt_bytes(chacha_ctx *x, const uint8_t *m, uint8_t *c, uint32_t
     uint8_t temp[64];
     uint8_t *t;
 
+#if defined(CPU_X86_DISPATCH)
+    if (bytes >= 256)
+        chacha_encrypt_simd(x, &m, &c, &bytes);
+#endif
+
     /* Load the context into local variables */
     in0 = x->input[0]; in1 = x->input[1]; in2 = x->input[2]; in3 = x->input[3];
     in4 = x->input[4]; in5 = x->input[5]; in6 = x->input[6]; in7 = x->input[7];
@@ -310,3 +378,103 @@ void chacha_encrypt_bytes(chacha_ctx *x, const uint8_t *m, uint8_t *c, uint32_t
 }
 
 #endif /* !USE_VECTOR_MATH */
+
+/* Generate the first keystream block (block counter zero) for "count"
+   consecutive 64-bit IV's starting at "iv", without modifying the
+   context.  This is used to derive the one-time Poly1305 keys for a
+   batch of packets in one go. */
+
+#ifdef USE_VECTOR_MATH
+
+#define broadcastVec(w) (VectorUInt32){(w), (w), (w), (w)}
+
+void chacha_first_blocks(const chacha_ctx *x, uint64_t iv, uint8_t *out, uint32_t count)
+{
+    VectorUInt32 in[16];
+    VectorUInt32 s[16];
+    uint32_t index, lane, lanes;
+
+#if defined(CPU_X86_DISPATCH)
+    if (count >= 4) {
+        uint32_t words[16];
+        uint32_t done;
+        memcpy(words, x->input, sizeof(words));
+        words[12] = 0;
+        words[13] = 0;
+        words[14] = (uint32_t)iv;
+        words[15] = (uint32_t)(iv >> 32);
+        memset(out, 0, count * 64);
+        done = chacha_simd_blocks(words, 14, out, out, count);
+        memset(words, 0, sizeof(words));
+        out += done * 64;
+        iv += done;
+        count -= done;
+    }
+#endif
+
+    /* Each vector lane holds the state for a different IV, so four
+       blocks are produced for the cost of one vectorised block */
+    for (index = 0; index < 12; ++index)
+        in[index] = broadcastVec(x->input[index / 4][index % 4]);
+    in[12] = broadcastVec(0);
+    in[13] = broadcastVec(0);
+    while (count > 0) {
+        lanes = (count < 4) ? count : 4;
+        in[14] = (VectorUInt32){(uint32_t)iv, (uint32_t)(iv + 1),
+                                (uint32_t)(iv + 2), (uint32_t)(iv + 3)};
+        in[15] = (VectorUInt32){(uint32_t)(iv >> 32),
+                                (uint32_t)((iv + 1) >> 32),
+                                (uint32_t)((iv + 2) >> 32),
+                                (uint32_t)((iv + 3) >> 32)};
+        for (index = 0; index < 16; ++index)
+            s[index] = in[index];
+
+        /* Perform the 20 rounds of the hash core */
+        for (index = 20; index >= 2; index -= 2) {
+            /* Column round */
+            quarterRound(s[0], s[4], s[8],  s[12]);
+            quarterRound(s[1], s[5], s[9],  s[13]);
+            quarterRound(s[2], s[6], s[10], s[14]);
+            quarterRound(s[3], s[7], s[11], s[15]);
+
+            /* Diagonal round */
+            quarterRound(s[0], s[5], s[10], s[15]);
+            quarterRound(s[1], s[6], s[11], s[12]);
+            quarterRound(s[2], s[7], s[8],  s[13]);
+            quarterRound(s[3], s[4], s[9],  s[14]);
+        }
+
+        /* Add the input and write out the blocks for the active lanes */
+        for (index = 0; index < 16; ++index)
+            s[index] += in[index];
+        for (lane = 0; lane < lanes; ++lane) {
+            for (index = 0; index < 16; ++index)
+                toLittle(out + index * 4, s[index][lane]);
+            out += 64;
+        }
+        iv += lanes;
+        count -= lanes;
+    }
+}
+
+#else /* !USE_VECTOR_MATH */
+
+void chacha_first_blocks(const chacha_ctx *x, uint64_t iv, uint8_t *out, uint32_t count)
+{
+    chacha_ctx ctx;
+    memcpy(&ctx, x, sizeof(ctx));
+    while (count > 0) {
+        ctx.input[12] = 0;
+        ctx.input[13] = 0;
+        ctx.input[14] = (uint32_t)iv;
+        ctx.input[15] = (uint32_t)(iv >> 32);
+        memset(out, 0, 64);
+        chacha_encrypt_bytes(&ctx, out, out, 64);
+        out += 64;
+        ++iv;
+        --count;
+    }
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+#endif /* !USE_VECTOR_MATH */
@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "../cpu/cpu.h"
 
 #if defined(__SSE2__) && defined(__GNUC__) && __GNUC__ >= 4
 #define USE_VECTOR_MATH 1
@@ -29,5 +30,13 @@ typedef struct
 extern void chacha_keysetup(chacha_ctx *x,const uint8_t *k,uint32_t kbits);
 extern void chacha_ivsetup(chacha_ctx *x,const uint8_t *iv,const uint8_t *counter);
 extern void chacha_encrypt_bytes(chacha_ctx *x,const uint8_t *m,uint8_t *c,uint32_t bytes);
+extern void chacha_first_blocks(const chacha_ctx *x,uint64_t iv,uint8_t *out,uint32_t count);
+
+#if defined(CPU_X86_DISPATCH)
+/* Multi-block kernels, selected at runtime; see chacha-simd.c */
+void chacha_blocks_ssse3(const uint32_t input[16], int pos, const uint8_t *m, uint8_t *c, size_t blocks);
+void chacha_blocks_avx2(const uint32_t input[16], int pos, const uint8_t *m, uint8_t *c, size_t blocks);
+void chacha_blocks_avx512(const uint32_t input[16], int pos, const uint8_t *m, uint8_t *c, size_t blocks);
+#endif
 
 #endif
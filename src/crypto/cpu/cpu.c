@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "cpu.h"
+#if defined(CPU_X86_DISPATCH)
+#include <cpuid.h>
+#endif
+
+/* Features that are detected and enabled; zero until first detection */
+uint32_t cpu_features = 0;
+
+/* Features that the CPU and operating system actually support */
+static uint32_t cpu_supported = 0;
+
+#if defined(CPU_X86_DISPATCH)
+
+/* Read an extended control register to check which register
+   states the operating system saves on context switches */
+static uint64_t cpu_xgetbv(uint32_t index)
+{
+    uint32_t eax, edx;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0"    /* xgetbv */
+                          : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static uint32_t cpu_probe(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int max_leaf;
+    uint32_t features = 0;
+    uint64_t xcr0 = 0;
+
+    max_leaf = __get_cpuid_max(0, 0);
+    if (max_leaf < 1)
+        return 0;
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (ecx & (1U << 9))
+        features |= CPU_FEATURE_SSSE3;
+    if (ecx & (1U << 19))
+        features |= CPU_FEATURE_SSE41;
+    if (ecx & (1U << 25))
+        features |= CPU_FEATURE_AESNI;
+    if (ecx & (1U << 1))
+        features |= CPU_FEATURE_PCLMUL;
+
+    /* AVX state must be enabled by the OS via OSXSAVE/XCR0 */
+    if (ecx & (1U << 27))
+        xcr0 = cpu_xgetbv(0);
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx & (1U << 5)) && (xcr0 & 0x06) == 0x06)
+            features |= CPU_FEATURE_AVX2;
+        if ((ebx & (1U << 16)) && (xcr0 & 0xE6) == 0xE6)
+            features |= CPU_FEATURE_AVX512;
+        if (ebx & (1U << 29))
+            features |= CPU_FEATURE_SHA;
+    }
+    return features;
+}
+
+#else
+
+static uint32_t cpu_probe(void)
+{
+    return 0;
+}
+
+#endif
+
+/* Detects the features of the CPU that we are running on.  Safe to call
+   from multiple threads at once because every caller computes and
+   stores the same values.  The supported set is published before the
+   detected flag, so any thread that sees the flag also sees it. */
+void cpu_detect_features(void)
+{
+    uint32_t supported = cpu_probe();
+    cpu_atomic_store(&cpu_supported, supported);
+    cpu_atomic_store(&cpu_features, supported | CPU_FEATURE_DETECTED);
+}
+
+uint32_t cpu_supported_features(void)
+{
+    cpu_enabled_features();
+    return cpu_atomic_load(&cpu_supported);
+}
+
+/* Restrict the enabled features to a subset of the supported ones */
+void cpu_set_features(uint32_t features)
+{
+    cpu_atomic_store(&cpu_features,
+                     (cpu_supported_features() & features & CPU_FEATURE_ALL) |
+                     CPU_FEATURE_DETECTED);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CRYPTO_CPU_h
+#define CRYPTO_CPU_h
+
+#include <stdint.h>
+
+/* Runtime CPU feature detection for selecting accelerated primitives.
+   The feature bits must match the NOISE_CPU_* values in constants.h */
+#define CPU_FEATURE_SSSE3       0x0001
+#define CPU_FEATURE_SSE41       0x0002
+#define CPU_FEATURE_AVX2        0x0004
+#define CPU_FEATURE_AVX512      0x0008
+#define CPU_FEATURE_AESNI       0x0010
+#define CPU_FEATURE_PCLMUL      0x0020
+#define CPU_FEATURE_SHA         0x0040
+#define CPU_FEATURE_ALL         0x007F
+
+/* Set once the features have been detected */
+#define CPU_FEATURE_DETECTED    0x80000000U
+
+/* Accelerated x86 kernels are compiled with per-function target
+   attributes so that the rest of the library can be built for the
+   baseline instruction set and still run everywhere */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+        (__GNUC__ >= 5 || defined(__clang__))
+#define CPU_X86_DISPATCH 1
+#define CPU_TARGET(arch) __attribute__((target(arch)))
+#else
+#undef CPU_X86_DISPATCH
+#endif
+
+/* The feature words are read by every thread that uses an accelerated
+   primitive and written lazily by whichever thread gets there first,
+   so they must be accessed atomically */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)) || defined(__clang__)
+#define cpu_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define cpu_atomic_store(ptr, value) \
+    __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#else
+#define cpu_atomic_load(ptr) (*(ptr))
+#define cpu_atomic_store(ptr, value) (*(ptr) = (value))
+#endif
+
+extern uint32_t cpu_features;
+
+void cpu_detect_features(void);
+uint32_t cpu_supported_features(void);
+void cpu_set_features(uint32_t features);
+
+/* Get the features that are currently enabled, detecting them if
+   this is the first call */
+static inline uint32_t cpu_enabled_features(void)
+{
+    uint32_t current = cpu_atomic_load(&cpu_features);
+    if (!(current & CPU_FEATURE_DETECTED)) {
+        cpu_detect_features();
+        current = cpu_atomic_load(&cpu_features);
+    }
+    return current;
+}
+
+/* Determine if all of the requested features are available and enabled */
+static inline int cpu_has_features(uint32_t features)
+{
+    return (cpu_enabled_features() & features) == features;
+}
+
+#endif
@@ -242,3 +242,156 @@ int curve448_eval(unsigned char mypublic[56], const unsigned char secret[56], co
     /* If the original base point was out of range, then fail now */
     return (int)(1 & success);
 }
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)) || defined(__clang__)
+
+/*
+Fixed-base evaluation for public key derivation.
+
+The curve448 base point u = 5 is the image of the edwards448 base point
+under the 4-isogeny (x, y) -> (y^2 / x^2) from RFC 7748, section 4.2.
+Ed448-Goldilocks already has signed comb tables for fixed-base scalar
+multiplication on its twisted curve, so we transfer the edwards448 base
+point over with twist_even(), build a comb table once, and then map the
+result back with untwist_and_double().  The round trip through the twist
+doubles the point, so the comb is evaluated on half of the scalar.
+
+The comb table is built on first use.  While one thread is building it,
+other threads fall back to the Montgomery ladder rather than waiting.
+*/
+
+#include <ec_point.h>
+#include <scalarmul.h>
+#include <barrett_field.h>
+#include <magic.h>
+
+/* Affine coordinates of the edwards448 base point, in little-endian order */
+static unsigned char const curve448_base_x[56] = {
+    0x5e, 0xc0, 0x0c, 0xc7, 0x2b, 0xa8, 0x26, 0x26,
+    0x8e, 0x93, 0x00, 0x8b, 0xe1, 0x80, 0x3b, 0x43,
+    0x11, 0x65, 0xb6, 0x2a, 0xf7, 0x1a, 0xae, 0x12,
+    0x64, 0xa4, 0xd3, 0xa3, 0x24, 0xe3, 0x6d, 0xea,
+    0x67, 0x17, 0x0f, 0x47, 0x70, 0x65, 0x14, 0x9e,
+    0xda, 0x36, 0xbf, 0x22, 0xa6, 0x15, 0x1d, 0x22,
+    0xed, 0x0d, 0xed, 0x6b, 0xc6, 0x70, 0x19, 0x4f
+};
+static unsigned char const curve448_base_y[56] = {
+    0x14, 0xfa, 0x30, 0xf2, 0x5b, 0x79, 0x08, 0x98,
+    0xad, 0xc8, 0xd7, 0x4e, 0x2c, 0x13, 0xbd, 0xfd,
+    0xc4, 0x39, 0x7c, 0xe6, 0x1c, 0xff, 0xd3, 0x3a,
+    0xd7, 0xc2, 0xa0, 0x05, 0x1e, 0x9c, 0x78, 0x87,
+    0x40, 0x98, 0xa3, 0x6c, 0x73, 0x73, 0xea, 0x4b,
+    0x62, 0xc7, 0xc9, 0x56, 0x37, 0x20, 0x76, 0x88,
+    0x24, 0xbc, 0xb6, 0x6e, 0x71, 0x46, 0x3f, 0x69
+};
+
+#define CURVE448_TABLE_NONE     0
+#define CURVE448_TABLE_BUILDING 1
+#define CURVE448_TABLE_READY    2
+#define CURVE448_TABLE_FAILED   3
+
+static int curve448_table_status = CURVE448_TABLE_NONE;
+static struct fixed_base_table_t curve448_table;
+static tw_niels_a_t curve448_combs[COMB_N << (COMB_T - 1)];
+
+/* Working space for building the combs.  The table is only ever built
+   once, by the thread that wins the race to build it, so the space is
+   allocated statically rather than on the heap; that way the library's
+   allocator from noise_set_allocator() sees all of its heap usage */
+static tw_pniels_a_t curve448_comb_doubles[COMB_T - 1];
+static field_a_t curve448_comb_zs[COMB_N << (COMB_T - 1)];
+static field_a_t curve448_comb_zis[COMB_N << (COMB_T - 1)];
+
+/**
+ * \brief Makes sure that the comb table for the base point is available.
+ *
+ * \return 1 if the table is ready for use, or 0 if the caller should
+ * fall back to the Montgomery ladder.
+ */
+static int curve448_fixed_base_init(void)
+{
+    int status = __atomic_load_n(&curve448_table_status, __ATOMIC_ACQUIRE);
+    affine_a_t base;
+    extensible_a_t ext;
+    tw_extensible_a_t text;
+    mask_t success;
+
+    if (status == CURVE448_TABLE_READY)
+        return 1;
+    if (status != CURVE448_TABLE_NONE)
+        return 0;
+    if (!__atomic_compare_exchange_n
+            (&curve448_table_status, &status, CURVE448_TABLE_BUILDING, 0,
+             __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return status == CURVE448_TABLE_READY;
+
+    /* Transfer the base point to the twisted curve and build the combs */
+    success = field_deserialize(base->x, curve448_base_x);
+    success &= field_deserialize(base->y, curve448_base_y);
+    convert_affine_to_extensible(ext, base);
+    twist_even(text, ext);
+    success &= precompute_fixed_base_scratch
+        (&curve448_table, text, COMB_N, COMB_T, COMB_S, curve448_combs,
+         curve448_comb_doubles, curve448_comb_zs, curve448_comb_zis);
+
+    __atomic_store_n(&curve448_table_status,
+                     success ? CURVE448_TABLE_READY : CURVE448_TABLE_FAILED,
+                     __ATOMIC_RELEASE);
+    return success ? 1 : 0;
+}
+
+/**
+ * \brief Evaluates the curve function against the curve448 base point.
+ *
+ * \param mypublic Final output public key, 56 bytes.
+ * \param secret Secret value; i.e. the private key, 56 bytes.
+ *
+ * This gives the same result as curve448_eval() with a base point of 5,
+ * using the fixed-base comb tables from Ed448-Goldilocks in place of the
+ * Montgomery ladder.
+ */
+void curve448_eval_base(unsigned char mypublic[56], const unsigned char secret[56])
+{
+    static unsigned char const basepoint[56] = {5};
+    unsigned char half[56];
+    word_t scalar[SCALAR_WORDS];
+    tw_extensible_a_t twisted;
+    extensible_a_t point;
+    field_a_t x2, y2, t;
+    unsigned char posn;
+
+    if (!curve448_fixed_base_init()) {
+        curve448_eval(mypublic, secret, basepoint);
+        return;
+    }
+
+    /* Apply the RFC 7748 masking and halve the scalar; the masked value
+       is always even so nothing is lost.  Then reduce modulo the order */
+    for (posn = 0; posn < 55; ++posn)
+        half[posn] = (secret[posn] >> 1) | (secret[posn + 1] << 7);
+    half[55] = (secret[55] >> 1) | 0x40;
+    half[0] &= 0xFE;
+    barrett_deserialize_and_reduce(scalar, half, sizeof(half), &curve_prime_order);
+
+    /* Multiply and then return to the untwisted curve */
+    scalarmul_fixed_base(twisted, scalar, SCALAR_BITS, &curve448_table);
+    untwist_and_double(point, twisted);
+
+    /* u = y^2 / x^2.  Since x^2 is a square, isr(x^2)^2 = 1 / x^2 */
+    field_sqr(x2, point->x);
+    field_sqr(y2, point->y);
+    field_isr(t, x2);
+    field_sqr(x2, t);
+    field_mul(t, y2, x2);
+    field_serialize(mypublic, t);
+}
+
+#else
+
+void curve448_eval_base(unsigned char mypublic[56], const unsigned char secret[56])
+{
+    static unsigned char const basepoint[56] = {5};
+    curve448_eval(mypublic, secret, basepoint);
+}
+
+#endif
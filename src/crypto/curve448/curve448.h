@@ -28,6 +28,7 @@ extern "C" {
 #endif
 
 int curve448_eval(unsigned char mypublic[56], const unsigned char secret[56], const unsigned char basepoint[56]);
+void curve448_eval_base(unsigned char mypublic[56], const unsigned char secret[56]);
 
 #ifdef __cplusplus
 };
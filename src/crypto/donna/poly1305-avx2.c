@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "poly1305-donna.h"
+
+#if defined(CPU_X86_DISPATCH)
+
+#include <immintrin.h>
+
+/* AVX2 Poly1305 kernel.  Values are held as five 26-bit limbs so that
+   the limb products fit in the 32 x 32 -> 64 bit multiplies provided by
+   vpmuludq, with each 64-bit vector lane accumulating a separate block.
+
+   Four interleaved accumulators are run in parallel.  Lane j absorbs
+   blocks j, j + 4, j + 8, ..., and is multiplied by r^4 after each
+   block except the last, where the lanes are multiplied by r^4, r^3,
+   r^2, and r respectively.  Adding the four lanes together afterwards
+   gives the same result as Horner's rule on the serial block sequence. */
+
+#define M26 0x3ffffffU
+
+/* Multiply two values in radix 2^26 and partially reduce modulo
+   2^130 - 5.  Used to precompute the powers of r */
+static void poly1305_mul26(uint32_t out[5], const uint32_t a[5], const uint32_t b[5])
+{
+    uint64_t s1 = b[1] * 5ULL;
+    uint64_t s2 = b[2] * 5ULL;
+    uint64_t s3 = b[3] * 5ULL;
+    uint64_t s4 = b[4] * 5ULL;
+    uint64_t d0, d1, d2, d3, d4, c;
+
+    d0 = a[0] * (uint64_t)b[0] + a[1] * s4 + a[2] * s3 + a[3] * s2 + a[4] * s1;
+    d1 = a[0] * (uint64_t)b[1] + a[1] * (uint64_t)b[0] + a[2] * s4 + a[3] * s3 + a[4] * s2;
+    d2 = a[0] * (uint64_t)b[2] + a[1] * (uint64_t)b[1] + a[2] * (uint64_t)b[0] + a[3] * s4 + a[4] * s3;
+    d3 = a[0] * (uint64_t)b[3] + a[1] * (uint64_t)b[2] + a[2] * (uint64_t)b[1] + a[3] * (uint64_t)b[0] + a[4] * s4;
+    d4 = a[0] * (uint64_t)b[4] + a[1] * (uint64_t)b[3] + a[2] * (uint64_t)b[2] + a[3] * (uint64_t)b[1] + a[4] * (uint64_t)b[0];
+
+    c = d0 >> 26; d0 &= M26; d1 += c;
+    c = d1 >> 26; d1 &= M26; d2 += c;
+    c = d2 >> 26; d2 &= M26; d3 += c;
+    c = d3 >> 26; d3 &= M26; d4 += c;
+    c = d4 >> 26; d4 &= M26; d0 += c * 5;
+    c = d0 >> 26; d0 &= M26; d1 += c;
+
+    out[0] = (uint32_t)d0;
+    out[1] = (uint32_t)d1;
+    out[2] = (uint32_t)d2;
+    out[3] = (uint32_t)d3;
+    out[4] = (uint32_t)d4;
+}
+
+/* Vector multiply-accumulate of the lanes in "a" by the per-lane
+   multiplier "r" with "s" = 5 * r, followed by a partial reduction */
+CPU_TARGET("avx2")
+static inline void poly1305_mul_avx2(__m256i a[5], const __m256i r[5], const __m256i s[5])
+{
+    const __m256i mask = _mm256_set1_epi64x(M26);
+    __m256i d0, d1, d2, d3, d4, c;
+
+#define MUL(x, y) _mm256_mul_epu32((x), (y))
+#define ADD(x, y) _mm256_add_epi64((x), (y))
+    d0 = ADD(ADD(ADD(ADD(MUL(a[0], r[0]), MUL(a[1], s[4])), MUL(a[2], s[3])), MUL(a[3], s[2])), MUL(a[4], s[1]));
+    d1 = ADD(ADD(ADD(ADD(MUL(a[0], r[1]), MUL(a[1], r[0])), MUL(a[2], s[4])), MUL(a[3], s[3])), MUL(a[4], s[2]));
+    d2 = ADD(ADD(ADD(ADD(MUL(a[0], r[2]), MUL(a[1], r[1])), MUL(a[2], r[0])), MUL(a[3], s[4])), MUL(a[4], s[3]));
+    d3 = ADD(ADD(ADD(ADD(MUL(a[0], r[3]), MUL(a[1], r[2])), MUL(a[2], r[1])), MUL(a[3], r[0])), MUL(a[4], s[4]));
+    d4 = ADD(ADD(ADD(ADD(MUL(a[0], r[4]), MUL(a[1], r[3])), MUL(a[2], r[2])), MUL(a[3], r[1])), MUL(a[4], r[0]));
+
+    c = _mm256_srli_epi64(d0, 26); d0 = _mm256_and_si256(d0, mask); d1 = ADD(d1, c);
+    c = _mm256_srli_epi64(d3, 26); d3 = _mm256_and_si256(d3, mask); d4 = ADD(d4, c);
+    c = _mm256_srli_epi64(d1, 26); d1 = _mm256_and_si256(d1, mask); d2 = ADD(d2, c);
+    c = _mm256_srli_epi64(d4, 26); d4 = _mm256_and_si256(d4, mask);
+    d0 = ADD(d0, ADD(c, _mm256_slli_epi64(c, 2)));
+    c = _mm256_srli_epi64(d2, 26); d2 = _mm256_and_si256(d2, mask); d3 = ADD(d3, c);
+    c = _mm256_srli_epi64(d0, 26); d0 = _mm256_and_si256(d0, mask); d1 = ADD(d1, c);
+    c = _mm256_srli_epi64(d3, 26); d3 = _mm256_and_si256(d3, mask); d4 = ADD(d4, c);
+#undef MUL
+#undef ADD
+
+    a[0] = d0;
+    a[1] = d1;
+    a[2] = d2;
+    a[3] = d3;
+    a[4] = d4;
+}
+
+/* Split the next four 16-byte blocks into 26-bit limbs, one block per
+   lane, set the 2^128 bit, and add them to the accumulators */
+CPU_TARGET("avx2")
+static inline void poly1305_load_avx2(__m256i a[5], const unsigned char *m)
+{
+    const __m256i mask = _mm256_set1_epi64x(M26);
+    const __m256i hibit = _mm256_set1_epi64x(1 << 24);
+    __m256i x = _mm256_loadu_si256((const __m256i *)m);
+    __m256i y = _mm256_loadu_si256((const __m256i *)(m + 32));
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(x, y), 0xD8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(x, y), 0xD8);
+
+    a[0] = _mm256_add_epi64(a[0], _mm256_and_si256(lo, mask));
+    a[1] = _mm256_add_epi64
+        (a[1], _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask));
+    a[2] = _mm256_add_epi64
+        (a[2], _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52),
+                                                _mm256_slli_epi64(hi, 12)),
+                                mask));
+    a[3] = _mm256_add_epi64
+        (a[3], _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask));
+    a[4] = _mm256_add_epi64
+        (a[4], _mm256_or_si256(_mm256_srli_epi64(hi, 40), hibit));
+}
+
+/* Absorb "blocks" full message blocks into the accumulator "h" with
+   the key "r".  Both are in radix 2^26 and "blocks" must be a non-zero
+   multiple of 4.  On exit, "h" is partially reduced */
+CPU_TARGET("avx2")
+void poly1305_blocks_avx2(uint32_t h[5], const uint32_t r[5],
+                          const unsigned char *m, size_t blocks)
+{
+    uint32_t r2[5], r3[5], r4[5];
+    __m256i a[5], R[5], S[5];
+    uint64_t t[4];
+    uint64_t d[5], c;
+    int i;
+
+    /* Precompute r^2, r^3, and r^4 */
+    poly1305_mul26(r2, r, r);
+    poly1305_mul26(r3, r2, r);
+    poly1305_mul26(r4, r2, r2);
+
+    /* The existing accumulator value is folded into the first block */
+    a[0] = _mm256_setr_epi64x(h[0], 0, 0, 0);
+    a[1] = _mm256_setr_epi64x(h[1], 0, 0, 0);
+    a[2] = _mm256_setr_epi64x(h[2], 0, 0, 0);
+    a[3] = _mm256_setr_epi64x(h[3], 0, 0, 0);
+    a[4] = _mm256_setr_epi64x(h[4], 0, 0, 0);
+
+    for (i = 0; i < 5; ++i) {
+        R[i] = _mm256_set1_epi64x(r4[i]);
+        S[i] = _mm256_set1_epi64x(r4[i] * 5ULL);
+    }
+    while (blocks > 4) {
+        poly1305_load_avx2(a, m);
+        poly1305_mul_avx2(a, R, S);
+        m += 64;
+        blocks -= 4;
+    }
+
+    /* Last group: multiply the lanes by r^4, r^3, r^2, and r */
+    for (i = 0; i < 5; ++i) {
+        R[i] = _mm256_setr_epi64x(r4[i], r3[i], r2[i], r[i]);
+        S[i] = _mm256_add_epi64(R[i], _mm256_slli_epi64(R[i], 2));
+    }
+    poly1305_load_avx2(a, m);
+    poly1305_mul_avx2(a, R, S);
+
+    /* Sum the lanes and carry the result back into "h" */
+    for (i = 0; i < 5; ++i) {
+        _mm256_storeu_si256((__m256i *)t, a[i]);
+        d[i] = t[0] + t[1] + t[2] + t[3];
+    }
+    c = d[0] >> 26; d[0] &= M26; d[1] += c;
+    c = d[1] >> 26; d[1] &= M26; d[2] += c;
+    c = d[2] >> 26; d[2] &= M26; d[3] += c;
+    c = d[3] >> 26; d[3] &= M26; d[4] += c;
+    c = d[4] >> 26; d[4] &= M26; d[0] += c * 5;
+    c = d[0] >> 26; d[0] &= M26; d[1] += c;
+    for (i = 0; i < 5; ++i)
+        h[i] = (uint32_t)d[i];
+}
+
+#endif
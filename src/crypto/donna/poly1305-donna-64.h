@@ -34,6 +34,7 @@
 #endif
 
 #define poly1305_block_size 16
+#define POLY1305_RADIX_2_44 1
 
 /* 17 + sizeof(size_t) + 8*sizeof(unsigned long long) */
 typedef struct poly1305_state_internal_t {
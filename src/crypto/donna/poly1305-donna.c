@@ -23,6 +23,60 @@
 
 #endif
 
+#if defined(CPU_X86_DISPATCH) && defined(POLY1305_RADIX_2_44)
+
+/* Minimum run of full blocks before switching to the AVX2 kernel, to
+   amortise the cost of converting radix and computing the powers of r */
+#define POLY1305_AVX2_MIN_BYTES 256
+
+/* convert a value in radix 2^44 to radix 2^26 */
+static void
+poly1305_44_to_26(uint32_t out[5], const unsigned long long in[3]) {
+	uint128_t v;
+	unsigned long long lo, hi, top;
+	v = in[0] + ((uint128_t)in[1] << 44);
+	lo = LO(v);
+	v = SHR(v, 64) + ((uint128_t)in[2] << 24);
+	hi = LO(v);
+	top = SHR(v, 64);
+	out[0] = (uint32_t)(lo & 0x3ffffff);
+	out[1] = (uint32_t)((lo >> 26) & 0x3ffffff);
+	out[2] = (uint32_t)(((lo >> 52) | (hi << 12)) & 0x3ffffff);
+	out[3] = (uint32_t)((hi >> 14) & 0x3ffffff);
+	out[4] = (uint32_t)((hi >> 40) | (top << 24));
+}
+
+/* convert a partially reduced value in radix 2^26 back to radix 2^44 */
+static void
+poly1305_26_to_44(unsigned long long out[3], const uint32_t in[5]) {
+	unsigned long long t, c;
+	t = in[0] + ((unsigned long long)in[1] << 26);
+	out[0] = t & 0xfffffffffff; t >>= 44;
+	t += ((unsigned long long)in[2] << 8) + ((unsigned long long)in[3] << 34);
+	out[1] = t & 0xfffffffffff; t >>= 44;
+	t += ((unsigned long long)in[4] << 16);
+	out[2] = t & 0x3ffffffffff; c = t >> 42;
+	out[0] += c * 5; c = out[0] >> 44; out[0] &= 0xfffffffffff;
+	out[1] += c;
+}
+
+/* process a multiple of 64 bytes of full blocks with the AVX2 kernel */
+static void
+poly1305_blocks_wide(poly1305_state_internal_t *st, const unsigned char *m, size_t bytes) {
+	uint32_t h[5], r[5];
+	size_t i;
+	poly1305_44_to_26(h, st->h);
+	poly1305_44_to_26(r, st->r);
+	poly1305_blocks_avx2(h, r, m, bytes / poly1305_block_size);
+	poly1305_26_to_44(st->h, h);
+	for (i = 0; i < 5; i++) {
+		h[i] = 0;
+		r[i] = 0;
+	}
+}
+
+#endif
+
 void
 poly1305_update(poly1305_context *ctx, const unsigned char *m, size_t bytes) {
 	poly1305_state_internal_t *st = (poly1305_state_internal_t *)ctx;
@@ -47,6 +101,15 @@ poly1305_update(poly1305_context *ctx, const unsigned char *m, size_t bytes) {
 	/* process full blocks */
 	if (bytes >= poly1305_block_size) {
 		size_t want = (bytes & ~(poly1305_block_size - 1));
+#if defined(CPU_X86_DISPATCH) && defined(POLY1305_RADIX_2_44)
+		if (want >= POLY1305_AVX2_MIN_BYTES && cpu_has_features(CPU_FEATURE_AVX2)) {
+			size_t wide = (want & ~(size_t)(4 * poly1305_block_size - 1));
+			poly1305_blocks_wide(st, m, wide);
+			m += wide;
+			bytes -= wide;
+			want -= wide;
+		}
+#endif
 		poly1305_blocks(st, m, want);
 		m += want;
 		bytes -= want;
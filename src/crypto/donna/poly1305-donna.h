@@ -2,6 +2,8 @@
 #define POLY1305_DONNA_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "../cpu/cpu.h"
 
 typedef struct poly1305_context {
 	size_t aligner;
@@ -16,5 +18,9 @@ void poly1305_auth(unsigned char mac[16], const unsigned char *m, size_t bytes,
 int poly1305_verify(const unsigned char mac1[16], const unsigned char mac2[16]);
 int poly1305_power_on_self_test(void);
 
+#if defined(CPU_X86_DISPATCH)
+void poly1305_blocks_avx2(uint32_t h[5], const uint32_t r[5], const unsigned char *m, size_t blocks);
+#endif
+
 #endif /* POLY1305_DONNA_H */
 
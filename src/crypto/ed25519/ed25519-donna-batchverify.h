@@ -207,7 +207,7 @@ ED25519_FN(ed25519_sign_open_batch) (const unsigned char **m, size_t *mlen, cons
 	ge25519 ALIGN(16) p;
 	bignum256modm *r_scalars;
 	size_t i, batchsize;
-	unsigned char hram[64];
+	hash_512bits hram[max_batch_size];
 	int ret = 0;
 
 	for (i = 0; i < num; i++)
@@ -231,9 +231,9 @@ ED25519_FN(ed25519_sign_open_batch) (const unsigned char **m, size_t *mlen, cons
 			add256_modm(batch.scalars[0], batch.scalars[0], batch.scalars[i]);
 
 		/* compute scalars[1]..scalars[batchsize] as r[i]*H(R[i],A[i],m[i]) */
+		ed25519_hram_batch(hram, RS, pk, m, mlen, batchsize);
 		for (i = 0; i < batchsize; i++) {
-			ed25519_hram(hram, RS[i], pk[i], m[i], mlen[i]);
-			expand256_modm(batch.scalars[i+1], hram, 64);
+			expand256_modm(batch.scalars[i+1], hram[i], 64);
 			mul256_modm(batch.scalars[i+1], batch.scalars[i+1], r_scalars[i]);
 		}
 
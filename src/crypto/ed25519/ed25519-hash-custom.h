@@ -7,6 +7,11 @@
 	void ed25519_hash_update(ed25519_hash_context *ctx, const uint8_t *in, size_t inlen);
 	void ed25519_hash_final(ed25519_hash_context *ctx, uint8_t *hash);
 	void ed25519_hash(uint8_t *hash, const uint8_t *in, size_t inlen);
+
+	and can optionally define ed25519_hash_final_many to finish several
+	contexts at once, which is used to compute H(R,A,m) in batch verify:
+
+	void ed25519_hash_final_many(ed25519_hash_context * const *ctx, const uint8_t * const *in, const size_t *inlen, uint8_t * const *hash, size_t num);
 */
 
 /* Definitions for using the SHA512 code from Noise-C */
@@ -18,3 +23,4 @@
 #define ed25519_hash_update sha512_update
 #define ed25519_hash_final sha512_finish
 #define ed25519_hash sha512_hash
+#define ed25519_hash_final_many sha512_finish_many
@@ -41,6 +41,44 @@ ed25519_hram(hash_512bits hram, const ed25519_signature RS, const ed25519_public
 	ed25519_hash_final(&ctx, hram);
 }
 
+/*
+	Computes H(R,A,m) for several signatures, hashing the messages
+	together when the custom hash can finish several contexts at once
+*/
+
+static void
+ed25519_hram_batch(hash_512bits *hram, const unsigned char **RS, const unsigned char **pk, const unsigned char **m, size_t *mlen, size_t num) {
+#if defined(ed25519_hash_final_many)
+	ed25519_hash_context ctx[4];
+	ed25519_hash_context *ctxs[4];
+	unsigned char *hashes[4];
+	size_t i, batchsize;
+
+	while (num > 0) {
+		batchsize = (num > 4) ? 4 : num;
+		for (i = 0; i < batchsize; i++) {
+			ed25519_hash_init(&ctx[i]);
+			ed25519_hash_update(&ctx[i], RS[i], 32);
+			ed25519_hash_update(&ctx[i], pk[i], 32);
+			ctxs[i] = &ctx[i];
+			hashes[i] = hram[i];
+		}
+		ed25519_hash_final_many(ctxs, m, mlen, hashes, batchsize);
+
+		hram += batchsize;
+		RS += batchsize;
+		pk += batchsize;
+		m += batchsize;
+		mlen += batchsize;
+		num -= batchsize;
+	}
+#else
+	size_t i;
+	for (i = 0; i < num; i++)
+		ed25519_hram(hram[i], RS[i], pk[i], m[i], mlen[i]);
+#endif
+}
+
 void
 ED25519_FN(ed25519_publickey) (const ed25519_secret_key sk, ed25519_public_key pk) {
 	bignum256modm a;
@@ -107,6 +107,76 @@ static void GF128_mul(uint64_t Y[2], const uint64_t H[2])
     Y[1] = swapEndian(Z1);
 }
 
+#if !defined(GHASH_NO_TABLE)
+
+static void GF128_initTable(uint64_t T[16][2], const uint64_t H[2])
+{
+    uint64_t V0 = H[0];
+    uint64_t V1 = H[1];
+    uint64_t mask;
+
+    /* T[n] is H multiplied by the 4-bit value n, where the high bit of n
+       is the coefficient of x^0 and the low bit is the coefficient of x^3.
+       Fill in T[8] = H, T[4] = H * x, T[2] = H * x^2, T[1] = H * x^3 */
+    T[0][0] = 0;
+    T[0][1] = 0;
+    for (uint8_t posn = 8; posn > 0; posn >>= 1) {
+        T[posn][0] = V0;
+        T[posn][1] = V1;
+        mask = ((~(V1 & 0x01)) + 1) & 0xE100000000000000ULL;
+        V1 = (V1 >> 1) | (V0 << 63);
+        V0 = (V0 >> 1) ^ mask;
+    }
+
+    /* The other entries are the XOR of the entries for their set bits */
+    for (uint8_t posn = 2; posn < 16; posn <<= 1) {
+        for (uint8_t index = 1; index < posn; ++index) {
+            T[posn + index][0] = T[posn][0] ^ T[index][0];
+            T[posn + index][1] = T[posn][1] ^ T[index][1];
+        }
+    }
+}
+
+static void GF128_mulTable(uint64_t Y[2], const uint64_t T[16][2])
+{
+    uint64_t Z0 = 0;
+    uint64_t Z1 = 0;
+    uint64_t R;
+    uint32_t select;
+
+    /* Process Y a nibble at a time, starting with the last.  Horner's rule
+       gives Z = (Z * x^4) ^ (nibble * H) for each nibble in turn */
+    for (int posn = 15; posn >= 0; --posn) {
+        uint8_t value = ((const uint8_t *)Y)[posn];
+        for (int shift = 0; shift <= 4; shift += 4) {
+            uint8_t nibble = (value >> shift) & 0x0F;
+
+            /* Multiply Z by x^4.  The 4 bits that are shifted out are
+               reduced with the polynomial 0xE1 at each of the positions
+               that they would have been reduced by GF128_mul() */
+            R = Z1 << 60;
+            R ^= (R >> 1) ^ (R >> 2) ^ (R >> 7);
+            Z1 = (Z1 >> 4) | (Z0 << 60);
+            Z0 = (Z0 >> 4) ^ R;
+
+            /* Look up nibble * H by scanning every entry in the table so
+               that the memory access pattern does not depend upon Y.
+               "select" has a single bit set for the entry we want */
+            select = ((uint32_t)1) << nibble;
+            for (uint8_t index = 0; index < 16; ++index) {
+                uint64_t mask = (~((uint64_t)((select >> index) & 1))) + 1;
+                Z0 ^= T[index][0] & mask;
+                Z1 ^= T[index][1] & mask;
+            }
+        }
+    }
+
+    Y[0] = swapEndian(Z0);
+    Y[1] = swapEndian(Z1);
+}
+
+#endif /* !GHASH_NO_TABLE */
+
 #else /* GHASH_WORD32 */
 
 /* Default 32-bit version of GHASH */
@@ -175,12 +245,141 @@ static void GF128_mul(uint32_t Y[4], const uint32_t H[4])
     Y[3] = swapEndian(Z3);
 }
 
+#if !defined(GHASH_NO_TABLE)
+
+static void GF128_initTable(uint32_t T[16][4], const uint32_t H[4])
+{
+    uint32_t V0 = H[0];
+    uint32_t V1 = H[1];
+    uint32_t V2 = H[2];
+    uint32_t V3 = H[3];
+    uint32_t mask;
+
+    /* T[n] is H multiplied by the 4-bit value n, where the high bit of n
+       is the coefficient of x^0 and the low bit is the coefficient of x^3.
+       Fill in T[8] = H, T[4] = H * x, T[2] = H * x^2, T[1] = H * x^3 */
+    memset(T[0], 0, sizeof(T[0]));
+    for (uint8_t posn = 8; posn > 0; posn >>= 1) {
+        T[posn][0] = V0;
+        T[posn][1] = V1;
+        T[posn][2] = V2;
+        T[posn][3] = V3;
+        mask = ((~(V3 & 0x01)) + 1) & 0xE1000000;
+        V3 = (V3 >> 1) | (V2 << 31);
+        V2 = (V2 >> 1) | (V1 << 31);
+        V1 = (V1 >> 1) | (V0 << 31);
+        V0 = (V0 >> 1) ^ mask;
+    }
+
+    /* The other entries are the XOR of the entries for their set bits */
+    for (uint8_t posn = 2; posn < 16; posn <<= 1) {
+        for (uint8_t index = 1; index < posn; ++index) {
+            T[posn + index][0] = T[posn][0] ^ T[index][0];
+            T[posn + index][1] = T[posn][1] ^ T[index][1];
+            T[posn + index][2] = T[posn][2] ^ T[index][2];
+            T[posn + index][3] = T[posn][3] ^ T[index][3];
+        }
+    }
+}
+
+static void GF128_mulTable(uint32_t Y[4], const uint32_t T[16][4])
+{
+    uint32_t Z0 = 0;
+    uint32_t Z1 = 0;
+    uint32_t Z2 = 0;
+    uint32_t Z3 = 0;
+    uint32_t R;
+    uint32_t select;
+
+    /* Process Y a nibble at a time, starting with the last.  Horner's rule
+       gives Z = (Z * x^4) ^ (nibble * H) for each nibble in turn */
+    for (int posn = 15; posn >= 0; --posn) {
+        uint8_t value = ((const uint8_t *)Y)[posn];
+        for (int shift = 0; shift <= 4; shift += 4) {
+            uint8_t nibble = (value >> shift) & 0x0F;
+
+            /* Multiply Z by x^4.  The 4 bits that are shifted out are
+               reduced with the polynomial 0xE1 at each of the positions
+               that they would have been reduced by GF128_mul() */
+            R = Z3 << 28;
+            R ^= (R >> 1) ^ (R >> 2) ^ (R >> 7);
+            Z3 = (Z3 >> 4) | (Z2 << 28);
+            Z2 = (Z2 >> 4) | (Z1 << 28);
+            Z1 = (Z1 >> 4) | (Z0 << 28);
+            Z0 = (Z0 >> 4) ^ R;
+
+            /* Look up nibble * H by scanning every entry in the table so
+               that the memory access pattern does not depend upon Y.
+               "select" has a single bit set for the entry we want */
+            select = ((uint32_t)1) << nibble;
+            for (uint8_t index = 0; index < 16; ++index) {
+                uint32_t mask = (~((uint32_t)((select >> index) & 1))) + 1;
+                Z0 ^= T[index][0] & mask;
+                Z1 ^= T[index][1] & mask;
+                Z2 ^= T[index][2] & mask;
+                Z3 ^= T[index][3] & mask;
+            }
+        }
+    }
+
+    Y[0] = swapEndian(Z0);
+    Y[1] = swapEndian(Z1);
+    Y[2] = swapEndian(Z2);
+    Y[3] = swapEndian(Z3);
+}
+
+#endif /* !GHASH_NO_TABLE */
+
 #endif /* GHASH_WORD32 */
 
+/* Engine to use for states whose key is set from now on */
+static uint8_t ghash_engine = GHASH_DEFAULT_ENGINE;
+
+/* Multiply Y by H with the engine that was selected for the state */
+static void ghash_mul(ghash_state *state)
+{
+#if !defined(GHASH_NO_TABLE)
+    if (state->engine == GHASH_ENGINE_TABLE) {
+        GF128_mulTable(state->Y, state->T);
+        return;
+    }
+#endif
+    GF128_mul(state->Y, state->H);
+}
+
+/* Returns the engine that will be used for newly keyed states */
+int ghash_get_engine(void)
+{
+    return ghash_engine;
+}
+
+/* Selects the engine for states whose key is set afterwards.  Returns
+   zero if the engine is not available in this build */
+int ghash_set_engine(int engine)
+{
+    if (engine == GHASH_ENGINE_BITWISE) {
+        ghash_engine = GHASH_ENGINE_BITWISE;
+        return 1;
+    }
+#if !defined(GHASH_NO_TABLE)
+    if (engine == GHASH_ENGINE_TABLE) {
+        ghash_engine = GHASH_ENGINE_TABLE;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
 void ghash_reset(ghash_state *state, const void *key)
 {
-    if (key)
+    if (key) {
         GF128_mulInit(state->H, (const void *)key);
+        state->engine = ghash_engine;
+#if !defined(GHASH_NO_TABLE)
+        if (state->engine == GHASH_ENGINE_TABLE)
+            GF128_initTable(state->T, state->H);
+#endif
+    }
     memset(state->Y, 0, sizeof(state->Y));
     state->posn = 0;
 }
@@ -199,7 +398,7 @@ void ghash_update(ghash_state *state, const void *data, size_t len)
         len -= size;
         d += size;
         if (state->posn == 16) {
-            GF128_mul(state->Y, state->H);
+            ghash_mul(state);
             state->posn = 0;
         }
     }
@@ -218,7 +417,7 @@ void ghash_pad(ghash_state *state)
     if (state->posn != 0) {
         /* Padding involves XOR'ing the rest of state->Y with zeroes,
            which does nothing.  Immediately process the next chunk */
-        GF128_mul(state->Y, state->H);
+        ghash_mul(state);
         state->posn = 0;
     }
 }
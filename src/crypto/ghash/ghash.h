@@ -30,12 +30,31 @@
 #define GHASH_WORD64 1
 #endif
 
+/* GHASH engines.  The bitwise engine multiplies by H one bit at a time
+   and needs no per-key storage.  The table engine precomputes the 16
+   multiples of H by a 4-bit value when the key is set, and multiplies
+   by H a nibble at a time.  Both are constant-time: the table engine
+   reads every table entry for each nibble, which costs more than the
+   bitwise engine on most 64-bit hosts.  The performance test reports
+   both so that GHASH_DEFAULT_ENGINE can be chosen per platform.
+   Define GHASH_NO_TABLE to build without the table engine */
+#define GHASH_ENGINE_BITWISE    0
+#define GHASH_ENGINE_TABLE      1
+#if !defined(GHASH_DEFAULT_ENGINE) || defined(GHASH_NO_TABLE)
+#undef GHASH_DEFAULT_ENGINE
+#define GHASH_DEFAULT_ENGINE    GHASH_ENGINE_BITWISE
+#endif
+
 #if defined(GHASH_WORD64)
 
 typedef struct {
     uint64_t H[2];
     uint64_t Y[2];
+#if !defined(GHASH_NO_TABLE)
+    uint64_t T[16][2];
+#endif
     uint8_t posn;
+    uint8_t engine;
 } ghash_state;
 
 #else
@@ -43,11 +62,18 @@ typedef struct {
 typedef struct {
     uint32_t H[4];
     uint32_t Y[4];
+#if !defined(GHASH_NO_TABLE)
+    uint32_t T[16][4];
+#endif
     uint8_t posn;
+    uint8_t engine;
 } ghash_state;
 
 #endif
 
+int ghash_get_engine(void);
+int ghash_set_engine(int engine);
+
 void ghash_reset(ghash_state *state, const void *key);
 void ghash_update(ghash_state *state, const void *data, size_t len);
 void ghash_finalize(ghash_state *state, void *token, size_t len);
@@ -14,6 +14,9 @@
 
 #include "word.h"
 
+/* Noise-C: avoid a clash with barrett_reduce() from the NewHope sources */
+#define barrett_reduce goldilocks_barrett_reduce
+
 #ifdef __cplusplus
 extern "C" {
 #endif
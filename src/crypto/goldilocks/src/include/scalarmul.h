@@ -168,6 +168,28 @@ precompute_fixed_base (
   tw_niels_a_t *prealloc
 ) __attribute__((warn_unused_result));
 
+/**
+ * Same as precompute_fixed_base(), but with caller-supplied working
+ * space.  If all of the scratch arrays are provided, the function does
+ * no heap allocation at all when prealloc is also provided.
+ *
+ * @param [in] scratch_doubles Space for t-1 values of type tw_pniels_t.
+ * @param [in] scratch_zs Space for n<<(t-1) values of type field_t.
+ * @param [in] scratch_zis Space for n<<(t-1) values of type field_t.
+ */
+mask_t
+precompute_fixed_base_scratch (
+  struct fixed_base_table_t *out,
+  const tw_extensible_a_t base,
+  unsigned int n,
+  unsigned int t,
+  unsigned int s,
+  tw_niels_a_t *prealloc,
+  tw_pniels_a_t *scratch_doubles,
+  field_a_t *scratch_zs,
+  field_a_t *scratch_zis
+) __attribute__((warn_unused_result));
+
  /**
   * Destroy a fixed-base table.  Frees any memory that we allocated
   * for the combs.
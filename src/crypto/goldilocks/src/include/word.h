@@ -23,6 +23,11 @@
 #define __BYTE_ORDER __LITTLE_ENDIAN
 #endif
 #else
+/* glibc 2.20 and later want _DEFAULT_SOURCE and warn about _BSD_SOURCE
+   on its own; older versions and other C libraries want _BSD_SOURCE */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE 1
+#endif
 #ifndef _BSD_SOURCE
 #define _BSD_SOURCE 1
 #endif
@@ -267,7 +267,7 @@ schedule_scalar_for_combs (
 mask_t
 scalarmul_fixed_base (
     tw_extensible_a_t out,
-    const word_t scalar[SCALAR_WORDS],
+    const word_t *scalar,
     unsigned int nbits,
     const struct fixed_base_table_t* table
 ) {
@@ -408,6 +408,22 @@ precompute_fixed_base (
   unsigned int t,
   unsigned int s,
   tw_niels_a_t *prealloc
+) {
+    return precompute_fixed_base_scratch(out, base, n, t, s, prealloc,
+                                         NULL, NULL, NULL);
+}
+
+mask_t
+precompute_fixed_base_scratch (
+  struct fixed_base_table_t* out,
+  const tw_extensible_a_t base,
+  unsigned int n,
+  unsigned int t,
+  unsigned int s,
+  tw_niels_a_t *prealloc,
+  tw_pniels_a_t *scratch_doubles,
+  field_a_t *scratch_zs,
+  field_a_t *scratch_zis
 ) {
     if (s < 1 || t < 1 || n < 1 || n*t*s < SCALAR_BITS) {
         really_memset(out, 0, sizeof(*out));
@@ -422,9 +438,15 @@ precompute_fixed_base (
     copy_tw_extensible(working, base);
     tw_pniels_a_t pn_tmp;
   
-    tw_pniels_a_t *doubles = (tw_pniels_a_t *) malloc_vector(sizeof(*doubles) * (t-1));
-    field_a_t *zs  = (field_a_t *) malloc_vector(sizeof(*zs) * (n<<(t-1)));
-    field_a_t *zis = (field_a_t *) malloc_vector(sizeof(*zis) * (n<<(t-1)));
+    int own_scratch = !scratch_doubles || !scratch_zs || !scratch_zis;
+    tw_pniels_a_t *doubles = scratch_doubles;
+    field_a_t *zs  = scratch_zs;
+    field_a_t *zis = scratch_zis;
+    if (own_scratch) {
+        doubles = (tw_pniels_a_t *) malloc_vector(sizeof(*doubles) * (t-1));
+        zs  = (field_a_t *) malloc_vector(sizeof(*zs) * (n<<(t-1)));
+        zis = (field_a_t *) malloc_vector(sizeof(*zis) * (n<<(t-1)));
+    }
     
     tw_niels_a_t *table = prealloc;
     if (prealloc) {
@@ -436,9 +458,11 @@ precompute_fixed_base (
     out->table = table;
   
     if (!doubles || !zs || !zis || !table) {
-        free(doubles);
-        free(zs);
-        free(zis);
+        if (own_scratch) {
+            free(doubles);
+            free(zs);
+            free(zis);
+        }
         really_memset(out, 0, sizeof(*out));
         really_memset(table, 0, sizeof(*table) * (n<<(t-1)));
         if (!prealloc) free(table);
@@ -549,9 +573,11 @@ precompute_fixed_base (
 	
 	mask_t ret = ~field_is_zero(zis[0]);
 
-    free(doubles);
-    free(zs);
-    free(zis);
+    if (own_scratch) {
+        free(doubles);
+        free(zs);
+        free(zis);
+    }
 
     if (unlikely(!ret)) {
         really_memset(table, 0, sizeof(*table) * (n<<(t-1)));
@@ -733,7 +759,7 @@ prepare_wnaf_table(
 void
 scalarmul_vt (
     tw_extensible_a_t working,
-    const word_t scalar[SCALAR_WORDS],
+    const word_t *scalar,
     unsigned int nbits
 ) {
     const int table_bits = SCALARMUL_WNAF_TABLE_BITS;
@@ -774,7 +800,7 @@ scalarmul_vt (
 void
 scalarmul_fixed_base_wnaf_vt (
     tw_extensible_a_t working,
-    const word_t scalar[SCALAR_WORDS],
+    const word_t *scalar,
     unsigned int nbits,
     const tw_niels_a_t *precmp,
     unsigned int table_bits
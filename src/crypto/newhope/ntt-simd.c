@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "ntt.h"
+#include "params.h"
+
+#if defined(CPU_X86_DISPATCH)
+
+#include <immintrin.h>
+
+/* NewHope polynomial arithmetic kernels for x86.
+
+   The AVX2 kernels process 8 coefficients at a time, widened to 32-bit
+   lanes so that every intermediate value wraps exactly as it does in the
+   reference code in ntt.c, poly.c, and reduce.c.  The reductions are
+   incomplete, so the coefficients that come out of the NTT are not fully
+   reduced modulo q and must match the reference bit for bit or the
+   serialized polynomials would differ between implementations.
+
+   The multiplications by q and by -1/q mod 2^18 in the Montgomery and
+   Barrett reductions are done with shifts and adds, which is cheaper than
+   _mm256_mullo_epi32() and gives the same result modulo 2^32. */
+
+/* Load 8 coefficients and widen them to 32 bits */
+#define AVX2_LOAD(p) \
+    (_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p))))
+
+/* Narrow 8 coefficients to 16 bits and store them.  The values must
+   already be in the range 0..65535 */
+#define AVX2_STORE(p, x) \
+    do { \
+        __m256i packed = _mm256_packus_epi32((x), (x)); \
+        packed = _mm256_permute4x64_epi64(packed, 0x08); \
+        _mm_storeu_si128((__m128i *)(p), _mm256_castsi256_si128(packed)); \
+    } while (0)
+
+/* Truncate each lane to 16 bits, as for an assignment to uint16_t */
+#define AVX2_TRUNC16(x) (_mm256_and_si256((x), _mm256_set1_epi32(0xFFFF)))
+
+/* Multiply each lane by q = 12289 = 2^13 + 2^12 + 1 */
+#define AVX2_MUL_Q(x) \
+    (_mm256_add_epi32 \
+        (_mm256_add_epi32(_mm256_slli_epi32((x), 13), \
+                          _mm256_slli_epi32((x), 12)), (x)))
+
+/* Vector version of montgomery_reduce(); the multiplier is
+   qinv = 12287 = 2^13 + 2^12 - 1 */
+#define AVX2_MONTGOMERY(a) \
+    (_mm256_srli_epi32 \
+        (_mm256_add_epi32 \
+            ((a), AVX2_MUL_Q(_mm256_and_si256 \
+                (_mm256_sub_epi32 \
+                    (_mm256_add_epi32(_mm256_slli_epi32((a), 13), \
+                                      _mm256_slli_epi32((a), 12)), (a)), \
+                 _mm256_set1_epi32((1 << 18) - 1)))), 18))
+
+/* Vector version of barrett_reduce(); the input must already have been
+   truncated to 16 bits */
+#define AVX2_BARRETT(a) \
+    (AVX2_TRUNC16(_mm256_sub_epi32 \
+        ((a), AVX2_MUL_Q(_mm256_srli_epi32 \
+            (_mm256_add_epi32(_mm256_slli_epi32((a), 2), (a)), 16)))))
+
+/* Gentleman-Sande butterfly from ntt() on 8 pairs of coefficients.
+   Odd levels of the NTT reduce the sum and even levels leave it lazy */
+#define AVX2_BUTTERFLY(x, y, w, odd) \
+    do { \
+        __m256i diff = _mm256_sub_epi32 \
+            (_mm256_add_epi32((x), _mm256_set1_epi32(3 * PARAM_Q)), (y)); \
+        (x) = AVX2_TRUNC16(_mm256_add_epi32((x), (y))); \
+        if ((odd)) \
+            (x) = AVX2_BARRETT((x)); \
+        (y) = AVX2_MONTGOMERY(_mm256_mullo_epi32((w), diff)); \
+    } while (0)
+
+CPU_TARGET("avx2")
+void ntt_avx2(uint16_t *a, const uint16_t *omega)
+{
+    const __m256i perm0 = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+    const __m256i perm1 = _mm256_setr_epi32(0, 0, 2, 2, 1, 1, 3, 3);
+    const __m256i perm2 = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    __m256i v0, v1, x, y, w;
+    int level, distance, start, j, k;
+
+    /* The first three levels only combine coefficients that are less
+       than 8 apart.  Do them together on 16 coefficients at a time,
+       shuffling each level's pairs into matching lanes of x and y */
+    for (start = 0; start < PARAM_N; start += 16) {
+        v0 = AVX2_LOAD(a + start);
+        v1 = AVX2_LOAD(a + start + 8);
+
+        /* Level 0, distance 1: pair up the even and odd coefficients */
+        v0 = _mm256_shuffle_epi32(v0, 0xD8);
+        v1 = _mm256_shuffle_epi32(v1, 0xD8);
+        x = _mm256_unpacklo_epi64(v0, v1);
+        y = _mm256_unpackhi_epi64(v0, v1);
+        w = _mm256_permutevar8x32_epi32(AVX2_LOAD(omega + start / 2), perm0);
+        AVX2_BUTTERFLY(x, y, w, 0);
+        v0 = _mm256_shuffle_epi32(_mm256_unpacklo_epi64(x, y), 0xD8);
+        v1 = _mm256_shuffle_epi32(_mm256_unpackhi_epi64(x, y), 0xD8);
+
+        /* Level 1, distance 2 */
+        x = _mm256_unpacklo_epi64(v0, v1);
+        y = _mm256_unpackhi_epi64(v0, v1);
+        w = _mm256_permutevar8x32_epi32(AVX2_LOAD(omega + start / 4), perm1);
+        AVX2_BUTTERFLY(x, y, w, 1);
+        v0 = _mm256_unpacklo_epi64(x, y);
+        v1 = _mm256_unpackhi_epi64(x, y);
+
+        /* Level 2, distance 4 */
+        x = _mm256_permute2x128_si256(v0, v1, 0x20);
+        y = _mm256_permute2x128_si256(v0, v1, 0x31);
+        w = _mm256_permutevar8x32_epi32(AVX2_LOAD(omega + start / 8), perm2);
+        AVX2_BUTTERFLY(x, y, w, 0);
+        v0 = _mm256_permute2x128_si256(x, y, 0x20);
+        v1 = _mm256_permute2x128_si256(x, y, 0x31);
+
+        AVX2_STORE(a + start, v0);
+        AVX2_STORE(a + start + 8, v1);
+    }
+
+    /* The remaining levels are whole vectors apart, and every butterfly
+       in a block uses the same twiddle factor */
+    for (level = 3; level < 10; ++level) {
+        distance = 1 << level;
+        for (start = 0, k = 0; start < PARAM_N; start += 2 * distance, ++k) {
+            w = _mm256_set1_epi32(omega[k]);
+            for (j = start; j < start + distance; j += 8) {
+                x = AVX2_LOAD(a + j);
+                y = AVX2_LOAD(a + j + distance);
+                AVX2_BUTTERFLY(x, y, w, level & 1);
+                AVX2_STORE(a + j, x);
+                AVX2_STORE(a + j + distance, y);
+            }
+        }
+    }
+}
+
+CPU_TARGET("avx2")
+void mul_coefficients_avx2(uint16_t *poly, const uint16_t *factors)
+{
+    __m256i x;
+    int i;
+    for (i = 0; i < PARAM_N; i += 8) {
+        x = _mm256_mullo_epi32(AVX2_LOAD(poly + i), AVX2_LOAD(factors + i));
+        x = AVX2_MONTGOMERY(x);
+        AVX2_STORE(poly + i, x);
+    }
+}
+
+CPU_TARGET("avx2")
+void poly_pointwise_avx2(uint16_t *r, const uint16_t *a, const uint16_t *b)
+{
+    const __m256i rsq = _mm256_set1_epi32(3186); /* 2^36 mod q */
+    __m256i t;
+    int i;
+    for (i = 0; i < PARAM_N; i += 8) {
+        /* Convert b to the Montgomery domain, and then multiply by a to
+           bring the product back to the normal domain */
+        t = AVX2_MONTGOMERY(_mm256_mullo_epi32(AVX2_LOAD(b + i), rsq));
+        t = AVX2_MONTGOMERY(_mm256_mullo_epi32(AVX2_LOAD(a + i), t));
+        AVX2_STORE(r + i, t);
+    }
+}
+
+CPU_TARGET("avx2")
+void poly_add_avx2(uint16_t *r, const uint16_t *a, const uint16_t *b)
+{
+    __m256i x;
+    int i;
+    for (i = 0; i < PARAM_N; i += 8) {
+        x = _mm256_add_epi32(AVX2_LOAD(a + i), AVX2_LOAD(b + i));
+        x = AVX2_BARRETT(AVX2_TRUNC16(x));
+        AVX2_STORE(r + i, x);
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
@@ -59,6 +59,14 @@ void mul_coefficients(uint16_t* poly, const uint16_t* factors)
 {
     unsigned int i;
 
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_AVX2))
+    {
+      mul_coefficients_avx2(poly, factors);
+      return;
+    }
+#endif
+
     for(i = 0; i < PARAM_N; i++)
       poly[i] = montgomery_reduce((poly[i] * factors[i]));
 }
@@ -71,6 +79,13 @@ void ntt(uint16_t * a, const uint16_t* omega)
   int i, start, j, jTwiddle, distance;
   uint16_t temp, W;
 
+#if defined(CPU_X86_DISPATCH)
+  if (cpu_has_features(CPU_FEATURE_AVX2))
+  {
+    ntt_avx2(a, omega);
+    return;
+  }
+#endif
 
   for(i=0;i<10;i+=2)
   {
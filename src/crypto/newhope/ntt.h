@@ -2,6 +2,7 @@
 #define NTT_H
 
 #include "inttypes.h"
+#include "../cpu/cpu.h"
 
 extern uint16_t omegas_montgomery[];
 extern uint16_t omegas_inv_montgomery[];
@@ -13,4 +14,12 @@ void bitrev_vector(uint16_t* poly);
 void mul_coefficients(uint16_t* poly, const uint16_t* factors);
 void ntt(uint16_t* poly, const uint16_t* omegas);
 
+#if defined(CPU_X86_DISPATCH)
+/* Polynomial arithmetic kernels, selected at runtime; see ntt-simd.c */
+void ntt_avx2(uint16_t *a, const uint16_t *omega);
+void mul_coefficients_avx2(uint16_t *poly, const uint16_t *factors);
+void poly_pointwise_avx2(uint16_t *r, const uint16_t *a, const uint16_t *b);
+void poly_add_avx2(uint16_t *r, const uint16_t *a, const uint16_t *b);
+#endif
+
 #endif
@@ -132,6 +132,13 @@ void poly_pointwise(poly *r, const poly *a, const poly *b)
 {
   int i;
   uint16_t t;
+#if defined(CPU_X86_DISPATCH)
+  if (cpu_has_features(CPU_FEATURE_AVX2))
+  {
+    poly_pointwise_avx2(r->coeffs, a->coeffs, b->coeffs);
+    return;
+  }
+#endif
   for(i=0;i<PARAM_N;i++)
   {
     t       = montgomery_reduce(3186*b->coeffs[i]); /* t is now in Montgomery domain */
@@ -142,6 +149,13 @@ void poly_pointwise(poly *r, const poly *a, const poly *b)
 void poly_add(poly *r, const poly *a, const poly *b)
 {
   int i;
+#if defined(CPU_X86_DISPATCH)
+  if (cpu_has_features(CPU_FEATURE_AVX2))
+  {
+    poly_add_avx2(r->coeffs, a->coeffs, b->coeffs);
+    return;
+  }
+#endif
   for(i=0;i<PARAM_N;i++)
     r->coeffs[i] = barrett_reduce(a->coeffs[i] + b->coeffs[i]);
 }
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sha256.h"
+
+#if defined(CPU_X86_DISPATCH)
+
+#include <immintrin.h>
+
+/* SHA-256 compression kernels for x86.
+
+   The SHA-NI kernel processes a single stream with the SHA extensions.
+   The hash state is kept in the "ABEF" and "CDGH" register layout that
+   the sha256rnds2 instruction expects, and the message schedule is
+   computed four words at a time with sha256msg1 and sha256msg2.
+
+   The AVX2 kernel compresses one block for each of 8 independent hashes
+   at once.  The state is transposed so that each vector register holds
+   the same word for every lane, with the chaining values stored as
+   h[word * 8 + lane]. */
+
+/* Round constants */
+static uint32_t const sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* ------------------------- SHA-NI: single stream ------------------------- */
+
+/* Four rounds with the message words in "msg" and round constants "n" */
+#define SHA_NI_ROUNDS(msg, n) \
+    do { \
+        tmp = _mm_add_epi32 \
+            ((msg), _mm_loadu_si128((const __m128i *)(sha256_k + (n)))); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, tmp); \
+        tmp = _mm_shuffle_epi32(tmp, 0x0E); \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, tmp); \
+    } while (0)
+
+/* Completes the next four schedule words in "next", which has already
+   been through sha256msg1, from the current and previous words */
+#define SHA_NI_SCHEDULE(next, cur, prev) \
+    ((next) = _mm_sha256msg2_epu32 \
+        (_mm_add_epi32((next), _mm_alignr_epi8((cur), (prev), 4)), (cur)))
+
+/* Loads four big-endian message words */
+#define SHA_NI_LOAD(offset) \
+    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(m + (offset))), bswap)
+
+CPU_TARGET("sha,sse4.1")
+void sha256_compress_shani(uint32_t *h, const uint8_t *m, size_t blocks)
+{
+    const __m128i bswap = _mm_setr_epi8
+        (3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m128i state0, state1, save0, save1, tmp;
+    __m128i m0, m1, m2, m3;
+
+    /* Rearrange the state into ABEF and CDGH order */
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)h), 0xB1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(h + 4)), 0x1B);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks > 0) {
+        save0 = state0;
+        save1 = state1;
+
+        m0 = SHA_NI_LOAD(0);
+        SHA_NI_ROUNDS(m0, 0);
+        m1 = SHA_NI_LOAD(16);
+        SHA_NI_ROUNDS(m1, 4);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        m2 = SHA_NI_LOAD(32);
+        SHA_NI_ROUNDS(m2, 8);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        m3 = SHA_NI_LOAD(48);
+        SHA_NI_ROUNDS(m3, 12);
+        SHA_NI_SCHEDULE(m0, m3, m2);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+
+        SHA_NI_ROUNDS(m0, 16);
+        SHA_NI_SCHEDULE(m1, m0, m3);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHA_NI_ROUNDS(m1, 20);
+        SHA_NI_SCHEDULE(m2, m1, m0);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHA_NI_ROUNDS(m2, 24);
+        SHA_NI_SCHEDULE(m3, m2, m1);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        SHA_NI_ROUNDS(m3, 28);
+        SHA_NI_SCHEDULE(m0, m3, m2);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+
+        SHA_NI_ROUNDS(m0, 32);
+        SHA_NI_SCHEDULE(m1, m0, m3);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHA_NI_ROUNDS(m1, 36);
+        SHA_NI_SCHEDULE(m2, m1, m0);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        SHA_NI_ROUNDS(m2, 40);
+        SHA_NI_SCHEDULE(m3, m2, m1);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        SHA_NI_ROUNDS(m3, 44);
+        SHA_NI_SCHEDULE(m0, m3, m2);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+
+        SHA_NI_ROUNDS(m0, 48);
+        SHA_NI_SCHEDULE(m1, m0, m3);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        SHA_NI_ROUNDS(m1, 52);
+        SHA_NI_SCHEDULE(m2, m1, m0);
+        SHA_NI_ROUNDS(m2, 56);
+        SHA_NI_SCHEDULE(m3, m2, m1);
+        SHA_NI_ROUNDS(m3, 60);
+
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+        m += 64;
+        --blocks;
+    }
+
+    /* Put the state back into ABCD and EFGH order */
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i *)h, state0);
+    _mm_storeu_si128((__m128i *)(h + 4), state1);
+}
+
+/* ----------------------------- AVX2: 8 lanes ----------------------------- */
+
+#define AVX2_ROTR(x, n) \
+    _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define AVX2_XOR3(x, y, z) \
+    _mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+#define AVX2_SIGMA0(x) \
+    AVX2_XOR3(AVX2_ROTR((x), 7), AVX2_ROTR((x), 18), _mm256_srli_epi32((x), 3))
+#define AVX2_SIGMA1(x) \
+    AVX2_XOR3(AVX2_ROTR((x), 17), AVX2_ROTR((x), 19), _mm256_srli_epi32((x), 10))
+#define AVX2_BSIG0(x) \
+    AVX2_XOR3(AVX2_ROTR((x), 2), AVX2_ROTR((x), 13), AVX2_ROTR((x), 22))
+#define AVX2_BSIG1(x) \
+    AVX2_XOR3(AVX2_ROTR((x), 6), AVX2_ROTR((x), 11), AVX2_ROTR((x), 25))
+#define AVX2_CH(e, f, g) \
+    _mm256_xor_si256(_mm256_and_si256((e), (f)), _mm256_andnot_si256((e), (g)))
+#define AVX2_MAJ(a, b, c) \
+    _mm256_or_si256(_mm256_and_si256((a), (b)), \
+                    _mm256_and_si256((c), _mm256_or_si256((a), (b))))
+
+/* One round on the transposed state, with the variables named as in the
+   specification and rotated by the caller from one round to the next */
+#define AVX2_ROUND(a, b, c, d, e, f, g, h, i) \
+    do { \
+        __m256i t1 = _mm256_add_epi32 \
+            (_mm256_add_epi32((h), AVX2_BSIG1(e)), \
+             _mm256_add_epi32(AVX2_CH((e), (f), (g)), \
+                              _mm256_add_epi32 \
+                                (_mm256_set1_epi32((int)(sha256_k[i])), \
+                                 w[(i) & 15]))); \
+        __m256i t2 = _mm256_add_epi32(AVX2_BSIG0(a), AVX2_MAJ((a), (b), (c))); \
+        (d) = _mm256_add_epi32((d), t1); \
+        (h) = _mm256_add_epi32(t1, t2); \
+    } while (0)
+
+CPU_TARGET("avx2")
+void sha256_compress_x8_avx2(uint32_t *h, const uint8_t * const *blocks)
+{
+    const __m256i bswap = _mm256_setr_epi8
+        (3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+         3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    __m256i w[16];
+    __m256i s[8];
+    __m256i a, b, c, d, e, f, g, hh;
+    int index;
+
+    /* Transpose the message blocks, eight words from each lane at a time,
+       and convert the words from big-endian */
+    for (index = 0; index < 16; index += 8) {
+        __m256i r[8], t0, t1, t2, t3, u0, u1, u2, u3;
+        int lane;
+        for (lane = 0; lane < 8; ++lane) {
+            r[lane] = _mm256_shuffle_epi8(_mm256_loadu_si256
+                ((const __m256i *)(blocks[lane] + index * 4)), bswap);
+        }
+        t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+        t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+        t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+        t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+        u0 = _mm256_unpacklo_epi64(t0, t2);
+        u1 = _mm256_unpackhi_epi64(t0, t2);
+        u2 = _mm256_unpacklo_epi64(t1, t3);
+        u3 = _mm256_unpackhi_epi64(t1, t3);
+        t0 = _mm256_unpacklo_epi32(r[4], r[5]);
+        t1 = _mm256_unpackhi_epi32(r[4], r[5]);
+        t2 = _mm256_unpacklo_epi32(r[6], r[7]);
+        t3 = _mm256_unpackhi_epi32(r[6], r[7]);
+        r[4] = _mm256_unpacklo_epi64(t0, t2);
+        r[5] = _mm256_unpackhi_epi64(t0, t2);
+        r[6] = _mm256_unpacklo_epi64(t1, t3);
+        r[7] = _mm256_unpackhi_epi64(t1, t3);
+        w[index]     = _mm256_permute2x128_si256(u0, r[4], 0x20);
+        w[index + 1] = _mm256_permute2x128_si256(u1, r[5], 0x20);
+        w[index + 2] = _mm256_permute2x128_si256(u2, r[6], 0x20);
+        w[index + 3] = _mm256_permute2x128_si256(u3, r[7], 0x20);
+        w[index + 4] = _mm256_permute2x128_si256(u0, r[4], 0x31);
+        w[index + 5] = _mm256_permute2x128_si256(u1, r[5], 0x31);
+        w[index + 6] = _mm256_permute2x128_si256(u2, r[6], 0x31);
+        w[index + 7] = _mm256_permute2x128_si256(u3, r[7], 0x31);
+    }
+
+    /* Load the chaining values */
+    for (index = 0; index < 8; ++index)
+        s[index] = _mm256_loadu_si256((const __m256i *)(h + index * 8));
+    a = s[0];
+    b = s[1];
+    c = s[2];
+    d = s[3];
+    e = s[4];
+    f = s[5];
+    g = s[6];
+    hh = s[7];
+
+    /* Perform the 64 rounds, extending the message schedule in a
+       16-word circular buffer as we go */
+    for (index = 0; index < 64; index += 8) {
+        if (index >= 16) {
+            int i;
+            for (i = index; i < index + 8; ++i) {
+                w[i & 15] = _mm256_add_epi32
+                    (_mm256_add_epi32(w[i & 15], AVX2_SIGMA0(w[(i - 15) & 15])),
+                     _mm256_add_epi32(w[(i - 7) & 15],
+                                      AVX2_SIGMA1(w[(i - 2) & 15])));
+            }
+        }
+        AVX2_ROUND(a, b, c, d, e, f, g, hh, index);
+        AVX2_ROUND(hh, a, b, c, d, e, f, g, index + 1);
+        AVX2_ROUND(g, hh, a, b, c, d, e, f, index + 2);
+        AVX2_ROUND(f, g, hh, a, b, c, d, e, index + 3);
+        AVX2_ROUND(e, f, g, hh, a, b, c, d, index + 4);
+        AVX2_ROUND(d, e, f, g, hh, a, b, c, index + 5);
+        AVX2_ROUND(c, d, e, f, g, hh, a, b, index + 6);
+        AVX2_ROUND(b, c, d, e, f, g, hh, a, index + 7);
+    }
+
+    /* Add the compressed block to the chaining values */
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+    s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g);
+    s[7] = _mm256_add_epi32(s[7], hh);
+    for (index = 0; index < 8; ++index)
+        _mm256_storeu_si256((__m256i *)(h + index * 8), s[index]);
+}
+
+#endif /* CPU_X86_DISPATCH */
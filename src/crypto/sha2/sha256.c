@@ -39,6 +39,9 @@ void sha256_reset(sha256_context_t *context)
 
 #define rightRotate(v, n) (((v) >> (n)) | ((v) << (32 - (n))))
 
+/* Features that are required for the SHA-NI kernel */
+#define SHA256_SHANI_FEATURES (CPU_FEATURE_SHA | CPU_FEATURE_SSE41)
+
 static void sha256_transform(sha256_context_t *context, const uint8_t *m)
 {
     static uint32_t const k[64] = {
@@ -63,6 +66,13 @@ static void sha256_transform(sha256_context_t *context, const uint8_t *m)
     uint32_t temp1, temp2;
     uint32_t w[64];
 
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(SHA256_SHANI_FEATURES)) {
+        sha256_compress_shani(context->h, m, 1);
+        return;
+    }
+#endif
+
     /* Initialize working variables to the current hash value */
     uint32_t a = context->h[0];
     uint32_t b = context->h[1];
@@ -179,3 +189,175 @@ void sha256_finish(sha256_context_t *context, uint8_t *hash)
     for (posn = 0; posn < 8; ++posn)
         write_be32(hash + posn * 4, context->h[posn]);
 }
+
+#if defined(CPU_X86_DISPATCH)
+
+/* Number of lanes in the multi-lane kernel */
+#define SHA256_LANES 8
+
+/* Get block "block" of the remaining input for a lane, which consists of
+   the bytes that are buffered in the context, then the lane's data, and
+   then the padding and the length in bits.  Returns a pointer directly
+   into the data where possible, or formats the block in "buf" otherwise */
+static const uint8_t *sha256_lane_block
+    (const sha256_context_t *context, const uint8_t *data, size_t size,
+     size_t block, size_t num_blocks, uint8_t *buf)
+{
+    size_t start = block * 64;
+    size_t total = context->posn + size;
+    size_t posn = 0;
+    size_t len;
+    uint64_t length;
+    if (context->posn == 0 && (start + 64) <= size)
+        return data + start;
+    if (start < context->posn) {
+        posn = context->posn - start;
+        memcpy(buf, context->m + start, posn);
+    }
+    if ((start + posn) < total && posn < 64) {
+        len = total - (start + posn);
+        if (len > (64 - posn))
+            len = 64 - posn;
+        memcpy(buf + posn, data + (start + posn - context->posn), len);
+        posn += len;
+    }
+    if (posn < 64) {
+        if ((start + posn) == total)
+            buf[posn++] = 0x80;
+        memset(buf + posn, 0, 64 - posn);
+    }
+    if ((block + 1) == num_blocks) {
+        length = context->length + ((uint64_t)size) * 8;
+        write_be32(buf + 64 - 8, (uint32_t)(length >> 32));
+        write_be32(buf + 64 - 4, (uint32_t)length);
+    }
+    return buf;
+}
+
+/* Finish up to eight hashes with the multi-lane kernel.  The lanes
+   advance through their inputs one block at a time in lockstep.  Unused
+   lanes and lanes that have already finished hash a block of zeroes,
+   and their results are discarded */
+static void sha256_finish_lanes
+    (sha256_context_t * const *contexts, const uint8_t * const *data,
+     const size_t *sizes, uint8_t * const *hashes, size_t count)
+{
+    static uint8_t const zero_block[64] = {0};
+    uint32_t h[8 * SHA256_LANES];
+    const uint8_t *blocks[SHA256_LANES];
+    uint8_t bufs[SHA256_LANES][64];
+    size_t num_blocks[SHA256_LANES];
+    size_t max_blocks = 0;
+    size_t lane, block, word;
+
+    /* Transpose the chaining values and count the remaining blocks,
+       including one or two blocks of padding */
+    for (lane = 0; lane < SHA256_LANES; ++lane) {
+        if (lane < count) {
+            for (word = 0; word < 8; ++word)
+                h[word * SHA256_LANES + lane] = contexts[lane]->h[word];
+            num_blocks[lane] = (contexts[lane]->posn + sizes[lane] + 8) / 64 + 1;
+            if (num_blocks[lane] > max_blocks)
+                max_blocks = num_blocks[lane];
+        } else {
+            for (word = 0; word < 8; ++word)
+                h[word * SHA256_LANES + lane] = 0;
+            num_blocks[lane] = 0;
+        }
+    }
+
+    /* Compress the blocks for all lanes in lockstep */
+    for (block = 0; block < max_blocks; ++block) {
+        for (lane = 0; lane < SHA256_LANES; ++lane) {
+            if (block < num_blocks[lane]) {
+                blocks[lane] = sha256_lane_block
+                    (contexts[lane], data[lane], sizes[lane],
+                     block, num_blocks[lane], bufs[lane]);
+            } else {
+                blocks[lane] = zero_block;
+            }
+        }
+        sha256_compress_x8_avx2(h, blocks);
+
+        /* Copy out the hash values for the lanes that just finished */
+        for (lane = 0; lane < count; ++lane) {
+            if ((block + 1) != num_blocks[lane])
+                continue;
+            for (word = 0; word < 8; ++word) {
+                write_be32(hashes[lane] + word * 4,
+                           h[word * SHA256_LANES + lane]);
+            }
+        }
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
+
+/* Finish "count" independent hashes, where each context is first updated
+   with the corresponding data.  The contexts can have already absorbed
+   different amounts of data, such as the precomputed inner and outer
+   contexts for HMAC.  The hashes are computed several at a time with the
+   multi-lane kernel where the CPU supports it, which works best when the
+   data for each context is of similar length.  The contexts are left in
+   an undefined state and must be reset before they are reused. */
+void sha256_finish_many(sha256_context_t * const *contexts,
+                        const uint8_t * const *data, const size_t *sizes,
+                        uint8_t * const *hashes, size_t count)
+{
+    size_t index;
+#if defined(CPU_X86_DISPATCH)
+    size_t lanes;
+
+    /* SHA-NI hashes a single stream faster than the AVX2 kernel can
+       hash eight, so only use the lanes when SHA-NI is not available */
+    while (count >= 2 && cpu_has_features(CPU_FEATURE_AVX2) &&
+           !cpu_has_features(SHA256_SHANI_FEATURES)) {
+        lanes = count < SHA256_LANES ? count : SHA256_LANES;
+        sha256_finish_lanes(contexts, data, sizes, hashes, lanes);
+        contexts += lanes;
+        data += lanes;
+        sizes += lanes;
+        hashes += lanes;
+        count -= lanes;
+    }
+#endif
+    for (index = 0; index < count; ++index) {
+        sha256_update(contexts[index], data[index], sizes[index]);
+        sha256_finish(contexts[index], hashes[index]);
+    }
+}
+
+/* Hash "count" independent inputs, writing the 32-byte hash values to
+   the buffers in "hashes" */
+void sha256_hash_many(const uint8_t * const *data, const size_t *sizes,
+                      uint8_t * const *hashes, size_t count)
+{
+    sha256_context_t contexts[8];
+    sha256_context_t *context_ptrs[8];
+    size_t index, batch;
+    while (count > 0) {
+        batch = count < 8 ? count : 8;
+        for (index = 0; index < batch; ++index) {
+            sha256_reset(&(contexts[index]));
+            context_ptrs[index] = &(contexts[index]);
+        }
+        sha256_finish_many(context_ptrs, data, sizes, hashes, batch);
+        data += batch;
+        sizes += batch;
+        hashes += batch;
+        count -= batch;
+    }
+}
+
+/* Get the number of inputs that sha256_finish_many() and sha256_hash_many()
+   hash in parallel with the current CPU features, or 1 if they hash them
+   one at a time */
+size_t sha256_hash_many_lanes(void)
+{
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_AVX2) &&
+            !cpu_has_features(SHA256_SHANI_FEATURES))
+        return SHA256_LANES;
+#endif
+    return 1;
+}
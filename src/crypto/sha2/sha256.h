@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../cpu/cpu.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,18 @@ typedef struct
 void sha256_reset(sha256_context_t *context);
 void sha256_update(sha256_context_t *context, const void *data, size_t size);
 void sha256_finish(sha256_context_t *context, uint8_t *hash);
+void sha256_finish_many(sha256_context_t * const *contexts,
+                        const uint8_t * const *data, const size_t *sizes,
+                        uint8_t * const *hashes, size_t count);
+void sha256_hash_many(const uint8_t * const *data, const size_t *sizes,
+                      uint8_t * const *hashes, size_t count);
+size_t sha256_hash_many_lanes(void);
+
+#if defined(CPU_X86_DISPATCH)
+/* Compression kernels, selected at runtime; see sha256-simd.c */
+void sha256_compress_shani(uint32_t *h, const uint8_t *m, size_t blocks);
+void sha256_compress_x8_avx2(uint32_t *h, const uint8_t * const *blocks);
+#endif
 
 #ifdef __cplusplus
 };
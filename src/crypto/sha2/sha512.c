@@ -204,3 +204,169 @@ void sha512_hash(uint8_t *hash, const void *data, size_t size)
     sha512_update(&context, data, size);
     sha512_finish(&context, hash);
 }
+
+#if defined(CPU_X86_DISPATCH)
+
+/* Number of lanes in the multi-buffer kernel */
+#define SHA512_LANES 4
+
+/* Get block "block" of the remaining input for a lane, which consists of
+   the bytes that are buffered in the context, then the lane's data, and
+   then the padding and the length in bits.  Returns a pointer directly
+   into the data where possible, or formats the block in "buf" otherwise */
+static const uint8_t *sha512_lane_block
+    (const sha512_context_t *context, const uint8_t *data, size_t size,
+     size_t block, size_t num_blocks, uint8_t *buf)
+{
+    size_t start = block * 128;
+    size_t total = context->posn + size;
+    size_t posn = 0;
+    size_t len;
+    if (context->posn == 0 && (start + 128) <= size)
+        return data + start;
+    if (start < context->posn) {
+        posn = context->posn - start;
+        memcpy(buf, context->m + start, posn);
+    }
+    if ((start + posn) < total && posn < 128) {
+        len = total - (start + posn);
+        if (len > (128 - posn))
+            len = 128 - posn;
+        memcpy(buf + posn, data + (start + posn - context->posn), len);
+        posn += len;
+    }
+    if (posn < 128) {
+        if ((start + posn) == total)
+            buf[posn++] = 0x80;
+        memset(buf + posn, 0, 128 - posn);
+    }
+    if ((block + 1) == num_blocks) {
+        write_be64(buf + 128 - 16, 0);
+        write_be64(buf + 128 - 8, context->length + ((uint64_t)size) * 8);
+    }
+    return buf;
+}
+
+/* Finish up to four hashes with the multi-buffer kernel.  The lanes
+   advance through their inputs one block at a time in lockstep.  Unused
+   lanes and lanes that have already finished hash a block of zeroes,
+   and their results are discarded */
+static void sha512_finish_lanes
+    (sha512_context_t * const *contexts, const uint8_t * const *data,
+     const size_t *sizes, uint8_t * const *hashes, size_t count)
+{
+    static uint8_t const zero_block[128] = {0};
+    uint64_t h[8 * SHA512_LANES];
+    const uint8_t *blocks[SHA512_LANES];
+    uint8_t bufs[SHA512_LANES][128];
+    size_t num_blocks[SHA512_LANES];
+    size_t max_blocks = 0;
+    size_t lane, block, word;
+
+    /* Transpose the chaining values and count the remaining blocks,
+       including one or two blocks of padding */
+    for (lane = 0; lane < SHA512_LANES; ++lane) {
+        if (lane < count) {
+            for (word = 0; word < 8; ++word)
+                h[word * SHA512_LANES + lane] = contexts[lane]->h[word];
+            num_blocks[lane] =
+                (contexts[lane]->posn + sizes[lane] + 16) / 128 + 1;
+            if (num_blocks[lane] > max_blocks)
+                max_blocks = num_blocks[lane];
+        } else {
+            for (word = 0; word < 8; ++word)
+                h[word * SHA512_LANES + lane] = 0;
+            num_blocks[lane] = 0;
+        }
+    }
+
+    /* Compress the blocks for all lanes in lockstep */
+    for (block = 0; block < max_blocks; ++block) {
+        for (lane = 0; lane < SHA512_LANES; ++lane) {
+            if (block < num_blocks[lane]) {
+                blocks[lane] = sha512_lane_block
+                    (contexts[lane], data[lane], sizes[lane],
+                     block, num_blocks[lane], bufs[lane]);
+            } else {
+                blocks[lane] = zero_block;
+            }
+        }
+        sha512_compress_x4_avx2(h, blocks);
+
+        /* Copy out the hash values for the lanes that just finished */
+        for (lane = 0; lane < count; ++lane) {
+            if ((block + 1) != num_blocks[lane])
+                continue;
+            for (word = 0; word < 8; ++word) {
+                write_be64(hashes[lane] + word * 8,
+                           h[word * SHA512_LANES + lane]);
+            }
+        }
+    }
+}
+
+#endif /* CPU_X86_DISPATCH */
+
+/* Finish "count" independent hashes, where each context is first updated
+   with the corresponding data.  The contexts can have already absorbed
+   different amounts of data, such as the precomputed inner and outer
+   contexts for HMAC or the R and A prefixes for Ed25519.  The hashes are
+   computed several at a time with the multi-buffer kernel where the CPU
+   supports it.  The contexts are left in an undefined state and must be
+   reset before they are reused. */
+void sha512_finish_many(sha512_context_t * const *contexts,
+                        const uint8_t * const *data, const size_t *sizes,
+                        uint8_t * const *hashes, size_t count)
+{
+    size_t index;
+#if defined(CPU_X86_DISPATCH)
+    size_t lanes;
+    while (count >= 2 && cpu_has_features(CPU_FEATURE_AVX2)) {
+        lanes = count < SHA512_LANES ? count : SHA512_LANES;
+        sha512_finish_lanes(contexts, data, sizes, hashes, lanes);
+        contexts += lanes;
+        data += lanes;
+        sizes += lanes;
+        hashes += lanes;
+        count -= lanes;
+    }
+#endif
+    for (index = 0; index < count; ++index) {
+        sha512_update(contexts[index], data[index], sizes[index]);
+        sha512_finish(contexts[index], hashes[index]);
+    }
+}
+
+/* Hash "count" independent inputs, writing the 64-byte hash values to
+   the buffers in "hashes" */
+void sha512_hash_many(const uint8_t * const *data, const size_t *sizes,
+                      uint8_t * const *hashes, size_t count)
+{
+    sha512_context_t contexts[4];
+    sha512_context_t *context_ptrs[4];
+    size_t index, batch;
+    while (count > 0) {
+        batch = count < 4 ? count : 4;
+        for (index = 0; index < batch; ++index) {
+            sha512_reset(&(contexts[index]));
+            context_ptrs[index] = &(contexts[index]);
+        }
+        sha512_finish_many(context_ptrs, data, sizes, hashes, batch);
+        data += batch;
+        sizes += batch;
+        hashes += batch;
+        count -= batch;
+    }
+}
+
+/* Get the number of inputs that sha512_finish_many() and sha512_hash_many()
+   hash in parallel with the current CPU features, or 1 if they hash them
+   one at a time */
+size_t sha512_hash_many_lanes(void)
+{
+#if defined(CPU_X86_DISPATCH)
+    if (cpu_has_features(CPU_FEATURE_AVX2))
+        return SHA512_LANES;
+#endif
+    return 1;
+}
@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "../cpu/cpu.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,6 +44,17 @@ void sha512_reset(sha512_context_t *context);
 void sha512_update(sha512_context_t *context, const void *data, size_t size);
 void sha512_finish(sha512_context_t *context, uint8_t *hash);
 void sha512_hash(uint8_t *hash, const void *data, size_t size);
+void sha512_finish_many(sha512_context_t * const *contexts,
+                        const uint8_t * const *data, const size_t *sizes,
+                        uint8_t * const *hashes, size_t count);
+void sha512_hash_many(const uint8_t * const *data, const size_t *sizes,
+                      uint8_t * const *hashes, size_t count);
+size_t sha512_hash_many_lanes(void);
+
+#if defined(CPU_X86_DISPATCH)
+/* Compression kernel, selected at runtime; see sha512-simd.c */
+void sha512_compress_x4_avx2(uint64_t *h, const uint8_t * const *blocks);
+#endif
 
 #ifdef __cplusplus
 };
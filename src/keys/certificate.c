@@ -129,7 +129,7 @@ int Noise_Certificate_new(Noise_Certificate **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_Certificate *)calloc(1, sizeof(Noise_Certificate));
+    *obj = (Noise_Certificate *)noise_protobuf_new_memory(sizeof(Noise_Certificate));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -336,7 +336,7 @@ int Noise_CertificateChain_new(Noise_CertificateChain **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_CertificateChain *)calloc(1, sizeof(Noise_CertificateChain));
+    *obj = (Noise_CertificateChain *)noise_protobuf_new_memory(sizeof(Noise_CertificateChain));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -466,7 +466,7 @@ int Noise_SubjectInfo_new(Noise_SubjectInfo **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_SubjectInfo *)calloc(1, sizeof(Noise_SubjectInfo));
+    *obj = (Noise_SubjectInfo *)noise_protobuf_new_memory(sizeof(Noise_SubjectInfo));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -477,9 +477,9 @@ int Noise_SubjectInfo_free(Noise_SubjectInfo *obj)
     size_t index;
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->id, obj->id_size_);
-    noise_protobuf_free_memory(obj->name, obj->name_size_);
-    noise_protobuf_free_memory(obj->role, obj->role_size_);
+    noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
+    noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+    noise_protobuf_free_memory(obj->role, obj->role_size_ + 1);
     for (index = 0; index < obj->keys_count_; ++index)
         Noise_PublicKeyInfo_free(obj->keys[index]);
     noise_protobuf_free_memory(obj->keys, obj->keys_max_ * sizeof(Noise_PublicKeyInfo *));
@@ -526,19 +526,19 @@ int Noise_SubjectInfo_read(NoiseProtobuf *pbuf, int tag, Noise_SubjectInfo **obj
     while (!noise_protobuf_read_at_end_element(pbuf, end_posn)) {
         switch (noise_protobuf_peek_tag(pbuf)) {
             case 1: {
-                noise_protobuf_free_memory((*obj)->id, (*obj)->id_size_);
+                noise_protobuf_free_memory((*obj)->id, (*obj)->id_size_ + 1);
                 (*obj)->id = 0;
                 (*obj)->id_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 1, &((*obj)->id), 0, &((*obj)->id_size_));
             } break;
             case 2: {
-                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_);
+                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_ + 1);
                 (*obj)->name = 0;
                 (*obj)->name_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 2, &((*obj)->name), 0, &((*obj)->name_size_));
             } break;
             case 3: {
-                noise_protobuf_free_memory((*obj)->role, (*obj)->role_size_);
+                noise_protobuf_free_memory((*obj)->role, (*obj)->role_size_ + 1);
                 (*obj)->role = 0;
                 (*obj)->role_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 3, &((*obj)->role), 0, &((*obj)->role_size_));
@@ -575,7 +575,7 @@ int Noise_SubjectInfo_read(NoiseProtobuf *pbuf, int tag, Noise_SubjectInfo **obj
 int Noise_SubjectInfo_clear_id(Noise_SubjectInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->id, obj->id_size_);
+        noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
         obj->id = 0;
         obj->id_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -601,8 +601,8 @@ size_t Noise_SubjectInfo_get_size_id(const Noise_SubjectInfo *obj)
 int Noise_SubjectInfo_set_id(Noise_SubjectInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->id, obj->id_size_);
-        obj->id = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
+        obj->id = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->id) {
             memcpy(obj->id, value, size);
             obj->id[size] = 0;
@@ -619,7 +619,7 @@ int Noise_SubjectInfo_set_id(Noise_SubjectInfo *obj, const char *value, size_t s
 int Noise_SubjectInfo_clear_name(Noise_SubjectInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
         obj->name = 0;
         obj->name_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -645,8 +645,8 @@ size_t Noise_SubjectInfo_get_size_name(const Noise_SubjectInfo *obj)
 int Noise_SubjectInfo_set_name(Noise_SubjectInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
-        obj->name = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+        obj->name = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->name) {
             memcpy(obj->name, value, size);
             obj->name[size] = 0;
@@ -663,7 +663,7 @@ int Noise_SubjectInfo_set_name(Noise_SubjectInfo *obj, const char *value, size_t
 int Noise_SubjectInfo_clear_role(Noise_SubjectInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->role, obj->role_size_);
+        noise_protobuf_free_memory(obj->role, obj->role_size_ + 1);
         obj->role = 0;
         obj->role_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -689,8 +689,8 @@ size_t Noise_SubjectInfo_get_size_role(const Noise_SubjectInfo *obj)
 int Noise_SubjectInfo_set_role(Noise_SubjectInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->role, obj->role_size_);
-        obj->role = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->role, obj->role_size_ + 1);
+        obj->role = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->role) {
             memcpy(obj->role, value, size);
             obj->role[size] = 0;
@@ -828,7 +828,7 @@ int Noise_PublicKeyInfo_new(Noise_PublicKeyInfo **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_PublicKeyInfo *)calloc(1, sizeof(Noise_PublicKeyInfo));
+    *obj = (Noise_PublicKeyInfo *)noise_protobuf_new_memory(sizeof(Noise_PublicKeyInfo));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -838,7 +838,7 @@ int Noise_PublicKeyInfo_free(Noise_PublicKeyInfo *obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
+    noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
     noise_protobuf_free_memory(obj->key, obj->key_size_);
     noise_protobuf_free_memory(obj, sizeof(Noise_PublicKeyInfo));
     return NOISE_ERROR_NONE;
@@ -873,7 +873,7 @@ int Noise_PublicKeyInfo_read(NoiseProtobuf *pbuf, int tag, Noise_PublicKeyInfo *
     while (!noise_protobuf_read_at_end_element(pbuf, end_posn)) {
         switch (noise_protobuf_peek_tag(pbuf)) {
             case 1: {
-                noise_protobuf_free_memory((*obj)->algorithm, (*obj)->algorithm_size_);
+                noise_protobuf_free_memory((*obj)->algorithm, (*obj)->algorithm_size_ + 1);
                 (*obj)->algorithm = 0;
                 (*obj)->algorithm_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 1, &((*obj)->algorithm), 0, &((*obj)->algorithm_size_));
@@ -900,7 +900,7 @@ int Noise_PublicKeyInfo_read(NoiseProtobuf *pbuf, int tag, Noise_PublicKeyInfo *
 int Noise_PublicKeyInfo_clear_algorithm(Noise_PublicKeyInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
+        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
         obj->algorithm = 0;
         obj->algorithm_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -926,8 +926,8 @@ size_t Noise_PublicKeyInfo_get_size_algorithm(const Noise_PublicKeyInfo *obj)
 int Noise_PublicKeyInfo_set_algorithm(Noise_PublicKeyInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
-        obj->algorithm = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
+        obj->algorithm = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->algorithm) {
             memcpy(obj->algorithm, value, size);
             obj->algorithm[size] = 0;
@@ -971,7 +971,7 @@ int Noise_PublicKeyInfo_set_key(Noise_PublicKeyInfo *obj, const void *value, siz
 {
     if (obj) {
         noise_protobuf_free_memory(obj->key, obj->key_size_);
-        obj->key = (void *)malloc(size ? size : 1);
+        obj->key = (void *)noise_protobuf_new_memory(size ? size : 1);
         if (obj->key) {
             memcpy(obj->key, value, size);
             obj->key_size_ = size;
@@ -988,7 +988,7 @@ int Noise_MetaInfo_new(Noise_MetaInfo **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_MetaInfo *)calloc(1, sizeof(Noise_MetaInfo));
+    *obj = (Noise_MetaInfo *)noise_protobuf_new_memory(sizeof(Noise_MetaInfo));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -998,8 +998,8 @@ int Noise_MetaInfo_free(Noise_MetaInfo *obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->name, obj->name_size_);
-    noise_protobuf_free_memory(obj->value, obj->value_size_);
+    noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+    noise_protobuf_free_memory(obj->value, obj->value_size_ + 1);
     noise_protobuf_free_memory(obj, sizeof(Noise_MetaInfo));
     return NOISE_ERROR_NONE;
 }
@@ -1033,13 +1033,13 @@ int Noise_MetaInfo_read(NoiseProtobuf *pbuf, int tag, Noise_MetaInfo **obj)
     while (!noise_protobuf_read_at_end_element(pbuf, end_posn)) {
         switch (noise_protobuf_peek_tag(pbuf)) {
             case 1: {
-                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_);
+                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_ + 1);
                 (*obj)->name = 0;
                 (*obj)->name_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 1, &((*obj)->name), 0, &((*obj)->name_size_));
             } break;
             case 2: {
-                noise_protobuf_free_memory((*obj)->value, (*obj)->value_size_);
+                noise_protobuf_free_memory((*obj)->value, (*obj)->value_size_ + 1);
                 (*obj)->value = 0;
                 (*obj)->value_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 2, &((*obj)->value), 0, &((*obj)->value_size_));
@@ -1060,7 +1060,7 @@ int Noise_MetaInfo_read(NoiseProtobuf *pbuf, int tag, Noise_MetaInfo **obj)
 int Noise_MetaInfo_clear_name(Noise_MetaInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
         obj->name = 0;
         obj->name_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1086,8 +1086,8 @@ size_t Noise_MetaInfo_get_size_name(const Noise_MetaInfo *obj)
 int Noise_MetaInfo_set_name(Noise_MetaInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
-        obj->name = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+        obj->name = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->name) {
             memcpy(obj->name, value, size);
             obj->name[size] = 0;
@@ -1104,7 +1104,7 @@ int Noise_MetaInfo_set_name(Noise_MetaInfo *obj, const char *value, size_t size)
 int Noise_MetaInfo_clear_value(Noise_MetaInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->value, obj->value_size_);
+        noise_protobuf_free_memory(obj->value, obj->value_size_ + 1);
         obj->value = 0;
         obj->value_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1130,8 +1130,8 @@ size_t Noise_MetaInfo_get_size_value(const Noise_MetaInfo *obj)
 int Noise_MetaInfo_set_value(Noise_MetaInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->value, obj->value_size_);
-        obj->value = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->value, obj->value_size_ + 1);
+        obj->value = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->value) {
             memcpy(obj->value, value, size);
             obj->value[size] = 0;
@@ -1149,7 +1149,7 @@ int Noise_Signature_new(Noise_Signature **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_Signature *)calloc(1, sizeof(Noise_Signature));
+    *obj = (Noise_Signature *)noise_protobuf_new_memory(sizeof(Noise_Signature));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -1159,10 +1159,10 @@ int Noise_Signature_free(Noise_Signature *obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->id, obj->id_size_);
-    noise_protobuf_free_memory(obj->name, obj->name_size_);
+    noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
+    noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
     Noise_PublicKeyInfo_free(obj->signing_key);
-    noise_protobuf_free_memory(obj->hash_algorithm, obj->hash_algorithm_size_);
+    noise_protobuf_free_memory(obj->hash_algorithm, obj->hash_algorithm_size_ + 1);
     Noise_ExtraSignedInfo_free(obj->extra_signed_info);
     noise_protobuf_free_memory(obj->signature, obj->signature_size_);
     noise_protobuf_free_memory(obj, sizeof(Noise_Signature));
@@ -1206,13 +1206,13 @@ int Noise_Signature_read(NoiseProtobuf *pbuf, int tag, Noise_Signature **obj)
     while (!noise_protobuf_read_at_end_element(pbuf, end_posn)) {
         switch (noise_protobuf_peek_tag(pbuf)) {
             case 1: {
-                noise_protobuf_free_memory((*obj)->id, (*obj)->id_size_);
+                noise_protobuf_free_memory((*obj)->id, (*obj)->id_size_ + 1);
                 (*obj)->id = 0;
                 (*obj)->id_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 1, &((*obj)->id), 0, &((*obj)->id_size_));
             } break;
             case 2: {
-                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_);
+                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_ + 1);
                 (*obj)->name = 0;
                 (*obj)->name_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 2, &((*obj)->name), 0, &((*obj)->name_size_));
@@ -1223,7 +1223,7 @@ int Noise_Signature_read(NoiseProtobuf *pbuf, int tag, Noise_Signature **obj)
                 Noise_PublicKeyInfo_read(pbuf, 3, &((*obj)->signing_key));
             } break;
             case 4: {
-                noise_protobuf_free_memory((*obj)->hash_algorithm, (*obj)->hash_algorithm_size_);
+                noise_protobuf_free_memory((*obj)->hash_algorithm, (*obj)->hash_algorithm_size_ + 1);
                 (*obj)->hash_algorithm = 0;
                 (*obj)->hash_algorithm_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 4, &((*obj)->hash_algorithm), 0, &((*obj)->hash_algorithm_size_));
@@ -1255,7 +1255,7 @@ int Noise_Signature_read(NoiseProtobuf *pbuf, int tag, Noise_Signature **obj)
 int Noise_Signature_clear_id(Noise_Signature *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->id, obj->id_size_);
+        noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
         obj->id = 0;
         obj->id_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1281,8 +1281,8 @@ size_t Noise_Signature_get_size_id(const Noise_Signature *obj)
 int Noise_Signature_set_id(Noise_Signature *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->id, obj->id_size_);
-        obj->id = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
+        obj->id = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->id) {
             memcpy(obj->id, value, size);
             obj->id[size] = 0;
@@ -1299,7 +1299,7 @@ int Noise_Signature_set_id(Noise_Signature *obj, const char *value, size_t size)
 int Noise_Signature_clear_name(Noise_Signature *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
         obj->name = 0;
         obj->name_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1325,8 +1325,8 @@ size_t Noise_Signature_get_size_name(const Noise_Signature *obj)
 int Noise_Signature_set_name(Noise_Signature *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
-        obj->name = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+        obj->name = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->name) {
             memcpy(obj->name, value, size);
             obj->name[size] = 0;
@@ -1379,7 +1379,7 @@ int Noise_Signature_get_new_signing_key(Noise_Signature *obj, Noise_PublicKeyInf
 int Noise_Signature_clear_hash_algorithm(Noise_Signature *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->hash_algorithm, obj->hash_algorithm_size_);
+        noise_protobuf_free_memory(obj->hash_algorithm, obj->hash_algorithm_size_ + 1);
         obj->hash_algorithm = 0;
         obj->hash_algorithm_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1405,8 +1405,8 @@ size_t Noise_Signature_get_size_hash_algorithm(const Noise_Signature *obj)
 int Noise_Signature_set_hash_algorithm(Noise_Signature *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->hash_algorithm, obj->hash_algorithm_size_);
-        obj->hash_algorithm = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->hash_algorithm, obj->hash_algorithm_size_ + 1);
+        obj->hash_algorithm = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->hash_algorithm) {
             memcpy(obj->hash_algorithm, value, size);
             obj->hash_algorithm[size] = 0;
@@ -1486,7 +1486,7 @@ int Noise_Signature_set_signature(Noise_Signature *obj, const void *value, size_
 {
     if (obj) {
         noise_protobuf_free_memory(obj->signature, obj->signature_size_);
-        obj->signature = (void *)malloc(size ? size : 1);
+        obj->signature = (void *)noise_protobuf_new_memory(size ? size : 1);
         if (obj->signature) {
             memcpy(obj->signature, value, size);
             obj->signature_size_ = size;
@@ -1503,7 +1503,7 @@ int Noise_ExtraSignedInfo_new(Noise_ExtraSignedInfo **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_ExtraSignedInfo *)calloc(1, sizeof(Noise_ExtraSignedInfo));
+    *obj = (Noise_ExtraSignedInfo *)noise_protobuf_new_memory(sizeof(Noise_ExtraSignedInfo));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -1515,8 +1515,8 @@ int Noise_ExtraSignedInfo_free(Noise_ExtraSignedInfo *obj)
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
     noise_protobuf_free_memory(obj->nonce, obj->nonce_size_);
-    noise_protobuf_free_memory(obj->valid_from, obj->valid_from_size_);
-    noise_protobuf_free_memory(obj->valid_to, obj->valid_to_size_);
+    noise_protobuf_free_memory(obj->valid_from, obj->valid_from_size_ + 1);
+    noise_protobuf_free_memory(obj->valid_to, obj->valid_to_size_ + 1);
     for (index = 0; index < obj->meta_count_; ++index)
         Noise_MetaInfo_free(obj->meta[index]);
     noise_protobuf_free_memory(obj->meta, obj->meta_max_ * sizeof(Noise_MetaInfo *));
@@ -1564,13 +1564,13 @@ int Noise_ExtraSignedInfo_read(NoiseProtobuf *pbuf, int tag, Noise_ExtraSignedIn
                 noise_protobuf_read_alloc_bytes(pbuf, 1, &((*obj)->nonce), 0, &((*obj)->nonce_size_));
             } break;
             case 2: {
-                noise_protobuf_free_memory((*obj)->valid_from, (*obj)->valid_from_size_);
+                noise_protobuf_free_memory((*obj)->valid_from, (*obj)->valid_from_size_ + 1);
                 (*obj)->valid_from = 0;
                 (*obj)->valid_from_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 2, &((*obj)->valid_from), 0, &((*obj)->valid_from_size_));
             } break;
             case 3: {
-                noise_protobuf_free_memory((*obj)->valid_to, (*obj)->valid_to_size_);
+                noise_protobuf_free_memory((*obj)->valid_to, (*obj)->valid_to_size_ + 1);
                 (*obj)->valid_to = 0;
                 (*obj)->valid_to_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 3, &((*obj)->valid_to), 0, &((*obj)->valid_to_size_));
@@ -1626,7 +1626,7 @@ int Noise_ExtraSignedInfo_set_nonce(Noise_ExtraSignedInfo *obj, const void *valu
 {
     if (obj) {
         noise_protobuf_free_memory(obj->nonce, obj->nonce_size_);
-        obj->nonce = (void *)malloc(size ? size : 1);
+        obj->nonce = (void *)noise_protobuf_new_memory(size ? size : 1);
         if (obj->nonce) {
             memcpy(obj->nonce, value, size);
             obj->nonce_size_ = size;
@@ -1642,7 +1642,7 @@ int Noise_ExtraSignedInfo_set_nonce(Noise_ExtraSignedInfo *obj, const void *valu
 int Noise_ExtraSignedInfo_clear_valid_from(Noise_ExtraSignedInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->valid_from, obj->valid_from_size_);
+        noise_protobuf_free_memory(obj->valid_from, obj->valid_from_size_ + 1);
         obj->valid_from = 0;
         obj->valid_from_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1668,8 +1668,8 @@ size_t Noise_ExtraSignedInfo_get_size_valid_from(const Noise_ExtraSignedInfo *ob
 int Noise_ExtraSignedInfo_set_valid_from(Noise_ExtraSignedInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->valid_from, obj->valid_from_size_);
-        obj->valid_from = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->valid_from, obj->valid_from_size_ + 1);
+        obj->valid_from = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->valid_from) {
             memcpy(obj->valid_from, value, size);
             obj->valid_from[size] = 0;
@@ -1686,7 +1686,7 @@ int Noise_ExtraSignedInfo_set_valid_from(Noise_ExtraSignedInfo *obj, const char
 int Noise_ExtraSignedInfo_clear_valid_to(Noise_ExtraSignedInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->valid_to, obj->valid_to_size_);
+        noise_protobuf_free_memory(obj->valid_to, obj->valid_to_size_ + 1);
         obj->valid_to = 0;
         obj->valid_to_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1712,8 +1712,8 @@ size_t Noise_ExtraSignedInfo_get_size_valid_to(const Noise_ExtraSignedInfo *obj)
 int Noise_ExtraSignedInfo_set_valid_to(Noise_ExtraSignedInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->valid_to, obj->valid_to_size_);
-        obj->valid_to = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->valid_to, obj->valid_to_size_ + 1);
+        obj->valid_to = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->valid_to) {
             memcpy(obj->valid_to, value, size);
             obj->valid_to[size] = 0;
@@ -1791,7 +1791,7 @@ int Noise_EncryptedPrivateKey_new(Noise_EncryptedPrivateKey **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_EncryptedPrivateKey *)calloc(1, sizeof(Noise_EncryptedPrivateKey));
+    *obj = (Noise_EncryptedPrivateKey *)noise_protobuf_new_memory(sizeof(Noise_EncryptedPrivateKey));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -1801,7 +1801,7 @@ int Noise_EncryptedPrivateKey_free(Noise_EncryptedPrivateKey *obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
+    noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
     noise_protobuf_free_memory(obj->salt, obj->salt_size_);
     noise_protobuf_free_memory(obj->encrypted_data, obj->encrypted_data_size_);
     noise_protobuf_free_memory(obj, sizeof(Noise_EncryptedPrivateKey));
@@ -1846,7 +1846,7 @@ int Noise_EncryptedPrivateKey_read(NoiseProtobuf *pbuf, int tag, Noise_Encrypted
                 noise_protobuf_read_uint32(pbuf, 10, &((*obj)->version));
             } break;
             case 11: {
-                noise_protobuf_free_memory((*obj)->algorithm, (*obj)->algorithm_size_);
+                noise_protobuf_free_memory((*obj)->algorithm, (*obj)->algorithm_size_ + 1);
                 (*obj)->algorithm = 0;
                 (*obj)->algorithm_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 11, &((*obj)->algorithm), 0, &((*obj)->algorithm_size_));
@@ -1910,7 +1910,7 @@ int Noise_EncryptedPrivateKey_set_version(Noise_EncryptedPrivateKey *obj, uint32
 int Noise_EncryptedPrivateKey_clear_algorithm(Noise_EncryptedPrivateKey *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
+        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
         obj->algorithm = 0;
         obj->algorithm_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -1936,8 +1936,8 @@ size_t Noise_EncryptedPrivateKey_get_size_algorithm(const Noise_EncryptedPrivate
 int Noise_EncryptedPrivateKey_set_algorithm(Noise_EncryptedPrivateKey *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
-        obj->algorithm = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
+        obj->algorithm = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->algorithm) {
             memcpy(obj->algorithm, value, size);
             obj->algorithm[size] = 0;
@@ -1981,7 +1981,7 @@ int Noise_EncryptedPrivateKey_set_salt(Noise_EncryptedPrivateKey *obj, const voi
 {
     if (obj) {
         noise_protobuf_free_memory(obj->salt, obj->salt_size_);
-        obj->salt = (void *)malloc(size ? size : 1);
+        obj->salt = (void *)noise_protobuf_new_memory(size ? size : 1);
         if (obj->salt) {
             memcpy(obj->salt, value, size);
             obj->salt_size_ = size;
@@ -2052,7 +2052,7 @@ int Noise_EncryptedPrivateKey_set_encrypted_data(Noise_EncryptedPrivateKey *obj,
 {
     if (obj) {
         noise_protobuf_free_memory(obj->encrypted_data, obj->encrypted_data_size_);
-        obj->encrypted_data = (void *)malloc(size ? size : 1);
+        obj->encrypted_data = (void *)noise_protobuf_new_memory(size ? size : 1);
         if (obj->encrypted_data) {
             memcpy(obj->encrypted_data, value, size);
             obj->encrypted_data_size_ = size;
@@ -2069,7 +2069,7 @@ int Noise_PrivateKey_new(Noise_PrivateKey **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_PrivateKey *)calloc(1, sizeof(Noise_PrivateKey));
+    *obj = (Noise_PrivateKey *)noise_protobuf_new_memory(sizeof(Noise_PrivateKey));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -2080,9 +2080,9 @@ int Noise_PrivateKey_free(Noise_PrivateKey *obj)
     size_t index;
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->id, obj->id_size_);
-    noise_protobuf_free_memory(obj->name, obj->name_size_);
-    noise_protobuf_free_memory(obj->role, obj->role_size_);
+    noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
+    noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+    noise_protobuf_free_memory(obj->role, obj->role_size_ + 1);
     for (index = 0; index < obj->keys_count_; ++index)
         Noise_PrivateKeyInfo_free(obj->keys[index]);
     noise_protobuf_free_memory(obj->keys, obj->keys_max_ * sizeof(Noise_PrivateKeyInfo *));
@@ -2129,19 +2129,19 @@ int Noise_PrivateKey_read(NoiseProtobuf *pbuf, int tag, Noise_PrivateKey **obj)
     while (!noise_protobuf_read_at_end_element(pbuf, end_posn)) {
         switch (noise_protobuf_peek_tag(pbuf)) {
             case 1: {
-                noise_protobuf_free_memory((*obj)->id, (*obj)->id_size_);
+                noise_protobuf_free_memory((*obj)->id, (*obj)->id_size_ + 1);
                 (*obj)->id = 0;
                 (*obj)->id_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 1, &((*obj)->id), 0, &((*obj)->id_size_));
             } break;
             case 2: {
-                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_);
+                noise_protobuf_free_memory((*obj)->name, (*obj)->name_size_ + 1);
                 (*obj)->name = 0;
                 (*obj)->name_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 2, &((*obj)->name), 0, &((*obj)->name_size_));
             } break;
             case 3: {
-                noise_protobuf_free_memory((*obj)->role, (*obj)->role_size_);
+                noise_protobuf_free_memory((*obj)->role, (*obj)->role_size_ + 1);
                 (*obj)->role = 0;
                 (*obj)->role_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 3, &((*obj)->role), 0, &((*obj)->role_size_));
@@ -2178,7 +2178,7 @@ int Noise_PrivateKey_read(NoiseProtobuf *pbuf, int tag, Noise_PrivateKey **obj)
 int Noise_PrivateKey_clear_id(Noise_PrivateKey *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->id, obj->id_size_);
+        noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
         obj->id = 0;
         obj->id_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -2204,8 +2204,8 @@ size_t Noise_PrivateKey_get_size_id(const Noise_PrivateKey *obj)
 int Noise_PrivateKey_set_id(Noise_PrivateKey *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->id, obj->id_size_);
-        obj->id = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->id, obj->id_size_ + 1);
+        obj->id = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->id) {
             memcpy(obj->id, value, size);
             obj->id[size] = 0;
@@ -2222,7 +2222,7 @@ int Noise_PrivateKey_set_id(Noise_PrivateKey *obj, const char *value, size_t siz
 int Noise_PrivateKey_clear_name(Noise_PrivateKey *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
         obj->name = 0;
         obj->name_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -2248,8 +2248,8 @@ size_t Noise_PrivateKey_get_size_name(const Noise_PrivateKey *obj)
 int Noise_PrivateKey_set_name(Noise_PrivateKey *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->name, obj->name_size_);
-        obj->name = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->name, obj->name_size_ + 1);
+        obj->name = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->name) {
             memcpy(obj->name, value, size);
             obj->name[size] = 0;
@@ -2266,7 +2266,7 @@ int Noise_PrivateKey_set_name(Noise_PrivateKey *obj, const char *value, size_t s
 int Noise_PrivateKey_clear_role(Noise_PrivateKey *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->role, obj->role_size_);
+        noise_protobuf_free_memory(obj->role, obj->role_size_ + 1);
         obj->role = 0;
         obj->role_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -2292,8 +2292,8 @@ size_t Noise_PrivateKey_get_size_role(const Noise_PrivateKey *obj)
 int Noise_PrivateKey_set_role(Noise_PrivateKey *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->role, obj->role_size_);
-        obj->role = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->role, obj->role_size_ + 1);
+        obj->role = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->role) {
             memcpy(obj->role, value, size);
             obj->role[size] = 0;
@@ -2431,7 +2431,7 @@ int Noise_PrivateKeyInfo_new(Noise_PrivateKeyInfo **obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    *obj = (Noise_PrivateKeyInfo *)calloc(1, sizeof(Noise_PrivateKeyInfo));
+    *obj = (Noise_PrivateKeyInfo *)noise_protobuf_new_memory(sizeof(Noise_PrivateKeyInfo));
     if (!(*obj))
         return NOISE_ERROR_NO_MEMORY;
     return NOISE_ERROR_NONE;
@@ -2441,7 +2441,7 @@ int Noise_PrivateKeyInfo_free(Noise_PrivateKeyInfo *obj)
 {
     if (!obj)
         return NOISE_ERROR_INVALID_PARAM;
-    noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
+    noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
     noise_protobuf_free_memory(obj->key, obj->key_size_);
     noise_protobuf_free_memory(obj, sizeof(Noise_PrivateKeyInfo));
     return NOISE_ERROR_NONE;
@@ -2476,7 +2476,7 @@ int Noise_PrivateKeyInfo_read(NoiseProtobuf *pbuf, int tag, Noise_PrivateKeyInfo
     while (!noise_protobuf_read_at_end_element(pbuf, end_posn)) {
         switch (noise_protobuf_peek_tag(pbuf)) {
             case 1: {
-                noise_protobuf_free_memory((*obj)->algorithm, (*obj)->algorithm_size_);
+                noise_protobuf_free_memory((*obj)->algorithm, (*obj)->algorithm_size_ + 1);
                 (*obj)->algorithm = 0;
                 (*obj)->algorithm_size_ = 0;
                 noise_protobuf_read_alloc_string(pbuf, 1, &((*obj)->algorithm), 0, &((*obj)->algorithm_size_));
@@ -2503,7 +2503,7 @@ int Noise_PrivateKeyInfo_read(NoiseProtobuf *pbuf, int tag, Noise_PrivateKeyInfo
 int Noise_PrivateKeyInfo_clear_algorithm(Noise_PrivateKeyInfo *obj)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
+        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
         obj->algorithm = 0;
         obj->algorithm_size_ = 0;
         return NOISE_ERROR_NONE;
@@ -2529,8 +2529,8 @@ size_t Noise_PrivateKeyInfo_get_size_algorithm(const Noise_PrivateKeyInfo *obj)
 int Noise_PrivateKeyInfo_set_algorithm(Noise_PrivateKeyInfo *obj, const char *value, size_t size)
 {
     if (obj) {
-        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_);
-        obj->algorithm = (char *)malloc(size + 1);
+        noise_protobuf_free_memory(obj->algorithm, obj->algorithm_size_ + 1);
+        obj->algorithm = (char *)noise_protobuf_new_memory(size + 1);
         if (obj->algorithm) {
             memcpy(obj->algorithm, value, size);
             obj->algorithm[size] = 0;
@@ -2574,7 +2574,7 @@ int Noise_PrivateKeyInfo_set_key(Noise_PrivateKeyInfo *obj, const void *value, s
 {
     if (obj) {
         noise_protobuf_free_memory(obj->key, obj->key_size_);
-        obj->key = (void *)malloc(size ? size : 1);
+        obj->key = (void *)noise_protobuf_new_memory(size ? size : 1);
         if (obj->key) {
             memcpy(obj->key, value, size);
             obj->key_size_ = size;
@@ -119,7 +119,7 @@ static int noise_load_file
     } else {
         pbuf->size = NOISE_MAX_PAYLOAD_LEN;
     }
-    pbuf->data = (uint8_t *)malloc(pbuf->size);
+    pbuf->data = (uint8_t *)noise_new_memory(pbuf->size);
     if (!(pbuf->data)) {
         fclose(file);
         return NOISE_ERROR_NO_MEMORY;
@@ -588,7 +588,7 @@ static int noise_save_to_file
         return err;
 
     /* Allocate memory to hold the serialized form temporarily */
-    pbuf.data = (uint8_t *)malloc(size);
+    pbuf.data = (uint8_t *)noise_new_memory(size);
     if (!(pbuf.data))
         return NOISE_ERROR_NO_MEMORY;
     pbuf.size = size;
@@ -751,8 +751,9 @@ int noise_save_private_key_to_file
         return err;
     size += strlen(protect_name) + NOISE_ENC_KEY_OVERHEAD;
 
-    /* Serialize the EncryptedPrivateKey into memory */
-    pbuf.data = (uint8_t *)malloc(size);
+    /* Serialize the EncryptedPrivateKey into memory.  The private key
+       passes through the buffer in plaintext before it is encrypted */
+    pbuf.data = (uint8_t *)noise_new_secure_memory(size);
     if (!(pbuf.data))
         return NOISE_ERROR_NO_MEMORY;
     pbuf.posn = size;
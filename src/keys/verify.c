@@ -0,0 +1,782 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <noise/keys.h>
+#include <noise/protocol.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/**
+ * \file verify.h
+ * \brief Certificate verification interface
+ */
+
+/**
+ * \file verify.c
+ * \brief Certificate verification implementation
+ */
+
+/**
+ * \defgroup keyverify Certificate verification API
+ *
+ * The functions in this module check the signatures on certificates and
+ * certificate chains.  Each signature covers the canonical encoding of the
+ * subject information in the certificate, followed by the canonical
+ * encoding of the signer's extra signed information.  Both are written
+ * with their field tags from the Certificate and Signature structures,
+ * so the data that is hashed is exactly the "subject" field followed by
+ * the "extra_signed_info" field as they would appear in a serialized
+ * certificate.  The hash is then signed with the signing key.
+ *
+ * The certificates are re-serialized from the parsed objects to
+ * canonicalize them.  Unknown fields are dropped by the parser, so
+ * signatures over certificates that carry private extensions in the
+ * subject information will not verify.
+ *
+ * All of the signatures in a chain are collected and then verified
+ * together with noise_signstate_verify_batch(), which is a lot faster
+ * than verifying them one at a time.  Large chains can optionally be
+ * split across several threads, and a VerifyCache can be supplied to
+ * skip signatures that have already been verified.
+ *
+ * Verification only establishes that each signature is valid for the
+ * signing key that it names.  It is up to the application to decide
+ * whether it trusts those signing keys.  As an aid, the status for each
+ * signature indicates which certificate in the chain, if any, has a
+ * subject key that matches the signing key.
+ */
+/**@{*/
+
+/**
+ * \struct NoiseSignatureStatus
+ * \brief Verification status for a single signature on a certificate.
+ */
+/**
+ * \var NoiseSignatureStatus::cert_index
+ * \brief Index of the certificate in the chain.
+ */
+/**
+ * \var NoiseSignatureStatus::signature_index
+ * \brief Index of the signature within the certificate.
+ */
+/**
+ * \var NoiseSignatureStatus::signer_index
+ * \brief Index of the certificate in the chain whose subject has the
+ * signing key as one of its keys, or -1 if the signer is not in the chain.
+ */
+/**
+ * \var NoiseSignatureStatus::status
+ * \brief NOISE_ERROR_NONE if the signature is valid, or an error code
+ * that indicates why the signature could not be verified.
+ */
+
+/** @cond */
+
+/**
+ * \brief Minimum number of signatures to hand to each thread.
+ *
+ * This is the group size of the Ed25519 batch verifier.  Smaller slices
+ * fall back to single verification and lose most of the benefit.
+ */
+#define NOISE_VERIFY_MIN_PER_THREAD 64
+
+/**
+ * \brief Maximum length of the hash value that is signed.
+ */
+#define NOISE_VERIFY_MAX_HASH_LEN   64
+
+/**
+ * \brief Maximum number of threads to fan verification out to.
+ */
+#define NOISE_VERIFY_MAX_THREADS    32
+
+/**
+ * \brief Information about a signature that is waiting to be verified.
+ */
+typedef struct
+{
+    /** \brief Signing algorithm identifier, or zero if not pending */
+    int sign_id;
+
+    /** \brief Points to the signing key */
+    const uint8_t *public_key;
+
+    /** \brief Length of the signing key */
+    size_t public_key_len;
+
+    /** \brief Points to the signature */
+    const uint8_t *signature;
+
+    /** \brief Length of the signature */
+    size_t signature_len;
+
+    /** \brief Length of the hash value that was signed */
+    size_t hash_len;
+
+    /** \brief Hash of the subject and extra signed information */
+    uint8_t hash[NOISE_VERIFY_MAX_HASH_LEN];
+
+} NoiseVerifyItem;
+
+/**
+ * \brief Arguments for verifying a slice of a batch of signatures.
+ */
+typedef struct
+{
+    const NoiseSignState *sign;
+    const uint8_t * const *public_keys;
+    const uint8_t * const *messages;
+    const size_t *message_lens;
+    const uint8_t * const *signatures;
+    size_t count;
+    int *results;
+
+} NoiseVerifySlice;
+
+typedef int (*NoiseWriteFunc)(NoiseProtobuf *pbuf, int tag, const void *obj);
+
+/**
+ * \brief Writes the canonical encoding of an object to a buffer.
+ *
+ * \param func The write function for the object.
+ * \param tag The field tag to write the object with.
+ * \param obj The object to write.
+ * \param buf Points to the buffer, which is enlarged as necessary.
+ * \param buf_size Points to the allocated size of the buffer.
+ * \param data Returns a pointer to the encoded data within the buffer.
+ * \param len Returns the length of the encoded data.
+ *
+ * \return NOISE_ERROR_NONE on success, or an error code otherwise.
+ */
+static int noise_verify_encode
+    (NoiseWriteFunc func, int tag, const void *obj,
+     uint8_t **buf, size_t *buf_size, uint8_t **data, size_t *len)
+{
+    NoiseProtobuf pbuf;
+    size_t size = 0;
+    int err;
+
+    /* Measure the size of the encoded object */
+    noise_protobuf_prepare_measure(&pbuf, NOISE_MAX_PAYLOAD_LEN);
+    err = (*func)(&pbuf, tag, obj);
+    if (err == NOISE_ERROR_NONE)
+        err = noise_protobuf_finish_measure(&pbuf, &size);
+    if (err != NOISE_ERROR_NONE)
+        return err;
+
+    /* Make sure that the buffer is big enough */
+    if (size > *buf_size) {
+        uint8_t *new_buf = (uint8_t *)noise_new_memory(size);
+        if (!new_buf)
+            return NOISE_ERROR_NO_MEMORY;
+        noise_free(*buf, *buf_size);
+        *buf = new_buf;
+        *buf_size = size;
+    }
+
+    /* Write the object into the buffer */
+    noise_protobuf_prepare_output(&pbuf, *buf, size);
+    err = (*func)(&pbuf, tag, obj);
+    if (err == NOISE_ERROR_NONE)
+        err = noise_protobuf_finish_output(&pbuf, data, len);
+    return err;
+}
+
+/**
+ * \brief Finds the certificate in a chain whose subject holds a key.
+ *
+ * \param certs The certificates in the chain.
+ * \param num_certs The number of certificates in the chain.
+ * \param key The key to look for.
+ *
+ * \return The index of the certificate, or -1 if the key was not found.
+ */
+static int noise_verify_find_signer
+    (const Noise_Certificate * const *certs, size_t num_certs,
+     const Noise_PublicKeyInfo *key)
+{
+    const Noise_SubjectInfo *subject;
+    const Noise_PublicKeyInfo *info;
+    size_t cert_index;
+    size_t key_index;
+    size_t alg_len = Noise_PublicKeyInfo_get_size_algorithm(key);
+    size_t key_len = Noise_PublicKeyInfo_get_size_key(key);
+    for (cert_index = 0; cert_index < num_certs; ++cert_index) {
+        subject = Noise_Certificate_get_subject(certs[cert_index]);
+        if (!subject)
+            continue;
+        for (key_index = 0;
+                key_index < Noise_SubjectInfo_count_keys(subject);
+                ++key_index) {
+            info = Noise_SubjectInfo_get_at_keys(subject, key_index);
+            if (Noise_PublicKeyInfo_get_size_algorithm(info) != alg_len ||
+                    Noise_PublicKeyInfo_get_size_key(info) != key_len)
+                continue;
+            if (!memcmp(Noise_PublicKeyInfo_get_algorithm(info),
+                        Noise_PublicKeyInfo_get_algorithm(key), alg_len) &&
+                    !memcmp(Noise_PublicKeyInfo_get_key(info),
+                            Noise_PublicKeyInfo_get_key(key), key_len))
+                return (int)cert_index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief Prepares a single signature for verification.
+ *
+ * \param item The item to populate with the details of the signature.
+ * \param sig The signature block from the certificate.
+ * \param subject Points to the encoded subject information.
+ * \param subject_len The length of the encoded subject information.
+ * \param buf Points to the scratch buffer for encoding.
+ * \param buf_size Points to the allocated size of the scratch buffer.
+ *
+ * \return NOISE_ERROR_NONE if the signature is ready to be verified,
+ * or an error code that describes the problem with the signature.
+ */
+static int noise_verify_prepare
+    (NoiseVerifyItem *item, const Noise_Signature *sig,
+     const uint8_t *subject, size_t subject_len,
+     uint8_t **buf, size_t *buf_size)
+{
+    const Noise_PublicKeyInfo *key;
+    const Noise_ExtraSignedInfo *extra;
+    NoiseHashState *hash;
+    uint8_t *extra_data = 0;
+    size_t extra_len = 0;
+    int hash_id;
+    int err;
+
+    /* Look up the signing and hash algorithms */
+    key = Noise_Signature_get_signing_key(sig);
+    if (!key || !Noise_PublicKeyInfo_has_algorithm(key) ||
+            !Noise_PublicKeyInfo_has_key(key) ||
+            !Noise_Signature_has_hash_algorithm(sig) ||
+            !Noise_Signature_has_signature(sig))
+        return NOISE_ERROR_INVALID_FORMAT;
+    item->sign_id = noise_name_to_id
+        (NOISE_SIGN_CATEGORY, Noise_PublicKeyInfo_get_algorithm(key),
+         Noise_PublicKeyInfo_get_size_algorithm(key));
+    hash_id = noise_name_to_id
+        (NOISE_HASH_CATEGORY, Noise_Signature_get_hash_algorithm(sig),
+         Noise_Signature_get_size_hash_algorithm(sig));
+    if (!(item->sign_id) || !hash_id) {
+        item->sign_id = 0;
+        return NOISE_ERROR_UNKNOWN_NAME;
+    }
+    item->public_key = (const uint8_t *)Noise_PublicKeyInfo_get_key(key);
+    item->public_key_len = Noise_PublicKeyInfo_get_size_key(key);
+    item->signature = (const uint8_t *)Noise_Signature_get_signature(sig);
+    item->signature_len = Noise_Signature_get_size_signature(sig);
+
+    /* Encode the extra signed information for this signer */
+    extra = Noise_Signature_get_extra_signed_info(sig);
+    if (extra) {
+        err = noise_verify_encode
+            ((NoiseWriteFunc)Noise_ExtraSignedInfo_write, 5, extra,
+             buf, buf_size, &extra_data, &extra_len);
+        if (err != NOISE_ERROR_NONE) {
+            item->sign_id = 0;
+            return err;
+        }
+    }
+
+    /* Hash the subject and the extra signed information */
+    err = noise_hashstate_new_by_id(&hash, hash_id);
+    if (err == NOISE_ERROR_NONE) {
+        item->hash_len = noise_hashstate_get_hash_length(hash);
+        err = noise_hashstate_hash_two
+            (hash, subject, subject_len, extra_data, extra_len,
+             item->hash, item->hash_len);
+        noise_hashstate_free(hash);
+    }
+    if (err != NOISE_ERROR_NONE)
+        item->sign_id = 0;
+    return err;
+}
+
+/**
+ * \brief Verifies a slice of a batch of signatures.
+ *
+ * \param arg Points to the NoiseVerifySlice to verify.
+ *
+ * \return Always NULL.
+ */
+static void *noise_verify_slice(void *arg)
+{
+    NoiseVerifySlice *slice = (NoiseVerifySlice *)arg;
+    noise_signstate_verify_batch
+        (slice->sign, slice->public_keys, slice->messages,
+         slice->message_lens, slice->signatures, slice->count,
+         slice->results);
+    return 0;
+}
+
+/**
+ * \brief Verifies a batch of signatures, fanning out across threads.
+ *
+ * \param slice The full batch of signatures to be verified.
+ * \param max_threads The maximum number of threads to use.
+ */
+static void noise_verify_parallel(NoiseVerifySlice *slice, int max_threads)
+{
+#if HAVE_PTHREAD
+    NoiseVerifySlice slices[NOISE_VERIFY_MAX_THREADS];
+    pthread_t threads[NOISE_VERIFY_MAX_THREADS];
+    int started[NOISE_VERIFY_MAX_THREADS];
+    size_t per_thread;
+    size_t offset;
+    int num_threads;
+    int index;
+
+    /* Decide how many threads are worth using */
+    if (max_threads > NOISE_VERIFY_MAX_THREADS)
+        max_threads = NOISE_VERIFY_MAX_THREADS;
+    num_threads = (int)(slice->count / NOISE_VERIFY_MIN_PER_THREAD);
+    if (num_threads > max_threads)
+        num_threads = max_threads;
+    if (num_threads > 1) {
+        /* Round the slices up to a whole number of batch groups */
+        per_thread = (slice->count + num_threads - 1) / num_threads;
+        per_thread = (per_thread + NOISE_VERIFY_MIN_PER_THREAD - 1) &
+                     ~((size_t)(NOISE_VERIFY_MIN_PER_THREAD - 1));
+        offset = 0;
+        for (index = 0; index < num_threads && offset < slice->count; ++index) {
+            slices[index] = *slice;
+            slices[index].public_keys += offset;
+            slices[index].messages += offset;
+            slices[index].message_lens += offset;
+            slices[index].signatures += offset;
+            slices[index].results += offset;
+            slices[index].count = slice->count - offset;
+            if (slices[index].count > per_thread)
+                slices[index].count = per_thread;
+            offset += slices[index].count;
+        }
+        num_threads = index;
+
+        /* The calling thread verifies the first slice itself.  If a
+           thread cannot be started, its slice is verified inline. */
+        for (index = 1; index < num_threads; ++index) {
+            started[index] = !pthread_create
+                (&(threads[index]), 0, noise_verify_slice, &(slices[index]));
+        }
+        noise_verify_slice(&(slices[0]));
+        for (index = 1; index < num_threads; ++index) {
+            if (started[index])
+                pthread_join(threads[index], 0);
+            else
+                noise_verify_slice(&(slices[index]));
+        }
+        return;
+    }
+#else
+    (void)max_threads;
+#endif
+    noise_verify_slice(slice);
+}
+
+/**
+ * \brief Verifies all pending signatures that use a specific algorithm.
+ *
+ * \param items The items to be verified.
+ * \param status The status values corresponding to \a items.
+ * \param count The number of items.
+ * \param sign_id The signing algorithm to verify.
+ * \param cache The cache of verified signatures, or NULL.
+ * \param max_threads The maximum number of threads to use.
+ *
+ * \return NOISE_ERROR_NONE on success, or NOISE_ERROR_NO_MEMORY if there
+ * was insufficient memory to prepare the batch.
+ */
+static int noise_verify_algorithm
+    (NoiseVerifyItem *items, NoiseSignatureStatus *status, size_t count,
+     int sign_id, NoiseVerifyCache *cache, int max_threads)
+{
+    NoiseSignState *sign;
+    NoiseVerifySlice slice;
+    const uint8_t **public_keys;
+    const uint8_t **messages;
+    size_t *message_lens;
+    const uint8_t **signatures;
+    int *results;
+    size_t *indexes;
+    size_t public_key_len;
+    size_t signature_len;
+    size_t index;
+    size_t batch;
+    int err;
+
+    /* Mark all items for this algorithm as no longer pending */
+    for (index = 0; index < count; ++index) {
+        if (items[index].sign_id == sign_id)
+            items[index].sign_id = -sign_id;
+    }
+
+    /* Create a SignState for the algorithm to get the key lengths */
+    err = noise_signstate_new_by_id(&sign, sign_id);
+    if (err != NOISE_ERROR_NONE) {
+        for (index = 0; index < count; ++index) {
+            if (items[index].sign_id == -sign_id)
+                status[index].status = err;
+        }
+        return err == NOISE_ERROR_NO_MEMORY ? err : NOISE_ERROR_NONE;
+    }
+    public_key_len = noise_signstate_get_public_key_length(sign);
+    signature_len = noise_signstate_get_signature_length(sign);
+    noise_signstate_set_verify_cache(sign, cache);
+
+    /* Allocate space for the batch */
+    public_keys = (const uint8_t **)noise_new_memory(count * sizeof(uint8_t *));
+    messages = (const uint8_t **)noise_new_memory(count * sizeof(uint8_t *));
+    message_lens = (size_t *)noise_new_memory(count * sizeof(size_t));
+    signatures = (const uint8_t **)noise_new_memory(count * sizeof(uint8_t *));
+    results = (int *)noise_new_memory(count * sizeof(int));
+    indexes = (size_t *)noise_new_memory(count * sizeof(size_t));
+    if (!public_keys || !messages || !message_lens || !signatures ||
+            !results || !indexes) {
+        err = NOISE_ERROR_NO_MEMORY;
+        goto cleanup;
+    }
+
+    /* Collect the signatures into the batch */
+    batch = 0;
+    for (index = 0; index < count; ++index) {
+        if (items[index].sign_id != -sign_id)
+            continue;
+        if (items[index].public_key_len != public_key_len ||
+                items[index].signature_len != signature_len) {
+            status[index].status = NOISE_ERROR_INVALID_LENGTH;
+            continue;
+        }
+        public_keys[batch] = items[index].public_key;
+        messages[batch] = items[index].hash;
+        message_lens[batch] = items[index].hash_len;
+        signatures[batch] = items[index].signature;
+        indexes[batch] = index;
+        ++batch;
+    }
+
+    /* Verify the batch and scatter the results */
+    slice.sign = sign;
+    slice.public_keys = public_keys;
+    slice.messages = messages;
+    slice.message_lens = message_lens;
+    slice.signatures = signatures;
+    slice.count = batch;
+    slice.results = results;
+    noise_verify_parallel(&slice, max_threads);
+    for (index = 0; index < batch; ++index)
+        status[indexes[index]].status = results[index];
+
+cleanup:
+    noise_free((void *)public_keys, count * sizeof(uint8_t *));
+    noise_free((void *)messages, count * sizeof(uint8_t *));
+    noise_free(message_lens, count * sizeof(size_t));
+    noise_free((void *)signatures, count * sizeof(uint8_t *));
+    noise_free(results, count * sizeof(int));
+    noise_free(indexes, count * sizeof(size_t));
+    noise_signstate_free(sign);
+    return err;
+}
+
+/**
+ * \brief Verifies the signatures on a list of certificates.
+ *
+ * \param certs The certificates.
+ * \param num_certs The number of certificates.
+ * \param cache The cache of verified signatures, or NULL.
+ * \param status The array to fill with the status of each signature.
+ * \param max_status The maximum number of entries in \a status.
+ * \param num_status Returns the number of entries in \a status.
+ * \param max_threads The maximum number of threads to use.
+ *
+ * \return NOISE_ERROR_NONE if all signatures are valid, or an error
+ * code otherwise.
+ */
+static int noise_verify_certificates
+    (const Noise_Certificate * const *certs, size_t num_certs,
+     NoiseVerifyCache *cache, NoiseSignatureStatus *status,
+     size_t max_status, size_t *num_status, int max_threads)
+{
+    const Noise_Certificate *cert;
+    const Noise_SubjectInfo *subject;
+    const Noise_Signature *sig;
+    NoiseVerifyItem *items = 0;
+    uint8_t *subject_buf = 0;
+    size_t subject_buf_size = 0;
+    uint8_t *subject_data = 0;
+    size_t subject_len = 0;
+    uint8_t *extra_buf = 0;
+    size_t extra_buf_size = 0;
+    size_t total = 0;
+    size_t cert_index;
+    size_t sig_index;
+    size_t index;
+    int subject_err;
+    int err = NOISE_ERROR_NONE;
+
+    /* Make sure that there is enough room for the results */
+    for (cert_index = 0; cert_index < num_certs; ++cert_index)
+        total += Noise_Certificate_count_signatures(certs[cert_index]);
+    if (total > max_status)
+        return NOISE_ERROR_INVALID_LENGTH;
+    if (!total)
+        return NOISE_ERROR_NONE;
+    items = (NoiseVerifyItem *)
+        noise_new_memory(total * sizeof(NoiseVerifyItem));
+    if (!items)
+        return NOISE_ERROR_NO_MEMORY;
+
+    /* Canonicalize each certificate and collect up its signatures */
+    index = 0;
+    for (cert_index = 0; cert_index < num_certs; ++cert_index) {
+        cert = certs[cert_index];
+        subject = Noise_Certificate_get_subject(cert);
+        if (subject) {
+            subject_err = noise_verify_encode
+                ((NoiseWriteFunc)Noise_SubjectInfo_write, 2, subject,
+                 &subject_buf, &subject_buf_size, &subject_data, &subject_len);
+        } else {
+            subject_err = NOISE_ERROR_INVALID_FORMAT;
+        }
+        for (sig_index = 0;
+                sig_index < Noise_Certificate_count_signatures(cert);
+                ++sig_index, ++index) {
+            sig = Noise_Certificate_get_at_signatures(cert, sig_index);
+            status[index].cert_index = cert_index;
+            status[index].signature_index = sig_index;
+            status[index].signer_index = -1;
+            if (Noise_Signature_has_signing_key(sig)) {
+                status[index].signer_index = noise_verify_find_signer
+                    (certs, num_certs, Noise_Signature_get_signing_key(sig));
+            }
+            if (subject_err == NOISE_ERROR_NONE) {
+                status[index].status = noise_verify_prepare
+                    (&(items[index]), sig, subject_data, subject_len,
+                     &extra_buf, &extra_buf_size);
+            } else {
+                status[index].status = subject_err;
+            }
+            if (status[index].status == NOISE_ERROR_NO_MEMORY) {
+                err = NOISE_ERROR_NO_MEMORY;
+                goto cleanup;
+            }
+        }
+    }
+
+    /* Verify the signatures for each algorithm in a single batch */
+    for (index = 0; index < total; ++index) {
+        if (items[index].sign_id > 0) {
+            err = noise_verify_algorithm
+                (items, status, total, items[index].sign_id,
+                 cache, max_threads);
+            if (err != NOISE_ERROR_NONE)
+                goto cleanup;
+        }
+    }
+
+    /* Report a failure if any of the signatures did not verify */
+    for (index = 0; index < total; ++index) {
+        if (status[index].status != NOISE_ERROR_NONE) {
+            err = NOISE_ERROR_INVALID_SIGNATURE;
+            break;
+        }
+    }
+    *num_status = total;
+
+cleanup:
+    noise_free(items, total * sizeof(NoiseVerifyItem));
+    noise_free(subject_buf, subject_buf_size);
+    noise_free(extra_buf, extra_buf_size);
+    return err;
+}
+
+/** @endcond */
+
+/**
+ * \brief Counts the signatures on a certificate.
+ *
+ * \param cert The certificate.
+ *
+ * \return The number of signatures, or zero if \a cert is NULL.
+ *
+ * \sa noise_certificate_verify()
+ */
+size_t noise_certificate_count_signatures(const Noise_Certificate *cert)
+{
+    return Noise_Certificate_count_signatures(cert);
+}
+
+/**
+ * \brief Counts the signatures on all certificates in a chain.
+ *
+ * \param chain The certificate chain.
+ *
+ * \return The number of signatures, or zero if \a chain is NULL.
+ *
+ * This can be used to size the status array that is passed to
+ * noise_certificate_chain_verify().
+ *
+ * \sa noise_certificate_chain_verify()
+ */
+size_t noise_certificate_chain_count_signatures
+    (const Noise_CertificateChain *chain)
+{
+    size_t count = 0;
+    size_t index;
+    size_t num_certs = Noise_CertificateChain_count_certs(chain);
+    for (index = 0; index < num_certs; ++index) {
+        count += Noise_Certificate_count_signatures
+            (Noise_CertificateChain_get_at_certs(chain, index));
+    }
+    return count;
+}
+
+/**
+ * \brief Verifies the signatures on a certificate.
+ *
+ * \param cert The certificate to verify.
+ * \param cache The cache of verified signatures to consult, or NULL.
+ * \param status Points to an array that receives the status of
+ * each signature on the certificate.
+ * \param max_status The maximum number of entries in \a status.
+ * \param num_status Returns the number of entries in \a status that
+ * were filled in.
+ *
+ * \return NOISE_ERROR_NONE if all of the signatures are valid.
+ * \return NOISE_ERROR_INVALID_PARAM if \a cert, \a status, or
+ * \a num_status is NULL.
+ * \return NOISE_ERROR_INVALID_LENGTH if \a max_status is less than
+ * the number of signatures on the certificate.
+ * \return NOISE_ERROR_INVALID_SIGNATURE if one or more of the signatures
+ * could not be verified, in which case \a status indicates which ones.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory.
+ *
+ * The \a signer_index for each signature will be zero for a self-signed
+ * certificate, or -1 otherwise.
+ *
+ * \sa noise_certificate_chain_verify(), noise_certificate_count_signatures()
+ */
+int noise_certificate_verify
+    (const Noise_Certificate *cert, NoiseVerifyCache *cache,
+     NoiseSignatureStatus *status, size_t max_status, size_t *num_status)
+{
+    /* Validate the parameters */
+    if (num_status)
+        *num_status = 0;
+    if (!cert || !status || !num_status)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    /* Verify the signatures */
+    return noise_verify_certificates
+        (&cert, 1, cache, status, max_status, num_status, 1);
+}
+
+/**
+ * \brief Verifies the signatures on all certificates in a chain.
+ *
+ * \param chain The certificate chain to verify.
+ * \param cache The cache of verified signatures to consult, or NULL.
+ * \param status Points to an array that receives the status of
+ * each signature in the chain.
+ * \param max_status The maximum number of entries in \a status.
+ * \param num_status Returns the number of entries in \a status that
+ * were filled in.
+ * \param max_threads The maximum number of threads to use for
+ * verification, including the calling thread.  Zero or 1 indicates
+ * that all verification should be performed on the calling thread.
+ *
+ * \return NOISE_ERROR_NONE if all of the signatures are valid.
+ * \return NOISE_ERROR_INVALID_PARAM if \a chain, \a status, or
+ * \a num_status is NULL.
+ * \return NOISE_ERROR_INVALID_LENGTH if \a max_status is less than
+ * the number of signatures in the chain.
+ * \return NOISE_ERROR_INVALID_SIGNATURE if one or more of the signatures
+ * could not be verified, in which case \a status indicates which ones.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory.
+ *
+ * The entries in \a status are in the same order as the signatures
+ * appear in the chain.  The \a status field of each entry is set to one
+ * of the following values:
+ *
+ * \li NOISE_ERROR_NONE if the signature is valid.
+ * \li NOISE_ERROR_INVALID_SIGNATURE if the signature is not valid.
+ * \li NOISE_ERROR_INVALID_FORMAT if the certificate has no subject or the
+ * signature block is missing the signing key, hash algorithm, or signature.
+ * \li NOISE_ERROR_UNKNOWN_NAME if the signing or hash algorithm is
+ * not supported.
+ * \li NOISE_ERROR_INVALID_LENGTH if the signing key or signature has
+ * the wrong length for the signing algorithm.
+ *
+ * If \a cache is not NULL, then signatures that have been verified
+ * before are accepted from the cache and only the remainder are
+ * verified.  This saves a lot of work when peers present the same
+ * certificate chains over and over.
+ *
+ * Threads are only used when there are enough signatures to give each
+ * thread at least one full batch of 64.  If the library was built without
+ * thread support, then \a max_threads is ignored.
+ *
+ * \sa noise_certificate_verify(), noise_certificate_chain_count_signatures()
+ */
+int noise_certificate_chain_verify
+    (const Noise_CertificateChain *chain, NoiseVerifyCache *cache,
+     NoiseSignatureStatus *status, size_t max_status, size_t *num_status,
+     int max_threads)
+{
+    const Noise_Certificate **certs;
+    size_t num_certs;
+    size_t index;
+    int err;
+
+    /* Validate the parameters */
+    if (num_status)
+        *num_status = 0;
+    if (!chain || !status || !num_status)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    /* Collect up the certificates in the chain */
+    num_certs = Noise_CertificateChain_count_certs(chain);
+    if (!num_certs)
+        return NOISE_ERROR_NONE;
+    certs = (const Noise_Certificate **)
+        noise_new_memory(num_certs * sizeof(Noise_Certificate *));
+    if (!certs)
+        return NOISE_ERROR_NO_MEMORY;
+    for (index = 0; index < num_certs; ++index)
+        certs[index] = Noise_CertificateChain_get_at_certs(chain, index);
+
+    /* Verify the signatures */
+    err = noise_verify_certificates
+        (certs, num_certs, cache, status, max_status, num_status,
+         max_threads);
+    noise_free((void *)certs, num_certs * sizeof(Noise_Certificate *));
+    return err;
+}
+
+/**@}*/
@@ -21,8 +21,10 @@
  */
 
 #include <noise/protobufs.h>
+#include <noise/protocol/util.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 /**
  * \file protobufs.h
@@ -1700,7 +1702,10 @@ int noise_protobuf_read_string
  * This function will validate the incoming data to ensure that it is
  * strict UTF-8 with no embedded NUL's.
  *
- * The memory is allocated with the system malloc() function.
+ * The memory is allocated with noise_protobuf_new_memory(), which uses
+ * the allocator that was set with noise_set_allocator().  The string is
+ * NUL-terminated, so the caller should release it by passing \a size + 1
+ * to noise_protobuf_free_memory().
  *
  * \sa noise_protobuf_read_string(), noise_protobuf_read_alloc_bytes()
  */
@@ -1736,7 +1741,7 @@ int noise_protobuf_read_alloc_string
         pbuf->error = NOISE_ERROR_INVALID_FORMAT;
         return pbuf->error;
     }
-    if ((*str = (char *)malloc(sz + 1)) == 0) {
+    if ((*str = (char *)noise_protobuf_new_memory(sz + 1)) == 0) {
         pbuf->error = NOISE_ERROR_NO_MEMORY;
         return pbuf->error;
     }
@@ -1814,7 +1819,10 @@ int noise_protobuf_read_bytes
  * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to allocate
  * the byte array.
  *
- * The memory is allocated with the system malloc() function.
+ * The memory is allocated with noise_protobuf_new_memory(), which uses
+ * the allocator that was set with noise_set_allocator().  The caller
+ * should release the byte array by passing \a size to
+ * noise_protobuf_free_memory(), even if it is zero.
  *
  * \sa noise_protobuf_read_alloc_string(), noise_protobuf_read_bytes()
  */
@@ -1847,14 +1855,14 @@ int noise_protobuf_read_alloc_bytes
     if (err != NOISE_ERROR_NONE)
         return err;
     if (sz > 0) {
-        if ((*data = malloc(sz)) == 0) {
+        if ((*data = noise_protobuf_new_memory(sz)) == 0) {
             pbuf->error = NOISE_ERROR_NO_MEMORY;
             return pbuf->error;
         }
         memcpy(*data, d, sz);
     } else {
-        /* malloc() may return NULL for a zero size: prevent that */
-        if ((*data = malloc(1)) == 0) {
+        /* Always return a non-NULL pointer, even for a zero size */
+        if ((*data = noise_protobuf_new_memory(1)) == 0) {
             pbuf->error = NOISE_ERROR_NO_MEMORY;
             return pbuf->error;
         }
@@ -2076,7 +2084,10 @@ int noise_protobuf_add_to_array
 {
     if (*count >= *max) {
         size_t new_max = noise_protobuf_grow_array(*max);
-        void *new_array = calloc(new_max, size);
+        void *new_array;
+        if (new_max > SIZE_MAX / size)
+            return NOISE_ERROR_NO_MEMORY;
+        new_array = noise_protobuf_new_memory(new_max * size);
         if (!new_array)
             return NOISE_ERROR_NO_MEMORY;
         if (*count)
@@ -2099,13 +2110,15 @@ static int noise_protobuf_add_to_block_array
      const void *value, size_t size, int add_nul)
 {
     void *data;
+    size_t data_size;
 
     /* Bail out if the value to add is NULL and non-zero in size */
     if (!value && size)
         return NOISE_ERROR_INVALID_PARAM;
 
     /* Make a copy of the value first */
-    data = malloc(size + (add_nul ? 1 : 0));
+    data_size = size + (add_nul ? 1 : 0);
+    data = noise_protobuf_new_memory(data_size);
     if (!data)
         return NOISE_ERROR_NO_MEMORY;
     if (size)
@@ -2116,14 +2129,22 @@ static int noise_protobuf_add_to_block_array
     /* Grow the size of the array if necessary */
     if (*count >= *max) {
         size_t new_max = noise_protobuf_grow_array(*max);
-        void **new_array = (void **)calloc(new_max, sizeof(void *));
-        size_t *new_len_array = (size_t *)calloc(new_max, sizeof(size_t));
+        void **new_array;
+        size_t *new_len_array;
+        if (new_max > SIZE_MAX / sizeof(void *) ||
+                new_max > SIZE_MAX / sizeof(size_t)) {
+            noise_protobuf_free_memory(data, data_size);
+            return NOISE_ERROR_NO_MEMORY;
+        }
+        new_array = (void **)
+            noise_protobuf_new_memory(new_max * sizeof(void *));
+        new_len_array = (size_t *)
+            noise_protobuf_new_memory(new_max * sizeof(size_t));
         if (!new_array || !new_len_array) {
-            if (new_array)
-                free(new_array);
-            if (new_len_array)
-                free(new_len_array);
-            noise_protobuf_free_memory(data, size);
+            noise_protobuf_free_memory(new_array, new_max * sizeof(void *));
+            noise_protobuf_free_memory
+                (new_len_array, new_max * sizeof(size_t));
+            noise_protobuf_free_memory(data, data_size);
             return NOISE_ERROR_NO_MEMORY;
         }
         if (*count) {
@@ -2226,7 +2247,10 @@ int noise_protobuf_insert_into_array
     /* Grow the array size if necessary */
     if (*count >= *max) {
         size_t new_max = noise_protobuf_grow_array(*max);
-        void *new_array = calloc(new_max, size);
+        void *new_array;
+        if (new_max > SIZE_MAX / size)
+            return NOISE_ERROR_NO_MEMORY;
+        new_array = noise_protobuf_new_memory(new_max * size);
         if (!new_array)
             return NOISE_ERROR_NO_MEMORY;
         if (*count)
@@ -2245,24 +2269,37 @@ int noise_protobuf_insert_into_array
     return NOISE_ERROR_NONE;
 }
 
+/**
+ * \brief Allocates a zeroed block of memory for a protobuf object or field.
+ *
+ * \param size The size of the block in bytes.
+ *
+ * \return A pointer to the block, or NULL if there is insufficient memory.
+ *
+ * This function uses the allocator that was set with noise_set_allocator().
+ *
+ * \sa noise_protobuf_free_memory()
+ */
+void *noise_protobuf_new_memory(size_t size)
+{
+    return noise_new_memory(size);
+}
+
 /**
  * \brief Frees a block of memory after securely clearing it.
  *
  * \param ptr Points to the block of memory.
- * \param size The size of the block in bytes.
+ * \param size The size of the block in bytes, which must be the size
+ * that was passed to noise_protobuf_new_memory().
  *
- * This function uses the system free() function to free \a ptr.
+ * This function uses noise_free() to return \a ptr to the allocator
+ * that was set with noise_set_allocator().
+ *
+ * \sa noise_protobuf_new_memory()
  */
 void noise_protobuf_free_memory(void *ptr, size_t size)
 {
-    if (ptr) {
-        volatile uint8_t *p = (volatile uint8_t *)ptr;
-        while (size > 0) {
-            *p++ = 0;
-            --size;
-        }
-        free(ptr);
-    }
+    noise_free(ptr, size);
 }
 
 /**@}*/
@@ -160,7 +160,7 @@ int noise_cipherstate_free(NoiseCipherState *state)
         (*(state->destroy))(state);
 
     /* Clean and free the memory */
-    noise_free(state, state->size);
+    noise_free_object(state, state->size);
     return NOISE_ERROR_NONE;
 }
 
@@ -496,6 +496,171 @@ int noise_cipherstate_decrypt(NoiseCipherState *state, NoiseBuffer *buffer)
     return noise_cipherstate_decrypt_with_ad(state, NULL, 0, buffer);
 }
 
+/**
+ * \brief Encrypts a batch of packets with this CipherState object.
+ *
+ * \param state The CipherState object.
+ * \param buffers Points to an array of \a count buffers, each containing
+ * the plaintext of one packet on entry and the ciphertext plus MAC on exit.
+ * \param count The number of packets to encrypt.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state or \a buffers is NULL,
+ * or one of the buffers has a NULL data pointer.
+ * \return NOISE_ERROR_INVALID_NONCE if the nonce would overflow before
+ * all of the packets have been encrypted.
+ * \return NOISE_ERROR_INVALID_LENGTH if the ciphertext plus MAC for one
+ * of the packets is too large to fit within the maximum size of its
+ * buffer and to also remain within 65535 bytes.
+ *
+ * This is equivalent to calling noise_cipherstate_encrypt() on each of
+ * the buffers in order, so packet i is encrypted with the current nonce
+ * plus i.  Back ends that support batching can amortize the per-packet
+ * setup cost across the whole batch, which is useful when an application
+ * has many small transport packets to send at once.
+ *
+ * All buffers are validated before any of them are encrypted, so on error
+ * none of the packets are modified and the nonce is unchanged.
+ *
+ * \sa noise_cipherstate_decrypt_batch(), noise_cipherstate_encrypt()
+ */
+int noise_cipherstate_encrypt_batch
+    (NoiseCipherState *state, NoiseBuffer *buffers, size_t count)
+{
+    size_t index;
+    int err;
+
+    /* Validate the parameters */
+    if (!state || !buffers)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (index = 0; index < count; ++index) {
+        const NoiseBuffer *buffer = &(buffers[index]);
+        if (!(buffer->data))
+            return NOISE_ERROR_INVALID_PARAM;
+        if (buffer->size > buffer->max_size)
+            return NOISE_ERROR_INVALID_LENGTH;
+        if (!state->has_key) {
+            if (buffer->size > NOISE_MAX_PAYLOAD_LEN)
+                return NOISE_ERROR_INVALID_LENGTH;
+            continue;
+        }
+        if (buffer->size > (size_t)(NOISE_MAX_PAYLOAD_LEN - state->mac_len))
+            return NOISE_ERROR_INVALID_LENGTH;
+        if ((buffer->max_size - buffer->size) < state->mac_len)
+            return NOISE_ERROR_INVALID_LENGTH;
+    }
+
+    /* If the key hasn't been set yet, return the plaintext as-is */
+    if (!state->has_key || !count)
+        return NOISE_ERROR_NONE;
+
+    /* Every packet in the batch needs a nonce below the reserved 2^64 - 1 */
+    if (count > (0xFFFFFFFFFFFFFFFFULL - state->n))
+        return NOISE_ERROR_INVALID_NONCE;
+
+    /* Encrypt the packets, using the back end's batch support if present */
+    if (state->encrypt_batch) {
+        err = (*(state->encrypt_batch))(state, buffers, count);
+        state->n += count;
+        if (err != NOISE_ERROR_NONE)
+            return err;
+        for (index = 0; index < count; ++index)
+            buffers[index].size += state->mac_len;
+    } else {
+        for (index = 0; index < count; ++index) {
+            err = (*(state->encrypt))
+                (state, 0, 0, buffers[index].data, buffers[index].size);
+            ++(state->n);
+            if (err != NOISE_ERROR_NONE)
+                return err;
+            buffers[index].size += state->mac_len;
+        }
+    }
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Decrypts a batch of packets with this CipherState object.
+ *
+ * \param state The CipherState object.
+ * \param buffers Points to an array of \a count buffers, each containing
+ * the ciphertext plus MAC of one packet on entry and the plaintext on exit.
+ * \param count The number of packets to decrypt.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state or \a buffers is NULL,
+ * or one of the buffers has a NULL data pointer.
+ * \return NOISE_ERROR_MAC_FAILURE if the MAC check failed for one of
+ * the packets.
+ * \return NOISE_ERROR_INVALID_NONCE if the nonce would overflow before
+ * all of the packets have been decrypted.
+ * \return NOISE_ERROR_INVALID_LENGTH if the size of one of the buffers
+ * is larger than 65535 bytes or is too small to contain the MAC value.
+ *
+ * This is equivalent to calling noise_cipherstate_decrypt() on each of
+ * the buffers in order, so packet i is decrypted with the current nonce
+ * plus i.
+ *
+ * If the MAC check fails for one of the packets, then the packets before
+ * it will have been decrypted and the nonce advanced past them.  The
+ * failing packet and all packets after it are left as-is.  The caller
+ * can tell which packets were decrypted because their buffer sizes will
+ * have been reduced by the MAC length.  No plaintext is released for a
+ * packet until its own MAC has been verified.
+ *
+ * \sa noise_cipherstate_encrypt_batch(), noise_cipherstate_decrypt()
+ */
+int noise_cipherstate_decrypt_batch
+    (NoiseCipherState *state, NoiseBuffer *buffers, size_t count)
+{
+    size_t index;
+    size_t done;
+    int err;
+
+    /* Validate the parameters */
+    if (!state || !buffers)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (index = 0; index < count; ++index) {
+        const NoiseBuffer *buffer = &(buffers[index]);
+        if (!(buffer->data))
+            return NOISE_ERROR_INVALID_PARAM;
+        if (buffer->size > buffer->max_size ||
+                buffer->size > NOISE_MAX_PAYLOAD_LEN)
+            return NOISE_ERROR_INVALID_LENGTH;
+        if (state->has_key && buffer->size < state->mac_len)
+            return NOISE_ERROR_INVALID_LENGTH;
+    }
+
+    /* If the key hasn't been set yet, return the ciphertext as-is */
+    if (!state->has_key || !count)
+        return NOISE_ERROR_NONE;
+
+    /* Every packet in the batch needs a nonce below the reserved 2^64 - 1 */
+    if (count > (0xFFFFFFFFFFFFFFFFULL - state->n))
+        return NOISE_ERROR_INVALID_NONCE;
+
+    /* Decrypt the packets, using the back end's batch support if present */
+    if (state->decrypt_batch) {
+        done = (*(state->decrypt_batch))(state, buffers, count);
+        for (index = 0; index < done; ++index)
+            buffers[index].size -= state->mac_len;
+        state->n += done;
+        if (done < count)
+            return NOISE_ERROR_MAC_FAILURE;
+    } else {
+        for (index = 0; index < count; ++index) {
+            err = (*(state->decrypt))
+                (state, 0, 0, buffers[index].data,
+                 buffers[index].size - state->mac_len);
+            if (err != NOISE_ERROR_NONE)
+                return err;
+            ++(state->n);
+            buffers[index].size -= state->mac_len;
+        }
+    }
+    return NOISE_ERROR_NONE;
+}
+
 /**
  * \brief Sets the nonce value for this cipherstate object.
  *
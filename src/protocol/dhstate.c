@@ -154,7 +154,7 @@ int noise_dhstate_free(NoiseDHState *state)
         (*(state->destroy))(state);
 
     /* Clean and free the memory */
-    noise_free(state, state->size);
+    noise_free_object(state, state->size);
     return NOISE_ERROR_NONE;
 }
 
@@ -322,11 +322,16 @@ int noise_dhstate_generate_keypair(NoiseDHState *state)
  * algorithm does not require dependent parameters to generate the
  * keypair, \a other is ignored.
  *
+ * If a pool of pre-generated keypairs has been set with
+ * noise_dhstate_set_ephemeral_pool(), then a keypair is taken from the
+ * pool instead when one is available.
+ *
  * \note This function needs to generate random key material for the
  * private key, so the system random number generator must be properly
  * seeded before calling this function.
  *
- * \sa noise_dhstate_calculate(), noise_dhstate_set_keypair()
+ * \sa noise_dhstate_calculate(), noise_dhstate_set_keypair(),
+ * noise_dhstate_set_ephemeral_pool()
  */
 int noise_dhstate_generate_dependent_keypair
     (NoiseDHState *state, const NoiseDHState *other)
@@ -339,6 +344,11 @@ int noise_dhstate_generate_dependent_keypair
     if (other && state->dh_id != other->dh_id)
         return NOISE_ERROR_INVALID_PARAM;
 
+    /* Take a pre-generated keypair from the pool if one is available */
+    if (state->ephemeral_pool &&
+            noise_ephemeral_pool_pop(state->ephemeral_pool, state))
+        return NOISE_ERROR_NONE;
+
     /* Generate the new keypair */
     err = (*(state->generate_keypair))(state, other);
     if (err == NOISE_ERROR_NONE)
@@ -346,6 +356,36 @@ int noise_dhstate_generate_dependent_keypair
     return err;
 }
 
+/**
+ * \brief Sets the pool of pre-generated keypairs to use for a DHState.
+ *
+ * \param state The DHState object.
+ * \param pool The pool of pre-generated ephemeral keypairs, or NULL to
+ * stop using a pool.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state is NULL.
+ * \return NOISE_ERROR_NOT_APPLICABLE if \a pool is for a different
+ * algorithm than \a state.
+ *
+ * Once a pool has been set, noise_dhstate_generate_dependent_keypair()
+ * takes keypairs from the pool when it can, and only generates a new
+ * keypair inline when the pool is empty.  The pool must outlive \a state
+ * or be detached from it first.
+ *
+ * \sa noise_ephemeral_pool_new(), noise_handshakestate_set_ephemeral_pool()
+ */
+int noise_dhstate_set_ephemeral_pool
+    (NoiseDHState *state, NoiseEphemeralPool *pool)
+{
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (pool && pool->dh_id != state->dh_id)
+        return NOISE_ERROR_NOT_APPLICABLE;
+    state->ephemeral_pool = pool;
+    return NOISE_ERROR_NONE;
+}
+
 /**
  * \brief Sets the keypair within a DHState object.
  *
@@ -844,4 +884,147 @@ int noise_dhstate_set_role(NoiseDHState *state, int role)
     return NOISE_ERROR_NONE;
 }
 
+
+/**
+ * \typedef NoiseStaticKey
+ * \brief Opaque object that represents a shared, immutable static keypair.
+ *
+ * Servers typically use the same static keypair for every handshake they
+ * accept.  Rather than loading and validating the keypair into a fresh
+ * DHState for each HandshakeState, the application can create a
+ * NoiseStaticKey once and attach it to each handshake with
+ * noise_handshakestate_set_static_key().  The key is reference-counted
+ * and is never modified after creation, so it can be shared between
+ * HandshakeStates that are running on different threads.
+ */
+
+/**
+ * \brief Creates a new static key from the keypair in a DHState.
+ *
+ * \param key Points to the variable where to store the pointer to
+ * the new NoiseStaticKey object.
+ * \param state The DHState object containing the keypair.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a key or \a state is NULL.
+ * \return NOISE_ERROR_INVALID_STATE if \a state does not contain a keypair.
+ * \return NOISE_ERROR_NOT_APPLICABLE if \a state is for an ephemeral-only
+ * algorithm which cannot be used for static keys.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to
+ * allocate the new object.
+ *
+ * The keypair was already validated when it was loaded into \a state with
+ * noise_dhstate_set_keypair(), noise_dhstate_set_keypair_private(), or
+ * noise_dhstate_generate_keypair().  This function copies the keys without
+ * recomputing the public key.  The new object starts with a single
+ * reference, which the caller releases with noise_static_key_unref().
+ *
+ * \sa noise_static_key_unref(), noise_handshakestate_set_static_key()
+ */
+int noise_static_key_new(NoiseStaticKey **key, const NoiseDHState *state)
+{
+    NoiseStaticKey *k;
+    int err;
+
+    /* Validate the parameters */
+    if (!key)
+        return NOISE_ERROR_INVALID_PARAM;
+    *key = 0;
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (state->key_type != NOISE_KEY_TYPE_KEYPAIR)
+        return NOISE_ERROR_INVALID_STATE;
+    if (state->ephemeral_only)
+        return NOISE_ERROR_NOT_APPLICABLE;
+
+    /* Allocate the static key and a private DHState to hold the keys */
+    k = noise_new(NoiseStaticKey);
+    if (!k)
+        return NOISE_ERROR_NO_MEMORY;
+    err = noise_dhstate_new_by_id(&(k->dh), state->dh_id);
+    if (err == NOISE_ERROR_NONE)
+        err = noise_dhstate_copy(k->dh, state);
+    if (err != NOISE_ERROR_NONE) {
+        if (k->dh)
+            noise_dhstate_free(k->dh);
+        noise_free(k, k->size);
+        return err;
+    }
+    k->refs = 1;
+    *key = k;
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Adds a reference to a static key.
+ *
+ * \param key The NoiseStaticKey object.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a key is NULL.
+ *
+ * Each call must be balanced by a call to noise_static_key_unref().
+ *
+ * \sa noise_static_key_unref()
+ */
+int noise_static_key_ref(NoiseStaticKey *key)
+{
+    if (!key)
+        return NOISE_ERROR_INVALID_PARAM;
+    noise_atomic_inc(&(key->refs));
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Releases a reference to a static key.
+ *
+ * \param key The NoiseStaticKey object.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a key is NULL.
+ *
+ * The key material is cleaned and freed when the last reference
+ * is released.
+ *
+ * \sa noise_static_key_new(), noise_static_key_ref()
+ */
+int noise_static_key_unref(NoiseStaticKey *key)
+{
+    if (!key)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (noise_atomic_dec(&(key->refs)) == 0) {
+        noise_dhstate_free(key->dh);
+        noise_free(key, key->size);
+    }
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Gets the algorithm identifier for a static key.
+ *
+ * \param key The NoiseStaticKey object.
+ *
+ * \return The algorithm identifier, or NOISE_DH_NONE if \a key is NULL.
+ */
+int noise_static_key_get_dh_id(const NoiseStaticKey *key)
+{
+    return key ? key->dh->dh_id : NOISE_DH_NONE;
+}
+
+/**
+ * \brief Gets read-only access to the DHState inside a static key.
+ *
+ * \param key The NoiseStaticKey object.
+ *
+ * \return A pointer to the DHState, or NULL if \a key is NULL.
+ *
+ * The returned object can be passed to functions such as
+ * noise_dhstate_get_public_key() or noise_dhstate_format_fingerprint().
+ * It must not be modified or freed by the caller.
+ */
+const NoiseDHState *noise_static_key_get_dhstate(const NoiseStaticKey *key)
+{
+    return key ? key->dh : 0;
+}
+
 /**@}*/
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "internal.h"
+#include <string.h>
+
+/**
+ * \file ephemeralpool.h
+ * \brief EphemeralPool interface
+ */
+
+/**
+ * \file ephemeralpool.c
+ * \brief EphemeralPool implementation
+ */
+
+/**
+ * \defgroup ephemeralpool EphemeralPool API
+ *
+ * Generating the local ephemeral keypair is on the critical path of the
+ * first handshake message.  An EphemeralPool moves that work elsewhere:
+ * a worker thread calls noise_ephemeral_pool_fill() to generate keypairs
+ * ahead of time into a bounded lock-free ring, and HandshakeStates that
+ * have the pool attached with noise_handshakestate_set_ephemeral_pool()
+ * take a keypair from the ring instead of generating one inline.  If the
+ * ring is empty, the keypair is generated inline as before.
+ *
+ * Each keypair is handed out exactly once and is cleared from the pool
+ * when it is taken.
+ *
+ * Refilling is synchronous: noise_ephemeral_pool_fill() generates the
+ * keypairs on the calling thread, and the library never creates a
+ * worker thread of its own.  Applications that want the keypairs to be
+ * generated off the handshake path run their own worker thread whose
+ * loop calls noise_ephemeral_pool_fill() and sleeps briefly whenever
+ * nothing was generated because the pool was already full.
+ */
+/**@{*/
+
+/**
+ * \typedef NoiseEphemeralPool
+ * \brief Opaque object that represents a pool of pre-generated
+ * ephemeral keypairs.
+ */
+
+/** @cond */
+
+/* Upper bound on the capacity to keep allocations sensible */
+#define NOISE_EPHEMERAL_POOL_MAX_CAPACITY 65536
+
+/** @endcond */
+
+/**
+ * \brief Creates a new pool of pre-generated ephemeral keypairs.
+ *
+ * \param pool Points to the variable where to store the pointer to
+ * the new EphemeralPool object.
+ * \param dh_id The algorithm identifier; NOISE_DH_CURVE25519,
+ * NOISE_DH_CURVE448, NOISE_DH_NEWHOPE, etc.
+ * \param capacity The maximum number of keypairs to hold, which is
+ * rounded up to the next power of two.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a pool is NULL, or \a capacity
+ * is zero or larger than 65536.
+ * \return NOISE_ERROR_UNKNOWN_ID if \a dh_id is unknown.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to
+ * allocate the new EphemeralPool object.
+ *
+ * The pool starts out empty.  For algorithms like New Hope where the
+ * responder's keypair depends upon the initiator's public key, the pool
+ * holds initiator keypairs only and responders always generate inline.
+ *
+ * \sa noise_ephemeral_pool_free(), noise_ephemeral_pool_fill()
+ */
+int noise_ephemeral_pool_new
+    (NoiseEphemeralPool **pool, int dh_id, size_t capacity)
+{
+    NoiseEphemeralPool *p;
+    size_t size;
+    size_t index;
+    int err;
+
+    /* Validate the parameters */
+    if (!pool)
+        return NOISE_ERROR_INVALID_PARAM;
+    *pool = 0;
+    if (!capacity || capacity > NOISE_EPHEMERAL_POOL_MAX_CAPACITY)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (size = 1; size < capacity; size <<= 1)
+        ;   /* Round up to a power of two */
+
+    /* Allocate the pool and the ring of slots */
+    p = noise_new(NoiseEphemeralPool);
+    if (!p)
+        return NOISE_ERROR_NO_MEMORY;
+    p->dh_id = dh_id;
+    p->capacity = size;
+    p->slots = (NoiseEphemeralSlot *)
+        noise_new_memory(size * sizeof(NoiseEphemeralSlot));
+    if (!p->slots) {
+        noise_free(p, p->size);
+        return NOISE_ERROR_NO_MEMORY;
+    }
+
+    /* Each slot gets its own DHState to hold a keypair */
+    for (index = 0; index < size; ++index) {
+        p->slots[index].sequence = index;
+        err = noise_dhstate_new_by_id(&(p->slots[index].dh), dh_id);
+        if (err == NOISE_ERROR_NONE && p->slots[index].dh->ephemeral_only) {
+            err = noise_dhstate_set_role
+                (p->slots[index].dh, NOISE_ROLE_INITIATOR);
+        }
+        if (err != NOISE_ERROR_NONE) {
+            noise_ephemeral_pool_free(p);
+            return err;
+        }
+    }
+
+    *pool = p;
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Frees a pool of pre-generated ephemeral keypairs.
+ *
+ * \param pool The EphemeralPool object to free.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a pool is NULL.
+ *
+ * The pool must not be in use by any worker thread, and must be detached
+ * from all DHState and HandshakeState objects, before it is freed.
+ *
+ * \sa noise_ephemeral_pool_new()
+ */
+int noise_ephemeral_pool_free(NoiseEphemeralPool *pool)
+{
+    size_t index;
+
+    /* Validate the parameter */
+    if (!pool)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    /* Destroy the keypairs and the pool */
+    if (pool->slots) {
+        for (index = 0; index < pool->capacity; ++index) {
+            if (pool->slots[index].dh)
+                noise_dhstate_free(pool->slots[index].dh);
+        }
+        noise_free(pool->slots,
+                   pool->capacity * sizeof(NoiseEphemeralSlot));
+    }
+    noise_free(pool, pool->size);
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Gets the algorithm identifier for a pool of ephemeral keypairs.
+ *
+ * \param pool The EphemeralPool object.
+ *
+ * \return The algorithm identifier, or NOISE_DH_NONE if \a pool is NULL.
+ */
+int noise_ephemeral_pool_get_dh_id(const NoiseEphemeralPool *pool)
+{
+    return pool ? pool->dh_id : NOISE_DH_NONE;
+}
+
+/**
+ * \brief Gets the maximum number of keypairs that a pool can hold.
+ *
+ * \param pool The EphemeralPool object.
+ *
+ * \return The capacity of the pool after rounding up to a power of two,
+ * or zero if \a pool is NULL.
+ */
+size_t noise_ephemeral_pool_get_capacity(const NoiseEphemeralPool *pool)
+{
+    return pool ? pool->capacity : 0;
+}
+
+/**
+ * \brief Gets the number of keypairs that are currently in a pool.
+ *
+ * \param pool The EphemeralPool object.
+ *
+ * \return The number of keypairs, or zero if \a pool is NULL.
+ *
+ * The value is a snapshot; other threads may add or remove keypairs
+ * at any time.
+ */
+size_t noise_ephemeral_pool_get_count(const NoiseEphemeralPool *pool)
+{
+    size_t head, tail;
+    if (!pool)
+        return 0;
+    tail = noise_atomic_load(&(pool->dequeue_pos));
+    head = noise_atomic_load(&(pool->enqueue_pos));
+    if (head <= tail)
+        return 0;
+    return head - tail;
+}
+
+/**
+ * \brief Generates keypairs into a pool until it is full.
+ *
+ * \param pool The EphemeralPool object.
+ * \param max_count The maximum number of keypairs to generate, or zero
+ * to keep going until the pool is full.
+ * \param generated Returns the number of keypairs that were generated.
+ * May be NULL if the caller is not interested in the count.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a pool is NULL.
+ *
+ * The keypairs are generated synchronously on the calling thread; the
+ * pool has no worker thread of its own.  The function is intended to be
+ * called from a worker thread that the application owns.  Any number of
+ * threads may fill and take from the same pool concurrently.
+ * A slot is claimed before its keypair is generated, so no work is lost
+ * when the pool fills up.
+ *
+ * \note This function needs to generate random key material, so the
+ * system random number generator must be properly seeded first.
+ */
+int noise_ephemeral_pool_fill
+    (NoiseEphemeralPool *pool, size_t max_count, size_t *generated)
+{
+    NoiseEphemeralSlot *slot;
+    size_t count = 0;
+    size_t pos;
+    size_t seq;
+
+    /* Validate the parameters */
+    if (generated)
+        *generated = 0;
+    if (!pool)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    pos = noise_atomic_load(&(pool->enqueue_pos));
+    while (!max_count || count < max_count) {
+        /* Claim the slot at the enqueue position if it is free */
+        slot = &(pool->slots[pos & (pool->capacity - 1)]);
+        seq = noise_atomic_load(&(slot->sequence));
+        if (seq == pos) {
+            if (!noise_atomic_cas(&(pool->enqueue_pos), &pos, pos + 1))
+                continue;
+        } else if ((ptrdiff_t)(seq - pos) < 0) {
+            break;  /* The pool is full */
+        } else {
+            pos = noise_atomic_load(&(pool->enqueue_pos));
+            continue;
+        }
+
+        /* Generate the keypair and hand the slot to the consumers.
+           On failure the slot is published without a key, and the
+           consumer will skip it and generate inline instead. */
+        if (noise_dhstate_generate_keypair(slot->dh) == NOISE_ERROR_NONE)
+            ++count;
+        noise_atomic_store(&(slot->sequence), pos + 1);
+        pos = noise_atomic_load(&(pool->enqueue_pos));
+    }
+
+    if (generated)
+        *generated = count;
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Takes a pre-generated keypair from a pool.
+ *
+ * \param pool The EphemeralPool object.
+ * \param state The DHState to copy the keypair into.
+ *
+ * \return Non-zero if a keypair was taken, or zero if the pool is empty
+ * or cannot supply a keypair for \a state.
+ *
+ * \note This function is internal to the library.
+ */
+int noise_ephemeral_pool_pop(NoiseEphemeralPool *pool, NoiseDHState *state)
+{
+    NoiseEphemeralSlot *slot;
+    size_t pos;
+    size_t seq;
+    int taken;
+
+    /* Responder keypairs for algorithms like New Hope depend upon the
+       initiator's public key and cannot be generated ahead of time */
+    if (pool->dh_id != state->dh_id)
+        return 0;
+    if (state->ephemeral_only && state->role == NOISE_ROLE_RESPONDER)
+        return 0;
+
+    /* Claim the slot at the dequeue position if it has been filled */
+    pos = noise_atomic_load(&(pool->dequeue_pos));
+    for (;;) {
+        slot = &(pool->slots[pos & (pool->capacity - 1)]);
+        seq = noise_atomic_load(&(slot->sequence));
+        if (seq == pos + 1) {
+            if (noise_atomic_cas(&(pool->dequeue_pos), &pos, pos + 1))
+                break;
+        } else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+            return 0;   /* The pool is empty */
+        } else {
+            pos = noise_atomic_load(&(pool->dequeue_pos));
+        }
+    }
+
+    /* Move the keypair out of the slot and hand the slot back */
+    taken = (slot->dh->key_type == NOISE_KEY_TYPE_KEYPAIR &&
+             noise_dhstate_copy(state, slot->dh) == NOISE_ERROR_NONE);
+    noise_dhstate_clear_key(slot->dh);
+    noise_atomic_store(&(slot->sequence), pos + pool->capacity);
+    return taken;
+}
+
+/**@}*/
@@ -323,6 +323,144 @@ int noise_handshakestate_new_by_name
     return noise_handshakestate_new(state, symmetric, role);
 }
 
+/**
+ * \brief Gets the size of the arena needed to hold a HandshakeState object.
+ *
+ * \param protocol_id The protocol identifier as a set of algorithm identifiers.
+ * \param role The role for the new object, either NOISE_ROLE_INITIATOR or
+ * NOISE_ROLE_RESPONDER.
+ * \param size Points to the variable where to store the arena size
+ * in bytes.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if either \a protocol_id or \a size
+ * is NULL, or \a role is not one of NOISE_ROLE_INITIATOR or
+ * NOISE_ROLE_RESPONDER.
+ * \return NOISE_ERROR_NOT_APPLICABLE if the platform does not support
+ * arenas, or the combination of algorithm identifiers in \a protocol_id
+ * is not permitted.
+ * \return NOISE_ERROR_UNKNOWN_ID if the \a protocol_id is unknown.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to
+ * measure the objects.
+ *
+ * The size is measured by constructing a HandshakeState on the heap and
+ * recording the space that its objects take up, so applications should
+ * call this once per protocol and keep the result.  The size allows for
+ * an arena that is not aligned.
+ *
+ * \sa noise_handshakestate_new_in_arena()
+ */
+int noise_handshakestate_get_arena_size
+    (const NoiseProtocolId *protocol_id, int role, size_t *size)
+{
+    NoiseHandshakeState *state;
+    NoiseArena arena;
+    NoiseArena *prev;
+    int err;
+
+    /* Validate the parameters */
+    if (!size)
+        return NOISE_ERROR_INVALID_PARAM;
+    *size = 0;
+    if (!protocol_id)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (role != NOISE_ROLE_INITIATOR && role != NOISE_ROLE_RESPONDER)
+        return NOISE_ERROR_INVALID_PARAM;
+#if !defined(NOISE_THREAD_LOCAL)
+    return NOISE_ERROR_NOT_APPLICABLE;
+#else
+
+    /* Measure the objects that make up the HandshakeState */
+    arena.base = 0;
+    arena.size = 0;
+    arena.posn = 0;
+    prev = noise_arena_set(&arena);
+    err = noise_handshakestate_new_by_id(&state, protocol_id, role);
+    noise_arena_set(prev);
+    if (err != NOISE_ERROR_NONE)
+        return err;
+    noise_handshakestate_free(state);
+    *size = arena.posn + NOISE_ARENA_ALIGN - 1;
+    return NOISE_ERROR_NONE;
+#endif
+}
+
+/**
+ * \brief Creates a new HandshakeState object inside a caller-supplied arena.
+ *
+ * \param state Points to the variable where to store the pointer to
+ * the new HandshakeState object.
+ * \param protocol_id The protocol identifier as a set of algorithm identifiers.
+ * \param role The role for the new object, either NOISE_ROLE_INITIATOR or
+ * NOISE_ROLE_RESPONDER.
+ * \param arena Points to the memory to construct the object in.
+ * \param arena_size The size of the \a arena in bytes.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state, \a protocol_id, or
+ * \a arena is NULL, or \a role is not one of NOISE_ROLE_INITIATOR or
+ * NOISE_ROLE_RESPONDER.
+ * \return NOISE_ERROR_UNKNOWN_ID if the \a protocol_id is unknown.
+ * \return NOISE_ERROR_NOT_APPLICABLE if the platform does not support
+ * arenas, or the combination of algorithm identifiers in \a protocol_id
+ * is not permitted.
+ * \return NOISE_ERROR_NO_MEMORY if \a arena_size is too small.
+ *
+ * The HandshakeState, its SymmetricState, CipherState, and HashState,
+ * and all of its DHState objects are allocated from \a arena rather than
+ * the heap.  The arena must be at least the size that is reported by
+ * noise_handshakestate_get_arena_size() and must stay valid until the
+ * object is freed.
+ *
+ * The object is destroyed with noise_handshakestate_free() as usual,
+ * which cleans the entire arena but leaves the memory itself to the
+ * caller.  The arena can then be reused for the next handshake.
+ * The CipherState objects from noise_handshakestate_split() are
+ * allocated on the heap so that they can outlive the arena.
+ *
+ * \sa noise_handshakestate_get_arena_size(), noise_handshakestate_free()
+ */
+int noise_handshakestate_new_in_arena
+    (NoiseHandshakeState **state, const NoiseProtocolId *protocol_id,
+     int role, void *arena, size_t arena_size)
+{
+    NoiseArena a;
+    NoiseArena *prev;
+    int err;
+
+    /* Validate the parameters */
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+    *state = 0;
+    if (!protocol_id || !arena)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (role != NOISE_ROLE_INITIATOR && role != NOISE_ROLE_RESPONDER)
+        return NOISE_ERROR_INVALID_PARAM;
+#if !defined(NOISE_THREAD_LOCAL)
+    (void)arena_size;
+    return NOISE_ERROR_NOT_APPLICABLE;
+#else
+
+    /* Construct the objects with the arena installed */
+    a.base = (uint8_t *)arena;
+    a.size = arena_size;
+    a.posn = 0;
+    prev = noise_arena_set(&a);
+    err = noise_handshakestate_new_by_id(state, protocol_id, role);
+    noise_arena_set(prev);
+    if (err != NOISE_ERROR_NONE) {
+        *state = 0;
+        noise_clean(arena, arena_size);
+        return err;
+    }
+
+    /* Record the arena so that noise_handshakestate_free() can find it */
+    (*state)->arena = a;
+    (*state)->symmetric->arena = &((*state)->arena);
+    return NOISE_ERROR_NONE;
+#endif
+}
+
 /**
  * \brief Frees a HandshakeState object after destroying all sensitive material.
  *
@@ -331,19 +469,32 @@ int noise_handshakestate_new_by_name
  * \return NOISE_ERROR_NONE on success.
  * \return NOISE_ERROR_INVALID_PARAM if \a state is NULL.
  *
+ * If \a state was created with noise_handshakestate_new_in_arena(), then
+ * the whole arena is cleaned and the memory is left to the caller.
+ *
  * \sa noise_handshakestate_new_by_id(), noise_handshakestate_new_by_name()
  */
 int noise_handshakestate_free(NoiseHandshakeState *state)
 {
+    NoiseArena arena;
+    NoiseArena *prev = 0;
+
     /* Bail out if no handshake state */
     if (!state)
         return NOISE_ERROR_INVALID_PARAM;
 
+    /* Objects that live in an arena are cleaned but not freed */
+    arena = state->arena;
+    if (arena.base)
+        prev = noise_arena_set(&arena);
+
     /* Free the sub objects that are hanging off the handshakestate */
     if (state->symmetric)
         noise_symmetricstate_free(state->symmetric);
     if (state->dh_local_static)
         noise_dhstate_free(state->dh_local_static);
+    if (state->static_key)
+        noise_static_key_unref(state->static_key);
     if (state->dh_local_ephemeral)
         noise_dhstate_free(state->dh_local_ephemeral);
     if (state->dh_local_hybrid)
@@ -361,7 +512,13 @@ int noise_handshakestate_free(NoiseHandshakeState *state)
     noise_free(state->prologue, state->prologue_len);
 
     /* Clean and free the memory for "state" */
-    noise_free(state, state->size);
+    noise_free_object(state, state->size);
+
+    /* Clean the rest of the arena, including any alignment padding */
+    if (arena.base) {
+        noise_arena_set(prev);
+        noise_clean(arena.base, arena.size);
+    }
     return NOISE_ERROR_NONE;
 }
 
@@ -401,6 +558,22 @@ int noise_handshakestate_get_protocol_id
     return NOISE_ERROR_NONE;
 }
 
+/**
+ * \brief Gets the DHState that holds the effective local static keypair.
+ *
+ * \param state The HandshakeState object.
+ *
+ * \return The DHState from the shared static key if one has been set with
+ * noise_handshakestate_set_static_key(), or dh_local_static otherwise.
+ */
+static const NoiseDHState *noise_handshakestate_local_static
+    (const NoiseHandshakeState *state)
+{
+    if (state->static_key)
+        return state->static_key->dh;
+    return state->dh_local_static;
+}
+
 /**
  * \brief Gets the DHState object that contains the local static keypair.
  *
@@ -412,7 +585,8 @@ int noise_handshakestate_get_protocol_id
  * The application uses the returned object to set the static keypair for
  * the local end of the handshake if one is required.
  *
- * \sa noise_handshakestate_get_remote_public_key_dh()
+ * \sa noise_handshakestate_get_remote_public_key_dh(),
+ * noise_handshakestate_set_static_key()
  */
 NoiseDHState *noise_handshakestate_get_local_keypair_dh
     (const NoiseHandshakeState *state)
@@ -420,6 +594,103 @@ NoiseDHState *noise_handshakestate_get_local_keypair_dh
     return state ? state->dh_local_static : 0;
 }
 
+/**
+ * \brief Sets a shared static key as the local keypair for a HandshakeState.
+ *
+ * \param state The HandshakeState object.
+ * \param key The shared static key, or NULL to detach a previously
+ * set key and revert to the keypair in
+ * noise_handshakestate_get_local_keypair_dh().
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state is NULL.
+ * \return NOISE_ERROR_NOT_APPLICABLE if the handshake does not use a
+ * local static keypair, or \a key is for a different DH algorithm.
+ * \return NOISE_ERROR_INVALID_STATE if this function is called after
+ * the protocol has already started.
+ *
+ * The HandshakeState takes its own reference to \a key and reads the
+ * keypair directly from it, so no per-handshake copy of the private key
+ * is made and the public key is never recomputed.  The reference is
+ * released when the HandshakeState is freed.  While a shared key is set,
+ * any keypair stored in the object returned by
+ * noise_handshakestate_get_local_keypair_dh() is ignored.
+ *
+ * \sa noise_static_key_new(), noise_handshakestate_get_local_keypair_dh()
+ */
+int noise_handshakestate_set_static_key
+    (NoiseHandshakeState *state, NoiseStaticKey *key)
+{
+    /* Validate the parameters and state */
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (!state->dh_local_static)
+        return NOISE_ERROR_NOT_APPLICABLE;
+    if (key && noise_static_key_get_dh_id(key) != state->dh_local_static->dh_id)
+        return NOISE_ERROR_NOT_APPLICABLE;
+    if (state->action != NOISE_ACTION_NONE)
+        return NOISE_ERROR_INVALID_STATE;
+
+    /* Swap the reference, taking the new one before dropping the old */
+    if (key)
+        noise_static_key_ref(key);
+    if (state->static_key)
+        noise_static_key_unref(state->static_key);
+    state->static_key = key;
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Sets the pool of pre-generated ephemeral keypairs for a
+ * HandshakeState.
+ *
+ * \param state The HandshakeState object.
+ * \param pool The pool of pre-generated keypairs, or NULL to detach
+ * any pools that were previously set.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state is NULL.
+ * \return NOISE_ERROR_NOT_APPLICABLE if \a pool does not match the
+ * algorithm of either the local ephemeral key or the local hybrid
+ * forward secrecy key.
+ *
+ * The pool is attached to whichever of the local ephemeral and hybrid
+ * keys use the same algorithm as the pool.  Those keys are then taken
+ * from the pool when the handshake writes its "e" or "f" token, falling
+ * back to inline generation when the pool is empty.  Call this function
+ * once per algorithm to supply pools for both keys in a hybrid protocol.
+ * Fixed ephemeral keys for test vectors take precedence over the pool.
+ *
+ * The pool must outlive \a state.
+ *
+ * \sa noise_ephemeral_pool_new(), noise_dhstate_set_ephemeral_pool()
+ */
+int noise_handshakestate_set_ephemeral_pool
+    (NoiseHandshakeState *state, NoiseEphemeralPool *pool)
+{
+    int matched = 0;
+
+    /* Validate the parameters */
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    /* Detach all pools if the new pool is NULL */
+    if (!pool) {
+        noise_dhstate_set_ephemeral_pool(state->dh_local_ephemeral, 0);
+        noise_dhstate_set_ephemeral_pool(state->dh_local_hybrid, 0);
+        return NOISE_ERROR_NONE;
+    }
+
+    /* Attach the pool to the local keys that use its algorithm */
+    if (noise_dhstate_set_ephemeral_pool(state->dh_local_ephemeral, pool)
+            == NOISE_ERROR_NONE)
+        matched = 1;
+    if (noise_dhstate_set_ephemeral_pool(state->dh_local_hybrid, pool)
+            == NOISE_ERROR_NONE)
+        matched = 1;
+    return matched ? NOISE_ERROR_NONE : NOISE_ERROR_NOT_APPLICABLE;
+}
+
 /**
  * \brief Gets the DHState object that contains the remote static public key.
  *
@@ -630,7 +901,7 @@ int noise_handshakestate_set_prologue
     } else {
         noise_free(state->prologue, state->prologue_len);
         if (prologue_len) {
-            state->prologue = (uint8_t *)malloc(prologue_len);
+            state->prologue = (uint8_t *)noise_new_memory(prologue_len);
             if (!(state->prologue)) {
                 state->prologue_len = 0;
                 return NOISE_ERROR_NO_MEMORY;
@@ -666,7 +937,7 @@ int noise_handshakestate_needs_local_keypair(const NoiseHandshakeState *state)
         return 0;
     if ((state->requirements & NOISE_REQ_LOCAL_REQUIRED) == 0)
         return 0;
-    return !noise_dhstate_has_keypair(state->dh_local_static);
+    return !noise_dhstate_has_keypair(noise_handshakestate_local_static(state));
 }
 
 /**
@@ -686,7 +957,7 @@ int noise_handshakestate_has_local_keypair(const NoiseHandshakeState *state)
 {
     if (!state || !state->dh_local_static)
         return 0;
-    return noise_dhstate_has_keypair(state->dh_local_static);
+    return noise_dhstate_has_keypair(noise_handshakestate_local_static(state));
 }
 
 /**
@@ -810,7 +1081,7 @@ int noise_handshakestate_start(NoiseHandshakeState *state)
 
     /* Check that we have satisfied all of the pattern requirements */
     if ((state->requirements & NOISE_REQ_LOCAL_REQUIRED) != 0 &&
-            !noise_dhstate_has_keypair(state->dh_local_static))
+            !noise_dhstate_has_keypair(noise_handshakestate_local_static(state)))
         return NOISE_ERROR_LOCAL_KEY_REQUIRED;
     if ((state->requirements & NOISE_REQ_REMOTE_REQUIRED) != 0 &&
             !noise_dhstate_has_public_key(state->dh_remote_static))
@@ -844,7 +1115,8 @@ int noise_handshakestate_start(NoiseHandshakeState *state)
     /* Mix the pre-supplied public keys into the handshake hash */
     if (state->role == NOISE_ROLE_INITIATOR) {
         if (state->requirements & NOISE_REQ_LOCAL_PREMSG)
-            noise_handshakestate_mix_public_key(state, state->dh_local_static);
+            noise_handshakestate_mix_public_key
+                (state, noise_handshakestate_local_static(state));
         if (state->requirements & NOISE_REQ_FALLBACK_PREMSG) {
             noise_handshakestate_mix_public_key(state, state->dh_remote_ephemeral);
             if (state->dh_remote_hybrid) {
@@ -873,7 +1145,8 @@ int noise_handshakestate_start(NoiseHandshakeState *state)
             }
         }
         if (state->requirements & NOISE_REQ_LOCAL_PREMSG)
-            noise_handshakestate_mix_public_key(state, state->dh_local_static);
+            noise_handshakestate_mix_public_key
+                (state, noise_handshakestate_local_static(state));
     }
 
     /* The handshake has now officially started */
@@ -1151,6 +1424,7 @@ static int noise_handshake_mix_dh
 static int noise_handshakestate_write
     (NoiseHandshakeState *state, NoiseBuffer *message, const NoiseBuffer *payload)
 {
+    const NoiseDHState *local;
     NoiseBuffer rest;
     size_t len;
     size_t mac_len;
@@ -1219,13 +1493,14 @@ static int noise_handshakestate_write
             break;
         case NOISE_TOKEN_S:
             /* Encrypt the local static public key and add it to the message */
-            if (!state->dh_local_static)
+            local = noise_handshakestate_local_static(state);
+            if (!local)
                 return NOISE_ERROR_INVALID_STATE;
-            len = state->dh_local_static->public_key_len;
+            len = local->public_key_len;
             mac_len = noise_symmetricstate_get_mac_length(state->symmetric);
             if (rest.max_size < (len + mac_len))
                 return NOISE_ERROR_INVALID_LENGTH;
-            memcpy(rest.data, state->dh_local_static->public_key, len);
+            memcpy(rest.data, local->public_key, len);
             rest.size += len;
             err = noise_symmetricstate_encrypt_and_hash(state->symmetric, &rest);
             if (err != NOISE_ERROR_NONE)
@@ -1243,14 +1518,16 @@ static int noise_handshakestate_write
                     (state, state->dh_local_ephemeral, state->dh_remote_static);
             } else {
                 err = noise_handshake_mix_dh
-                    (state, state->dh_local_static, state->dh_remote_ephemeral);
+                    (state, noise_handshakestate_local_static(state),
+                     state->dh_remote_ephemeral);
             }
             break;
         case NOISE_TOKEN_SE:
             /* DH operation with initiator static and responder ephemeral keys */
             if (state->role == NOISE_ROLE_INITIATOR) {
                 err = noise_handshake_mix_dh
-                    (state, state->dh_local_static, state->dh_remote_ephemeral);
+                    (state, noise_handshakestate_local_static(state),
+                     state->dh_remote_ephemeral);
             } else {
                 err = noise_handshake_mix_dh
                     (state, state->dh_local_ephemeral, state->dh_remote_static);
@@ -1259,7 +1536,8 @@ static int noise_handshakestate_write
         case NOISE_TOKEN_SS:
             /* DH operation with initiator and responder static keys */
             err = noise_handshake_mix_dh
-                (state, state->dh_local_static, state->dh_remote_static);
+                (state, noise_handshakestate_local_static(state),
+                 state->dh_remote_static);
             break;
         case NOISE_TOKEN_F:
             /* Generate a local hybrid keypair and add the encrypted public
@@ -1515,14 +1793,16 @@ static int noise_handshakestate_read
                     (state, state->dh_local_ephemeral, state->dh_remote_static);
             } else {
                 err = noise_handshake_mix_dh
-                    (state, state->dh_local_static, state->dh_remote_ephemeral);
+                    (state, noise_handshakestate_local_static(state),
+                     state->dh_remote_ephemeral);
             }
             break;
         case NOISE_TOKEN_SE:
             /* DH operation with initiator static and responder ephemeral keys */
             if (state->role == NOISE_ROLE_INITIATOR) {
                 err = noise_handshake_mix_dh
-                    (state, state->dh_local_static, state->dh_remote_ephemeral);
+                    (state, noise_handshakestate_local_static(state),
+                     state->dh_remote_ephemeral);
             } else {
                 err = noise_handshake_mix_dh
                     (state, state->dh_local_ephemeral, state->dh_remote_static);
@@ -1531,7 +1811,8 @@ static int noise_handshakestate_read
         case NOISE_TOKEN_SS:
             /* DH operation with initiator and responder static keys */
             err = noise_handshake_mix_dh
-                (state, state->dh_local_static, state->dh_remote_static);
+                (state, noise_handshakestate_local_static(state),
+                 state->dh_remote_static);
             break;
         case NOISE_TOKEN_F:
             /* Decrypt and save the remote hybrid key */
@@ -1727,6 +2008,136 @@ int noise_handshakestate_split
     return err;
 }
 
+/** @cond */
+
+/**
+ * \brief Maximum number of handshakes whose transport keys are
+ * generated together by noise_handshakestate_split_batch().
+ */
+#define NOISE_SPLIT_BATCH_SIZE 8
+
+/** @endcond */
+
+/**
+ * \brief Splits the transport encryption CipherState objects out of
+ * several HandshakeState objects at once.
+ *
+ * \param states Points to an array of \a count HandshakeState objects.
+ * \param send Points to an array of \a count variables where to place
+ * the pointers to the CipherState objects to use to send packets from
+ * local to remote.  This can be NULL if the application is using a
+ * one-way handshake pattern.
+ * \param receive Points to an array of \a count variables where to place
+ * the pointers to the CipherState objects to use to receive packets from
+ * the remote to local.  This can be NULL if the application is using a
+ * one-way handshake pattern.
+ * \param count The number of HandshakeState objects to split.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a states is NULL or one of its
+ * entries is NULL.
+ * \return NOISE_ERROR_INVALID_PARAM if both \a send and \a receive are NULL.
+ * \return NOISE_ERROR_INVALID_STATE if one of the \a states has already
+ * been split or its handshake protocol has not completed successfully yet.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to create
+ * the new CipherState objects.
+ *
+ * The result is the same as calling noise_handshakestate_split() on each
+ * of the \a states in turn.  The HKDF operations that generate the
+ * transport keys are evaluated with noise_hashstate_hkdf_batch() for
+ * neighbouring handshakes that use the same hash algorithm, which is
+ * faster when a server completes many handshakes at the same time.
+ *
+ * All of the \a states are checked before any of them are split, so
+ * the parameter and state errors leave every object unchanged.  If memory
+ * runs out part-way through, then the handshakes that were split keep
+ * their new CipherState objects and the others can be split again later.
+ *
+ * \sa noise_handshakestate_split(), noise_hashstate_hkdf_batch()
+ */
+int noise_handshakestate_split_batch
+    (NoiseHandshakeState * const *states, NoiseCipherState **send,
+     NoiseCipherState **receive, size_t count)
+{
+    uint8_t keys1[NOISE_SPLIT_BATCH_SIZE][NOISE_MAX_HASHLEN];
+    uint8_t keys2[NOISE_SPLIT_BATCH_SIZE][NOISE_MAX_HASHLEN];
+    const uint8_t *ck[NOISE_SPLIT_BATCH_SIZE];
+    uint8_t *k1[NOISE_SPLIT_BATCH_SIZE];
+    uint8_t *k2[NOISE_SPLIT_BATCH_SIZE];
+    NoiseHandshakeState *state;
+    NoiseHashState *hash;
+    NoiseCipherState **c1;
+    NoiseCipherState **c2;
+    size_t first, batch, index, hash_len;
+    int err = NOISE_ERROR_NONE;
+    int result;
+
+    /* Validate the parameters */
+    if (!states)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (!send && !receive)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (index = 0; index < count; ++index) {
+        if (!states[index])
+            return NOISE_ERROR_INVALID_PARAM;
+    }
+    for (index = 0; index < count; ++index) {
+        if (states[index]->action != NOISE_ACTION_SPLIT)
+            return NOISE_ERROR_INVALID_STATE;
+        if (!states[index]->symmetric->cipher)
+            return NOISE_ERROR_INVALID_STATE;
+    }
+    for (index = 0; index < count; ++index) {
+        if (send)
+            send[index] = 0;
+        if (receive)
+            receive[index] = 0;
+    }
+    for (index = 0; index < NOISE_SPLIT_BATCH_SIZE; ++index) {
+        k1[index] = keys1[index];
+        k2[index] = keys2[index];
+    }
+
+    for (first = 0; first < count; first += batch) {
+        /* Gather the neighbouring handshakes with the same hash algorithm
+           and generate all of their transport keys together */
+        hash = states[first]->symmetric->hash;
+        hash_len = noise_hashstate_get_hash_length(hash);
+        for (batch = 0; batch < NOISE_SPLIT_BATCH_SIZE &&
+                        (first + batch) < count; ++batch) {
+            state = states[first + batch];
+            if (noise_hashstate_get_hash_id(state->symmetric->hash) !=
+                    noise_hashstate_get_hash_id(hash))
+                break;
+            ck[batch] = state->symmetric->ck;
+        }
+        noise_hashstate_hkdf_batch
+            (hash, ck, hash_len, ck, 0, k1, hash_len, k2, hash_len, batch);
+
+        /* Split the CipherState objects out, swapping them for the role */
+        for (index = 0; index < batch; ++index) {
+            state = states[first + index];
+            c1 = send ? &(send[first + index]) : 0;
+            c2 = receive ? &(receive[first + index]) : 0;
+            if (state->role == NOISE_ROLE_RESPONDER)
+                result = noise_symmetricstate_split_keys
+                    (state->symmetric, c2, c1, k1[index], k2[index]);
+            else
+                result = noise_symmetricstate_split_keys
+                    (state->symmetric, c1, c2, k1[index], k2[index]);
+            if (result == NOISE_ERROR_NONE)
+                state->action = NOISE_ACTION_COMPLETE;
+            else if (err == NOISE_ERROR_NONE)
+                err = result;
+        }
+    }
+
+    /* Clean up and exit */
+    noise_clean(keys1, sizeof(keys1));
+    noise_clean(keys2, sizeof(keys2));
+    return err;
+}
+
 /**
  * \brief Gets the handshake hash value once the handshake ends.
  *
@@ -164,7 +164,7 @@ int noise_hashstate_free(NoiseHashState *state)
         (*(state->destroy))(state);
 
     /* Clean and free the memory */
-    noise_free(state, state->size);
+    noise_free_object(state, state->size);
     return NOISE_ERROR_NONE;
 }
 
@@ -282,6 +282,76 @@ int noise_hashstate_finalize
     return NOISE_ERROR_NONE;
 }
 
+/**
+ * \brief Copies the intermediate hash state from one HashState object
+ * to another.
+ *
+ * \param state The HashState to copy into.
+ * \param from The HashState to copy from.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state or \a from is NULL.
+ * \return NOISE_ERROR_NOT_APPLICABLE if \a from does not have the same
+ * hash algorithm identifier as \a state.
+ *
+ * Afterwards, both objects continue from the same point and can be
+ * updated and finalized independently.  This can be used to hash a
+ * common prefix once and then branch off several hashes that extend it.
+ *
+ * \sa noise_hashstate_clone()
+ */
+int noise_hashstate_copy(NoiseHashState *state, const NoiseHashState *from)
+{
+    /* Validate the parameters */
+    if (!state || !from)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (state->hash_id != from->hash_id)
+        return NOISE_ERROR_NOT_APPLICABLE;
+    if (state == from)
+        return NOISE_ERROR_NONE;
+
+    /* Copy the intermediate hash state across */
+    (*(state->copy))(state, from);
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Creates a new HashState object that is a copy of another.
+ *
+ * \param clone Points to the variable where to store the pointer to
+ * the new HashState object.
+ * \param state The HashState object to clone.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a clone or \a state is NULL.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to
+ * allocate the new HashState object.
+ *
+ * The new object uses the same algorithm as \a state and continues from
+ * the data that has been hashed into \a state so far.  The caller
+ * releases it with noise_hashstate_free().
+ *
+ * \sa noise_hashstate_copy(), noise_hashstate_free()
+ */
+int noise_hashstate_clone(NoiseHashState **clone, const NoiseHashState *state)
+{
+    int err;
+
+    /* Validate the parameters */
+    if (!clone)
+        return NOISE_ERROR_INVALID_PARAM;
+    *clone = 0;
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    /* Create a new object for the same algorithm and copy the state */
+    err = noise_hashstate_new_by_id(clone, state->hash_id);
+    if (err != NOISE_ERROR_NONE)
+        return err;
+    (*(state->copy))(*clone, state);
+    return NOISE_ERROR_NONE;
+}
+
 /**
  * \brief Hashes a single data buffer and returns the hash value.
  *
@@ -366,6 +436,65 @@ int noise_hashstate_hash_two
     return NOISE_ERROR_NONE;
 }
 
+/**
+ * \brief Hashes several independent data buffers and returns the
+ * hash value for each one.
+ *
+ * \param state The HashState object.
+ * \param data Points to an array of \a count data buffers to be hashed.
+ * \param data_lens Points to an array of \a count buffer lengths in bytes.
+ * \param hashes Points to an array of \a count return buffers for the
+ * hash values.
+ * \param hash_len The length of each buffer in \a hashes in bytes.
+ * \param count The number of data buffers to hash.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if one of \a state, \a data,
+ * \a data_lens, or \a hashes is NULL, or one of the entries in
+ * \a data or \a hashes is NULL.
+ * \return NOISE_ERROR_INVALID_LENGTH if \a hash_len is not the same
+ * as the hash length for the algorithm.
+ *
+ * This is equivalent to calling noise_hashstate_hash_one() on each of
+ * the data buffers in turn.  Back ends with multi-lane hash kernels can
+ * hash several of the buffers at once, which is useful when an application
+ * is advancing many handshakes at the same time.  The lanes advance in
+ * lockstep, so the buffers should be of similar lengths.
+ *
+ * The hash values must not overlap with any of the data buffers.
+ *
+ * \sa noise_hashstate_hash_one()
+ */
+int noise_hashstate_hash_many
+    (NoiseHashState *state, const uint8_t * const *data,
+     const size_t *data_lens, uint8_t * const *hashes, size_t hash_len,
+     size_t count)
+{
+    size_t index;
+
+    /* Validate the parameters */
+    if (!state || !data || !data_lens || !hashes)
+        return NOISE_ERROR_INVALID_PARAM;
+    if (hash_len != state->hash_len)
+        return NOISE_ERROR_INVALID_LENGTH;
+    for (index = 0; index < count; ++index) {
+        if (!(data[index]) || !(hashes[index]))
+            return NOISE_ERROR_INVALID_PARAM;
+    }
+
+    /* Hash the data buffers */
+    if (state->hash_many) {
+        (*(state->hash_many))(state, data, data_lens, hashes, count);
+    } else {
+        for (index = 0; index < count; ++index) {
+            (*(state->reset))(state);
+            (*(state->update))(state, data[index], data_lens[index]);
+            (*(state->finalize))(state, hashes[index]);
+        }
+    }
+    return NOISE_ERROR_NONE;
+}
+
 /** @cond */
 #define HMAC_IPAD   0x36    /**< Padding value for the inner HMAC context */
 #define HMAC_OPAD   0x5C    /**< Padding value for the outer HMAC context */
@@ -448,6 +577,113 @@ static void noise_hashstate_hmac
     noise_clean(key_block, state->block_len);
 }
 
+/**
+ * \brief Initializes a HashState snapshot from another HashState.
+ *
+ * \param state The HashState object to take the snapshot of.
+ * \param buf Points to a buffer of at least state->size bytes to hold
+ * the snapshot.
+ *
+ * \return A pointer to the snapshot within \a buf.
+ */
+static NoiseHashState *noise_hashstate_snapshot
+    (NoiseHashState *state, void *buf)
+{
+    NoiseHashState *snapshot = (NoiseHashState *)buf;
+    memcpy(snapshot, state, sizeof(struct NoiseHashState_s));
+    (*(state->copy))(snapshot, state);
+    return snapshot;
+}
+
+/**
+ * \brief Precomputes the inner and outer HMAC contexts for a key.
+ *
+ * \param state The HashState object.
+ * \param key Points to the key.
+ * \param key_len The length of the key in bytes.
+ * \param inner Points to a buffer of at least state->size bytes to
+ * receive the inner context after absorbing the ipad key block.
+ * \param outer Points to a buffer of at least state->size bytes to
+ * receive the outer context after absorbing the opad key block.
+ *
+ * The contexts can then be passed to noise_hashstate_hmac_precomputed()
+ * any number of times to compute HMAC values with the same key, without
+ * hashing the padded key blocks again for every value.
+ *
+ * \sa noise_hashstate_hmac_precomputed()
+ */
+static void noise_hashstate_hmac_precompute
+    (NoiseHashState *state, const uint8_t *key, size_t key_len,
+     void *inner, void *outer)
+{
+    size_t hash_len = state->hash_len;
+    size_t block_len = state->block_len;
+    uint8_t *key_block;
+
+    /* Allocate temporary stack space for the key block */
+    key_block = alloca(block_len);
+
+    /* Format the key for the inner hashing context */
+    if (key_len <= block_len) {
+        memcpy(key_block, key, key_len);
+        memset(key_block + key_len, 0, block_len - key_len);
+    } else {
+        (*(state->reset))(state);
+        (*(state->update))(state, key, key_len);
+        (*(state->finalize))(state, key_block);
+        memset(key_block + hash_len, 0, block_len - hash_len);
+    }
+    noise_hashstate_xor_key(key_block, block_len, HMAC_IPAD);
+
+    /* Absorb the key block into the inner hashing context */
+    (*(state->reset))(state);
+    (*(state->update))(state, key_block, block_len);
+    noise_hashstate_snapshot(state, inner);
+
+    /* Absorb the key block into the outer hashing context */
+    noise_hashstate_xor_key(key_block, block_len, HMAC_IPAD ^ HMAC_OPAD);
+    (*(state->reset))(state);
+    (*(state->update))(state, key_block, block_len);
+    noise_hashstate_snapshot(state, outer);
+
+    /* Clean up and exit */
+    noise_clean(key_block, block_len);
+}
+
+/**
+ * \brief Computes a HMAC value from precomputed key contexts and data.
+ *
+ * \param state The HashState object.
+ * \param inner The inner context from noise_hashstate_hmac_precompute().
+ * \param outer The outer context from noise_hashstate_hmac_precompute().
+ * \param data1 Points to the first data block.
+ * \param data1_len The length of the first data block in bytes.
+ * \param data2 Points to the second data block (may be NULL).
+ * \param data2_len The length of the second data block in bytes.
+ * \param hash The final output HMAC hash value.
+ *
+ * The \a data and \a hash buffers are allowed to overlap.
+ *
+ * \sa noise_hashstate_hmac_precompute()
+ */
+static void noise_hashstate_hmac_precomputed
+    (NoiseHashState *state, const void *inner, const void *outer,
+     const uint8_t *data1, size_t data1_len,
+     const uint8_t *data2, size_t data2_len, uint8_t *hash)
+{
+    /* Calculate the inner hash */
+    (*(state->copy))(state, (const NoiseHashState *)inner);
+    (*(state->update))(state, data1, data1_len);
+    if (data2)
+        (*(state->update))(state, data2, data2_len);
+    (*(state->finalize))(state, hash);
+
+    /* Calculate the outer hash */
+    (*(state->copy))(state, (const NoiseHashState *)outer);
+    (*(state->update))(state, hash, state->hash_len);
+    (*(state->finalize))(state, hash);
+}
+
 /**
  * \brief Hashes input data with a key to generate two output values.
  *
@@ -482,6 +718,8 @@ int noise_hashstate_hkdf
     size_t hash_len;
     uint8_t *temp_key;
     uint8_t *temp_hash;
+    void *inner;
+    void *outer;
 
     /* Validate the parameters */
     if (!state || !key || !data || !output1 || !output2)
@@ -490,31 +728,370 @@ int noise_hashstate_hkdf
     if (output1_len > hash_len || output2_len > hash_len)
         return NOISE_ERROR_INVALID_LENGTH;
 
-    /* Allocate local stack space for the temporary hash values */
+    /* Allocate local stack space for the temporary hash values
+       and the precomputed HMAC contexts for the temporary key */
     temp_key = alloca(hash_len);
     temp_hash = alloca(hash_len + 1);
+    inner = alloca(state->size);
+    outer = alloca(state->size);
 
     /* Generate the temporary hashing key */
     noise_hashstate_hmac(state, key, key_len, data, data_len, 0, 0, temp_key);
 
+    /* Both outputs are keyed with the temporary key, so absorb the
+       padded key blocks once and then reuse the contexts */
+    noise_hashstate_hmac_precompute(state, temp_key, hash_len, inner, outer);
+
     /* Generate the first output */
     temp_hash[0] = 0x01;
-    noise_hashstate_hmac
-        (state, temp_key, hash_len, temp_hash, 1, 0, 0, temp_hash);
+    noise_hashstate_hmac_precomputed
+        (state, inner, outer, temp_hash, 1, 0, 0, temp_hash);
     memcpy(output1, temp_hash, output1_len);
 
     /* Generate the second output */
     temp_hash[hash_len] = 0x02;
-    noise_hashstate_hmac
-        (state, temp_key, hash_len, temp_hash, hash_len + 1, 0, 0, temp_hash);
+    noise_hashstate_hmac_precomputed
+        (state, inner, outer, temp_hash, hash_len + 1, 0, 0, temp_hash);
     memcpy(output2, temp_hash, output2_len);
 
     /* Clean up and exit */
     noise_clean(temp_key, hash_len);
     noise_clean(temp_hash, hash_len + 1);
+    noise_clean(inner, state->size);
+    noise_clean(outer, state->size);
+    return NOISE_ERROR_NONE;
+}
+
+/** @cond */
+
+/**
+ * \brief Number of HKDF operations that noise_hashstate_hkdf_batch()
+ * evaluates together, which matches the widest multi-lane hash kernel.
+ */
+#define NOISE_HKDF_BATCH_LANES      8
+
+/** @endcond */
+
+/**
+ * \brief Computes HMAC values for several keys and messages at once.
+ *
+ * \param state The HashState object, which must have a hash_many hook.
+ * \param keys Points to the keys, which must not be longer than the
+ * block length of the hash algorithm.
+ * \param key_len The length of each key in bytes.
+ * \param data Points to the data to authenticate.
+ * \param data_len The length of each data buffer in bytes.
+ * \param suffix A byte to append to each data buffer, or -1 for none.
+ * \param hashes Points to the buffers to receive the HMAC values.
+ * \param count The number of HMAC values to compute, which must not be
+ * greater than NOISE_HKDF_BATCH_LANES.
+ * \param work Work area with room for \a count messages of \a stride bytes.
+ * \param stride The distance between messages in the work area.
+ *
+ * Each message is laid out in the work area as the padded key block,
+ * followed by the data and suffix, with the last hash_len bytes of the
+ * stride holding the inner hash value.  The keys and data are consumed
+ * before any hash values are written, so they may overlap \a hashes.
+ */
+static void noise_hashstate_hmac_many
+    (NoiseHashState *state, const uint8_t * const *keys, size_t key_len,
+     const uint8_t * const *data, size_t data_len, int suffix,
+     uint8_t * const *hashes, size_t count, uint8_t *work, size_t stride)
+{
+    size_t hash_len = state->hash_len;
+    size_t block_len = state->block_len;
+    const uint8_t *messages[NOISE_HKDF_BATCH_LANES] = {0};
+    size_t lengths[NOISE_HKDF_BATCH_LANES] = {0};
+    uint8_t *inner[NOISE_HKDF_BATCH_LANES] = {0};
+    uint8_t *buf;
+    size_t index;
+
+    /* Calculate the inner hashes */
+    for (index = 0; index < count; ++index) {
+        buf = work + index * stride;
+        memcpy(buf, keys[index], key_len);
+        memset(buf + key_len, 0, block_len - key_len);
+        noise_hashstate_xor_key(buf, block_len, 0x36);
+        memcpy(buf + block_len, data[index], data_len);
+        lengths[index] = block_len + data_len;
+        if (suffix >= 0)
+            buf[lengths[index]++] = (uint8_t)suffix;
+        messages[index] = buf;
+        inner[index] = buf + stride - hash_len;
+    }
+    (*(state->hash_many))(state, messages, lengths, inner, count);
+
+    /* Calculate the outer hashes */
+    for (index = 0; index < count; ++index) {
+        buf = work + index * stride;
+        memcpy(buf, keys[index], key_len);
+        memset(buf + key_len, 0, block_len - key_len);
+        noise_hashstate_xor_key(buf, block_len, 0x5C);
+        memcpy(buf + block_len, inner[index], hash_len);
+        lengths[index] = block_len + hash_len;
+    }
+    (*(state->hash_many))(state, messages, lengths, hashes, count);
+}
+
+/**
+ * \brief Evaluates several independent HKDF operations at once.
+ *
+ * \param state The HashState object.
+ * \param keys Points to an array of \a count keys.
+ * \param key_len The length of each key in bytes.
+ * \param data Points to an array of \a count data buffers.
+ * \param data_len The length of each data buffer in bytes.
+ * \param output1 Points to an array of \a count first output buffers.
+ * \param output1_len The length of each first output buffer, which may
+ * be shorter than the hash length of the HashState object.
+ * \param output2 Points to an array of \a count second output buffers.
+ * \param output2_len The length of each second output buffer, which may
+ * be shorter than the hash length of the HashState object.
+ * \param count The number of HKDF operations to evaluate.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if one of \a state, \a keys,
+ * \a data, \a output1, or \a output2 is NULL, or one of the entries
+ * in those arrays is NULL.
+ * \return NOISE_ERROR_INVALID_LENGTH if \a output1_len or \a output2_len
+ * is greater than the hash length for the HashState object.
+ *
+ * The results are the same as calling noise_hashstate_hkdf() on each
+ * entry in turn, but the hash computations for up to eight entries are
+ * interleaved so that they can share the lanes of the multi-buffer hash
+ * implementations where the algorithm and CPU support them.  This is
+ * intended for servers that complete many handshakes at once, where the
+ * MixKey() and Split() operations are independent of each other.
+ *
+ * The output buffers for an entry may overlap its key or data.
+ *
+ * \sa noise_hashstate_hkdf(), noise_hashstate_hash_many()
+ */
+int noise_hashstate_hkdf_batch
+    (NoiseHashState *state, const uint8_t * const *keys, size_t key_len,
+     const uint8_t * const *data, size_t data_len,
+     uint8_t * const *output1, size_t output1_len,
+     uint8_t * const *output2, size_t output2_len, size_t count)
+{
+    const uint8_t *temp_keys[NOISE_HKDF_BATCH_LANES];
+    const uint8_t *temp_hashes[NOISE_HKDF_BATCH_LANES];
+    uint8_t *tk[NOISE_HKDF_BATCH_LANES];
+    uint8_t *t1[NOISE_HKDF_BATCH_LANES];
+    uint8_t *t2[NOISE_HKDF_BATCH_LANES];
+    size_t key_lens[NOISE_HKDF_BATCH_LANES];
+    size_t hash_len, block_len, stride, lanes, batch, index;
+    size_t work_size = 0;
+    uint8_t *work = 0;
+
+    /* Validate the parameters */
+    if (!state || !keys || !data || !output1 || !output2)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (index = 0; index < count; ++index) {
+        if (!keys[index] || !data[index] || !output1[index] || !output2[index])
+            return NOISE_ERROR_INVALID_PARAM;
+    }
+    hash_len = state->hash_len;
+    block_len = state->block_len;
+    if (output1_len > hash_len || output2_len > hash_len)
+        return NOISE_ERROR_INVALID_LENGTH;
+
+    /* Each message in the work area holds a padded key block, then the
+       data or a previous hash plus a counter byte, then an inner hash.
+       Keep the messages aligned as some of the portable hash code reads
+       the blocks a word at a time straight out of the input */
+    lanes = count < NOISE_HKDF_BATCH_LANES ? count : NOISE_HKDF_BATCH_LANES;
+    stride = block_len + (data_len > hash_len ? data_len : hash_len) + 1 +
+             hash_len;
+    stride = (stride + 15) & ~((size_t)15);
+    if (lanes > 1 && state->hash_many && state->hash_many_lanes &&
+            (*(state->hash_many_lanes))(state) > 1) {
+        work_size = lanes * (stride + hash_len * 3);
+        work = (uint8_t *)noise_new_secure_memory(work_size);
+    }
+
+    /* If the hash is computed one buffer at a time on this CPU, then
+       there is nothing to share and the serial version is faster as it
+       can reuse its precomputed HMAC contexts */
+    if (!work) {
+        for (index = 0; index < count; ++index) {
+            noise_hashstate_hkdf
+                (state, keys[index], key_len, data[index], data_len,
+                 output1[index], output1_len, output2[index], output2_len);
+        }
+        return NOISE_ERROR_NONE;
+    }
+    for (index = 0; index < lanes; ++index) {
+        tk[index] = work + lanes * stride + index * hash_len * 3;
+        t1[index] = tk[index] + hash_len;
+        t2[index] = t1[index] + hash_len;
+        temp_keys[index] = tk[index];
+        temp_hashes[index] = t1[index];
+        key_lens[index] = key_len;
+    }
+
+    while (count > 0) {
+        batch = count < lanes ? count : lanes;
+
+        /* Generate the temporary hashing keys, hashing the original keys
+           down to size first if they are longer than a block */
+        if (key_len > block_len) {
+            (*(state->hash_many))(state, keys, key_lens, tk, batch);
+            noise_hashstate_hmac_many
+                (state, temp_keys, hash_len, data, data_len, -1,
+                 tk, batch, work, stride);
+        } else {
+            noise_hashstate_hmac_many
+                (state, keys, key_len, data, data_len, -1,
+                 tk, batch, work, stride);
+        }
+
+        /* Generate the two outputs */
+        noise_hashstate_hmac_many
+            (state, temp_keys, hash_len, temp_keys, 0, 0x01,
+             t1, batch, work, stride);
+        noise_hashstate_hmac_many
+            (state, temp_keys, hash_len, temp_hashes, hash_len, 0x02,
+             t2, batch, work, stride);
+        for (index = 0; index < batch; ++index) {
+            memcpy(output1[index], t1[index], output1_len);
+            memcpy(output2[index], t2[index], output2_len);
+        }
+
+        keys += batch;
+        data += batch;
+        output1 += batch;
+        output2 += batch;
+        count -= batch;
+    }
+
+    /* Clean up and exit */
+    noise_free(work, work_size);
     return NOISE_ERROR_NONE;
 }
 
+/** @cond */
+
+/**
+ * \brief Maximum number of helper threads to use for PBKDF2.
+ */
+#define NOISE_PBKDF2_MAX_THREADS    4
+
+/**
+ * \brief Minimum number of PBKDF2 iterations before helper threads
+ * are used to generate output blocks in parallel.
+ */
+#define NOISE_PBKDF2_MIN_ITERATIONS 1024
+
+/**
+ * \brief Work item for generating a subset of the PBKDF2 output blocks.
+ */
+typedef struct
+{
+    /** \brief HashState to use for the computation */
+    NoiseHashState *state;
+
+    /** \brief Precomputed inner HMAC context for the passphrase */
+    const void *inner;
+
+    /** \brief Precomputed outer HMAC context for the passphrase */
+    const void *outer;
+
+    /** \brief Points to the salt */
+    const uint8_t *salt;
+
+    /** \brief Length of the salt in bytes */
+    size_t salt_len;
+
+    /** \brief Number of hash iterations */
+    size_t iterations;
+
+    /** \brief Number of the first block to generate, starting at 1 */
+    size_t first;
+
+    /** \brief Distance between the blocks that this job generates */
+    size_t stride;
+
+    /** \brief Points to the full output buffer */
+    uint8_t *output;
+
+    /** \brief Length of the full output buffer in bytes */
+    size_t output_len;
+
+#if HAVE_PTHREAD
+    /** \brief Thread that is generating the blocks for this job */
+    pthread_t thread;
+
+    /** \brief Non-zero if the thread was started successfully */
+    int started;
+#endif
+
+} NoisePBKDF2Job;
+
+/** @endcond */
+
+/**
+ * \brief Generates the PBKDF2 output blocks for a job.
+ *
+ * \param job The job to run.
+ */
+static void noise_hashstate_pbkdf2_run(NoisePBKDF2Job *job)
+{
+    NoiseHashState *state = job->state;
+    size_t hash_len = state->hash_len;
+    uint8_t T[NOISE_MAX_HASHLEN];
+    uint8_t U[NOISE_MAX_HASHLEN];
+    uint8_t ibuf[4];
+    size_t blocks = (job->output_len + hash_len - 1) / hash_len;
+    size_t i, index, index2;
+    size_t posn, len;
+
+    for (i = job->first; i <= blocks; i += job->stride) {
+        /* Generate the next block of output */
+        ibuf[0] = (uint8_t)(i >> 24);
+        ibuf[1] = (uint8_t)(i >> 16);
+        ibuf[2] = (uint8_t)(i >> 8);
+        ibuf[3] = (uint8_t)i;
+        noise_hashstate_hmac_precomputed
+            (state, job->inner, job->outer, job->salt, job->salt_len,
+             ibuf, sizeof(ibuf), T);
+        memcpy(U, T, hash_len);
+        for (index = 1; index < job->iterations; ++index) {
+            noise_hashstate_hmac_precomputed
+                (state, job->inner, job->outer, U, hash_len, 0, 0, U);
+            for (index2 = 0; index2 < hash_len; ++index2)
+                T[index2] ^= U[index2];
+        }
+
+        /* Copy the generated data into its place in the output buffer */
+        posn = (i - 1) * hash_len;
+        len = job->output_len - posn;
+        if (len > hash_len)
+            len = hash_len;
+        memcpy(job->output + posn, T, len);
+    }
+
+    /* Clean up and exit */
+    noise_clean(T, sizeof(T));
+    noise_clean(U, sizeof(U));
+}
+
+#if HAVE_PTHREAD
+
+/**
+ * \brief Thread entry point for generating PBKDF2 output blocks.
+ *
+ * \param arg Points to the NoisePBKDF2Job to run.
+ *
+ * \return Always NULL.
+ */
+static void *noise_hashstate_pbkdf2_thread(void *arg)
+{
+    noise_hashstate_pbkdf2_run((NoisePBKDF2Job *)arg);
+    return 0;
+}
+
+#endif
+
 /**
  * \brief Hashes a passphrase and salt using the PBKDF2 key derivation function.
  *
@@ -536,6 +1113,11 @@ int noise_hashstate_hkdf
  * This function is intended as a utility for applications that need to hash a
  * passphrase to encrypt private keys and other sensitive information.
  *
+ * The HMAC contexts for the passphrase are computed once and reused for
+ * every iteration.  If the output spans several hash blocks and the
+ * iteration count is large, the blocks are generated in parallel on
+ * helper threads where POSIX threads are available.
+ *
  * Reference: <a href="https://www.ietf.org/rfc/rfc2898.txt">RFC 2898</a>
  */
 int noise_hashstate_pbkdf2
@@ -545,10 +1127,15 @@ int noise_hashstate_pbkdf2
 {
     size_t hash_len;
     uint64_t max_size;
-    uint8_t T[NOISE_MAX_HASHLEN];
-    uint8_t U[NOISE_MAX_HASHLEN];
-    uint8_t ibuf[4];
-    size_t i, index, index2;
+    void *inner;
+    void *outer;
+    NoisePBKDF2Job job;
+    size_t threads = 0;
+#if HAVE_PTHREAD
+    NoisePBKDF2Job *helpers = 0;
+    size_t helpers_size = 0;
+    size_t blocks, index;
+#endif
 
     /* Validate the parameters */
     if (!state || !passphrase || !salt || !output)
@@ -558,40 +1145,69 @@ int noise_hashstate_pbkdf2
     if (output_len > max_size)
         return NOISE_ERROR_INVALID_LENGTH;
 
-    /* Generate the required output blocks */
-    i = 1;
-    while (output_len > 0) {
-        /* Generate the next block of output */
-        ibuf[0] = (uint8_t)(i >> 24);
-        ibuf[1] = (uint8_t)(i >> 16);
-        ibuf[2] = (uint8_t)(i >> 8);
-        ibuf[3] = (uint8_t)i;
-        ++i;
-        noise_hashstate_hmac
-            (state, passphrase, passphrase_len, salt, salt_len,
-             ibuf, sizeof(ibuf), T);
-        memcpy(U, T, hash_len);
-        for (index = 1; index < iterations; ++index) {
-            noise_hashstate_hmac
-                (state, passphrase, passphrase_len, U, hash_len, 0, 0, U);
-            for (index2 = 0; index2 < hash_len; ++index2)
-                T[index2] ^= U[index2];
-        }
+    /* Every HMAC below is keyed with the passphrase, so absorb the
+       padded passphrase blocks once up front */
+    inner = alloca(state->size);
+    outer = alloca(state->size);
+    noise_hashstate_hmac_precompute
+        (state, passphrase, passphrase_len, inner, outer);
 
-        /* Copy the generated data into the output buffer */
-        if (output_len >= hash_len) {
-            memcpy(output, T, hash_len);
-            output += hash_len;
-            output_len -= hash_len;
-        } else {
-            memcpy(output, T, output_len);
-            output_len = 0;
-        }
+    /* Output blocks are independent of each other, so hand all but the
+       first to helper threads if there is enough work to justify it */
+#if HAVE_PTHREAD
+    blocks = (output_len + hash_len - 1) / hash_len;
+    if (blocks > 1 && iterations >= NOISE_PBKDF2_MIN_ITERATIONS) {
+        threads = blocks - 1;
+        if (threads > NOISE_PBKDF2_MAX_THREADS)
+            threads = NOISE_PBKDF2_MAX_THREADS;
+        helpers_size = threads * (sizeof(NoisePBKDF2Job) + state->size);
+        helpers = (NoisePBKDF2Job *)noise_new_secure_memory(helpers_size);
+        if (!helpers)
+            threads = 0;
+    }
+#endif
+
+    /* The calling thread generates blocks 1, threads + 2, ... and each
+       helper thread starts at the next block with the same stride */
+    job.state = state;
+    job.inner = inner;
+    job.outer = outer;
+    job.salt = salt;
+    job.salt_len = salt_len;
+    job.iterations = iterations;
+    job.first = 1;
+    job.stride = threads + 1;
+    job.output = output;
+    job.output_len = output_len;
+#if HAVE_PTHREAD
+    for (index = 0; index < threads; ++index) {
+        uint8_t *work = ((uint8_t *)(helpers + threads)) + index * state->size;
+        helpers[index] = job;
+        helpers[index].state = noise_hashstate_snapshot(state, work);
+        helpers[index].first = index + 2;
+        helpers[index].started =
+            (pthread_create(&(helpers[index].thread), 0,
+                            noise_hashstate_pbkdf2_thread,
+                            &(helpers[index])) == 0);
+    }
+#endif
+    noise_hashstate_pbkdf2_run(&job);
+#if HAVE_PTHREAD
+    for (index = 0; index < threads; ++index) {
+        /* Fall back to generating the blocks here if the thread
+           could not be started */
+        if (helpers[index].started)
+            pthread_join(helpers[index].thread, 0);
+        else
+            noise_hashstate_pbkdf2_run(&(helpers[index]));
     }
+    if (helpers)
+        noise_free(helpers, helpers_size);
+#endif
 
     /* Clean up and exit */
-    noise_clean(T, sizeof(T));
-    noise_clean(U, sizeof(U));
+    noise_clean(inner, state->size);
+    noise_clean(outer, state->size);
     return NOISE_ERROR_NONE;
 }
 
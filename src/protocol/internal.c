@@ -23,14 +23,10 @@
 
 #include "internal.h"
 
-#if USE_SODIUM
-NoiseCipherState *noise_aesgcm_new_sodium(void);
-#endif
 #if USE_OPENSSL
 NoiseCipherState *noise_aesgcm_new_openssl(void);
-#else
-NoiseCipherState *noise_aesgcm_new_ref(void);
 #endif
+NoiseCipherState *noise_aesgcm_new_ref(void);
 
 /**
  * \brief Creates a new AES-GCM CipherState object.
@@ -40,17 +36,12 @@ NoiseCipherState *noise_aesgcm_new_ref(void);
 NoiseCipherState *noise_aesgcm_new(void)
 {
     NoiseCipherState *state = 0;
-#if USE_SODIUM
-    if (crypto_aead_aes256gcm_is_available())
-        state = noise_aesgcm_new_sodium();
-#endif
 #if USE_OPENSSL
     if (!state)
         state = noise_aesgcm_new_openssl();
-#else
+#endif
     if (!state)
         state = noise_aesgcm_new_ref();
-#endif
 
     return state;
 }
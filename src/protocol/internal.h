@@ -29,6 +29,9 @@
 #else
 #include <alloca.h>
 #endif
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +55,70 @@ extern "C" {
  */
 #define NOISE_PSK_LEN 32
 
+/*
+ * Atomic operations for objects that are shared between threads.
+ * Without compiler support they fall back to plain operations and
+ * the shared objects must then be confined to a single thread.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)) || defined(__clang__)
+#define noise_atomic_inc(ptr) __atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED)
+#define noise_atomic_dec(ptr) __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#define noise_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define noise_atomic_store(ptr, value) \
+    __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define noise_atomic_cas(ptr, expected, desired) \
+    __atomic_compare_exchange_n((ptr), (expected), (desired), 0, \
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+#define noise_atomic_inc(ptr) (++(*(ptr)))
+#define noise_atomic_dec(ptr) (--(*(ptr)))
+#define noise_atomic_load(ptr) (*(ptr))
+#define noise_atomic_store(ptr, value) (*(ptr) = (value))
+#define noise_atomic_cas(ptr, expected, desired) \
+    (*(ptr) == *(expected) ? (*(ptr) = (desired), 1) \
+                           : (*(expected) = *(ptr), 0))
+#endif
+
+/*
+ * Thread-local storage class, if the compiler has one.  Features that
+ * need per-thread state are disabled when this is not defined.
+ */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+        !defined(__STDC_NO_THREADS__)
+#define NOISE_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) || defined(__clang__)
+#define NOISE_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define NOISE_THREAD_LOCAL __declspec(thread)
+#endif
+
+/**
+ * \brief Alignment of objects that are allocated from an arena.
+ */
+#define NOISE_ARENA_ALIGN 16
+
+/**
+ * \brief Caller-supplied region of memory that objects are carved from.
+ *
+ * While an arena is installed with noise_arena_set(), noise_new_object()
+ * allocates from it instead of the heap and noise_free() cleans objects
+ * that lie inside it without returning them to the heap.  An arena with
+ * a NULL \a base measures the space that would have been used while
+ * still allocating from the heap.
+ */
+typedef struct
+{
+    /** \brief Start of the arena memory, or NULL when measuring */
+    uint8_t *base;
+
+    /** \brief Total size of the arena memory in bytes */
+    size_t size;
+
+    /** \brief Number of bytes that have been used so far */
+    size_t posn;
+
+} NoiseArena;
+
 /**
  * \brief Internal structure of the NoiseCipherState type.
  */
@@ -130,6 +197,50 @@ struct NoiseCipherState_s
     int (*decrypt)(NoiseCipherState *state, const uint8_t *ad, size_t ad_len,
                    uint8_t *data, size_t len);
 
+    /**
+     * \brief Encrypts a batch of packets with consecutive nonces.
+     *
+     * \param state Points to the CipherState.
+     * \param buffers Points to the packet buffers, each containing the
+     * plaintext on entry and the ciphertext plus MAC on exit.
+     * \param count The number of packets in \a buffers.
+     *
+     * \return NOISE_ERROR_NONE on success.
+     *
+     * The packet at index i is encrypted with the nonce \ref n + i and no
+     * associated data.  The caller has already checked that every buffer
+     * has room for the MAC and that the nonce range will not overflow.
+     * The buffer sizes and the nonce are adjusted by the caller.
+     *
+     * This pointer can be NULL if the back end does not support batching,
+     * in which case the packets are passed to encrypt() one at a time.
+     */
+    int (*encrypt_batch)(NoiseCipherState *state, NoiseBuffer *buffers,
+                         size_t count);
+
+    /**
+     * \brief Decrypts a batch of packets with consecutive nonces.
+     *
+     * \param state Points to the CipherState.
+     * \param buffers Points to the packet buffers, each containing the
+     * ciphertext plus MAC on entry and the plaintext plus the old MAC
+     * on exit.
+     * \param count The number of packets in \a buffers.
+     *
+     * \return The number of leading packets that were authenticated and
+     * decrypted.  Processing stops at the first packet whose MAC check
+     * fails, which is left as-is along with all packets after it.
+     *
+     * The packet at index i is decrypted with the nonce \ref n + i and no
+     * associated data.  The buffer sizes and the nonce are adjusted by
+     * the caller.
+     *
+     * This pointer can be NULL if the back end does not support batching,
+     * in which case the packets are passed to decrypt() one at a time.
+     */
+    size_t (*decrypt_batch)(NoiseCipherState *state, NoiseBuffer *buffers,
+                            size_t count);
+
     /**
      * \brief Destroys this CipherState prior to the memory being freed.
      *
@@ -187,6 +298,53 @@ struct NoiseHashState_s
      */
     void (*finalize)(NoiseHashState *state, uint8_t *hash);
 
+    /**
+     * \brief Copies the hashing context from another HashState.
+     *
+     * \param state Points to the HashState to copy into.
+     * \param from Points to the HashState to copy from, which must be
+     * for the same algorithm as \a state.
+     *
+     * After the copy, \a state continues from the same point in the
+     * hashing session as \a from, which is left unmodified.
+     */
+    void (*copy)(NoiseHashState *state, const NoiseHashState *from);
+
+    /**
+     * \brief Hashes several independent data buffers.
+     *
+     * \param state Points to the HashState.
+     * \param data Points to the data buffers to be hashed.
+     * \param data_lens Points to the lengths of the data buffers.
+     * \param hashes Points to the buffers to receive the hash values,
+     * each of which is \ref hash_len bytes in length.
+     * \param count The number of data buffers.
+     *
+     * The hashing context in \a state may be modified.
+     *
+     * This pointer can be NULL if the back end does not support hashing
+     * several buffers at once, in which case the buffers are hashed with
+     * reset(), update(), and finalize() one at a time.
+     */
+    void (*hash_many)(NoiseHashState *state, const uint8_t * const *data,
+                      const size_t *data_lens, uint8_t * const *hashes,
+                      size_t count);
+
+    /**
+     * \brief Gets the number of buffers that hash_many() hashes in
+     * parallel with the current CPU features.
+     *
+     * \param state Points to the HashState.
+     *
+     * \return The number of lanes, or 1 if hash_many() hashes the
+     * buffers one at a time.
+     *
+     * Callers use this to decide whether it is worth rearranging their
+     * work around hash_many().  This pointer can be NULL if hash_many()
+     * is also NULL.
+     */
+    size_t (*hash_many_lanes)(const NoiseHashState *state);
+
     /**
      * \brief Destroys this HashState prior to the memory being freed.
      *
@@ -245,6 +403,9 @@ struct NoiseDHState_s
     /** \brief Points to the public key in the subclass state */
     uint8_t *public_key;
 
+    /** \brief Optional pool of pre-generated ephemeral keypairs */
+    NoiseEphemeralPool *ephemeral_pool;
+
     /**
      * \brief Generates a new key pair for this Diffie-Hellman algorithm.
      *
@@ -356,6 +517,139 @@ struct NoiseDHState_s
     void (*destroy)(NoiseDHState *state);
 };
 
+/**
+ * \brief Slot in the ring buffer of a NoiseEphemeralPool.
+ */
+typedef struct
+{
+    /** \brief Sequence number that tracks the ownership of the slot */
+    size_t sequence;
+
+    /** \brief DHState holding the keypair while the slot is full */
+    NoiseDHState *dh;
+
+} NoiseEphemeralSlot;
+
+/**
+ * \brief Internal structure of the NoiseEphemeralPool type.
+ *
+ * The pool is a bounded multi-producer, multi-consumer ring buffer.
+ * Each slot carries a sequence number; producers and consumers claim
+ * positions with a compare-and-swap on the enqueue or dequeue position
+ * and then hand the slot over by publishing a new sequence number.
+ */
+struct NoiseEphemeralPool_s
+{
+    /** \brief Total size of the structure */
+    size_t size;
+
+    /** \brief Algorithm identifier for the keypairs in the pool */
+    int dh_id;
+
+    /** \brief Number of slots in the ring, which is a power of two */
+    size_t capacity;
+
+    /** \brief Next position to be filled by a producer */
+    size_t enqueue_pos;
+
+    /** \brief Next position to be taken by a consumer */
+    size_t dequeue_pos;
+
+    /** \brief Points to the slots in the ring */
+    NoiseEphemeralSlot *slots;
+};
+
+/**
+ * \brief Number of entries in each set of a NoiseVerifyCache.
+ */
+#define NOISE_VERIFY_CACHE_WAYS 8
+
+/**
+ * \brief Length of the keys in a NoiseVerifyCache.
+ */
+#define NOISE_VERIFY_CACHE_KEY_LEN 32
+
+/**
+ * \brief Entry in a NoiseVerifyCache.
+ */
+typedef struct
+{
+    /** \brief Truncated BLAKE2b digest of the verified signature */
+    uint8_t key[NOISE_VERIFY_CACHE_KEY_LEN];
+
+    /** \brief Valid and referenced flags for the entry */
+    uint8_t flags;
+
+} NoiseVerifyCacheEntry;
+
+/**
+ * \brief Internal structure of the NoiseVerifyCache type.
+ *
+ * The entries are divided into sets of NOISE_VERIFY_CACHE_WAYS, with the
+ * set for a key chosen by the leading bytes of the key.  Each set has its
+ * own CLOCK hand for choosing the entry to evict.
+ */
+struct NoiseVerifyCache_s
+{
+    /** \brief Total size of the structure */
+    size_t size;
+
+    /** \brief Number of entries, which is a power of two */
+    size_t capacity;
+
+    /** \brief Number of valid entries */
+    size_t count;
+
+    /** \brief Number of lookups that found the key */
+    uint64_t hits;
+
+    /** \brief Number of lookups that did not find the key */
+    uint64_t misses;
+
+    /** \brief Points to the entries */
+    NoiseVerifyCacheEntry *entries;
+
+    /** \brief Points to the CLOCK hand for each set */
+    uint8_t *hands;
+
+    /** \brief BLAKE2b HashState for computing cache keys */
+    NoiseHashState *hash;
+
+#if HAVE_PTHREAD
+    /** \brief Lock that protects the entries and counters */
+    pthread_mutex_t mutex;
+#endif
+};
+
+#if HAVE_PTHREAD
+#define noise_verify_cache_lock(cache) pthread_mutex_lock(&((cache)->mutex))
+#define noise_verify_cache_unlock(cache) \
+    pthread_mutex_unlock(&((cache)->mutex))
+#else
+#define noise_verify_cache_lock(cache) do { ; } while (0)
+#define noise_verify_cache_unlock(cache) do { ; } while (0)
+#endif
+
+/**
+ * \brief Internal structure of the NoiseStaticKey type.
+ */
+struct NoiseStaticKey_s
+{
+    /** \brief Total size of the structure */
+    size_t size;
+
+    /** \brief Number of outstanding references to this static key */
+    long refs;
+
+    /**
+     * \brief Points to the DHState that holds the validated keypair.
+     *
+     * The DHState is never modified once the static key has been created,
+     * which allows it to be shared between threads without locking.
+     */
+    NoiseDHState *dh;
+};
+
 /**
  * \brief Internal structure of the NoiseSignState type.
  */
@@ -385,6 +679,9 @@ struct NoiseSignState_s
     /** \brief Points to the public key in the subclass state */
     uint8_t *public_key;
 
+    /** \brief Cache of verified signatures to consult, or NULL */
+    NoiseVerifyCache *verify_cache;
+
     /**
      * \brief Generates a new key pair for this digital signature algorithm.
      *
@@ -479,6 +776,30 @@ struct NoiseSignState_s
         (const NoiseSignState *state, const uint8_t *message,
          size_t message_len, const uint8_t *signature);
 
+    /**
+     * \brief Verifies a batch of digital signatures.
+     *
+     * \param state Points to the SignState.
+     * \param public_keys Points to the public keys to verify with.
+     * \param messages Points to the messages whose signatures should
+     * be verified.
+     * \param message_lens Points to the lengths of the \a messages.
+     * \param signatures Points to the signatures to be verified.
+     * \param count The number of signatures to be verified.
+     * \param results Points to an array of \a count entries that are
+     * set to NOISE_ERROR_NONE or NOISE_ERROR_INVALID_SIGNATURE on exit.
+     *
+     * \return NOISE_ERROR_NONE if all signatures are valid.
+     * \return NOISE_ERROR_INVALID_SIGNATURE if one or more of the
+     * signatures are invalid.
+     *
+     * The public key within \a state is not used.
+     */
+    int (*verify_batch)
+        (const NoiseSignState *state, const uint8_t * const *public_keys,
+         const uint8_t * const *messages, const size_t *message_lens,
+         const uint8_t * const *signatures, size_t count, int *results);
+
     /**
      * \brief Destroys this SignState prior to the memory being freed.
      *
@@ -523,6 +844,14 @@ struct NoiseSymmetricState_s
 
     /** \brief Current value of the handshake hash */
     uint8_t h[NOISE_MAX_HASHLEN];
+
+    /**
+     * \brief Points to the arena that the CipherState lives in, or NULL
+     * if it was allocated from the heap.
+     *
+     * \sa noise_handshakestate_new_in_arena()
+     */
+    NoiseArena *arena;
 };
 
 /**
@@ -551,6 +880,9 @@ struct NoiseHandshakeState_s
     /** \brief Points to the DHState object for local static key */
     NoiseDHState *dh_local_static;
 
+    /** \brief Points to the shared static key that overrides dh_local_static */
+    NoiseStaticKey *static_key;
+
     /** \brief Points to the DHState object for local ephemeral key */
     NoiseDHState *dh_local_ephemeral;
 
@@ -583,6 +915,9 @@ struct NoiseHandshakeState_s
 
     /** \brief Length of the prologue value in bytes */
     size_t prologue_len;
+
+    /** \brief Arena that holds this object and its sub-objects, if any */
+    NoiseArena arena;
 };
 
 /* Handshake message pattern tokens (must be single-byte values) */
@@ -650,6 +985,8 @@ struct NoiseHandshakeState_s
 
 void noise_rand_bytes(void *bytes, size_t size);
 
+NoiseArena *noise_arena_set(NoiseArena *arena);
+
 /** @cond */
 
 NoiseCipherState *noise_chachapoly_new(void);
@@ -666,6 +1003,19 @@ NoiseDHState *noise_newhope_new(void);
 
 NoiseSignState *noise_ed25519_new(void);
 
+int noise_ephemeral_pool_pop(NoiseEphemeralPool *pool, NoiseDHState *state);
+
+int noise_symmetricstate_split_keys
+    (NoiseSymmetricState *state, NoiseCipherState **c1, NoiseCipherState **c2,
+     const uint8_t *k1, const uint8_t *k2);
+
+void noise_verify_cache_key
+    (NoiseVerifyCache *cache, const NoiseSignState *state,
+     const uint8_t *public_key, const uint8_t *message, size_t message_len,
+     const uint8_t *signature, uint8_t *key);
+int noise_verify_cache_lookup(NoiseVerifyCache *cache, const uint8_t *key);
+void noise_verify_cache_insert(NoiseVerifyCache *cache, const uint8_t *key);
+
 typedef uint16_t NoisePatternFlags_t;
 
 /** @endcond */
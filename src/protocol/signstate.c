@@ -577,12 +577,19 @@ int noise_signstate_sign
  * \return NOISE_ERROR_INVALID_SIGNATURE if the \a signature is not
  * valid for the \a message using this public key.
  *
- * \sa noise_signstate_set_public_key(), noise_signstate_sign()
+ * If a cache has been set with noise_signstate_set_verify_cache(), then
+ * signatures that have already been verified are accepted from the cache.
+ *
+ * \sa noise_signstate_set_public_key(), noise_signstate_sign(),
+ * noise_signstate_set_verify_cache()
  */
 int noise_signstate_verify
     (const NoiseSignState *state, const uint8_t *message, size_t message_len,
      const uint8_t *signature, size_t signature_len)
 {
+    uint8_t key[NOISE_VERIFY_CACHE_KEY_LEN];
+    int err;
+
     /* Validate the parameters */
     if (!state || !message || !signature)
         return NOISE_ERROR_INVALID_PARAM;
@@ -591,10 +598,219 @@ int noise_signstate_verify
     if (state->key_type == NOISE_KEY_TYPE_NO_KEY)
         return NOISE_ERROR_INVALID_PUBLIC_KEY;
 
+    /* Consult the cache of verified signatures if there is one */
+    if (state->verify_cache) {
+        noise_verify_cache_key
+            (state->verify_cache, state, state->public_key,
+             message, message_len, signature, key);
+        if (noise_verify_cache_lookup(state->verify_cache, key))
+            return NOISE_ERROR_NONE;
+        err = (*(state->verify))(state, message, message_len, signature);
+        if (err == NOISE_ERROR_NONE)
+            noise_verify_cache_insert(state->verify_cache, key);
+        return err;
+    }
+
     /* Verify the digial signature */
     return (*(state->verify))(state, message, message_len, signature);
 }
 
+/**
+ * \brief Verifies a batch of digital signatures using a cache.
+ *
+ * \param state The SignState object, which has a cache set.
+ * \param public_keys Points to the public keys.
+ * \param messages Points to the messages.
+ * \param message_lens Points to the message lengths.
+ * \param signatures Points to the signatures.
+ * \param count The number of signatures to verify, which is non-zero.
+ * \param results Points to the array of results.
+ *
+ * \return NOISE_ERROR_NONE if all of the signatures are valid.
+ * \return NOISE_ERROR_INVALID_SIGNATURE if one or more of the signatures
+ * are not valid.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to
+ * consult the cache, in which case the caller verifies without it.
+ */
+static int noise_signstate_verify_batch_cached
+    (const NoiseSignState *state, const uint8_t * const *public_keys,
+     const uint8_t * const *messages, const size_t *message_lens,
+     const uint8_t * const *signatures, size_t count, int *results)
+{
+    uint8_t *keys;
+    const uint8_t **miss_public_keys;
+    const uint8_t **miss_messages;
+    size_t *miss_message_lens;
+    const uint8_t **miss_signatures;
+    int *miss_results;
+    size_t *miss_indexes;
+    size_t misses = 0;
+    size_t index;
+    int err = NOISE_ERROR_NONE;
+
+    /* Allocate space to hold the cache keys and the cache misses */
+    keys = (uint8_t *)noise_new_memory(count * NOISE_VERIFY_CACHE_KEY_LEN);
+    miss_public_keys = (const uint8_t **)noise_new_memory(count * sizeof(uint8_t *));
+    miss_messages = (const uint8_t **)noise_new_memory(count * sizeof(uint8_t *));
+    miss_message_lens = (size_t *)noise_new_memory(count * sizeof(size_t));
+    miss_signatures = (const uint8_t **)noise_new_memory(count * sizeof(uint8_t *));
+    miss_results = (int *)noise_new_memory(count * sizeof(int));
+    miss_indexes = (size_t *)noise_new_memory(count * sizeof(size_t));
+    if (!keys || !miss_public_keys || !miss_messages || !miss_message_lens ||
+            !miss_signatures || !miss_results || !miss_indexes) {
+        err = NOISE_ERROR_NO_MEMORY;
+        goto cleanup;
+    }
+
+    /* Look up each signature and collect the ones that are not cached */
+    for (index = 0; index < count; ++index) {
+        uint8_t *key = keys + index * NOISE_VERIFY_CACHE_KEY_LEN;
+        noise_verify_cache_key
+            (state->verify_cache, state, public_keys[index], messages[index],
+             message_lens[index], signatures[index], key);
+        if (noise_verify_cache_lookup(state->verify_cache, key)) {
+            results[index] = NOISE_ERROR_NONE;
+            continue;
+        }
+        miss_public_keys[misses] = public_keys[index];
+        miss_messages[misses] = messages[index];
+        miss_message_lens[misses] = message_lens[index];
+        miss_signatures[misses] = signatures[index];
+        miss_indexes[misses] = index;
+        ++misses;
+    }
+
+    /* Verify the cache misses and add the valid ones to the cache */
+    if (misses > 0) {
+        err = (*(state->verify_batch))
+            (state, miss_public_keys, miss_messages, miss_message_lens,
+             miss_signatures, misses, miss_results);
+        for (index = 0; index < misses; ++index) {
+            results[miss_indexes[index]] = miss_results[index];
+            if (miss_results[index] == NOISE_ERROR_NONE) {
+                noise_verify_cache_insert
+                    (state->verify_cache,
+                     keys + miss_indexes[index] * NOISE_VERIFY_CACHE_KEY_LEN);
+            }
+        }
+    }
+
+cleanup:
+    noise_free(keys, count * NOISE_VERIFY_CACHE_KEY_LEN);
+    noise_free((void *)miss_public_keys, count * sizeof(uint8_t *));
+    noise_free((void *)miss_messages, count * sizeof(uint8_t *));
+    noise_free(miss_message_lens, count * sizeof(size_t));
+    noise_free((void *)miss_signatures, count * sizeof(uint8_t *));
+    noise_free(miss_results, count * sizeof(int));
+    noise_free(miss_indexes, count * sizeof(size_t));
+    return err;
+}
+
+/**
+ * \brief Verifies a batch of digital signatures.
+ *
+ * \param state The SignState object that selects the algorithm.
+ * \param public_keys Points to an array of \a count public keys,
+ * each of which must be noise_signstate_get_public_key_length() bytes.
+ * \param messages Points to an array of \a count messages whose
+ * signatures should be verified.
+ * \param message_lens Points to an array of \a count message lengths.
+ * \param signatures Points to an array of \a count signatures,
+ * each of which must be noise_signstate_get_signature_length() bytes.
+ * \param count The number of signatures to verify.
+ * \param results Points to an array of \a count entries that are set to
+ * NOISE_ERROR_NONE or NOISE_ERROR_INVALID_SIGNATURE for each signature.
+ *
+ * \return NOISE_ERROR_NONE if all of the signatures are valid.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state, \a public_keys,
+ * \a messages, \a message_lens, \a signatures, \a results, or any
+ * of the array entries are NULL.  An entry in \a messages may be NULL
+ * if the corresponding entry in \a message_lens is zero.
+ * \return NOISE_ERROR_INVALID_SIGNATURE if one or more of the signatures
+ * are not valid, in which case \a results indicates which ones.
+ * \return NOISE_ERROR_NOT_APPLICABLE if the algorithm does not support
+ * batch verification.
+ *
+ * The public key within \a state is not used; each signature is verified
+ * against the corresponding entry in \a public_keys.  This makes it
+ * possible to check many signatures by different signers at once,
+ * such as the signatures on a set of certificates.
+ *
+ * For Ed25519, groups of up to 64 signatures are checked together with a
+ * single multi-scalar multiplication, which is considerably faster than
+ * verifying them one at a time.  If a group fails the combined check,
+ * then each signature in that group is verified on its own to determine
+ * which ones are invalid.
+ *
+ * If a cache has been set with noise_signstate_set_verify_cache(), then
+ * only the signatures that are not already in the cache are verified.
+ *
+ * \sa noise_signstate_verify(), noise_signstate_set_verify_cache()
+ */
+int noise_signstate_verify_batch
+    (const NoiseSignState *state, const uint8_t * const *public_keys,
+     const uint8_t * const *messages, const size_t *message_lens,
+     const uint8_t * const *signatures, size_t count, int *results)
+{
+    size_t index;
+    int err;
+
+    /* Validate the parameters */
+    if (!state || !public_keys || !messages || !message_lens ||
+            !signatures || !results)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (index = 0; index < count; ++index) {
+        if (!public_keys[index] || !signatures[index])
+            return NOISE_ERROR_INVALID_PARAM;
+        if (!messages[index] && message_lens[index] != 0)
+            return NOISE_ERROR_INVALID_PARAM;
+    }
+    if (!state->verify_batch)
+        return NOISE_ERROR_NOT_APPLICABLE;
+
+    /* Consult the cache of verified signatures if there is one */
+    if (state->verify_cache && count > 0) {
+        err = noise_signstate_verify_batch_cached
+            (state, public_keys, messages, message_lens, signatures,
+             count, results);
+        if (err != NOISE_ERROR_NO_MEMORY)
+            return err;
+    }
+
+    /* Verify the digital signatures */
+    return (*(state->verify_batch))
+        (state, public_keys, messages, message_lens, signatures,
+         count, results);
+}
+
+/**
+ * \brief Sets the cache of verified signatures to use for a SignState.
+ *
+ * \param state The SignState object.
+ * \param cache The cache of verified signatures, or NULL to stop
+ * using a cache.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a state is NULL.
+ *
+ * Once a cache has been set, noise_signstate_verify() and
+ * noise_signstate_verify_batch() look for each signature in the cache
+ * before verifying it, and add signatures that verify successfully.
+ * The same cache can be shared between many SignState objects and
+ * algorithms.  The cache must outlive \a state or be detached from it
+ * first.
+ *
+ * \sa noise_verify_cache_new(), noise_signstate_verify()
+ */
+int noise_signstate_set_verify_cache
+    (NoiseSignState *state, NoiseVerifyCache *cache)
+{
+    if (!state)
+        return NOISE_ERROR_INVALID_PARAM;
+    state->verify_cache = cache;
+    return NOISE_ERROR_NONE;
+}
+
 /**
  * \brief Copies the keys from one SignState object to another.
  *
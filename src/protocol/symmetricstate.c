@@ -219,7 +219,7 @@ int noise_symmetricstate_free(NoiseSymmetricState *state)
         noise_hashstate_free(state->hash);
 
     /* Clean and free the memory for "state" */
-    noise_free(state, state->size);
+    noise_free_object(state, state->size);
     return NOISE_ERROR_NONE;
 }
 
@@ -518,6 +518,7 @@ int noise_symmetricstate_split
     uint8_t temp_k2[NOISE_MAX_HASHLEN];
     size_t hash_len;
     size_t key_len;
+    int err;
 
     /* Validate the parameters */
     if (!state)
@@ -540,14 +541,78 @@ int noise_symmetricstate_split
         (state->hash, state->ck, hash_len, state->ck, 0,
          temp_k1, key_len, temp_k2, key_len);
 
+    /* Hand the keys to the CipherState objects */
+    err = noise_symmetricstate_split_keys(state, c1, c2, temp_k1, temp_k2);
+    noise_clean(temp_k1, sizeof(temp_k1));
+    noise_clean(temp_k2, sizeof(temp_k2));
+    return err;
+}
+
+/** @cond */
+
+/**
+ * \brief Splits the transport encryption CipherState objects out of
+ * a SymmetricState object once the keys have been generated.
+ *
+ * \param state The SymmetricState object, which must not have been
+ * split already.
+ * \param c1 Points to the variable where to place the pointer to the
+ * first CipherState object, or NULL if it is not required.
+ * \param c2 Points to the variable where to place the pointer to the
+ * second CipherState object, or NULL if it is not required.
+ * \param k1 The key for the first CipherState object.
+ * \param k2 The key for the second CipherState object.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to create
+ * the new CipherState objects.
+ *
+ * This is the second half of noise_symmetricstate_split(), which is
+ * shared with noise_handshakestate_split_batch() so that the keys
+ * for many handshakes can be generated together.
+ */
+int noise_symmetricstate_split_keys
+    (NoiseSymmetricState *state, NoiseCipherState **c1, NoiseCipherState **c2,
+     const uint8_t *k1, const uint8_t *k2)
+{
+    size_t key_len = noise_cipherstate_get_key_length(state->cipher);
+
+    /* The internal cipher cannot be handed off if it lives in an arena,
+       so give the application fresh heap objects and destroy it instead */
+    if (state->arena) {
+        NoiseArena *prev;
+        if (c1)
+            *c1 = (*(state->cipher->create))();
+        if (c2)
+            *c2 = (*(state->cipher->create))();
+        if ((c1 && !(*c1)) || (c2 && !(*c2))) {
+            if (c1 && *c1) {
+                noise_cipherstate_free(*c1);
+                *c1 = 0;
+            }
+            if (c2 && *c2) {
+                noise_cipherstate_free(*c2);
+                *c2 = 0;
+            }
+            return NOISE_ERROR_NO_MEMORY;
+        }
+        if (c1)
+            noise_cipherstate_init_key(*c1, k1, key_len);
+        if (c2)
+            noise_cipherstate_init_key(*c2, k2, key_len);
+        prev = noise_arena_set(state->arena);
+        noise_cipherstate_free(state->cipher);
+        noise_arena_set(prev);
+        state->cipher = 0;
+        return NOISE_ERROR_NONE;
+    }
+
     /* If we only need c2, then re-initialize the key in the internal
        cipher and copy it to c2 */
     if (!c1 && c2) {
-        noise_cipherstate_init_key(state->cipher, temp_k2, key_len);
+        noise_cipherstate_init_key(state->cipher, k2, key_len);
         *c2 = state->cipher;
         state->cipher = 0;
-        noise_clean(temp_k1, sizeof(temp_k1));
-        noise_clean(temp_k2, sizeof(temp_k2));
         return NOISE_ERROR_NONE;
     }
 
@@ -555,21 +620,18 @@ int noise_symmetricstate_split
        We don't need to do this if the second CipherSuite is not required */
     if (c2) {
         *c2 = (*(state->cipher->create))();
-        if (!(*c2)) {
-            noise_clean(temp_k1, sizeof(temp_k1));
-            noise_clean(temp_k2, sizeof(temp_k2));
+        if (!(*c2))
             return NOISE_ERROR_NO_MEMORY;
-        }
-        noise_cipherstate_init_key(*c2, temp_k2, key_len);
+        noise_cipherstate_init_key(*c2, k2, key_len);
     }
 
     /* Re-initialize the key in the internal cipher and copy it to c1 */
-    noise_cipherstate_init_key(state->cipher, temp_k1, key_len);
+    noise_cipherstate_init_key(state->cipher, k1, key_len);
     *c1 = state->cipher;
     state->cipher = 0;
-    noise_clean(temp_k1, sizeof(temp_k1));
-    noise_clean(temp_k2, sizeof(temp_k2));
     return NOISE_ERROR_NONE;
 }
 
+/** @endcond */
+
 /**@}*/
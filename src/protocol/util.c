@@ -22,6 +22,7 @@
  */
 
 #include "internal.h"
+#include "crypto/cpu/cpu.h"
 #if USE_LIBSODIUM
 #include <sodium.h>
 typedef crypto_hash_sha256_state sha256_context_t;
@@ -36,9 +37,185 @@ typedef crypto_hash_sha256_state sha256_context_t;
 #include <openssl/evp.h>
 #endif
 #include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #if HAVE_PTHREAD
 #include <pthread.h>
 static pthread_once_t noise_is_initialized = PTHREAD_ONCE_INIT;
+#endif
+#if defined(NOISE_THREAD_LOCAL)
+static NOISE_THREAD_LOCAL NoiseArena *noise_arena_current = 0;
+#endif
+
+static void *noise_default_alloc(void *ctx, size_t size)
+{
+    (void)ctx;
+    return malloc(size);
+}
+
+static void noise_default_free(void *ctx, void *ptr, size_t size)
+{
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+/* Allocator that all library memory is obtained from */
+static NoiseAllocator noise_allocator = {
+    noise_default_alloc,
+    noise_default_alloc,
+    noise_default_free,
+    0
+};
+
+#if defined(NOISE_THREAD_LOCAL)
+
+/* Number of distinct object sizes that each thread can pool */
+#define NOISE_POOL_SIZES 32
+
+/* Cleaned object that is waiting in a pool to be reused */
+typedef struct NoisePoolBlock_s
+{
+    struct NoisePoolBlock_s *next;
+
+} NoisePoolBlock;
+
+/* Pool of cleaned objects that all have the same size */
+typedef struct
+{
+    size_t size;
+    size_t count;
+    NoisePoolBlock *head;
+
+} NoisePoolClass;
+
+/* Per-thread set of object pools */
+typedef struct
+{
+    NoisePoolClass classes[NOISE_POOL_SIZES];
+    size_t cached;
+    size_t cached_bytes;
+    size_t high_water;
+    uint64_t hits;
+    uint64_t misses;
+    int registered;
+
+} NoiseObjectPool;
+
+static NOISE_THREAD_LOCAL NoiseObjectPool noise_object_pool;
+
+/* Maximum number of objects of each size that a thread may hold */
+static size_t noise_object_pool_limit = 0;
+
+/* Number of objects that are pooled across all threads */
+static size_t noise_object_pool_total = 0;
+
+/**
+ * \brief Finds the pool for objects of a specific size.
+ *
+ * \param pool The thread's set of pools.
+ * \param size The size of the objects.
+ * \param create Non-zero to create the pool if it does not exist yet.
+ *
+ * \return The pool, or NULL if there is no pool for \a size.
+ */
+static NoisePoolClass *noise_object_pool_find
+    (NoiseObjectPool *pool, size_t size, int create)
+{
+    size_t index = (size / sizeof(void *)) % NOISE_POOL_SIZES;
+    size_t probe;
+    for (probe = 0; probe < NOISE_POOL_SIZES; ++probe) {
+        NoisePoolClass *cls = &(pool->classes[index]);
+        if (cls->size == size)
+            return cls;
+        if (!cls->size) {
+            if (!create)
+                return 0;
+            cls->size = size;
+            return cls;
+        }
+        index = (index + 1) % NOISE_POOL_SIZES;
+    }
+    return 0;
+}
+
+/**
+ * \brief Frees objects in a thread's pools down to a limit.
+ *
+ * \param pool The thread's set of pools.
+ * \param limit The number of objects of each size to keep.
+ */
+static void noise_object_pool_drain(NoiseObjectPool *pool, size_t limit)
+{
+    size_t index;
+    for (index = 0; index < NOISE_POOL_SIZES; ++index) {
+        NoisePoolClass *cls = &(pool->classes[index]);
+        while (cls->count > limit) {
+            NoisePoolBlock *block = cls->head;
+            cls->head = block->next;
+            --(cls->count);
+            --(pool->cached);
+            pool->cached_bytes -= cls->size;
+            block->next = 0;
+            (*(noise_allocator.free))(noise_allocator.ctx, block, cls->size);
+            noise_atomic_dec(&noise_object_pool_total);
+        }
+    }
+}
+
+#if HAVE_PTHREAD
+
+static pthread_once_t noise_object_pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t noise_object_pool_key;
+static int noise_object_pool_have_key = 0;
+
+static void noise_object_pool_thread_exit(void *arg)
+{
+    noise_object_pool_drain((NoiseObjectPool *)arg, 0);
+}
+
+static void noise_object_pool_create_key(void)
+{
+    noise_object_pool_have_key =
+        (pthread_key_create(&noise_object_pool_key,
+                            noise_object_pool_thread_exit) == 0);
+}
+
+#endif
+
+/**
+ * \brief Takes an object of a specific size out of the thread's pools.
+ *
+ * \param size The size of the object.
+ *
+ * \return The zeroed object, or NULL if the pool for \a size is empty.
+ */
+static void *noise_object_pool_pop(size_t size)
+{
+    NoiseObjectPool *pool = &noise_object_pool;
+    NoisePoolClass *cls;
+    NoisePoolBlock *block;
+    if (!noise_atomic_load(&noise_object_pool_limit) ||
+            size < sizeof(NoisePoolBlock))
+        return 0;
+    cls = noise_object_pool_find(pool, size, 0);
+    if (!cls || !(cls->head)) {
+        ++(pool->misses);
+        return 0;
+    }
+    block = cls->head;
+    cls->head = block->next;
+    --(cls->count);
+    --(pool->cached);
+    pool->cached_bytes -= size;
+    ++(pool->hits);
+    noise_atomic_dec(&noise_object_pool_total);
+    memset(block, 0, size);
+    return block;
+}
+
 #endif
 
 /**
@@ -53,6 +230,7 @@ static pthread_once_t noise_is_initialized = PTHREAD_ONCE_INIT;
 
 void noise_init_helper(void)
 {
+    cpu_supported_features();
 #if USE_LIBSODIUM
     if (sodium_init() < 0)
         return;
@@ -81,7 +259,8 @@ void noise_init_helper(void)
  *
  * \return NOISE_ERROR_NONE on success.
  *
- * This will initialize the underlying crypto libraries.
+ * This will initialize the underlying crypto libraries and detect the
+ * CPU features that can be used to accelerate the built-in primitives.
  * You don't need to call this if you initialize the crypto libraries (eg. libsodium, OpenSSL) yourself.
  */
 int noise_init(void)
@@ -96,6 +275,47 @@ int noise_init(void)
     return NOISE_ERROR_NONE;
 }
 
+/**
+ * \brief Gets the CPU features that are used to accelerate primitives.
+ *
+ * \return A bitmask of NOISE_CPU_SSSE3, NOISE_CPU_AVX2, etc indicating
+ * the features that are supported by the CPU and currently enabled.
+ *
+ * The built-in implementations of the primitives choose between
+ * portable code and accelerated kernels at runtime, based on these
+ * features.  Primitives that are provided by external libraries such
+ * as libsodium or OpenSSL make their own choices.
+ *
+ * \sa noise_set_cpu_features()
+ */
+int noise_get_cpu_features(void)
+{
+    return (int)(cpu_enabled_features() & CPU_FEATURE_ALL);
+}
+
+/**
+ * \brief Restricts the CPU features that are used to accelerate primitives.
+ *
+ * \param features A bitmask of NOISE_CPU_SSSE3, NOISE_CPU_AVX2, etc
+ * indicating the features that may be used.  Features that the CPU
+ * does not support are ignored.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ *
+ * Passing zero forces the portable implementations to be used, and
+ * passing -1 enables everything that the CPU supports again.
+ *
+ * \note This function is intended for testing and benchmarking.
+ * It should not be called while other threads are using the library.
+ *
+ * \sa noise_get_cpu_features()
+ */
+int noise_set_cpu_features(int features)
+{
+    cpu_set_features((uint32_t)features);
+    return NOISE_ERROR_NONE;
+}
+
 /**
  * \def noise_new(type)
  * \brief Allocates an object from the system and initializes it.
@@ -134,29 +354,352 @@ int noise_init(void)
  */
 void *noise_new_object(size_t size)
 {
-    void *ptr = calloc(1, size);
+    void *ptr;
+#if defined(NOISE_THREAD_LOCAL)
+    NoiseArena *arena = noise_arena_current;
+    if (arena) {
+        size_t rounded = (size + NOISE_ARENA_ALIGN - 1) &
+                         ~((size_t)(NOISE_ARENA_ALIGN - 1));
+        if (arena->base) {
+            /* Carve the object out of the arena */
+            size_t pad = (size_t)(-(uintptr_t)(arena->base + arena->posn)) &
+                         (NOISE_ARENA_ALIGN - 1);
+            if (rounded < size || pad > (arena->size - arena->posn) ||
+                    rounded > (arena->size - arena->posn - pad))
+                return 0;
+            ptr = arena->base + arena->posn + pad;
+            arena->posn += pad + rounded;
+            memset(ptr, 0, size);
+            if (size >= sizeof(size_t))
+                *((size_t *)ptr) = size;
+            return ptr;
+        }
+
+        /* Measuring only: account for the object and use the heap */
+        arena->posn += rounded;
+    }
+#endif
+#if defined(NOISE_THREAD_LOCAL)
+    ptr = noise_object_pool_pop(size);
+    if (!ptr)
+        ptr = noise_new_secure_memory(size);
+#else
+    ptr = noise_new_secure_memory(size);
+#endif
     if (!ptr || size < sizeof(size_t))
         return ptr;
     *((size_t *)ptr) = size;
     return ptr;
 }
 
+/**
+ * \brief Allocates a zeroed block of memory with the current allocator.
+ *
+ * \param size The number of bytes of memory to allocate.
+ *
+ * \return Pointer to the allocated memory or NULL if the system is
+ * out of memory.
+ *
+ * This is used for buffers and arrays that do not hold secret material.
+ * The memory is released with noise_free().
+ *
+ * \sa noise_new_secure_memory(), noise_set_allocator()
+ */
+void *noise_new_memory(size_t size)
+{
+    void *ptr = (*(noise_allocator.alloc))(noise_allocator.ctx, size ? size : 1);
+    if (ptr)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * \brief Allocates a zeroed block of memory for secret material.
+ *
+ * \param size The number of bytes of memory to allocate.
+ *
+ * \return Pointer to the allocated memory or NULL if the system is
+ * out of memory.
+ *
+ * The memory is obtained from the secure allocation function that was
+ * supplied to noise_set_allocator(), which may place it in locked pages.
+ * All objects that are created with noise_new() use this function.
+ * The memory is released with noise_free().
+ *
+ * \sa noise_new_memory(), noise_set_allocator()
+ */
+void *noise_new_secure_memory(size_t size)
+{
+    void *ptr = (*(noise_allocator.secure_alloc))
+        (noise_allocator.ctx, size ? size : 1);
+    if (ptr)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
 /**
  * \brief Destroys the contents of a block of memory and free it.
  *
  * \param ptr Points to the memory to be freed.
  * \param size The number of bytes at \a ptr.
  *
- * \sa noise_new()
+ * The memory is returned to the allocator that was set with
+ * noise_set_allocator().
+ *
+ * \sa noise_new(), noise_new_memory()
  */
 void noise_free(void *ptr, size_t size)
 {
     if (ptr) {
+#if defined(NOISE_THREAD_LOCAL)
+        NoiseArena *arena = noise_arena_current;
+        if (arena && arena->base && (uint8_t *)ptr >= arena->base &&
+                (uint8_t *)ptr < (arena->base + arena->size)) {
+            /* Objects in an arena are cleaned but not freed */
+            noise_clean(ptr, size);
+            return;
+        }
+#endif
         noise_clean(ptr, size);
-        free(ptr);
+
+        /* Zero-sized blocks were allocated as a single byte, and the
+           allocator is told the same size that it was asked for */
+        (*(noise_allocator.free))
+            (noise_allocator.ctx, ptr, size ? size : 1);
+    }
+}
+
+/**
+ * \brief Destroys the contents of an object and recycles or frees it.
+ *
+ * \param ptr Points to the object to be freed.
+ * \param size The size of the object, which must be the size that
+ * was originally passed to noise_new_object().
+ *
+ * If object pools are enabled with noise_set_object_pool_limit(), then
+ * the cleaned object is kept in the calling thread's pool for objects
+ * of the same size.  Otherwise this is the same as noise_free().
+ *
+ * \sa noise_new_object(), noise_free()
+ */
+void noise_free_object(void *ptr, size_t size)
+{
+#if defined(NOISE_THREAD_LOCAL)
+    NoiseObjectPool *pool = &noise_object_pool;
+    NoiseArena *arena = noise_arena_current;
+    NoisePoolClass *cls;
+    size_t limit = noise_atomic_load(&noise_object_pool_limit);
+    if (!ptr || !limit || size < sizeof(NoisePoolBlock) ||
+            (arena && arena->base && (uint8_t *)ptr >= arena->base &&
+             (uint8_t *)ptr < (arena->base + arena->size))) {
+        noise_free(ptr, size);
+        return;
+    }
+    cls = noise_object_pool_find(pool, size, 1);
+    if (!cls || cls->count >= limit) {
+        noise_free(ptr, size);
+        return;
+    }
+#if HAVE_PTHREAD
+    if (!(pool->registered)) {
+        /* Arrange for the pools to be drained when the thread exits */
+        pthread_once(&noise_object_pool_once, noise_object_pool_create_key);
+        if (noise_object_pool_have_key)
+            pthread_setspecific(noise_object_pool_key, pool);
+        pool->registered = 1;
+    }
+#endif
+    noise_clean(ptr, size);
+    ((NoisePoolBlock *)ptr)->next = cls->head;
+    cls->head = (NoisePoolBlock *)ptr;
+    ++(cls->count);
+    ++(pool->cached);
+    pool->cached_bytes += size;
+    noise_atomic_inc(&noise_object_pool_total);
+    if (pool->cached > pool->high_water)
+        pool->high_water = pool->cached;
+#else
+    noise_free(ptr, size);
+#endif
+}
+
+/**
+ * \brief Sets the number of objects of each size that a thread may pool.
+ *
+ * \param limit The maximum number of cleaned objects of each size to
+ * keep in each thread's pool, or zero to disable pooling.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_NOT_APPLICABLE if the platform does not support
+ * per-thread pools.
+ *
+ * Object pools are disabled by default.  When they are enabled, the
+ * CipherState, HashState, DHState, SymmetricState, and HandshakeState
+ * objects that a thread frees are cleaned and kept for its next
+ * allocation of the same size instead of being returned to the allocator.
+ * This avoids contention in the allocator when many threads are creating
+ * and destroying sessions.
+ *
+ * Each thread's pools are emptied when the thread exits.  Lowering the
+ * limit does not free objects that are already pooled; call
+ * noise_trim_object_pool() on each thread to do that.
+ *
+ * \sa noise_get_object_pool_stats(), noise_trim_object_pool()
+ */
+int noise_set_object_pool_limit(size_t limit)
+{
+#if defined(NOISE_THREAD_LOCAL)
+    noise_atomic_store(&noise_object_pool_limit, limit);
+    if (!limit)
+        noise_object_pool_drain(&noise_object_pool, 0);
+    return NOISE_ERROR_NONE;
+#else
+    (void)limit;
+    return NOISE_ERROR_NOT_APPLICABLE;
+#endif
+}
+
+/**
+ * \brief Gets the statistics for the calling thread's object pools.
+ *
+ * \param stats Returns the statistics.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a stats is NULL.
+ *
+ * \sa noise_set_object_pool_limit(), noise_trim_object_pool()
+ */
+int noise_get_object_pool_stats(NoiseObjectPoolStats *stats)
+{
+#if defined(NOISE_THREAD_LOCAL)
+    NoiseObjectPool *pool = &noise_object_pool;
+    size_t index;
+#endif
+    if (!stats)
+        return NOISE_ERROR_INVALID_PARAM;
+    memset(stats, 0, sizeof(NoiseObjectPoolStats));
+#if defined(NOISE_THREAD_LOCAL)
+    for (index = 0; index < NOISE_POOL_SIZES; ++index) {
+        if (pool->classes[index].size)
+            ++(stats->sizes);
+    }
+    stats->cached = pool->cached;
+    stats->cached_bytes = pool->cached_bytes;
+    stats->high_water = pool->high_water;
+    stats->hits = pool->hits;
+    stats->misses = pool->misses;
+#endif
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Frees pooled objects in the calling thread down to a limit.
+ *
+ * \param limit The maximum number of objects of each size to keep.
+ * Zero frees all of the thread's pooled objects.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ *
+ * The high-water mark in the statistics is reset to the number of
+ * objects that remain, so that the peak since the last trim can be
+ * used to choose the next \a limit.
+ *
+ * \sa noise_set_object_pool_limit(), noise_get_object_pool_stats()
+ */
+int noise_trim_object_pool(size_t limit)
+{
+#if defined(NOISE_THREAD_LOCAL)
+    noise_object_pool_drain(&noise_object_pool, limit);
+    noise_object_pool.high_water = noise_object_pool.cached;
+#else
+    (void)limit;
+#endif
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Sets the allocator that the library obtains all memory from.
+ *
+ * \param allocator Points to the allocator to use, or NULL to go back to
+ * the system's malloc() and free() functions.  The contents are copied.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if the \a alloc or \a free function
+ * in \a allocator is NULL.
+ * \return NOISE_ERROR_INVALID_STATE if other threads still have objects
+ * in their pools that came from the previous allocator.
+ *
+ * Objects are allocated with the \a secure_alloc function because they
+ * contain keys and other secret material.  Plain buffers and arrays such
+ * as the fields of protobuf messages use the \a alloc function.  If
+ * \a secure_alloc is NULL, then \a alloc is used for everything.
+ *
+ * The \a free function receives memory from either allocation function
+ * after it has been cleaned.  The size that is passed to it is always the
+ * size that was passed to the allocation function for that block, so it
+ * can be used with sized deallocators such as jemalloc's sdallocx().
+ *
+ * \note The allocator must be set before any objects are created, and
+ * not changed again until they have all been freed.  This function is
+ * not thread-safe.  The calling thread's object pools are emptied, but
+ * other threads must call noise_trim_object_pool() themselves or exit
+ * before the allocator can be changed.
+ *
+ * \sa noise_new_memory(), noise_new_secure_memory(), noise_free()
+ */
+int noise_set_allocator(const NoiseAllocator *allocator)
+{
+#if defined(NOISE_THREAD_LOCAL)
+    noise_object_pool_drain(&noise_object_pool, 0);
+    if (noise_atomic_load(&noise_object_pool_total) != 0)
+        return NOISE_ERROR_INVALID_STATE;
+#endif
+    if (!allocator) {
+        noise_allocator.alloc = noise_default_alloc;
+        noise_allocator.secure_alloc = noise_default_alloc;
+        noise_allocator.free = noise_default_free;
+        noise_allocator.ctx = 0;
+        return NOISE_ERROR_NONE;
     }
+    if (!allocator->alloc || !allocator->free)
+        return NOISE_ERROR_INVALID_PARAM;
+    noise_allocator = *allocator;
+    if (!noise_allocator.secure_alloc)
+        noise_allocator.secure_alloc = noise_allocator.alloc;
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Installs the arena for the calling thread's object allocations.
+ *
+ * \param arena The arena to install, or NULL to go back to the heap.
+ *
+ * \return The arena that was previously installed, or NULL if there was
+ * none.  The caller passes it back to this function to restore it.
+ *
+ * If the compiler does not support thread-local storage then arenas are
+ * not available and this function does nothing.
+ *
+ * \sa noise_new_object(), noise_free()
+ */
+NoiseArena *noise_arena_set(NoiseArena *arena)
+{
+#if defined(NOISE_THREAD_LOCAL)
+    NoiseArena *prev = noise_arena_current;
+    noise_arena_current = arena;
+    return prev;
+#else
+    (void)arena;
+    return 0;
+#endif
 }
 
+#if !defined(__GNUC__) && !defined(__clang__)
+/* Calling memset() through a volatile pointer stops the compiler from
+   proving that the call has no effect and removing it */
+static void *(*const volatile noise_clean_memset)(void *, int, size_t) = memset;
+#endif
+
 /**
  * \brief Cleans a block of memory to destroy its contents.
  *
@@ -165,15 +708,31 @@ void noise_free(void *ptr, size_t size)
  *
  * This function tries to perform the operation in a way that should
  * work around compilers and linkers that optimize away memset() calls
- * for memory that the compiler thinks is no longer live.
+ * for memory that the compiler thinks is no longer live.  The block is
+ * cleared with the system memset(), which uses the widest stores that
+ * the CPU supports, followed by a compiler barrier that makes the
+ * cleared memory appear to be used.
  */
 void noise_clean(void *data, size_t size)
 {
-    volatile uint8_t *d = (volatile uint8_t *)data;
-    while (size > 0) {
-        *d++ = 0;
-        --size;
-    }
+#if defined(__GNUC__) || defined(__clang__)
+    memset(data, 0, size);
+    __asm__ __volatile__ ("" : : "r"(data) : "memory");
+#else
+    (*noise_clean_memset)(data, 0, size);
+#endif
+}
+
+/**
+ * \brief Reduces a difference accumulator to a boolean in constant time.
+ *
+ * \param temp The accumulated difference bits.
+ *
+ * \return Returns 1 if \a temp is zero, or 0 otherwise.
+ */
+static int noise_is_zero_word(uint64_t temp)
+{
+    return (int)(((temp | (0 - temp)) >> 63) ^ 1);
 }
 
 /**
@@ -184,19 +743,46 @@ void noise_clean(void *data, size_t size)
  * \param size Number of bytes in each block.
  *
  * \return Returns 1 if the blocks are equal, 0 if they are not.
+ *
+ * The differences are OR-accumulated over 128-bit vectors and 64-bit
+ * words, and the whole of both blocks is always read.
  */
 int noise_is_equal(const void *s1, const void *s2, size_t size)
 {
     const uint8_t *str1 = (const unsigned char *)s1;
     const uint8_t *str2 = (const unsigned char *)s2;
-    uint8_t temp = 0;
+    uint64_t temp = 0;
+    uint64_t w1, w2;
+#if defined(__SSE2__)
+    if (size >= 16) {
+        __m128i acc = _mm_setzero_si128();
+        do {
+            acc = _mm_or_si128
+                (acc, _mm_xor_si128(_mm_loadu_si128((const __m128i *)str1),
+                                    _mm_loadu_si128((const __m128i *)str2)));
+            str1 += 16;
+            str2 += 16;
+            size -= 16;
+        } while (size >= 16);
+        acc = _mm_or_si128(acc, _mm_srli_si128(acc, 8));
+        _mm_storel_epi64((__m128i *)&temp, acc);
+    }
+#endif
+    while (size >= 8) {
+        memcpy(&w1, str1, 8);
+        memcpy(&w2, str2, 8);
+        temp |= w1 ^ w2;
+        str1 += 8;
+        str2 += 8;
+        size -= 8;
+    }
     while (size > 0) {
         temp |= *str1 ^ *str2;
         ++str1;
         ++str2;
         --size;
     }
-    return (0x0100 - (int)temp) >> 8;
+    return noise_is_zero_word(temp);
 }
 
 /**
@@ -211,12 +797,19 @@ int noise_is_equal(const void *s1, const void *s2, size_t size)
 int noise_is_zero(const void *data, size_t size)
 {
     const uint8_t *d = (const uint8_t *)data;
-    uint8_t temp = 0;
+    uint64_t temp = 0;
+    uint64_t w;
+    while (size >= 8) {
+        memcpy(&w, d, 8);
+        temp |= w;
+        d += 8;
+        size -= 8;
+    }
     while (size > 0) {
         temp |= *d++;
         --size;
     }
-    return (0x0100 - (int)temp) >> 8;
+    return noise_is_zero_word(temp);
 }
 
 /**
@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "internal.h"
+#include <string.h>
+
+/**
+ * \file verifycache.h
+ * \brief VerifyCache interface
+ */
+
+/**
+ * \file verifycache.c
+ * \brief VerifyCache implementation
+ */
+
+/**
+ * \defgroup verifycache VerifyCache API
+ *
+ * Peers tend to present the same certificates over and over, and checking
+ * the same signature again costs just as much as it did the first time.
+ * A VerifyCache remembers signatures that have already been found to be
+ * valid.  When the cache is attached to a SignState with
+ * noise_signstate_set_verify_cache(), noise_signstate_verify() and
+ * noise_signstate_verify_batch() consult the cache before performing
+ * the public key operation, and add newly verified signatures to it.
+ *
+ * Each entry is a BLAKE2b digest of the algorithm, signing key, signature,
+ * and message.  A signature is only reported as valid from the cache if
+ * all of those are identical to a tuple that was verified before.
+ * Invalid signatures are never cached.
+ *
+ * The cache has a fixed capacity.  It is organised as a set-associative
+ * table with 8 entries per set, and the CLOCK algorithm picks the entry
+ * within a set to evict when a new signature is added.
+ *
+ * A single cache may be shared between SignStates on multiple threads
+ * if the library was built with POSIX threads.
+ */
+/**@{*/
+
+/**
+ * \typedef NoiseVerifyCache
+ * \brief Opaque object that represents a cache of verified signatures.
+ */
+
+/** @cond */
+
+/* Upper bound on the capacity to keep allocations sensible */
+#define NOISE_VERIFY_CACHE_MAX_CAPACITY (1 << 24)
+
+/* Flags for cache entries */
+#define NOISE_VERIFY_CACHE_VALID        0x01
+#define NOISE_VERIFY_CACHE_REFERENCED   0x02
+
+/** @endcond */
+
+/**
+ * \brief Creates a new cache of verified signatures.
+ *
+ * \param cache Points to the variable where to store the pointer to
+ * the new VerifyCache object.
+ * \param capacity The maximum number of signatures to hold, which is
+ * rounded up to the next power of two with a minimum of 8.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a cache is NULL, or \a capacity
+ * is zero or larger than 16777216.
+ * \return NOISE_ERROR_NO_MEMORY if there is insufficient memory to
+ * allocate the new VerifyCache object.
+ *
+ * Each entry occupies a little over 32 bytes.
+ *
+ * \sa noise_verify_cache_free(), noise_signstate_set_verify_cache()
+ */
+int noise_verify_cache_new(NoiseVerifyCache **cache, size_t capacity)
+{
+    NoiseVerifyCache *c;
+    size_t size;
+
+    /* Validate the parameters */
+    if (!cache)
+        return NOISE_ERROR_INVALID_PARAM;
+    *cache = 0;
+    if (!capacity || capacity > NOISE_VERIFY_CACHE_MAX_CAPACITY)
+        return NOISE_ERROR_INVALID_PARAM;
+    for (size = NOISE_VERIFY_CACHE_WAYS; size < capacity; size <<= 1)
+        ;   /* Round up to a power of two */
+
+    /* Allocate the cache and its entries */
+    c = noise_new(NoiseVerifyCache);
+    if (!c)
+        return NOISE_ERROR_NO_MEMORY;
+    c->capacity = size;
+    c->entries = (NoiseVerifyCacheEntry *)
+        noise_new_memory(size * sizeof(NoiseVerifyCacheEntry));
+    c->hands = (uint8_t *)noise_new_memory(size / NOISE_VERIFY_CACHE_WAYS);
+    if (!c->entries || !c->hands ||
+            noise_hashstate_new_by_id(&(c->hash), NOISE_HASH_BLAKE2b)
+                != NOISE_ERROR_NONE) {
+        noise_free(c->entries, size * sizeof(NoiseVerifyCacheEntry));
+        noise_free(c->hands, size / NOISE_VERIFY_CACHE_WAYS);
+        noise_free(c, c->size);
+        return NOISE_ERROR_NO_MEMORY;
+    }
+#if HAVE_PTHREAD
+    if (pthread_mutex_init(&(c->mutex), 0) != 0) {
+        noise_hashstate_free(c->hash);
+        noise_free(c->entries, size * sizeof(NoiseVerifyCacheEntry));
+        noise_free(c->hands, size / NOISE_VERIFY_CACHE_WAYS);
+        noise_free(c, c->size);
+        return NOISE_ERROR_SYSTEM;
+    }
+#endif
+
+    *cache = c;
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Frees a cache of verified signatures.
+ *
+ * \param cache The VerifyCache object to free.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a cache is NULL.
+ *
+ * The cache must be detached from all SignState objects before it is freed.
+ *
+ * \sa noise_verify_cache_new()
+ */
+int noise_verify_cache_free(NoiseVerifyCache *cache)
+{
+    /* Validate the parameter */
+    if (!cache)
+        return NOISE_ERROR_INVALID_PARAM;
+
+    /* Destroy the entries and the cache */
+#if HAVE_PTHREAD
+    pthread_mutex_destroy(&(cache->mutex));
+#endif
+    noise_hashstate_free(cache->hash);
+    noise_free(cache->entries,
+               cache->capacity * sizeof(NoiseVerifyCacheEntry));
+    noise_free(cache->hands, cache->capacity / NOISE_VERIFY_CACHE_WAYS);
+    noise_free(cache, cache->size);
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Removes all signatures from a cache and resets its counters.
+ *
+ * \param cache The VerifyCache object.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a cache is NULL.
+ */
+int noise_verify_cache_clear(NoiseVerifyCache *cache)
+{
+    if (!cache)
+        return NOISE_ERROR_INVALID_PARAM;
+    noise_verify_cache_lock(cache);
+    memset(cache->entries, 0,
+           cache->capacity * sizeof(NoiseVerifyCacheEntry));
+    memset(cache->hands, 0, cache->capacity / NOISE_VERIFY_CACHE_WAYS);
+    cache->count = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    noise_verify_cache_unlock(cache);
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Gets the capacity of a cache of verified signatures.
+ *
+ * \param cache The VerifyCache object.
+ *
+ * \return The maximum number of signatures that the cache can hold,
+ * or zero if \a cache is NULL.
+ */
+size_t noise_verify_cache_get_capacity(const NoiseVerifyCache *cache)
+{
+    return cache ? cache->capacity : 0;
+}
+
+/**
+ * \brief Gets the statistics for a cache of verified signatures.
+ *
+ * \param cache The VerifyCache object.
+ * \param count Returns the number of signatures in the cache.
+ * May be NULL if the caller is not interested in this value.
+ * \param hits Returns the number of lookups that found the signature
+ * in the cache.  May be NULL.
+ * \param misses Returns the number of lookups that did not find the
+ * signature in the cache.  May be NULL.
+ *
+ * \return NOISE_ERROR_NONE on success.
+ * \return NOISE_ERROR_INVALID_PARAM if \a cache is NULL.
+ *
+ * \sa noise_verify_cache_clear()
+ */
+int noise_verify_cache_get_stats
+    (NoiseVerifyCache *cache, size_t *count, uint64_t *hits, uint64_t *misses)
+{
+    if (!cache)
+        return NOISE_ERROR_INVALID_PARAM;
+    noise_verify_cache_lock(cache);
+    if (count)
+        *count = cache->count;
+    if (hits)
+        *hits = cache->hits;
+    if (misses)
+        *misses = cache->misses;
+    noise_verify_cache_unlock(cache);
+    return NOISE_ERROR_NONE;
+}
+
+/**
+ * \brief Computes the cache key for a signature.
+ *
+ * \param cache The VerifyCache object whose BLAKE2b HashState is used
+ * to compute the key.
+ * \param state The SignState that the signature is for.
+ * \param public_key Points to the signing key.
+ * \param message Points to the message that was signed.
+ * \param message_len The length of the \a message.
+ * \param signature Points to the signature.
+ * \param key Returns the cache key.
+ *
+ * The cache's HashState is shared by every SignState that uses the
+ * cache, so it is only used while holding the cache lock.
+ *
+ * \note This function is internal to the library.
+ */
+void noise_verify_cache_key
+    (NoiseVerifyCache *cache, const NoiseSignState *state,
+     const uint8_t *public_key, const uint8_t *message, size_t message_len,
+     const uint8_t *signature, uint8_t *key)
+{
+    NoiseHashState *hash = cache->hash;
+    uint8_t header[10];
+    uint8_t digest[64];
+    uint64_t len = message_len;
+    int index;
+
+    /* The key and signature lengths are fixed for the algorithm,
+       so only the message length needs to be included explicitly */
+    header[0] = (uint8_t)(state->sign_id >> 8);
+    header[1] = (uint8_t)(state->sign_id);
+    for (index = 0; index < 8; ++index)
+        header[2 + index] = (uint8_t)(len >> (56 - index * 8));
+    noise_verify_cache_lock(cache);
+    noise_hashstate_reset(hash);
+    noise_hashstate_update(hash, header, sizeof(header));
+    noise_hashstate_update(hash, public_key, state->public_key_len);
+    noise_hashstate_update(hash, signature, state->signature_len);
+    if (message_len)
+        noise_hashstate_update(hash, message, message_len);
+    noise_hashstate_finalize(hash, digest, sizeof(digest));
+    noise_verify_cache_unlock(cache);
+    memcpy(key, digest, NOISE_VERIFY_CACHE_KEY_LEN);
+}
+
+/**
+ * \brief Gets the set within the cache that a key belongs to.
+ *
+ * \param cache The VerifyCache object.
+ * \param key The cache key.
+ *
+ * \return The index of the first entry in the set.
+ */
+static size_t noise_verify_cache_set(const NoiseVerifyCache *cache,
+                                     const uint8_t *key)
+{
+    size_t set = ((size_t)(key[0])) | (((size_t)(key[1])) << 8) |
+                 (((size_t)(key[2])) << 16) | (((size_t)(key[3])) << 24);
+    return (set & (cache->capacity / NOISE_VERIFY_CACHE_WAYS - 1)) *
+           NOISE_VERIFY_CACHE_WAYS;
+}
+
+/**
+ * \brief Looks up a signature in the cache.
+ *
+ * \param cache The VerifyCache object.
+ * \param key The cache key from noise_verify_cache_key().
+ *
+ * \return Non-zero if the signature is known to be valid, zero if not.
+ *
+ * \note This function is internal to the library.
+ */
+int noise_verify_cache_lookup(NoiseVerifyCache *cache, const uint8_t *key)
+{
+    NoiseVerifyCacheEntry *entry;
+    size_t set = noise_verify_cache_set(cache, key);
+    int way;
+    int found = 0;
+    noise_verify_cache_lock(cache);
+    for (way = 0; way < NOISE_VERIFY_CACHE_WAYS; ++way) {
+        entry = &(cache->entries[set + way]);
+        if ((entry->flags & NOISE_VERIFY_CACHE_VALID) &&
+                !memcmp(entry->key, key, NOISE_VERIFY_CACHE_KEY_LEN)) {
+            entry->flags |= NOISE_VERIFY_CACHE_REFERENCED;
+            found = 1;
+            break;
+        }
+    }
+    if (found)
+        ++(cache->hits);
+    else
+        ++(cache->misses);
+    noise_verify_cache_unlock(cache);
+    return found;
+}
+
+/**
+ * \brief Adds a verified signature to the cache.
+ *
+ * \param cache The VerifyCache object.
+ * \param key The cache key from noise_verify_cache_key().
+ *
+ * \note This function is internal to the library.
+ */
+void noise_verify_cache_insert(NoiseVerifyCache *cache, const uint8_t *key)
+{
+    NoiseVerifyCacheEntry *entry;
+    size_t set = noise_verify_cache_set(cache, key);
+    uint8_t *hand = &(cache->hands[set / NOISE_VERIFY_CACHE_WAYS]);
+    int way;
+    noise_verify_cache_lock(cache);
+
+    /* Is the key already present, perhaps added by another thread?
+       If not, then use an empty entry in the set if there is one. */
+    entry = 0;
+    for (way = 0; way < NOISE_VERIFY_CACHE_WAYS; ++way) {
+        NoiseVerifyCacheEntry *e = &(cache->entries[set + way]);
+        if (!(e->flags & NOISE_VERIFY_CACHE_VALID)) {
+            if (!entry)
+                entry = e;
+        } else if (!memcmp(e->key, key, NOISE_VERIFY_CACHE_KEY_LEN)) {
+            e->flags |= NOISE_VERIFY_CACHE_REFERENCED;
+            noise_verify_cache_unlock(cache);
+            return;
+        }
+    }
+
+    /* Run the CLOCK hand around the set to find an entry to evict.
+       Entries that were referenced since the last sweep get a second
+       chance.  This terminates within two revolutions of the set. */
+    if (!entry) {
+        for (;;) {
+            entry = &(cache->entries[set + *hand]);
+            *hand = (*hand + 1) & (NOISE_VERIFY_CACHE_WAYS - 1);
+            if (!(entry->flags & NOISE_VERIFY_CACHE_REFERENCED))
+                break;
+            entry->flags &= ~NOISE_VERIFY_CACHE_REFERENCED;
+        }
+    } else {
+        ++(cache->count);
+    }
+    memcpy(entry->key, key, NOISE_VERIFY_CACHE_KEY_LEN);
+    entry->flags = NOISE_VERIFY_CACHE_VALID;
+    noise_verify_cache_unlock(cache);
+}
+
+/**@}*/
@@ -34,6 +34,10 @@
 #include <string.h>
 #include <time.h>
 #include "md5.h"
+#include "crypto/newhope/poly.h"
+#if !USE_LIBSODIUM
+#include "crypto/ghash/ghash.h"
+#endif
 #if defined(__APPLE__)
 #include <sys/time.h>
 #endif
@@ -46,9 +50,19 @@
 #define MB_COUNT        200
 #define DH_COUNT        1000
 #define PQ_DH_COUNT     2000
+#define NTT_COUNT       20000
+#define GHASH_KEY_COUNT 100000
 
 typedef uint64_t timestamp_t;
 
+/* Set of CPU features that selects an implementation of a primitive */
+typedef struct
+{
+    int features;
+    const char *name;
+
+} perf_kernel_t;
+
 static double units;
 
 #if defined(__WIN32__) || defined(WIN32)
@@ -110,7 +124,7 @@ static void calibrate_md5(void)
 }
 
 /* Measure the performance of a hashing primitive */
-static void perf_hash(int id)
+static void perf_hash_named(int id, const char *name)
 {
     NoiseHashState *hash;
     uint8_t data[BLOCK_SIZE];
@@ -129,15 +143,112 @@ static void perf_hash(int id)
     end = current_timestamp();
 
     elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
-    printf("%-20s%8.2f          %8.2f\n",
-           noise_id_to_name(NOISE_HASH_CATEGORY, id),
-           1.0 / elapsed, units / elapsed);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
 
     noise_hashstate_free(hash);
 }
 
+static void perf_hash(int id)
+{
+    perf_hash_named(id, noise_id_to_name(NOISE_HASH_CATEGORY, id));
+}
+
+/* Number of inputs to hash at once when measuring batched hashing */
+#define HASH_BATCH_SIZE 8
+
+/* Size of each input when measuring batched hashing, which is the size
+   of "h || e" for MixHash() with a 32-byte hash and 32-byte key */
+#define HASH_BATCH_INPUT 64
+
+/* Measure the performance of hashing many short independent inputs,
+   one at a time and then with noise_hashstate_hash_many() */
+static void perf_hash_many(int id)
+{
+    static uint8_t data[HASH_BATCH_SIZE][HASH_BATCH_INPUT];
+    static uint8_t output[HASH_BATCH_SIZE][64];
+    const uint8_t *data_ptrs[HASH_BATCH_SIZE];
+    size_t data_lens[HASH_BATCH_SIZE];
+    uint8_t *output_ptrs[HASH_BATCH_SIZE];
+    NoiseHashState *hash;
+    char name[64];
+    timestamp_t start, end;
+    long count, iterations;
+    size_t hash_len, index;
+    double elapsed;
+
+    if (noise_hashstate_new_by_id(&hash, id) != NOISE_ERROR_NONE)
+        return;
+    hash_len = noise_hashstate_get_hash_length(hash);
+    memset(data, 0xAA, sizeof(data));
+    for (index = 0; index < HASH_BATCH_SIZE; ++index) {
+        data_ptrs[index] = data[index];
+        data_lens[index] = HASH_BATCH_INPUT;
+        output_ptrs[index] = output[index];
+    }
+    iterations = ((long)MB_COUNT * 1024 * 1024) /
+                 (HASH_BATCH_SIZE * HASH_BATCH_INPUT);
+
+    start = current_timestamp();
+    for (count = 0; count < iterations; ++count) {
+        for (index = 0; index < HASH_BATCH_SIZE; ++index) {
+            noise_hashstate_hash_one(hash, data[index], HASH_BATCH_INPUT,
+                                     output[index], hash_len);
+        }
+    }
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
+    snprintf(name, sizeof(name), "%s %dB",
+             noise_id_to_name(NOISE_HASH_CATEGORY, id), HASH_BATCH_INPUT);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    start = current_timestamp();
+    for (count = 0; count < iterations; ++count) {
+        noise_hashstate_hash_many(hash, data_ptrs, data_lens, output_ptrs,
+                                  hash_len, HASH_BATCH_SIZE);
+    }
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
+    snprintf(name, sizeof(name), "%s %dB x%d",
+             noise_id_to_name(NOISE_HASH_CATEGORY, id), HASH_BATCH_INPUT,
+             HASH_BATCH_SIZE);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    noise_hashstate_free(hash);
+}
+
+/* Measure the performance of the memory cleaning and comparison helpers */
+static void perf_memory(size_t size)
+{
+    static uint8_t data1[BLOCK_SIZE];
+    static uint8_t data2[BLOCK_SIZE];
+    char name[32];
+    timestamp_t start, end;
+    long count;
+    long iterations = ((long)MB_COUNT * BLOCKS_PER_MB * BLOCK_SIZE) / size;
+    int equal = 0;
+    double elapsed;
+
+    start = current_timestamp();
+    for (count = 0; count < iterations; ++count)
+        noise_clean(data1, size);
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
+    snprintf(name, sizeof(name), "noise_clean %d", (int)size);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    start = current_timestamp();
+    for (count = 0; count < iterations; ++count)
+        equal += noise_is_equal(data1, data2, size);
+    end = current_timestamp();
+    if (equal != iterations)
+        return;
+    elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
+    snprintf(name, sizeof(name), "noise_is_equal %d", (int)size);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+}
+
 /* Measure the performance of an AEAD primitive */
-static void perf_cipher(int id)
+static void perf_cipher_named(int id, const char *name)
 {
     static uint8_t const key[32] = {
         0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
@@ -171,13 +282,176 @@ static void perf_cipher(int id)
     end = current_timestamp();
 
     elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
-    printf("%-20s%8.2f          %8.2f\n",
-           noise_id_to_name(NOISE_CIPHER_CATEGORY, id),
-           1.0 / elapsed, units / elapsed);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    noise_cipherstate_free(cipher);
+}
+
+static void perf_cipher(int id)
+{
+    perf_cipher_named(id, noise_id_to_name(NOISE_CIPHER_CATEGORY, id));
+}
+
+/* Measure the performance of an AEAD primitive when encrypting and
+   decrypting maximum-sized Noise packets */
+static void perf_cipher_large(int id)
+{
+    static uint8_t const key[32] = {
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+        0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,
+        0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+        0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20
+    };
+    static uint8_t data[NOISE_MAX_PAYLOAD_LEN];
+    static uint8_t packet[NOISE_MAX_PAYLOAD_LEN];
+    char name[64];
+    NoiseCipherState *cipher;
+    timestamp_t start, end;
+    size_t len = NOISE_MAX_PAYLOAD_LEN - 16;
+    int count, total;
+    double elapsed;
+    NoiseBuffer mbuf;
+
+    if (noise_cipherstate_new_by_id(&cipher, id) != NOISE_ERROR_NONE)
+        return;
+    total = (MB_COUNT * BLOCKS_PER_MB * BLOCK_SIZE) / len;
+
+    memset(data, 0xAA, sizeof(data));
+    noise_cipherstate_init_key(cipher, key, sizeof(key));
+    start = current_timestamp();
+    for (count = 0; count < total; ++count) {
+        noise_buffer_set_inout(mbuf, data, len, sizeof(data));
+        noise_cipherstate_encrypt(cipher, &mbuf);
+    }
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
+    snprintf(name, sizeof(name), "%s 64K enc",
+             noise_id_to_name(NOISE_CIPHER_CATEGORY, id));
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    /* Decrypt the same valid packet over and over; re-keying resets
+       the nonce and is negligible next to the packet size */
+    noise_cipherstate_init_key(cipher, key, sizeof(key));
+    noise_buffer_set_inout(mbuf, packet, len, sizeof(packet));
+    noise_cipherstate_encrypt(cipher, &mbuf);
+    start = current_timestamp();
+    for (count = 0; count < total; ++count) {
+        memcpy(data, packet, len + 16);
+        noise_cipherstate_init_key(cipher, key, sizeof(key));
+        noise_buffer_set_input(mbuf, data, len + 16);
+        noise_cipherstate_decrypt(cipher, &mbuf);
+    }
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)MB_COUNT;
+    snprintf(name, sizeof(name), "%s 64K dec",
+             noise_id_to_name(NOISE_CIPHER_CATEGORY, id));
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
 
     noise_cipherstate_free(cipher);
 }
 
+/* Measure the performance of an AEAD primitive with each of the
+   implementations that can be selected by CPU features */
+static void perf_cipher_kernels
+    (int id, const perf_kernel_t *kernels, size_t num_kernels)
+{
+    char name[64];
+    int supported = noise_get_cpu_features();
+    size_t index;
+    for (index = 0; index < num_kernels; ++index) {
+        if ((kernels[index].features & supported) != kernels[index].features)
+            continue;
+        noise_set_cpu_features(kernels[index].features);
+        snprintf(name, sizeof(name), "%s %s",
+                 noise_id_to_name(NOISE_CIPHER_CATEGORY, id),
+                 kernels[index].name);
+        perf_cipher_named(id, name);
+    }
+    noise_set_cpu_features(-1);
+}
+
+/* Measure the performance of a hash primitive with each of the
+   implementations that can be selected by CPU features */
+static void perf_hash_kernels
+    (int id, const perf_kernel_t *kernels, size_t num_kernels)
+{
+    char name[64];
+    int supported = noise_get_cpu_features();
+    size_t index;
+    for (index = 0; index < num_kernels; ++index) {
+        if ((kernels[index].features & supported) != kernels[index].features)
+            continue;
+        noise_set_cpu_features(kernels[index].features);
+        snprintf(name, sizeof(name), "%s %s",
+                 noise_id_to_name(NOISE_HASH_CATEGORY, id),
+                 kernels[index].name);
+        perf_hash_named(id, name);
+        perf_hash_many(id);
+    }
+    noise_set_cpu_features(-1);
+}
+
+#if !USE_LIBSODIUM
+
+/* Cost model for the portable GHASH engines that are used by AESGCM
+   when there is no carry-less multiply instruction.  Reports the cost
+   of setting a key and of each 16-byte block, and the number of bytes
+   per key after which the table engine's setup has paid for itself */
+static void perf_ghash_engines(void)
+{
+    static const struct {
+        int engine;
+        const char *name;
+    } engines[] = {
+        {GHASH_ENGINE_BITWISE,  "GHASH bitwise"},
+        {GHASH_ENGINE_TABLE,    "GHASH table"}
+    };
+    static ghash_state state;
+    uint8_t key[16];
+    uint8_t data[BLOCK_SIZE];
+    double setup[2] = {0, 0};
+    double per_block[2] = {0, 0};
+    timestamp_t start, end;
+    int prev_engine = ghash_get_engine();
+    int count, index;
+
+    memset(key, 0x66, sizeof(key));
+    memset(data, 0xAA, sizeof(data));
+    printf("GHASH engine     setup ns  block ns    MB/sec         MD5 units\n");
+    for (index = 0; index < 2; ++index) {
+        if (!ghash_set_engine(engines[index].engine))
+            continue;
+
+        start = current_timestamp();
+        for (count = 0; count < GHASH_KEY_COUNT; ++count)
+            ghash_reset(&state, key);
+        end = current_timestamp();
+        setup[index] = elapsed_to_seconds(start, end) / GHASH_KEY_COUNT;
+
+        start = current_timestamp();
+        for (count = 0; count < (BLOCKS_PER_MB * 8); ++count)
+            ghash_update(&state, data, sizeof(data));
+        end = current_timestamp();
+        per_block[index] = elapsed_to_seconds(start, end) /
+                           (BLOCKS_PER_MB * 8.0 * (BLOCK_SIZE / 16));
+
+        printf("%-16s %8.1f  %8.2f  %8.2f          %8.2f\n",
+               engines[index].name, setup[index] * 1e9,
+               per_block[index] * 1e9, 1.0 / (per_block[index] * 65536.0),
+               units / (per_block[index] * 65536.0));
+    }
+    ghash_set_engine(prev_engine);
+
+    if (per_block[1] > 0 && per_block[1] < per_block[0]) {
+        double blocks = (setup[1] - setup[0]) / (per_block[0] - per_block[1]);
+        if (blocks < 0)
+            blocks = 0;
+        printf("GHASH table break-even: %.0f bytes per key\n", blocks * 16);
+    }
+}
+
+#endif
+
 /* Measure the performance of a DH primitive when deriving keys */
 static void perf_dh_derive(int id)
 {
@@ -245,8 +519,9 @@ static void perf_dh_calculate(int id)
     noise_dhstate_free(dh2);
 }
 
-/* Measure the performance of an ephemeral-only DH primitive (e.g NewHope) */
-static void perf_dh_ephemeral_only(int id)
+/* Measure the performance of an ephemeral-only DH primitive (e.g NewHope),
+   reporting the results under the given name prefix */
+static void perf_dh_ephemeral_only_named(int id, const char *prefix)
 {
     char name[64];
     NoiseDHState *dh1;
@@ -269,8 +544,7 @@ static void perf_dh_ephemeral_only(int id)
     end = current_timestamp();
 
     elapsed = elapsed_to_seconds(start, end) / (double)PQ_DH_COUNT;
-    snprintf(name, sizeof(name), "%s generate",
-             noise_id_to_name(NOISE_DH_CATEGORY, id));
+    snprintf(name, sizeof(name), "%s generate", prefix);
     printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
 
     start = current_timestamp();
@@ -279,8 +553,7 @@ static void perf_dh_ephemeral_only(int id)
     end = current_timestamp();
 
     elapsed = elapsed_to_seconds(start, end) / (double)PQ_DH_COUNT;
-    snprintf(name, sizeof(name), "%s sharedb",
-             noise_id_to_name(NOISE_DH_CATEGORY, id));
+    snprintf(name, sizeof(name), "%s sharedb", prefix);
     printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
 
     start = current_timestamp();
@@ -289,14 +562,86 @@ static void perf_dh_ephemeral_only(int id)
     end = current_timestamp();
 
     elapsed = elapsed_to_seconds(start, end) / (double)PQ_DH_COUNT;
-    snprintf(name, sizeof(name), "%s shareda",
-             noise_id_to_name(NOISE_DH_CATEGORY, id));
+    snprintf(name, sizeof(name), "%s shareda", prefix);
     printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
 
     noise_dhstate_free(dh1);
     noise_dhstate_free(dh2);
 }
 
+/* Measure the performance of an ephemeral-only DH primitive (e.g NewHope) */
+static void perf_dh_ephemeral_only(int id)
+{
+    perf_dh_ephemeral_only_named(id, noise_id_to_name(NOISE_DH_CATEGORY, id));
+}
+
+/* Measure the performance of one NewHope polynomial operation */
+static void perf_newhope_op
+    (const char *op, const char *kernel, void (*func)(poly *r, const poly *b),
+     const poly *b)
+{
+    static poly r;
+    char name[64];
+    timestamp_t start, end;
+    int count;
+    double elapsed;
+
+    /* Repeat the operation on its own output; the coefficients end up
+       only partially reduced, but the cost is the same regardless */
+    for (count = 0; count < PARAM_N; ++count)
+        r.coeffs[count] = (uint16_t)((count * 4093) % PARAM_Q);
+    start = current_timestamp();
+    for (count = 0; count < NTT_COUNT; ++count)
+        (*func)(&r, b);
+    end = current_timestamp();
+
+    elapsed = elapsed_to_seconds(start, end) / (double)NTT_COUNT;
+    snprintf(name, sizeof(name), "%s %s", kernel, op);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+}
+
+static void newhope_ntt(poly *r, const poly *b)
+{
+    (void)b;
+    poly_ntt(r);
+}
+
+static void newhope_invntt(poly *r, const poly *b)
+{
+    (void)b;
+    poly_invntt(r);
+}
+
+static void newhope_pointwise(poly *r, const poly *b)
+{
+    poly_pointwise(r, r, b);
+}
+
+/* Measure the performance of the NewHope polynomial arithmetic and of
+   the key exchange as a whole with each of the implementations that can
+   be selected by CPU features */
+static void perf_newhope_kernels
+    (const perf_kernel_t *kernels, size_t num_kernels)
+{
+    static poly b;
+    int supported = noise_get_cpu_features();
+    size_t index;
+    int coeff;
+    for (coeff = 0; coeff < PARAM_N; ++coeff)
+        b.coeffs[coeff] = (uint16_t)((coeff * 7919) % PARAM_Q);
+    for (index = 0; index < num_kernels; ++index) {
+        if ((kernels[index].features & supported) != kernels[index].features)
+            continue;
+        noise_set_cpu_features(kernels[index].features);
+        perf_newhope_op("NTT", kernels[index].name, newhope_ntt, &b);
+        perf_newhope_op("invNTT", kernels[index].name, newhope_invntt, &b);
+        perf_newhope_op("pointwise", kernels[index].name,
+                        newhope_pointwise, &b);
+        perf_dh_ephemeral_only_named(NOISE_DH_NEWHOPE, kernels[index].name);
+    }
+    noise_set_cpu_features(-1);
+}
+
 /* Measure the performance of a signing primitive when deriving keys */
 static void perf_sign_derive(int id)
 {
@@ -397,6 +742,160 @@ static void perf_sign_verify(int id)
     noise_signstate_free(sign);
 }
 
+#define SIGN_BATCH_SIZE 64
+
+/* Measure the performance of a signing primitive when verifying
+   messages in batches */
+static void perf_sign_verify_batch(int id)
+{
+    char name[64];
+    NoiseSignState *sign;
+    uint8_t private_key[56];
+    uint8_t public_keys[SIGN_BATCH_SIZE][56];
+    uint8_t message[32];
+    uint8_t sigs[SIGN_BATCH_SIZE][56 * 2];
+    const uint8_t *public_key_ptrs[SIGN_BATCH_SIZE];
+    const uint8_t *message_ptrs[SIGN_BATCH_SIZE];
+    const uint8_t *sig_ptrs[SIGN_BATCH_SIZE];
+    size_t message_lens[SIGN_BATCH_SIZE];
+    int results[SIGN_BATCH_SIZE];
+    size_t key_len;
+    size_t public_key_len;
+    size_t sig_len;
+    timestamp_t start, end;
+    int count;
+    int index;
+    double elapsed;
+
+    if (noise_signstate_new_by_id(&sign, id) != NOISE_ERROR_NONE)
+        return;
+    key_len = noise_signstate_get_private_key_length(sign);
+    public_key_len = noise_signstate_get_public_key_length(sign);
+    sig_len = noise_signstate_get_signature_length(sign);
+    memset(message, 0x66, sizeof(message));
+    for (index = 0; index < SIGN_BATCH_SIZE; ++index) {
+        memset(private_key, 0xAA + index, sizeof(private_key));
+        noise_signstate_set_keypair_private(sign, private_key, key_len);
+        noise_signstate_get_public_key
+            (sign, public_keys[index], public_key_len);
+        noise_signstate_sign
+            (sign, message, sizeof(message), sigs[index], sig_len);
+        public_key_ptrs[index] = public_keys[index];
+        message_ptrs[index] = message;
+        sig_ptrs[index] = sigs[index];
+        message_lens[index] = sizeof(message);
+    }
+
+    start = current_timestamp();
+    for (count = 0; count < DH_COUNT; count += SIGN_BATCH_SIZE) {
+        noise_signstate_verify_batch
+            (sign, public_key_ptrs, message_ptrs, message_lens, sig_ptrs,
+             SIGN_BATCH_SIZE, results);
+    }
+    end = current_timestamp();
+
+    elapsed = elapsed_to_seconds(start, end) / (double)count;
+    snprintf(name, sizeof(name), "%s verify x%d",
+             noise_id_to_name(NOISE_SIGN_CATEGORY, id), SIGN_BATCH_SIZE);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    noise_signstate_free(sign);
+}
+
+#define HKDF_COUNT      100000
+#define HKDF_BATCH_SIZE 8
+
+/* Measure the performance of HKDF as used by MixKey() and Split(),
+   both one at a time and in batches of independent operations */
+static void perf_hkdf(int id)
+{
+    static uint8_t keys[HKDF_BATCH_SIZE][64];
+    static uint8_t data[HKDF_BATCH_SIZE][32];
+    static uint8_t output1[HKDF_BATCH_SIZE][64];
+    static uint8_t output2[HKDF_BATCH_SIZE][64];
+    const uint8_t *key_ptrs[HKDF_BATCH_SIZE];
+    const uint8_t *data_ptrs[HKDF_BATCH_SIZE];
+    uint8_t *output1_ptrs[HKDF_BATCH_SIZE];
+    uint8_t *output2_ptrs[HKDF_BATCH_SIZE];
+    NoiseHashState *hash;
+    char name[64];
+    timestamp_t start, end;
+    long count;
+    size_t hash_len, index;
+    double elapsed;
+
+    if (noise_hashstate_new_by_id(&hash, id) != NOISE_ERROR_NONE)
+        return;
+    hash_len = noise_hashstate_get_hash_length(hash);
+    memset(keys, 0xAA, sizeof(keys));
+    memset(data, 0x66, sizeof(data));
+    for (index = 0; index < HKDF_BATCH_SIZE; ++index) {
+        key_ptrs[index] = keys[index];
+        data_ptrs[index] = data[index];
+        output1_ptrs[index] = output1[index];
+        output2_ptrs[index] = output2[index];
+    }
+
+    start = current_timestamp();
+    for (count = 0; count < HKDF_COUNT; ++count) {
+        noise_hashstate_hkdf(hash, keys[0], hash_len, data[0], sizeof(data[0]),
+                             output1[0], hash_len, output2[0], hash_len);
+    }
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)HKDF_COUNT;
+    snprintf(name, sizeof(name), "%s HKDF",
+             noise_id_to_name(NOISE_HASH_CATEGORY, id));
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    start = current_timestamp();
+    for (count = 0; count < HKDF_COUNT; count += HKDF_BATCH_SIZE) {
+        noise_hashstate_hkdf_batch
+            (hash, key_ptrs, hash_len, data_ptrs, sizeof(data[0]),
+             output1_ptrs, hash_len, output2_ptrs, hash_len, HKDF_BATCH_SIZE);
+    }
+    end = current_timestamp();
+    elapsed = elapsed_to_seconds(start, end) / (double)count;
+    snprintf(name, sizeof(name), "%s HKDF x%d",
+             noise_id_to_name(NOISE_HASH_CATEGORY, id), HKDF_BATCH_SIZE);
+    printf("%-20s%8.2f          %8.2f\n", name, 1.0 / elapsed, units / elapsed);
+
+    noise_hashstate_free(hash);
+}
+
+/* Implementations of ChaCha20 that can be selected at runtime */
+static perf_kernel_t const chacha_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_SSSE3,                                   "SSSE3"},
+    {NOISE_CPU_SSSE3 | NOISE_CPU_AVX2,                  "AVX2"},
+    {NOISE_CPU_SSSE3 | NOISE_CPU_AVX2 | NOISE_CPU_AVX512, "AVX-512"}
+};
+static perf_kernel_t const blake2s_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_SSE41,                                   "SSE4.1"},
+    {NOISE_CPU_SSE41 | NOISE_CPU_AVX2,                  "AVX2"}
+};
+static perf_kernel_t const blake2b_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_AVX2,                                    "AVX2"}
+};
+static perf_kernel_t const sha256_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_SSE41 | NOISE_CPU_SHA,                   "SHA-NI"},
+    {NOISE_CPU_AVX2,                                    "AVX2"}
+};
+static perf_kernel_t const sha512_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_AVX2,                                    "AVX2"}
+};
+static perf_kernel_t const newhope_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_AVX2,                                    "AVX2"}
+};
+static perf_kernel_t const aesgcm_kernels[] = {
+    {0,                                                 "portable"},
+    {NOISE_CPU_SSSE3 | NOISE_CPU_AESNI | NOISE_CPU_PCLMUL, "AES-NI"}
+};
+
 int main(int argc, char *argv[])
 {
     if (noise_init() != NOISE_ERROR_NONE) {
@@ -421,6 +920,36 @@ int main(int argc, char *argv[])
     perf_cipher(NOISE_CIPHER_CHACHAPOLY);
     perf_cipher(NOISE_CIPHER_AESGCM);
 
+    /* Compare the implementations that are selected by CPU features */
+    printf("\n");
+    printf("Implementation        MB/sec         MD5 units\n");
+    perf_cipher_kernels(NOISE_CIPHER_CHACHAPOLY, chacha_kernels,
+                        sizeof(chacha_kernels) / sizeof(chacha_kernels[0]));
+    perf_cipher_kernels(NOISE_CIPHER_AESGCM, aesgcm_kernels,
+                        sizeof(aesgcm_kernels) / sizeof(aesgcm_kernels[0]));
+    perf_cipher_large(NOISE_CIPHER_CHACHAPOLY);
+    perf_cipher_large(NOISE_CIPHER_AESGCM);
+    perf_hash_kernels(NOISE_HASH_BLAKE2s, blake2s_kernels,
+                      sizeof(blake2s_kernels) / sizeof(blake2s_kernels[0]));
+    perf_hash_kernels(NOISE_HASH_BLAKE2b, blake2b_kernels,
+                      sizeof(blake2b_kernels) / sizeof(blake2b_kernels[0]));
+    perf_hash_kernels(NOISE_HASH_SHA256, sha256_kernels,
+                      sizeof(sha256_kernels) / sizeof(sha256_kernels[0]));
+    perf_hash_kernels(NOISE_HASH_SHA512, sha512_kernels,
+                      sizeof(sha512_kernels) / sizeof(sha512_kernels[0]));
+
+    /* Measure the performance of the memory helpers at key and block sizes */
+    printf("\n");
+    printf("Memory helper         MB/sec         MD5 units\n");
+    perf_memory(32);
+    perf_memory(BLOCK_SIZE);
+
+#if !USE_LIBSODIUM
+    /* Cost model for choosing the portable GHASH engine */
+    printf("\n");
+    perf_ghash_engines();
+#endif
+
     /* Measure the performance of the DH primitives */
     printf("\n");
     printf("Pubkey algorithm     ops/sec         MD5 units\n");
@@ -434,6 +963,21 @@ int main(int argc, char *argv[])
     perf_sign_derive(NOISE_SIGN_ED25519);
     perf_sign_sign(NOISE_SIGN_ED25519);
     perf_sign_verify(NOISE_SIGN_ED25519);
+    perf_sign_verify_batch(NOISE_SIGN_ED25519);
+
+    /* Measure the performance of key derivation */
+    printf("\n");
+    printf("Key derivation       ops/sec         MD5 units\n");
+    perf_hkdf(NOISE_HASH_BLAKE2s);
+    perf_hkdf(NOISE_HASH_BLAKE2b);
+    perf_hkdf(NOISE_HASH_SHA256);
+    perf_hkdf(NOISE_HASH_SHA512);
+
+    /* Measure the performance of the NewHope implementations */
+    printf("\n");
+    printf("NewHope              ops/sec         MD5 units\n");
+    perf_newhope_kernels
+        (newhope_kernels, sizeof(newhope_kernels) / sizeof(newhope_kernels[0]));
 
     /* Done */
     return 0;
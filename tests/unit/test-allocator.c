@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "test-helpers.h"
+#include <noise/keys.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+/* Allocator that counts the blocks that pass through it.  Like a sized
+   deallocator, it checks that each block is freed with the same size
+   that was used to allocate it */
+typedef struct
+{
+    int allocs;
+    int secure_allocs;
+    int frees;
+    int outstanding;
+    int fail_after;
+
+} CountingAllocator;
+
+#define COUNTING_HEADER 16
+
+static void *counting_malloc(size_t size)
+{
+    uint8_t *block = (uint8_t *)malloc(size + COUNTING_HEADER);
+    if (!block)
+        return 0;
+    memcpy(block, &size, sizeof(size));
+    return block + COUNTING_HEADER;
+}
+
+static void *counting_alloc(void *ctx, size_t size)
+{
+    CountingAllocator *counts = (CountingAllocator *)ctx;
+    if (counts->fail_after >= 0 && counts->fail_after-- == 0)
+        return 0;
+    ++(counts->allocs);
+    ++(counts->outstanding);
+    return counting_malloc(size);
+}
+
+static void *counting_secure_alloc(void *ctx, size_t size)
+{
+    CountingAllocator *counts = (CountingAllocator *)ctx;
+    if (counts->fail_after >= 0 && counts->fail_after-- == 0)
+        return 0;
+    ++(counts->secure_allocs);
+    ++(counts->outstanding);
+    return counting_malloc(size);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size)
+{
+    CountingAllocator *counts = (CountingAllocator *)ctx;
+    uint8_t *block = ((uint8_t *)ptr) - COUNTING_HEADER;
+    size_t alloc_size;
+    ++(counts->frees);
+    --(counts->outstanding);
+    memcpy(&alloc_size, block, sizeof(alloc_size));
+    compare(size, alloc_size);
+    verify(noise_is_zero(ptr, size));
+    free(block);
+}
+
+#if HAVE_PTHREAD
+
+/* State that is shared with a thread that holds a pooled object */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stage;
+    int error;
+
+} PoolThreadState;
+
+/* Pools an object and then waits until the main thread releases it.
+   The object is freed from the thread's pool when the thread exits */
+static void *pool_thread(void *arg)
+{
+    PoolThreadState *ts = (PoolThreadState *)arg;
+    NoiseCipherState *cipher;
+    if (noise_cipherstate_new_by_id(&cipher, NOISE_CIPHER_CHACHAPOLY)
+            == NOISE_ERROR_NONE)
+        noise_cipherstate_free(cipher);
+    else
+        ts->error = 1;
+    pthread_mutex_lock(&(ts->lock));
+    ts->stage = 1;
+    pthread_cond_broadcast(&(ts->cond));
+    while (ts->stage < 2)
+        pthread_cond_wait(&(ts->cond), &(ts->lock));
+    pthread_mutex_unlock(&(ts->lock));
+    return 0;
+}
+
+#endif
+
+static void allocator_check_objects(void)
+{
+    CountingAllocator counts;
+    NoiseAllocator allocator;
+    NoiseHandshakeState *state;
+    Noise_Certificate *cert;
+    Noise_SubjectInfo *subject;
+    Noise_PublicKeyInfo *key;
+    Noise_Signature *sig;
+    NoiseProtobuf pbuf;
+    uint8_t encoded[256];
+    uint8_t *data;
+    size_t size;
+
+    memset(&counts, 0, sizeof(counts));
+    counts.fail_after = -1;
+    allocator.alloc = counting_alloc;
+    allocator.secure_alloc = counting_secure_alloc;
+    allocator.free = counting_free;
+    allocator.ctx = &counts;
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_NONE);
+
+    /* Objects hold secrets and come from the secure allocator */
+    compare(noise_handshakestate_new_by_name
+                (&state, "Noise_XX_25519_AESGCM_SHA256", NOISE_ROLE_INITIATOR),
+            NOISE_ERROR_NONE);
+    verify(counts.secure_allocs >= 6);
+    compare(counts.allocs, 0);
+
+    /* Plain buffers come from the regular allocator */
+    compare(noise_handshakestate_set_prologue(state, "prologue", 8),
+            NOISE_ERROR_NONE);
+    compare(counts.allocs, 1);
+    compare(noise_handshakestate_free(state), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+
+    /* Protobuf objects, fields, and arrays */
+    counts.secure_allocs = 0;
+    compare(Noise_Certificate_new(&cert), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_get_new_subject(cert, &subject),
+            NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_set_id(subject, "jane@example.com", 16),
+            NOISE_ERROR_NONE);
+    compare(Noise_Certificate_add_signatures(cert, &sig), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_add_signatures(cert, &sig), NOISE_ERROR_NONE);
+    verify(counts.allocs >= 6);
+    compare(counts.secure_allocs, 0);
+    compare(Noise_Certificate_free(cert), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+
+    /* String fields have a NUL terminator and empty byte fields still
+       allocate a byte; both are freed with their allocated size */
+    compare(Noise_Certificate_new(&cert), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_get_new_subject(cert, &subject),
+            NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_set_id(subject, "jane@example.com", 16),
+            NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_set_id(subject, "jane", 4), NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_set_name(subject, "", 0), NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_add_keys(subject, &key), NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_algorithm(key, "Ed25519", 7),
+            NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_key(key, "", 0), NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_key(key, "key", 3), NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_key(key, "", 0), NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_clear_algorithm(key), NOISE_ERROR_NONE);
+    compare(noise_protobuf_prepare_output(&pbuf, encoded, sizeof(encoded)),
+            NOISE_ERROR_NONE);
+    compare(Noise_Certificate_write(&pbuf, 0, cert), NOISE_ERROR_NONE);
+    compare(noise_protobuf_finish_output(&pbuf, &data, &size),
+            NOISE_ERROR_NONE);
+    compare(Noise_Certificate_free(cert), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+
+    /* Strings and byte fields that are allocated while parsing */
+    compare(noise_protobuf_prepare_input(&pbuf, data, size), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_read(&pbuf, 0, &cert), NOISE_ERROR_NONE);
+    compare(noise_protobuf_finish_input(&pbuf), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_free(cert), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+
+    /* Failures from the allocator are reported as out of memory */
+    counts.fail_after = 3;
+    state = (NoiseHandshakeState *)8;
+    compare(noise_handshakestate_new_by_name
+                (&state, "Noise_XX_25519_AESGCM_SHA256", NOISE_ROLE_INITIATOR),
+            NOISE_ERROR_NO_MEMORY);
+    compare(counts.outstanding, 0);
+    counts.fail_after = -1;
+
+    /* Without a secure allocator, everything uses the regular one */
+    allocator.secure_alloc = 0;
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_NONE);
+    counts.allocs = 0;
+    counts.secure_allocs = 0;
+    compare(noise_handshakestate_new_by_name
+                (&state, "Noise_NN_25519_ChaChaPoly_BLAKE2s",
+                 NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    verify(counts.allocs >= 4);
+    compare(counts.secure_allocs, 0);
+    compare(noise_handshakestate_free(state), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+
+    /* Go back to the system allocator */
+    compare(noise_set_allocator(0), NOISE_ERROR_NONE);
+    counts.allocs = 0;
+    compare(noise_handshakestate_new_by_name
+                (&state, "Noise_NN_25519_ChaChaPoly_BLAKE2s",
+                 NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_free(state), NOISE_ERROR_NONE);
+    compare(counts.allocs, 0);
+}
+
+static void allocator_check_pools(void)
+{
+    CountingAllocator counts;
+    NoiseAllocator allocator;
+    NoiseObjectPoolStats before;
+    NoiseObjectPoolStats stats;
+    NoiseCipherState *cipher;
+    NoiseCipherState *ciphers[6];
+    void *small[4];
+    void *large[4];
+    void *first;
+    int index;
+#if HAVE_PTHREAD
+    PoolThreadState ts;
+    pthread_t thread;
+#endif
+
+    memset(&counts, 0, sizeof(counts));
+    counts.fail_after = -1;
+    allocator.alloc = counting_alloc;
+    allocator.secure_alloc = counting_secure_alloc;
+    allocator.free = counting_free;
+    allocator.ctx = &counts;
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_NONE);
+
+    /* Pools are disabled by default */
+    compare(noise_cipherstate_new_by_id(&cipher, NOISE_CIPHER_CHACHAPOLY),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_free(cipher), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.cached, 0);
+
+    /* A freed object is recycled for the next object of the same size */
+    compare(noise_set_object_pool_limit(4), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_new_by_id(&cipher, NOISE_CIPHER_CHACHAPOLY),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_init_key(cipher, (const uint8_t *)
+                "0123456789abcdef0123456789abcdef", 32),
+            NOISE_ERROR_NONE);
+    first = cipher;
+    compare(noise_cipherstate_free(cipher), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 1);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.sizes, 1);
+    compare(stats.cached, 1);
+    compare(stats.hits, 0);
+    compare(noise_cipherstate_new_by_id(&cipher, NOISE_CIPHER_CHACHAPOLY),
+            NOISE_ERROR_NONE);
+    verify(cipher == first);
+    compare(noise_cipherstate_has_key(cipher), 0);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.cached, 0);
+    compare(stats.hits, 1);
+    compare(noise_cipherstate_free(cipher), NOISE_ERROR_NONE);
+
+    /* Only "limit" objects of each size are kept */
+    for (index = 0; index < 6; ++index) {
+        compare(noise_cipherstate_new_by_id
+                    (&(ciphers[index]), NOISE_CIPHER_AESGCM),
+                NOISE_ERROR_NONE);
+    }
+    for (index = 0; index < 6; ++index)
+        compare(noise_cipherstate_free(ciphers[index]), NOISE_ERROR_NONE);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.sizes, 2);
+    compare(stats.cached, 5);
+    compare(stats.high_water, 5);
+
+    compare(noise_trim_object_pool(0), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+
+    /* Each size has its own pool, so freeing objects of one size
+       does not satisfy allocations of another */
+    compare(noise_set_object_pool_limit(3), NOISE_ERROR_NONE);
+    compare(noise_get_object_pool_stats(&before), NOISE_ERROR_NONE);
+    compare(before.cached, 0);
+    for (index = 0; index < 4; ++index) {
+        small[index] = noise_new_object(48);
+        large[index] = noise_new_object(80);
+        verify(small[index] != 0);
+        verify(large[index] != 0);
+    }
+    for (index = 0; index < 4; ++index)
+        noise_free_object(small[index], 48);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.sizes, before.sizes + 1);
+    compare(stats.cached, 3);
+    compare(stats.cached_bytes, 3 * 48);
+    compare(stats.hits, before.hits);
+    compare(stats.misses, before.misses + 8);
+    for (index = 0; index < 4; ++index)
+        noise_free_object(large[index], 80);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.sizes, before.sizes + 2);
+    compare(stats.cached, 6);
+    compare(stats.cached_bytes, 3 * 48 + 3 * 80);
+    compare(stats.high_water, 6);
+    compare(counts.outstanding, 6);
+
+    /* Allocations of a size are hits until that size's pool is empty */
+    for (index = 0; index < 4; ++index)
+        small[index] = noise_new_object(48);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.cached, 3);
+    compare(stats.cached_bytes, 3 * 80);
+    compare(stats.hits, before.hits + 3);
+    compare(stats.misses, before.misses + 9);
+    for (index = 0; index < 4; ++index)
+        noise_free_object(small[index], 48);
+    compare(counts.outstanding, 6);
+
+    /* Trimming frees the excess of each size and resets the high-water
+       mark */
+    compare(noise_trim_object_pool(1), NOISE_ERROR_NONE);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.cached, 2);
+    compare(stats.cached_bytes, 48 + 80);
+    compare(stats.high_water, 2);
+    compare(counts.outstanding, 2);
+    compare(noise_trim_object_pool(0), NOISE_ERROR_NONE);
+    compare(noise_get_object_pool_stats(&stats), NOISE_ERROR_NONE);
+    compare(stats.cached, 0);
+    compare(stats.cached_bytes, 0);
+    compare(counts.outstanding, 0);
+
+#if HAVE_PTHREAD
+    /* The allocator cannot change while another thread pools an object */
+    memset(&ts, 0, sizeof(ts));
+    compare(pthread_mutex_init(&(ts.lock), 0), 0);
+    compare(pthread_cond_init(&(ts.cond), 0), 0);
+    compare(pthread_create(&thread, 0, pool_thread, &ts), 0);
+    pthread_mutex_lock(&(ts.lock));
+    while (ts.stage < 1)
+        pthread_cond_wait(&(ts.cond), &(ts.lock));
+    pthread_mutex_unlock(&(ts.lock));
+    compare(ts.error, 0);
+    compare(counts.outstanding, 1);
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_INVALID_STATE);
+    pthread_mutex_lock(&(ts.lock));
+    ts.stage = 2;
+    pthread_cond_broadcast(&(ts.cond));
+    pthread_mutex_unlock(&(ts.lock));
+    compare(pthread_join(thread, 0), 0);
+    pthread_cond_destroy(&(ts.cond));
+    pthread_mutex_destroy(&(ts.lock));
+    compare(counts.outstanding, 0);
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_NONE);
+#endif
+
+    /* Disabling the pools empties them */
+    compare(noise_cipherstate_new_by_id(&cipher, NOISE_CIPHER_CHACHAPOLY),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_free(cipher), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 1);
+    compare(noise_set_object_pool_limit(0), NOISE_ERROR_NONE);
+    compare(counts.outstanding, 0);
+    compare(noise_set_allocator(0), NOISE_ERROR_NONE);
+}
+
+static void allocator_check_errors(void)
+{
+    NoiseAllocator allocator;
+
+    allocator.alloc = counting_alloc;
+    allocator.secure_alloc = counting_secure_alloc;
+    allocator.free = 0;
+    allocator.ctx = 0;
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_INVALID_PARAM);
+    allocator.alloc = 0;
+    allocator.free = counting_free;
+    compare(noise_set_allocator(&allocator), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_get_object_pool_stats(0), NOISE_ERROR_INVALID_PARAM);
+}
+
+void test_allocator(void)
+{
+    allocator_check_objects();
+    allocator_check_pools();
+    allocator_check_errors();
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "test-helpers.h"
+#include <noise/keys.h>
+
+#define MAX_ENCODED_LEN 4096
+#define MAX_STATUS      300
+
+/* Encodes an object with a field tag in the canonical format */
+static size_t encode_field
+    (int (*func)(NoiseProtobuf *, int, const void *), int tag,
+     const void *obj, uint8_t *data)
+{
+    NoiseProtobuf pbuf;
+    uint8_t *out;
+    size_t size;
+    compare(noise_protobuf_prepare_output(&pbuf, data, MAX_ENCODED_LEN),
+            NOISE_ERROR_NONE);
+    compare((*func)(&pbuf, tag, obj), NOISE_ERROR_NONE);
+    compare(noise_protobuf_finish_output_shift(&pbuf, &out, &size),
+            NOISE_ERROR_NONE);
+    return size;
+}
+
+/* Creates a certificate for a subject with a single Ed25519 key */
+static Noise_Certificate *create_cert(const char *id, NoiseSignState *key)
+{
+    Noise_Certificate *cert = 0;
+    Noise_SubjectInfo *subject;
+    Noise_PublicKeyInfo *info;
+    uint8_t public_key[32];
+
+    compare(noise_signstate_get_public_key
+                (key, public_key, sizeof(public_key)),
+            NOISE_ERROR_NONE);
+    compare(Noise_Certificate_new(&cert), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_set_version(cert, 1), NOISE_ERROR_NONE);
+    compare(Noise_Certificate_get_new_subject(cert, &subject),
+            NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_set_id(subject, id, strlen(id)),
+            NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_add_keys(subject, &info), NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_algorithm(info, "Ed25519", 7),
+            NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_key(info, public_key, sizeof(public_key)),
+            NOISE_ERROR_NONE);
+    return cert;
+}
+
+/* Adds a signature to a certificate */
+static Noise_Signature *sign_cert
+    (Noise_Certificate *cert, NoiseSignState *key, const char *hash_name,
+     uint8_t nonce)
+{
+    static uint8_t subject_data[MAX_ENCODED_LEN];
+    static uint8_t extra_data[MAX_ENCODED_LEN];
+    Noise_Signature *sig;
+    Noise_PublicKeyInfo *info;
+    Noise_ExtraSignedInfo *extra;
+    NoiseHashState *hash;
+    uint8_t public_key[32];
+    uint8_t digest[64];
+    uint8_t signature[64];
+    size_t subject_len;
+    size_t extra_len;
+    size_t hash_len;
+
+    compare(noise_signstate_get_public_key
+                (key, public_key, sizeof(public_key)),
+            NOISE_ERROR_NONE);
+    compare(Noise_Certificate_add_signatures(cert, &sig), NOISE_ERROR_NONE);
+    compare(Noise_Signature_get_new_signing_key(sig, &info),
+            NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_algorithm(info, "Ed25519", 7),
+            NOISE_ERROR_NONE);
+    compare(Noise_PublicKeyInfo_set_key(info, public_key, sizeof(public_key)),
+            NOISE_ERROR_NONE);
+    compare(Noise_Signature_set_hash_algorithm
+                (sig, hash_name, strlen(hash_name)),
+            NOISE_ERROR_NONE);
+    compare(Noise_Signature_get_new_extra_signed_info(sig, &extra),
+            NOISE_ERROR_NONE);
+    memset(digest, nonce, 16);
+    compare(Noise_ExtraSignedInfo_set_nonce(extra, digest, 16),
+            NOISE_ERROR_NONE);
+    compare(Noise_ExtraSignedInfo_set_valid_from
+                (extra, "2016-01-01T00:00:00Z", 20),
+            NOISE_ERROR_NONE);
+
+    /* The signature covers the subject and extra signed information */
+    subject_len = encode_field
+        ((int (*)(NoiseProtobuf *, int, const void *))Noise_SubjectInfo_write,
+         2, Noise_Certificate_get_subject(cert), subject_data);
+    extra_len = encode_field
+        ((int (*)(NoiseProtobuf *, int, const void *))
+            Noise_ExtraSignedInfo_write,
+         5, extra, extra_data);
+    compare(noise_hashstate_new_by_name(&hash, hash_name), NOISE_ERROR_NONE);
+    hash_len = noise_hashstate_get_hash_length(hash);
+    compare(noise_hashstate_hash_two
+                (hash, subject_data, subject_len, extra_data, extra_len,
+                 digest, hash_len),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_sign
+                (key, digest, hash_len, signature, sizeof(signature)),
+            NOISE_ERROR_NONE);
+    compare(Noise_Signature_set_signature(sig, signature, sizeof(signature)),
+            NOISE_ERROR_NONE);
+    noise_hashstate_free(hash);
+    return sig;
+}
+
+/* Check verification of a chain of root, intermediate, and leaf */
+static void certificates_check_chain(void)
+{
+    static NoiseSignatureStatus status[MAX_STATUS];
+    NoiseSignState *root_key;
+    NoiseSignState *inter_key;
+    NoiseSignState *leaf_key;
+    NoiseSignState *other_key;
+    Noise_CertificateChain *chain;
+    Noise_Certificate *root;
+    Noise_Certificate *inter;
+    Noise_Certificate *leaf;
+    Noise_Signature *sig;
+    NoiseVerifyCache *cache;
+    size_t num_status;
+    size_t count;
+    uint64_t hits;
+    uint64_t misses;
+    uint8_t *data;
+
+    compare(noise_signstate_new_by_id(&root_key, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_new_by_id(&inter_key, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_new_by_id(&leaf_key, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_new_by_id(&other_key, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_generate_keypair(root_key), NOISE_ERROR_NONE);
+    compare(noise_signstate_generate_keypair(inter_key), NOISE_ERROR_NONE);
+    compare(noise_signstate_generate_keypair(leaf_key), NOISE_ERROR_NONE);
+    compare(noise_signstate_generate_keypair(other_key), NOISE_ERROR_NONE);
+
+    /* Build the chain with the leaf first */
+    compare(Noise_CertificateChain_new(&chain), NOISE_ERROR_NONE);
+    leaf = create_cert("leaf@example.com", leaf_key);
+    sign_cert(leaf, inter_key, "BLAKE2b", 1);
+    sign_cert(leaf, other_key, "SHA256", 2);
+    inter = create_cert("inter@example.com", inter_key);
+    sign_cert(inter, root_key, "SHA512", 3);
+    root = create_cert("root@example.com", root_key);
+    sign_cert(root, root_key, "BLAKE2s", 4);
+    compare(Noise_CertificateChain_insert_certs(chain, 0, leaf),
+            NOISE_ERROR_NONE);
+    compare(Noise_CertificateChain_insert_certs(chain, 1, inter),
+            NOISE_ERROR_NONE);
+    compare(Noise_CertificateChain_insert_certs(chain, 2, root),
+            NOISE_ERROR_NONE);
+    compare(noise_certificate_chain_count_signatures(chain), 4);
+
+    /* All signatures are valid, and the signers are located in the chain */
+    memset(status, 0xAA, sizeof(status));
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_NONE);
+    compare(num_status, 4);
+    compare(status[0].cert_index, 0);
+    compare(status[0].signature_index, 0);
+    compare(status[0].signer_index, 1);
+    compare(status[0].status, NOISE_ERROR_NONE);
+    compare(status[1].cert_index, 0);
+    compare(status[1].signature_index, 1);
+    compare(status[1].signer_index, -1);
+    compare(status[1].status, NOISE_ERROR_NONE);
+    compare(status[2].cert_index, 1);
+    compare(status[2].signature_index, 0);
+    compare(status[2].signer_index, 2);
+    compare(status[2].status, NOISE_ERROR_NONE);
+    compare(status[3].cert_index, 2);
+    compare(status[3].signature_index, 0);
+    compare(status[3].signer_index, 2);
+    compare(status[3].status, NOISE_ERROR_NONE);
+
+    /* A second pass through a cache skips the public key operations */
+    compare(noise_verify_cache_new(&cache, 16), NOISE_ERROR_NONE);
+    compare(noise_certificate_chain_verify
+                (chain, cache, status, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_NONE);
+    compare(noise_certificate_chain_verify
+                (chain, cache, status, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_NONE);
+    compare(num_status, 4);
+    compare(noise_verify_cache_get_stats(cache, &count, &hits, &misses),
+            NOISE_ERROR_NONE);
+    compare(count, 4);
+    compare(hits, 4);
+    compare(misses, 4);
+    compare(noise_verify_cache_free(cache), NOISE_ERROR_NONE);
+
+    /* Single certificates can be verified on their own */
+    compare(noise_certificate_count_signatures(leaf), 2);
+    compare(noise_certificate_verify
+                (leaf, 0, status, MAX_STATUS, &num_status),
+            NOISE_ERROR_NONE);
+    compare(num_status, 2);
+    compare(status[0].signer_index, -1);
+    compare(noise_certificate_verify
+                (root, 0, status, MAX_STATUS, &num_status),
+            NOISE_ERROR_NONE);
+    compare(num_status, 1);
+    compare(status[0].signer_index, 0);
+
+    /* Modifying the subject invalidates all signatures on the certificate */
+    compare(Noise_SubjectInfo_set_name
+                (Noise_Certificate_get_subject(leaf), "Mallory", 7),
+            NOISE_ERROR_NONE);
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    compare(num_status, 4);
+    compare(status[0].status, NOISE_ERROR_INVALID_SIGNATURE);
+    compare(status[1].status, NOISE_ERROR_INVALID_SIGNATURE);
+    compare(status[2].status, NOISE_ERROR_NONE);
+    compare(status[3].status, NOISE_ERROR_NONE);
+    compare(Noise_SubjectInfo_clear_name(Noise_Certificate_get_subject(leaf)),
+            NOISE_ERROR_NONE);
+
+    /* Corrupted signatures and unsupported or malformed signature blocks */
+    sig = Noise_Certificate_get_at_signatures(inter, 0);
+    data = (uint8_t *)Noise_Signature_get_signature(sig);
+    data[10] ^= 0x01;
+    sig = Noise_Certificate_get_at_signatures(root, 0);
+    compare(Noise_Signature_set_hash_algorithm(sig, "MD5", 3),
+            NOISE_ERROR_NONE);
+    sig = Noise_Certificate_get_at_signatures(leaf, 1);
+    compare(Noise_Signature_set_signature(sig, data, 32), NOISE_ERROR_NONE);
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    compare(status[0].status, NOISE_ERROR_NONE);
+    compare(status[1].status, NOISE_ERROR_INVALID_LENGTH);
+    compare(status[2].status, NOISE_ERROR_INVALID_SIGNATURE);
+    compare(status[3].status, NOISE_ERROR_UNKNOWN_NAME);
+    sig = Noise_Certificate_get_at_signatures(leaf, 0);
+    compare(Noise_Signature_clear_signature(sig), NOISE_ERROR_NONE);
+    compare(noise_certificate_verify
+                (leaf, 0, status, MAX_STATUS, &num_status),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    compare(status[0].status, NOISE_ERROR_INVALID_FORMAT);
+
+    /* Bad parameters */
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, 3, &num_status, 1),
+            NOISE_ERROR_INVALID_LENGTH);
+    compare(num_status, 0);
+    compare(noise_certificate_chain_verify
+                (0, 0, status, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_certificate_chain_verify
+                (chain, 0, 0, MAX_STATUS, &num_status, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, MAX_STATUS, 0, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_certificate_verify
+                (0, 0, status, MAX_STATUS, &num_status),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_certificate_chain_count_signatures(0), 0);
+    compare(noise_certificate_count_signatures(0), 0);
+
+    Noise_CertificateChain_free(chain);
+    noise_signstate_free(root_key);
+    noise_signstate_free(inter_key);
+    noise_signstate_free(leaf_key);
+    noise_signstate_free(other_key);
+}
+
+/* Check verification of a large chain across multiple threads */
+static void certificates_check_threads(void)
+{
+    static NoiseSignatureStatus status[MAX_STATUS];
+    NoiseSignState *key;
+    Noise_CertificateChain *chain;
+    Noise_Certificate *cert = 0;
+    Noise_Signature *sig;
+    size_t num_status;
+    size_t index;
+    uint8_t *data;
+
+    compare(noise_signstate_new_by_id(&key, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_generate_keypair(key), NOISE_ERROR_NONE);
+    compare(Noise_CertificateChain_new(&chain), NOISE_ERROR_NONE);
+    for (index = 0; index < MAX_STATUS; ++index) {
+        if ((index % 30) == 0) {
+            cert = create_cert("subject@example.com", key);
+            compare(Noise_CertificateChain_insert_certs
+                        (chain, index / 30, cert),
+                    NOISE_ERROR_NONE);
+        }
+        sign_cert(cert, key, "BLAKE2b", (uint8_t)index);
+    }
+
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, MAX_STATUS, &num_status, 4),
+            NOISE_ERROR_NONE);
+    compare(num_status, MAX_STATUS);
+    for (index = 0; index < MAX_STATUS; ++index)
+        compare(status[index].status, NOISE_ERROR_NONE);
+
+    /* Break a signature in each of the thread slices */
+    for (index = 10; index < MAX_STATUS; index += 64) {
+        cert = Noise_CertificateChain_get_at_certs(chain, index / 30);
+        sig = Noise_Certificate_get_at_signatures(cert, index % 30);
+        data = (uint8_t *)Noise_Signature_get_signature(sig);
+        data[0] ^= 0x01;
+    }
+    compare(noise_certificate_chain_verify
+                (chain, 0, status, MAX_STATUS, &num_status, 4),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    for (index = 0; index < MAX_STATUS; ++index) {
+        size_t sig_index = index - (index / 30) * 30;
+        compare(status[index].cert_index, index / 30);
+        compare(status[index].signature_index, sig_index);
+        compare(status[index].signer_index, 0);
+        if ((index % 64) == 10)
+            compare(status[index].status, NOISE_ERROR_INVALID_SIGNATURE);
+        else
+            compare(status[index].status, NOISE_ERROR_NONE);
+    }
+
+    Noise_CertificateChain_free(chain);
+    noise_signstate_free(key);
+}
+
+void test_certificates(void)
+{
+    certificates_check_chain();
+    certificates_check_threads();
+}
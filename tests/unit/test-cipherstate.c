@@ -21,6 +21,9 @@
  */
 
 #include "test-helpers.h"
+#if !USE_LIBSODIUM
+#include "crypto/ghash/ghash.h"
+#endif
 
 #define MAX_KEY_LEN 32
 #define MAX_AD_LEN 32
@@ -310,8 +313,294 @@ static void cipherstate_check_errors(void)
     verify(state == NULL);
 }
 
+#define BATCH_PACKETS 11
+
+/* Check that batch encryption and decryption match the per-packet API */
+static void cipherstate_check_batch(int id)
+{
+    static uint8_t const key[32] = {
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+        0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,
+        0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+        0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20
+    };
+    NoiseCipherState *single;
+    NoiseCipherState *batch;
+    NoiseBuffer mbuf;
+    NoiseBuffer bufs[BATCH_PACKETS];
+    uint8_t expected[BATCH_PACKETS][MAX_CIPHER_DATA + MAX_MAC_LEN];
+    uint8_t packets[BATCH_PACKETS][MAX_CIPHER_DATA + MAX_MAC_LEN];
+    size_t sizes[BATCH_PACKETS];
+    size_t mac_len;
+    size_t index;
+
+    compare(noise_cipherstate_new_by_id(&single, id), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_new_by_id(&batch, id), NOISE_ERROR_NONE);
+    mac_len = noise_cipherstate_get_mac_length(single);
+
+    /* Without a key the packets are passed through as-is */
+    for (index = 0; index < BATCH_PACKETS; ++index) {
+        sizes[index] = (index * 37) % 200;
+        memset(packets[index], (int)index, sizes[index]);
+        noise_buffer_set_inout(bufs[index], packets[index], sizes[index],
+                               sizeof(packets[index]));
+    }
+    compare(noise_cipherstate_encrypt_batch(batch, bufs, BATCH_PACKETS),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_PACKETS; ++index)
+        compare(bufs[index].size, sizes[index]);
+
+    /* Encrypt the packets one at a time to get the expected output */
+    compare(noise_cipherstate_init_key(single, key, sizeof(key)),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_init_key(batch, key, sizeof(key)),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_set_nonce(single, 42), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_set_nonce(batch, 42), NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_PACKETS; ++index) {
+        memcpy(expected[index], packets[index], sizes[index]);
+        noise_buffer_set_inout(mbuf, expected[index], sizes[index],
+                               sizeof(expected[index]));
+        compare(noise_cipherstate_encrypt(single, &mbuf), NOISE_ERROR_NONE);
+        compare(mbuf.size, sizes[index] + mac_len);
+    }
+
+    /* Encrypt the same packets as a batch and compare */
+    compare(noise_cipherstate_encrypt_batch(batch, bufs, BATCH_PACKETS),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_PACKETS; ++index) {
+        compare_blocks(bufs[index].data, bufs[index].size,
+                       expected[index], sizes[index] + mac_len);
+    }
+
+    /* Decrypt the expected ciphertexts as a batch */
+    compare(noise_cipherstate_init_key(batch, key, sizeof(key)),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_set_nonce(batch, 42), NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_PACKETS; ++index) {
+        memcpy(packets[index], expected[index], sizes[index] + mac_len);
+        noise_buffer_set_inout(bufs[index], packets[index],
+                               sizes[index] + mac_len, sizeof(packets[index]));
+    }
+    compare(noise_cipherstate_decrypt_batch(batch, bufs, BATCH_PACKETS),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_PACKETS; ++index) {
+        uint8_t plaintext[MAX_CIPHER_DATA];
+        memset(plaintext, (int)index, sizes[index]);
+        compare_blocks(bufs[index].data, bufs[index].size,
+                       plaintext, sizes[index]);
+    }
+
+    /* Corrupt one packet in the middle of a batch.  The packets before
+       it are decrypted and the rest are left alone */
+    compare(noise_cipherstate_init_key(batch, key, sizeof(key)),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_set_nonce(batch, 42), NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_PACKETS; ++index) {
+        memcpy(packets[index], expected[index], sizes[index] + mac_len);
+        noise_buffer_set_inout(bufs[index], packets[index],
+                               sizes[index] + mac_len, sizeof(packets[index]));
+    }
+    packets[6][sizes[6]] ^= 0x01;
+    compare(noise_cipherstate_decrypt_batch(batch, bufs, BATCH_PACKETS),
+            NOISE_ERROR_MAC_FAILURE);
+    for (index = 0; index < 6; ++index)
+        compare(bufs[index].size, sizes[index]);
+    for (index = 6; index < BATCH_PACKETS; ++index) {
+        compare(bufs[index].size, sizes[index] + mac_len);
+        if (index != 6) {
+            compare_blocks(bufs[index].data, bufs[index].size,
+                           expected[index], sizes[index] + mac_len);
+        }
+    }
+
+    /* The nonce was advanced past the packets that were decrypted,
+       so the remaining packets can be retried after fixing the error */
+    packets[6][sizes[6]] ^= 0x01;
+    compare(noise_cipherstate_decrypt_batch(batch, bufs + 6, BATCH_PACKETS - 6),
+            NOISE_ERROR_NONE);
+    for (index = 6; index < BATCH_PACKETS; ++index)
+        compare(bufs[index].size, sizes[index]);
+
+    /* Parameter errors leave the packets and the nonce untouched */
+    compare(noise_cipherstate_encrypt_batch(0, bufs, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_cipherstate_encrypt_batch(batch, 0, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_cipherstate_decrypt_batch(0, bufs, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_cipherstate_decrypt_batch(batch, 0, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    noise_buffer_set_inout(bufs[0], packets[0], sizeof(packets[0]) - 1,
+                           sizeof(packets[0]));
+    compare(noise_cipherstate_encrypt_batch(batch, bufs, 1),
+            NOISE_ERROR_INVALID_LENGTH);
+    noise_buffer_set_input(bufs[0], packets[0], mac_len - 1);
+    compare(noise_cipherstate_decrypt_batch(batch, bufs, 1),
+            NOISE_ERROR_INVALID_LENGTH);
+
+    /* The whole batch must fit before the nonce overflows */
+    compare(noise_cipherstate_set_nonce(batch, 0xFFFFFFFFFFFFFFFCULL),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < 4; ++index) {
+        noise_buffer_set_inout(bufs[index], packets[index], sizes[index],
+                               sizeof(packets[index]));
+    }
+    compare(noise_cipherstate_encrypt_batch(batch, bufs, 4),
+            NOISE_ERROR_INVALID_NONCE);
+    compare(noise_cipherstate_encrypt_batch(batch, bufs, 3),
+            NOISE_ERROR_NONE);
+    compare(noise_cipherstate_encrypt_batch(batch, bufs + 3, 1),
+            NOISE_ERROR_INVALID_NONCE);
+
+    compare(noise_cipherstate_free(single), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_free(batch), NOISE_ERROR_NONE);
+}
+
+/* Check that the accelerated implementations for each CPU feature
+   produce the same output as the portable implementation */
+static void cipherstate_check_cpu_features(int id, const int *features,
+                                           size_t num_features)
+{
+    static size_t const sizes[] = {
+        0, 1, 15, 16, 63, 64, 65, 255, 256, 257, 511, 512, 513, 1023, 1024,
+        1025, 1500, 4096 + 17, NOISE_MAX_PAYLOAD_LEN - MAX_MAC_LEN
+    };
+    static uint8_t const key[32] = {
+        0xA0, 0x91, 0x82, 0x73, 0x64, 0x55, 0x46, 0x37,
+        0x28, 0x19, 0x0A, 0xFB, 0xEC, 0xDD, 0xCE, 0xBF,
+        0xB0, 0xA1, 0x92, 0x83, 0x74, 0x65, 0x56, 0x47,
+        0x38, 0x29, 0x1A, 0x0B, 0xFC, 0xED, 0xDE, 0xCF
+    };
+    static uint8_t plaintext[NOISE_MAX_PAYLOAD_LEN];
+    static uint8_t expected[NOISE_MAX_PAYLOAD_LEN];
+    static uint8_t buffer[NOISE_MAX_PAYLOAD_LEN];
+    NoiseCipherState *state;
+    NoiseBuffer mbuf;
+    int supported = noise_get_cpu_features();
+    size_t index, feature;
+
+    for (index = 0; index < sizeof(plaintext); ++index)
+        plaintext[index] = (uint8_t)(index * 7 + (index >> 8));
+    compare(noise_cipherstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_init_key(state, key, sizeof(key)),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < sizeof(sizes) / sizeof(sizes[0]); ++index) {
+        /* Encrypt with the portable implementation */
+        compare(noise_set_cpu_features(0), NOISE_ERROR_NONE);
+        compare(noise_get_cpu_features(), 0);
+        compare(noise_cipherstate_set_nonce(state, index * 2), NOISE_ERROR_NONE);
+        memcpy(expected, plaintext, sizes[index]);
+        noise_buffer_set_inout(mbuf, expected, sizes[index], sizeof(expected));
+        compare(noise_cipherstate_encrypt_with_ad(state, key, 5, &mbuf),
+                NOISE_ERROR_NONE);
+
+        /* Each accelerated implementation must produce the same output
+           and be able to decrypt what the portable code produced */
+        for (feature = 0; feature < num_features; ++feature) {
+            if ((features[feature] & supported) != features[feature])
+                continue;
+            compare(noise_set_cpu_features(features[feature]),
+                    NOISE_ERROR_NONE);
+            compare(noise_get_cpu_features(), features[feature]);
+            compare(noise_cipherstate_init_key(state, key, sizeof(key)),
+                    NOISE_ERROR_NONE);
+            compare(noise_cipherstate_set_nonce(state, index * 2),
+                    NOISE_ERROR_NONE);
+            memcpy(buffer, plaintext, sizes[index]);
+            noise_buffer_set_inout(mbuf, buffer, sizes[index], sizeof(buffer));
+            compare(noise_cipherstate_encrypt_with_ad(state, key, 5, &mbuf),
+                    NOISE_ERROR_NONE);
+            compare_blocks(buffer, mbuf.size, expected,
+                           sizes[index] + MAX_MAC_LEN);
+            compare(noise_cipherstate_init_key(state, key, sizeof(key)),
+                    NOISE_ERROR_NONE);
+            compare(noise_cipherstate_set_nonce(state, index * 2),
+                    NOISE_ERROR_NONE);
+            compare(noise_cipherstate_decrypt_with_ad(state, key, 5, &mbuf),
+                    NOISE_ERROR_NONE);
+            compare_blocks(buffer, mbuf.size, plaintext, sizes[index]);
+        }
+        compare(noise_cipherstate_init_key(state, key, sizeof(key)),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_set_cpu_features(-1), NOISE_ERROR_NONE);
+    compare(noise_get_cpu_features(), supported);
+    compare(noise_cipherstate_free(state), NOISE_ERROR_NONE);
+}
+
+/* Check that a failed MAC check leaves the ciphertext as-is, including
+   for packets that are long enough to be decrypted in several tiles */
+static void cipherstate_check_tampered(int id)
+{
+    static size_t const sizes[] = {
+        0, 1, 64, 2048, 8191, 8192, 8193, 16384, 20000,
+        NOISE_MAX_PAYLOAD_LEN - MAX_MAC_LEN
+    };
+    static uint8_t expected[NOISE_MAX_PAYLOAD_LEN];
+    static uint8_t buffer[NOISE_MAX_PAYLOAD_LEN];
+    uint8_t key[32];
+    NoiseCipherState *state;
+    NoiseBuffer mbuf;
+    size_t index, posn, mac_len;
+
+    memset(key, 0x5A, sizeof(key));
+    compare(noise_cipherstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    mac_len = noise_cipherstate_get_mac_length(state);
+    for (index = 0; index < sizeof(sizes) / sizeof(sizes[0]); ++index) {
+        for (posn = 0; posn < sizes[index]; ++posn)
+            expected[posn] = (uint8_t)(posn * 13);
+        compare(noise_cipherstate_init_key(state, key, sizeof(key)),
+                NOISE_ERROR_NONE);
+        noise_buffer_set_inout(mbuf, expected, sizes[index], sizeof(expected));
+        compare(noise_cipherstate_encrypt_with_ad(state, key, 3, &mbuf),
+                NOISE_ERROR_NONE);
+        compare(mbuf.size, sizes[index] + mac_len);
+
+        /* Flip a bit in the last byte of the ciphertext, or in the MAC */
+        expected[mbuf.size - mac_len - (sizes[index] ? 1 : 0)] ^= 0x01;
+        memcpy(buffer, expected, mbuf.size);
+        compare(noise_cipherstate_init_key(state, key, sizeof(key)),
+                NOISE_ERROR_NONE);
+        noise_buffer_set_input(mbuf, buffer, sizes[index] + mac_len);
+        compare(noise_cipherstate_decrypt_with_ad(state, key, 3, &mbuf),
+                NOISE_ERROR_MAC_FAILURE);
+        compare_blocks(buffer, sizes[index] + mac_len,
+                       expected, sizes[index] + mac_len);
+    }
+    compare(noise_cipherstate_free(state), NOISE_ERROR_NONE);
+}
+
 void test_cipherstate(void)
 {
+    static int const chachapoly_features[] = {
+        NOISE_CPU_SSSE3, NOISE_CPU_AVX2, NOISE_CPU_SSSE3 | NOISE_CPU_AVX2,
+        NOISE_CPU_SSSE3 | NOISE_CPU_AVX2 | NOISE_CPU_AVX512
+    };
+    static int const aesgcm_features[] = {
+        NOISE_CPU_SSSE3 | NOISE_CPU_AESNI | NOISE_CPU_PCLMUL
+    };
+
+    cipherstate_check_test_vectors();
+#if !USE_LIBSODIUM
+    /* Run the test vectors again through each portable GHASH engine */
+    compare(noise_set_cpu_features(0), NOISE_ERROR_NONE);
+    verify(ghash_set_engine(GHASH_ENGINE_BITWISE));
+    cipherstate_check_test_vectors();
+    verify(ghash_set_engine(GHASH_ENGINE_TABLE));
     cipherstate_check_test_vectors();
+    verify(ghash_set_engine(GHASH_DEFAULT_ENGINE));
+    compare(noise_set_cpu_features(-1), NOISE_ERROR_NONE);
+#endif
     cipherstate_check_errors();
+    cipherstate_check_batch(NOISE_CIPHER_CHACHAPOLY);
+    cipherstate_check_batch(NOISE_CIPHER_AESGCM);
+    cipherstate_check_tampered(NOISE_CIPHER_CHACHAPOLY);
+    cipherstate_check_tampered(NOISE_CIPHER_AESGCM);
+    cipherstate_check_cpu_features
+        (NOISE_CIPHER_CHACHAPOLY, chachapoly_features,
+         sizeof(chachapoly_features) / sizeof(chachapoly_features[0]));
+    cipherstate_check_cpu_features
+        (NOISE_CIPHER_AESGCM, aesgcm_features,
+         sizeof(aesgcm_features) / sizeof(aesgcm_features[0]));
 }
@@ -702,12 +702,45 @@ static void check_dh_generate(int id)
     compare(noise_dhstate_free(state2), NOISE_ERROR_NONE);
 }
 
+/* Check that the fixed-base public key derivation agrees with a
+   full scalar multiplication against the standard base point */
+static void check_dh_fixed_base(int id, uint8_t basepoint)
+{
+    NoiseDHState *state;
+    NoiseDHState *base;
+    uint8_t public_key[MAX_DH_KEY_LEN];
+    uint8_t shared_key[MAX_DH_KEY_LEN];
+    uint8_t base_key[MAX_DH_KEY_LEN];
+    size_t key_len;
+    int count;
+
+    compare(noise_dhstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&base, id), NOISE_ERROR_NONE);
+    key_len = noise_dhstate_get_public_key_length(state);
+    memset(base_key, 0, sizeof(base_key));
+    base_key[0] = basepoint;
+    compare(noise_dhstate_set_public_key(base, base_key, key_len),
+            NOISE_ERROR_NONE);
+    for (count = 0; count < 64; ++count) {
+        compare(noise_dhstate_generate_keypair(state), NOISE_ERROR_NONE);
+        compare(noise_dhstate_get_public_key(state, public_key, key_len),
+                NOISE_ERROR_NONE);
+        compare(noise_dhstate_calculate(state, base, shared_key, key_len),
+                NOISE_ERROR_NONE);
+        verify(!memcmp(public_key, shared_key, key_len));
+    }
+    compare(noise_dhstate_free(state), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(base), NOISE_ERROR_NONE);
+}
+
 /* Check the generation and use of new key pairs */
 static void dhstate_check_generate_keypair(void)
 {
     check_dh_generate(NOISE_DH_CURVE25519);
     check_dh_generate(NOISE_DH_CURVE448);
     check_dh_generate(NOISE_DH_NEWHOPE);
+    check_dh_fixed_base(NOISE_DH_CURVE25519, 9);
+    check_dh_fixed_base(NOISE_DH_CURVE448, 5);
 }
 
 /* Check other error conditions that can be reported by the functions */
@@ -748,6 +781,13 @@ static void dhstate_check_errors(void)
 void test_dhstate(void)
 {
     dhstate_check_test_vectors();
+
+    /* The NewHope polynomial arithmetic has accelerated implementations
+       that must agree with the reference code bit for bit */
+    compare(noise_set_cpu_features(0), NOISE_ERROR_NONE);
+    dhstate_check_test_vectors();
+    compare(noise_set_cpu_features(-1), NOISE_ERROR_NONE);
+
     dhstate_check_generate_keypair();
     dhstate_check_errors();
 }
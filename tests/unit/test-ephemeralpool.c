@@ -0,0 +1,437 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "test-helpers.h"
+#include "protocol/internal.h"
+#if HAVE_PTHREAD
+#include <sched.h>
+#endif
+
+/* Check that keypairs come out of the pool in place of fresh generation */
+static void check_pool_pop(int id)
+{
+    NoiseEphemeralPool *pool;
+    NoiseDHState *state1;
+    NoiseDHState *state2;
+    uint8_t pub1[2048];
+    uint8_t pub2[2048];
+    size_t pub_len;
+    size_t generated;
+
+    compare(noise_ephemeral_pool_new(&pool, id, 5), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_get_dh_id(pool), id);
+    compare(noise_ephemeral_pool_get_capacity(pool), 8);
+    compare(noise_ephemeral_pool_get_count(pool), 0);
+
+    /* Partially fill the pool and then top it up */
+    compare(noise_ephemeral_pool_fill(pool, 3, &generated), NOISE_ERROR_NONE);
+    compare(generated, 3);
+    compare(noise_ephemeral_pool_get_count(pool), 3);
+    compare(noise_ephemeral_pool_fill(pool, 0, &generated), NOISE_ERROR_NONE);
+    compare(generated, 5);
+    compare(noise_ephemeral_pool_get_count(pool), 8);
+    compare(noise_ephemeral_pool_fill(pool, 0, &generated), NOISE_ERROR_NONE);
+    compare(generated, 0);
+
+    /* Each generation consumes a different pre-generated keypair */
+    compare(noise_dhstate_new_by_id(&state1, id), NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&state2, id), NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(state1, pool), NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(state2, pool), NOISE_ERROR_NONE);
+    pub_len = noise_dhstate_get_public_key_length(state1);
+    compare(noise_dhstate_generate_dependent_keypair(state1, 0),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_get_count(pool), 7);
+    compare(noise_dhstate_generate_dependent_keypair(state2, 0),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_get_count(pool), 6);
+    compare(noise_dhstate_get_public_key(state1, pub1, pub_len),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_get_public_key(state2, pub2, pub_len),
+            NOISE_ERROR_NONE);
+    verify(memcmp(pub1, pub2, pub_len) != 0);
+    compare(noise_dhstate_has_keypair(state1), 1);
+
+    /* Drain the pool; generation falls back to the inline path */
+    while (noise_ephemeral_pool_get_count(pool) > 0)
+        compare(noise_dhstate_generate_dependent_keypair(state1, 0),
+                NOISE_ERROR_NONE);
+    compare(noise_dhstate_generate_dependent_keypair(state1, 0),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_has_keypair(state1), 1);
+    compare(noise_ephemeral_pool_get_count(pool), 0);
+
+    compare(noise_dhstate_free(state1), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(state2), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_free(pool), NOISE_ERROR_NONE);
+}
+
+/* Check that pooled keypairs agree with their peers */
+static void check_pool_calculate(int id)
+{
+    NoiseEphemeralPool *pool;
+    NoiseDHState *state1;
+    NoiseDHState *state2;
+    uint8_t shared1[64];
+    uint8_t shared2[64];
+    size_t shared_len;
+
+    compare(noise_ephemeral_pool_new(&pool, id, 2), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_fill(pool, 0, 0), NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&state1, id), NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&state2, id), NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(state1, pool), NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(state2, pool), NOISE_ERROR_NONE);
+    compare(noise_dhstate_generate_dependent_keypair(state1, 0),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_generate_dependent_keypair(state2, state1),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_get_count(pool), 0);
+
+    shared_len = noise_dhstate_get_shared_key_length(state1);
+    compare(noise_dhstate_calculate(state1, state2, shared1, shared_len),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_calculate(state2, state1, shared2, shared_len),
+            NOISE_ERROR_NONE);
+    compare_blocks(shared1, shared_len, shared2, shared_len);
+
+    compare(noise_dhstate_free(state1), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(state2), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_free(pool), NOISE_ERROR_NONE);
+}
+
+static void ephemeralpool_check_keypairs(void)
+{
+    check_pool_pop(NOISE_DH_CURVE25519);
+    check_pool_pop(NOISE_DH_CURVE448);
+    check_pool_pop(NOISE_DH_NEWHOPE);
+    check_pool_calculate(NOISE_DH_CURVE25519);
+    check_pool_calculate(NOISE_DH_CURVE448);
+}
+
+/* New Hope responder keypairs depend upon the initiator's public key */
+static void ephemeralpool_check_newhope_responder(void)
+{
+    NoiseEphemeralPool *pool;
+    NoiseDHState *alice;
+    NoiseDHState *bob;
+    uint8_t shared1[32];
+    uint8_t shared2[32];
+
+    compare(noise_ephemeral_pool_new(&pool, NOISE_DH_NEWHOPE, 4),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_fill(pool, 0, 0), NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&alice, NOISE_DH_NEWHOPE),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&bob, NOISE_DH_NEWHOPE),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_role(bob, NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(alice, pool), NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(bob, pool), NOISE_ERROR_NONE);
+
+    compare(noise_dhstate_generate_dependent_keypair(alice, 0),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_get_count(pool), 3);
+    compare(noise_dhstate_generate_dependent_keypair(bob, alice),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_get_count(pool), 3);
+
+    compare(noise_dhstate_calculate(alice, bob, shared1, sizeof(shared1)),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_calculate(bob, alice, shared2, sizeof(shared2)),
+            NOISE_ERROR_NONE);
+    compare_blocks(shared1, sizeof(shared1), shared2, sizeof(shared2));
+
+    compare(noise_dhstate_free(alice), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(bob), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_free(pool), NOISE_ERROR_NONE);
+}
+
+/* Run a handshake with ephemeral keys drawn from pools */
+static void check_pool_handshake(const char *name)
+{
+    NoiseEphemeralPool *pool;
+    NoiseEphemeralPool *hybrid_pool;
+    NoiseHandshakeState *initiator;
+    NoiseHandshakeState *responder;
+    NoiseHandshakeState *send;
+    NoiseHandshakeState *recv;
+    uint8_t message[4096];
+    uint8_t payload[23];
+    NoiseBuffer mbuf;
+    NoiseBuffer pbuf;
+    int action;
+
+    data_name = name;
+    compare(noise_ephemeral_pool_new(&pool, NOISE_DH_CURVE25519, 4),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_new(&hybrid_pool, NOISE_DH_NEWHOPE, 4),
+            NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_fill(pool, 0, 0), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_fill(hybrid_pool, 0, 0), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_new_by_name
+                (&initiator, name, NOISE_ROLE_INITIATOR),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_new_by_name
+                (&responder, name, NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_ephemeral_pool(initiator, pool),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_ephemeral_pool(responder, pool),
+            NOISE_ERROR_NONE);
+    if (strstr(name, "NewHope") != 0) {
+        compare(noise_handshakestate_set_ephemeral_pool
+                    (initiator, hybrid_pool),
+                NOISE_ERROR_NONE);
+        compare(noise_handshakestate_set_ephemeral_pool
+                    (responder, hybrid_pool),
+                NOISE_ERROR_NONE);
+    } else {
+        compare(noise_handshakestate_set_ephemeral_pool
+                    (initiator, hybrid_pool),
+                NOISE_ERROR_NOT_APPLICABLE);
+    }
+
+    compare(noise_handshakestate_start(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_start(responder), NOISE_ERROR_NONE);
+
+    memset(payload, 0xAA, sizeof(payload));
+    for (;;) {
+        action = noise_handshakestate_get_action(initiator);
+        if (action == NOISE_ACTION_WRITE_MESSAGE) {
+            send = initiator;
+            recv = responder;
+        } else if (action == NOISE_ACTION_READ_MESSAGE) {
+            send = responder;
+            recv = initiator;
+        } else {
+            break;
+        }
+        noise_buffer_set_output(mbuf, message, sizeof(message));
+        noise_buffer_set_input(pbuf, payload, sizeof(payload));
+        compare(noise_handshakestate_write_message(send, &mbuf, &pbuf),
+                NOISE_ERROR_NONE);
+        noise_buffer_set_output(pbuf, payload, sizeof(payload));
+        compare(noise_handshakestate_read_message(recv, &mbuf, &pbuf),
+                NOISE_ERROR_NONE);
+        compare(pbuf.size, sizeof(payload));
+    }
+    compare(noise_handshakestate_get_action(initiator), NOISE_ACTION_SPLIT);
+    compare(noise_handshakestate_get_action(responder), NOISE_ACTION_SPLIT);
+
+    /* Both sides took their classical ephemeral from the pool; only the
+       initiator can take a New Hope ephemeral */
+    compare(noise_ephemeral_pool_get_count(pool), 2);
+    if (strstr(name, "NewHope") != 0)
+        compare(noise_ephemeral_pool_get_count(hybrid_pool), 3);
+    else
+        compare(noise_ephemeral_pool_get_count(hybrid_pool), 4);
+
+    compare(noise_handshakestate_free(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_free(responder), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_free(pool), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_free(hybrid_pool), NOISE_ERROR_NONE);
+}
+
+static void ephemeralpool_check_handshake(void)
+{
+    check_pool_handshake("Noise_NN_25519_ChaChaPoly_BLAKE2s");
+    check_pool_handshake("Noise_NNhfs_25519+NewHope_ChaChaPoly_SHA256");
+}
+
+static void ephemeralpool_check_errors(void)
+{
+    NoiseEphemeralPool *pool;
+    NoiseDHState *state;
+
+    /* Bad parameters to pool functions */
+    compare(noise_ephemeral_pool_new(0, NOISE_DH_CURVE25519, 4),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_ephemeral_pool_free(0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_ephemeral_pool_get_dh_id(0), NOISE_DH_NONE);
+    compare(noise_ephemeral_pool_get_capacity(0), 0);
+    compare(noise_ephemeral_pool_get_count(0), 0);
+    compare(noise_ephemeral_pool_fill(0, 0, 0), NOISE_ERROR_INVALID_PARAM);
+
+    /* Out of range capacities and unknown algorithms set the pool to NULL */
+    pool = (NoiseEphemeralPool *)8;
+    compare(noise_ephemeral_pool_new(&pool, NOISE_DH_CURVE25519, 0),
+            NOISE_ERROR_INVALID_PARAM);
+    verify(pool == NULL);
+    pool = (NoiseEphemeralPool *)8;
+    compare(noise_ephemeral_pool_new(&pool, NOISE_DH_CURVE25519, 65537),
+            NOISE_ERROR_INVALID_PARAM);
+    verify(pool == NULL);
+    pool = (NoiseEphemeralPool *)8;
+    compare(noise_ephemeral_pool_new(&pool, NOISE_HASH_SHA512, 4),
+            NOISE_ERROR_UNKNOWN_ID);
+    verify(pool == NULL);
+
+    /* The pool must match the algorithm of the DHState */
+    compare(noise_ephemeral_pool_new(&pool, NOISE_DH_CURVE448, 4),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_new_by_id(&state, NOISE_DH_CURVE25519),
+            NOISE_ERROR_NONE);
+    compare(noise_dhstate_set_ephemeral_pool(0, pool),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_dhstate_set_ephemeral_pool(state, pool),
+            NOISE_ERROR_NOT_APPLICABLE);
+    compare(noise_dhstate_set_ephemeral_pool(state, 0), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(state), NOISE_ERROR_NONE);
+    compare(noise_ephemeral_pool_free(pool), NOISE_ERROR_NONE);
+}
+
+#if HAVE_PTHREAD
+
+#define POOL_THREADS 4
+#define POOL_KEYS_PER_THREAD 64
+#define POOL_KEYS (POOL_THREADS * POOL_KEYS_PER_THREAD)
+#define POOL_KEY_LEN 32
+
+typedef struct
+{
+    NoiseEphemeralPool *pool;
+    NoiseDHState *state;
+    uint8_t (*priv)[POOL_KEY_LEN];
+    uint8_t (*pub)[POOL_KEY_LEN];
+    size_t count;
+    int error;
+} PoolThreadInfo;
+
+static void *pool_producer(void *arg)
+{
+    PoolThreadInfo *info = (PoolThreadInfo *)arg;
+    size_t generated;
+    while (info->count < POOL_KEYS_PER_THREAD) {
+        if (noise_ephemeral_pool_fill(info->pool, 1, &generated)
+                != NOISE_ERROR_NONE) {
+            info->error = 1;
+            break;
+        }
+        info->count += generated;
+        if (!generated)
+            sched_yield();
+    }
+    return 0;
+}
+
+static void *pool_consumer(void *arg)
+{
+    PoolThreadInfo *info = (PoolThreadInfo *)arg;
+    while (info->count < POOL_KEYS_PER_THREAD) {
+        if (!noise_ephemeral_pool_pop(info->pool, info->state)) {
+            sched_yield();
+            continue;
+        }
+        if (noise_dhstate_get_keypair
+                (info->state, info->priv[info->count], POOL_KEY_LEN,
+                 info->pub[info->count], POOL_KEY_LEN) != NOISE_ERROR_NONE) {
+            info->error = 1;
+            break;
+        }
+        ++(info->count);
+    }
+    return 0;
+}
+
+/* Fill and drain a small pool from several threads at once and check
+   that every keypair comes out exactly once and in one piece */
+static void ephemeralpool_check_threads(void)
+{
+    static uint8_t priv[POOL_KEYS][POOL_KEY_LEN];
+    static uint8_t pub[POOL_KEYS][POOL_KEY_LEN];
+    PoolThreadInfo producers[POOL_THREADS];
+    PoolThreadInfo consumers[POOL_THREADS];
+    pthread_t producer_threads[POOL_THREADS];
+    pthread_t consumer_threads[POOL_THREADS];
+    NoiseEphemeralPool *pool;
+    NoiseDHState *state;
+    uint8_t check[POOL_KEY_LEN];
+    int index, index2;
+
+    compare(noise_ephemeral_pool_new(&pool, NOISE_DH_CURVE25519, 8),
+            NOISE_ERROR_NONE);
+    memset(producers, 0, sizeof(producers));
+    memset(consumers, 0, sizeof(consumers));
+    for (index = 0; index < POOL_THREADS; ++index) {
+        producers[index].pool = pool;
+        consumers[index].pool = pool;
+        compare(noise_dhstate_new_by_id
+                    (&(consumers[index].state), NOISE_DH_CURVE25519),
+                NOISE_ERROR_NONE);
+        consumers[index].priv = priv + index * POOL_KEYS_PER_THREAD;
+        consumers[index].pub = pub + index * POOL_KEYS_PER_THREAD;
+    }
+    for (index = 0; index < POOL_THREADS; ++index) {
+        compare(pthread_create(&(consumer_threads[index]), 0,
+                               pool_consumer, &(consumers[index])), 0);
+        compare(pthread_create(&(producer_threads[index]), 0,
+                               pool_producer, &(producers[index])), 0);
+    }
+    for (index = 0; index < POOL_THREADS; ++index) {
+        compare(pthread_join(producer_threads[index], 0), 0);
+        compare(pthread_join(consumer_threads[index], 0), 0);
+    }
+    for (index = 0; index < POOL_THREADS; ++index) {
+        compare(producers[index].error, 0);
+        compare(producers[index].count, POOL_KEYS_PER_THREAD);
+        compare(consumers[index].error, 0);
+        compare(consumers[index].count, POOL_KEYS_PER_THREAD);
+        compare(noise_dhstate_free(consumers[index].state), NOISE_ERROR_NONE);
+    }
+    compare(noise_ephemeral_pool_get_count(pool), 0);
+    compare(noise_ephemeral_pool_free(pool), NOISE_ERROR_NONE);
+
+    /* Each public key must belong to its private key and appear once */
+    compare(noise_dhstate_new_by_id(&state, NOISE_DH_CURVE25519),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < POOL_KEYS; ++index) {
+        compare(noise_dhstate_set_keypair_private
+                    (state, priv[index], POOL_KEY_LEN), NOISE_ERROR_NONE);
+        compare(noise_dhstate_get_public_key(state, check, POOL_KEY_LEN),
+                NOISE_ERROR_NONE);
+        compare_blocks(check, POOL_KEY_LEN, pub[index], POOL_KEY_LEN);
+        for (index2 = 0; index2 < index; ++index2)
+            verify(memcmp(pub[index], pub[index2], POOL_KEY_LEN) != 0);
+    }
+    compare(noise_dhstate_free(state), NOISE_ERROR_NONE);
+}
+
+#else
+
+static void ephemeralpool_check_threads(void)
+{
+    /* POSIX threads are not available */
+}
+
+#endif
+
+void test_ephemeralpool(void)
+{
+    ephemeralpool_check_keypairs();
+    ephemeralpool_check_newhope_responder();
+    ephemeralpool_check_handshake();
+    ephemeralpool_check_errors();
+    ephemeralpool_check_threads();
+}
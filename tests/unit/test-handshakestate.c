@@ -667,6 +667,500 @@ static void handshakestate_check_fallback(void)
     check_fallback_protocol("Noise_IK_448_ChaChaPoly_BLAKE2b", 0, 1);
 }
 
+/* Runs a handshake with a responder that uses a shared static key */
+static void check_static_key_handshake(const char *name, NoiseStaticKey *key)
+{
+    NoiseHandshakeState *initiator;
+    NoiseHandshakeState *responder;
+    NoiseHandshakeState *send;
+    NoiseHandshakeState *recv;
+    NoiseDHState *dh;
+    uint8_t message[4096];
+    uint8_t payload[23];
+    uint8_t public_key[32];
+    NoiseBuffer mbuf;
+    NoiseBuffer pbuf;
+    int action;
+
+    data_name = name;
+    compare(noise_handshakestate_new_by_name
+                (&initiator, name, NOISE_ROLE_INITIATOR),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_new_by_name
+                (&responder, name, NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+
+    /* The responder's own DHState is left empty; the shared key fills in */
+    compare(noise_handshakestate_needs_local_keypair(responder), 1);
+    compare(noise_handshakestate_set_static_key(responder, key),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_needs_local_keypair(responder), 0);
+    compare(noise_handshakestate_has_local_keypair(responder), 1);
+    dh = noise_handshakestate_get_local_keypair_dh(responder);
+    compare(noise_dhstate_has_keypair(dh), 0);
+
+    if (noise_handshakestate_needs_local_keypair(initiator)) {
+        dh = noise_handshakestate_get_local_keypair_dh(initiator);
+        compare(noise_dhstate_set_keypair_private
+                    (dh, init_private_25519, sizeof(init_private_25519)),
+                NOISE_ERROR_NONE);
+    }
+    if (noise_handshakestate_needs_remote_public_key(initiator)) {
+        dh = noise_handshakestate_get_remote_public_key_dh(initiator);
+        compare(noise_dhstate_set_public_key
+                    (dh, resp_public_25519, sizeof(resp_public_25519)),
+                NOISE_ERROR_NONE);
+    }
+
+    compare(noise_handshakestate_start(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_start(responder), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_static_key(responder, key),
+            NOISE_ERROR_INVALID_STATE);
+
+    memset(payload, 0xAA, sizeof(payload));
+    for (;;) {
+        action = noise_handshakestate_get_action(initiator);
+        if (action == NOISE_ACTION_WRITE_MESSAGE) {
+            send = initiator;
+            recv = responder;
+        } else if (action == NOISE_ACTION_READ_MESSAGE) {
+            send = responder;
+            recv = initiator;
+        } else {
+            break;
+        }
+        noise_buffer_set_output(mbuf, message, sizeof(message));
+        noise_buffer_set_input(pbuf, payload, sizeof(payload));
+        compare(noise_handshakestate_write_message(send, &mbuf, &pbuf),
+                NOISE_ERROR_NONE);
+        noise_buffer_set_output(pbuf, payload, sizeof(payload));
+        compare(noise_handshakestate_read_message(recv, &mbuf, &pbuf),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_handshakestate_get_action(initiator), NOISE_ACTION_SPLIT);
+    compare(noise_handshakestate_get_action(responder), NOISE_ACTION_SPLIT);
+    compare(noise_handshakestate_get_handshake_hash(initiator, message, 64),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_get_handshake_hash(responder, message + 64, 64),
+            NOISE_ERROR_NONE);
+    verify(!memcmp(message, message + 64, 64));
+
+    /* The initiator must have seen the shared static public key */
+    dh = noise_handshakestate_get_remote_public_key_dh(initiator);
+    compare(noise_dhstate_get_public_key(dh, public_key, sizeof(public_key)),
+            NOISE_ERROR_NONE);
+    verify(!memcmp(public_key, resp_public_25519, sizeof(public_key)));
+
+    compare(noise_handshakestate_free(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_free(responder), NOISE_ERROR_NONE);
+}
+
+static void handshakestate_check_static_key(void)
+{
+    NoiseHandshakeState *state;
+    NoiseStaticKey *key;
+    NoiseStaticKey *key448;
+    NoiseDHState *dh;
+
+    /* Load and validate the responder's keypair once */
+    compare(noise_dhstate_new_by_id(&dh, NOISE_DH_CURVE25519),
+            NOISE_ERROR_NONE);
+    key = (NoiseStaticKey *)8;
+    compare(noise_static_key_new(&key, dh), NOISE_ERROR_INVALID_STATE);
+    verify(key == 0);
+    compare(noise_dhstate_set_keypair_private
+                (dh, resp_private_25519, sizeof(resp_private_25519)),
+            NOISE_ERROR_NONE);
+    compare(noise_static_key_new(&key, dh), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(dh), NOISE_ERROR_NONE);
+    compare(noise_static_key_get_dh_id(key), NOISE_DH_CURVE25519);
+    compare(noise_dhstate_has_keypair(noise_static_key_get_dhstate(key)), 1);
+
+    /* Share the key across several handshakes */
+    check_static_key_handshake("Noise_XX_25519_ChaChaPoly_BLAKE2s", key);
+    check_static_key_handshake("Noise_IK_25519_AESGCM_SHA256", key);
+    check_static_key_handshake("Noise_XK_25519_ChaChaPoly_SHA512", key);
+
+    /* The key outlives the creator's reference while a handshake holds it */
+    compare(noise_handshakestate_new_by_name
+                (&state, "Noise_XX_25519_ChaChaPoly_BLAKE2s",
+                 NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_static_key(state, key), NOISE_ERROR_NONE);
+    compare(noise_static_key_ref(key), NOISE_ERROR_NONE);
+    compare(noise_static_key_unref(key), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_static_key(state, 0), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_has_local_keypair(state), 0);
+    compare(noise_handshakestate_set_static_key(state, key), NOISE_ERROR_NONE);
+
+    /* Mismatched algorithms and patterns without a local static key */
+    compare(noise_dhstate_new_by_id(&dh, NOISE_DH_CURVE448), NOISE_ERROR_NONE);
+    compare(noise_dhstate_generate_keypair(dh), NOISE_ERROR_NONE);
+    compare(noise_static_key_new(&key448, dh), NOISE_ERROR_NONE);
+    compare(noise_dhstate_free(dh), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_static_key(state, key448),
+            NOISE_ERROR_NOT_APPLICABLE);
+    compare(noise_static_key_unref(key448), NOISE_ERROR_NONE);
+    compare(noise_static_key_unref(key), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_has_local_keypair(state), 1);
+    compare(noise_handshakestate_free(state), NOISE_ERROR_NONE);
+
+    compare(noise_handshakestate_new_by_name
+                (&state, "Noise_NN_25519_ChaChaPoly_BLAKE2s",
+                 NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_set_static_key(state, 0),
+            NOISE_ERROR_NOT_APPLICABLE);
+    compare(noise_handshakestate_free(state), NOISE_ERROR_NONE);
+
+    /* Parameter errors */
+    compare(noise_static_key_new(0, 0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_static_key_new(&key, 0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_static_key_ref(0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_static_key_unref(0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_static_key_get_dh_id(0), NOISE_DH_NONE);
+    verify(noise_static_key_get_dhstate(0) == 0);
+    compare(noise_handshakestate_set_static_key(0, 0),
+            NOISE_ERROR_INVALID_PARAM);
+}
+
+static void check_arena_handshake(const char *name)
+{
+    NoiseProtocolId id;
+    NoiseHandshakeState *initiator;
+    NoiseHandshakeState *responder;
+    NoiseHandshakeState *send;
+    NoiseHandshakeState *recv;
+    NoiseCipherState *c1init;
+    NoiseCipherState *c2init;
+    NoiseCipherState *c1resp;
+    NoiseCipherState *c2resp;
+    NoiseDHState *dh;
+    uint8_t *arena;
+    size_t init_size;
+    size_t resp_size;
+    uint8_t message[4096];
+    uint8_t payload[23];
+    NoiseBuffer mbuf;
+    NoiseBuffer pbuf;
+    int action;
+
+    data_name = name;
+    compare(noise_protocol_name_to_id(&id, name, strlen(name)),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_get_arena_size
+                (&id, NOISE_ROLE_INITIATOR, &init_size),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_get_arena_size
+                (&id, NOISE_ROLE_RESPONDER, &resp_size),
+            NOISE_ERROR_NONE);
+    verify(init_size > sizeof(NoiseHandshakeState));
+    verify(resp_size > sizeof(NoiseHandshakeState));
+
+    /* An arena that is one byte short must be rejected and left clean.
+       Offset the arena by one byte to check that alignment is handled */
+    arena = (uint8_t *)malloc(init_size + 1);
+    verify(arena != 0);
+    memset(arena, 0xAA, init_size + 1);
+    initiator = (NoiseHandshakeState *)8;
+    compare(noise_handshakestate_new_in_arena
+                (&initiator, &id, NOISE_ROLE_INITIATOR, arena + 1,
+                 init_size - NOISE_ARENA_ALIGN),
+            NOISE_ERROR_NO_MEMORY);
+    verify(initiator == 0);
+    verify(noise_is_zero(arena + 1, init_size - NOISE_ARENA_ALIGN));
+
+    /* Run a handshake with the initiator in the arena */
+    compare(noise_handshakestate_new_in_arena
+                (&initiator, &id, NOISE_ROLE_INITIATOR, arena + 1, init_size),
+            NOISE_ERROR_NONE);
+    verify((uint8_t *)initiator >= arena + 1);
+    verify((uint8_t *)initiator < arena + 1 + init_size);
+    compare(noise_handshakestate_new_by_id
+                (&responder, &id, NOISE_ROLE_RESPONDER),
+            NOISE_ERROR_NONE);
+    if (noise_handshakestate_needs_local_keypair(initiator)) {
+        dh = noise_handshakestate_get_local_keypair_dh(initiator);
+        compare(noise_dhstate_set_keypair_private
+                    (dh, init_private_25519, sizeof(init_private_25519)),
+                NOISE_ERROR_NONE);
+    }
+    if (noise_handshakestate_needs_local_keypair(responder)) {
+        dh = noise_handshakestate_get_local_keypair_dh(responder);
+        compare(noise_dhstate_set_keypair_private
+                    (dh, resp_private_25519, sizeof(resp_private_25519)),
+                NOISE_ERROR_NONE);
+    }
+    if (noise_handshakestate_needs_remote_public_key(initiator)) {
+        dh = noise_handshakestate_get_remote_public_key_dh(initiator);
+        compare(noise_dhstate_set_public_key
+                    (dh, resp_public_25519, sizeof(resp_public_25519)),
+                NOISE_ERROR_NONE);
+    }
+    if (noise_handshakestate_needs_pre_shared_key(initiator)) {
+        compare(noise_handshakestate_set_pre_shared_key
+                    (initiator, psk, sizeof(psk)),
+                NOISE_ERROR_NONE);
+        compare(noise_handshakestate_set_pre_shared_key
+                    (responder, psk, sizeof(psk)),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_handshakestate_start(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_start(responder), NOISE_ERROR_NONE);
+    memset(payload, 0xAA, sizeof(payload));
+    for (;;) {
+        action = noise_handshakestate_get_action(initiator);
+        if (action == NOISE_ACTION_WRITE_MESSAGE) {
+            send = initiator;
+            recv = responder;
+        } else if (action == NOISE_ACTION_READ_MESSAGE) {
+            send = responder;
+            recv = initiator;
+        } else {
+            break;
+        }
+        noise_buffer_set_output(mbuf, message, sizeof(message));
+        noise_buffer_set_input(pbuf, payload, sizeof(payload));
+        compare(noise_handshakestate_write_message(send, &mbuf, &pbuf),
+                NOISE_ERROR_NONE);
+        noise_buffer_set_output(pbuf, payload, sizeof(payload));
+        compare(noise_handshakestate_read_message(recv, &mbuf, &pbuf),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_handshakestate_get_action(initiator), NOISE_ACTION_SPLIT);
+    compare(noise_handshakestate_get_action(responder), NOISE_ACTION_SPLIT);
+    compare(noise_handshakestate_split(initiator, &c1init, &c2init),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_split(responder, &c2resp, &c1resp),
+            NOISE_ERROR_NONE);
+
+    /* The split CipherStates must not live in the arena */
+    verify((uint8_t *)c1init < arena || (uint8_t *)c1init > arena + init_size);
+    verify((uint8_t *)c2init < arena || (uint8_t *)c2init > arena + init_size);
+
+    /* Freeing the HandshakeState cleans the whole arena */
+    compare(noise_handshakestate_free(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_free(responder), NOISE_ERROR_NONE);
+    verify(noise_is_zero(arena + 1, init_size));
+    compare(arena[0], 0xAA);
+    free(arena);
+
+    /* The split CipherStates outlive the arena */
+    memset(payload, 0x55, sizeof(payload));
+    noise_buffer_set_inout(mbuf, message, sizeof(payload), sizeof(message));
+    memcpy(message, payload, sizeof(payload));
+    compare(noise_cipherstate_encrypt(c1init, &mbuf), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_decrypt(c1resp, &mbuf), NOISE_ERROR_NONE);
+    compare_blocks(mbuf.data, mbuf.size, payload, sizeof(payload));
+    noise_buffer_set_inout(mbuf, message, sizeof(payload), sizeof(message));
+    memcpy(message, payload, sizeof(payload));
+    compare(noise_cipherstate_encrypt(c2resp, &mbuf), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_decrypt(c2init, &mbuf), NOISE_ERROR_NONE);
+    compare_blocks(mbuf.data, mbuf.size, payload, sizeof(payload));
+    noise_cipherstate_free(c1init);
+    noise_cipherstate_free(c2init);
+    noise_cipherstate_free(c1resp);
+    noise_cipherstate_free(c2resp);
+}
+
+static void handshakestate_check_arena(void)
+{
+    NoiseProtocolId id;
+    NoiseHandshakeState *state;
+    uint8_t arena[64];
+    size_t size;
+
+    check_arena_handshake("Noise_NN_25519_ChaChaPoly_BLAKE2s");
+    check_arena_handshake("Noise_XX_25519_AESGCM_SHA256");
+    check_arena_handshake("Noise_IK_25519_ChaChaPoly_SHA512");
+    check_arena_handshake("NoisePSK_XX_25519_AESGCM_BLAKE2b");
+    check_arena_handshake("Noise_NNhfs_25519+NewHope_ChaChaPoly_BLAKE2s");
+
+    /* Parameter errors */
+    memset(&id, 0, sizeof(id));
+    size = 8;
+    compare(noise_handshakestate_get_arena_size
+                (&id, NOISE_ROLE_INITIATOR, &size),
+            NOISE_ERROR_UNKNOWN_ID);
+    compare(size, 0);
+    compare(noise_handshakestate_get_arena_size(0, NOISE_ROLE_INITIATOR, &size),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_handshakestate_get_arena_size(&id, NOISE_ROLE_INITIATOR, 0),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_handshakestate_get_arena_size(&id, 0, &size),
+            NOISE_ERROR_INVALID_PARAM);
+    state = (NoiseHandshakeState *)8;
+    compare(noise_handshakestate_new_in_arena
+                (&state, &id, NOISE_ROLE_INITIATOR, arena, sizeof(arena)),
+            NOISE_ERROR_UNKNOWN_ID);
+    verify(state == NULL);
+    compare(noise_handshakestate_new_in_arena
+                (0, &id, NOISE_ROLE_INITIATOR, arena, sizeof(arena)),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_handshakestate_new_in_arena
+                (&state, 0, NOISE_ROLE_INITIATOR, arena, sizeof(arena)),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_handshakestate_new_in_arena
+                (&state, &id, NOISE_ROLE_INITIATOR, 0, sizeof(arena)),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_handshakestate_new_in_arena
+                (&state, &id, 0, arena, sizeof(arena)),
+            NOISE_ERROR_INVALID_PARAM);
+}
+
+#define SPLIT_BATCH_COUNT 12
+
+/* Run an unauthenticated handshake through to the "split" state */
+static void run_nn_handshake
+    (NoiseHandshakeState *initiator, NoiseHandshakeState *responder)
+{
+    NoiseHandshakeState *send;
+    NoiseHandshakeState *recv;
+    uint8_t message[4096];
+    NoiseBuffer mbuf;
+    int action;
+
+    compare(noise_handshakestate_start(initiator), NOISE_ERROR_NONE);
+    compare(noise_handshakestate_start(responder), NOISE_ERROR_NONE);
+    for (;;) {
+        action = noise_handshakestate_get_action(initiator);
+        if (action == NOISE_ACTION_WRITE_MESSAGE) {
+            send = initiator;
+            recv = responder;
+        } else if (action == NOISE_ACTION_READ_MESSAGE) {
+            send = responder;
+            recv = initiator;
+        } else {
+            break;
+        }
+        noise_buffer_set_output(mbuf, message, sizeof(message));
+        compare(noise_handshakestate_write_message(send, &mbuf, 0),
+                NOISE_ERROR_NONE);
+        compare(noise_handshakestate_read_message(recv, &mbuf, 0),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_handshakestate_get_action(initiator), NOISE_ACTION_SPLIT);
+    compare(noise_handshakestate_get_action(responder), NOISE_ACTION_SPLIT);
+}
+
+/* Check that a message encrypted by one CipherState decrypts with another */
+static void check_cipher_pair(NoiseCipherState *c1, NoiseCipherState *c2)
+{
+    uint8_t message[64];
+    uint8_t payload[23];
+    NoiseBuffer mbuf;
+
+    memset(payload, 0x55, sizeof(payload));
+    memcpy(message, payload, sizeof(payload));
+    noise_buffer_set_inout(mbuf, message, sizeof(payload), sizeof(message));
+    compare(noise_cipherstate_encrypt(c1, &mbuf), NOISE_ERROR_NONE);
+    compare(noise_cipherstate_decrypt(c2, &mbuf), NOISE_ERROR_NONE);
+    compare_blocks(mbuf.data, mbuf.size, payload, sizeof(payload));
+}
+
+/* Check splitting many handshakes at once with a mixture of algorithms */
+static void handshakestate_check_split_batch(void)
+{
+    static const char * const names[SPLIT_BATCH_COUNT] = {
+        "Noise_NN_25519_ChaChaPoly_BLAKE2s",
+        "Noise_NN_25519_AESGCM_BLAKE2s",
+        "Noise_NN_448_ChaChaPoly_BLAKE2s",
+        "Noise_NN_25519_ChaChaPoly_SHA256",
+        "Noise_NN_25519_AESGCM_SHA256",
+        "Noise_NN_25519_ChaChaPoly_BLAKE2s",
+        "Noise_NN_25519_ChaChaPoly_SHA512",
+        "Noise_NN_25519_AESGCM_SHA512",
+        "Noise_NN_25519_ChaChaPoly_BLAKE2b",
+        "Noise_NN_25519_ChaChaPoly_SHA256",
+        "Noise_NN_25519_AESGCM_SHA256",
+        "Noise_NN_25519_ChaChaPoly_SHA256"
+    };
+    NoiseHandshakeState *initiators[SPLIT_BATCH_COUNT];
+    NoiseHandshakeState *responders[SPLIT_BATCH_COUNT];
+    NoiseCipherState *init_send[SPLIT_BATCH_COUNT];
+    NoiseCipherState *init_recv[SPLIT_BATCH_COUNT];
+    NoiseCipherState *resp_send[SPLIT_BATCH_COUNT];
+    NoiseCipherState *resp_recv[SPLIT_BATCH_COUNT];
+    NoiseHandshakeState *saved;
+    size_t index;
+
+    for (index = 0; index < SPLIT_BATCH_COUNT; ++index) {
+        data_name = names[index];
+        compare(noise_handshakestate_new_by_name
+                    (&(initiators[index]), names[index], NOISE_ROLE_INITIATOR),
+                NOISE_ERROR_NONE);
+        compare(noise_handshakestate_new_by_name
+                    (&(responders[index]), names[index], NOISE_ROLE_RESPONDER),
+                NOISE_ERROR_NONE);
+        run_nn_handshake(initiators[index], responders[index]);
+    }
+    data_name = "split batch";
+
+    /* Nothing is split if one of the handshakes is not ready */
+    compare(noise_handshakestate_split(responders[4], &(resp_send[4]),
+                                       &(resp_recv[4])),
+            NOISE_ERROR_NONE);
+    resp_send[0] = (NoiseCipherState *)8;
+    compare(noise_handshakestate_split_batch
+                (responders, resp_send, resp_recv, SPLIT_BATCH_COUNT),
+            NOISE_ERROR_INVALID_STATE);
+    verify(resp_send[0] == (NoiseCipherState *)8);
+    compare(noise_handshakestate_get_action(responders[0]),
+            NOISE_ACTION_SPLIT);
+
+    /* Split the initiators as a batch and the responders one at a time,
+       or as smaller batches, and check that the keys match up */
+    compare(noise_handshakestate_split_batch
+                (initiators, init_send, init_recv, SPLIT_BATCH_COUNT),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_split_batch
+                (responders, resp_send, resp_recv, 4),
+            NOISE_ERROR_NONE);
+    compare(noise_handshakestate_split_batch
+                (responders + 5, resp_send + 5, resp_recv + 5,
+                 SPLIT_BATCH_COUNT - 5),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < SPLIT_BATCH_COUNT; ++index) {
+        data_name = names[index];
+        compare(noise_handshakestate_get_action(initiators[index]),
+                NOISE_ACTION_COMPLETE);
+        compare(noise_handshakestate_get_action(responders[index]),
+                NOISE_ACTION_COMPLETE);
+        check_cipher_pair(init_send[index], resp_recv[index]);
+        check_cipher_pair(resp_send[index], init_recv[index]);
+        noise_cipherstate_free(init_send[index]);
+        noise_cipherstate_free(init_recv[index]);
+        noise_cipherstate_free(resp_send[index]);
+        noise_cipherstate_free(resp_recv[index]);
+    }
+    data_name = "split batch";
+
+    /* Splitting again is an error, and an empty batch trivially succeeds */
+    compare(noise_handshakestate_split_batch
+                (initiators, init_send, init_recv, 1),
+            NOISE_ERROR_INVALID_STATE);
+    compare(noise_handshakestate_split_batch
+                (initiators, init_send, init_recv, 0),
+            NOISE_ERROR_NONE);
+
+    /* Check parameter error conditions */
+    compare(noise_handshakestate_split_batch(0, init_send, init_recv, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_handshakestate_split_batch(initiators, 0, 0, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    saved = initiators[1];
+    initiators[1] = 0;
+    compare(noise_handshakestate_split_batch
+                (initiators, init_send, init_recv, 2),
+            NOISE_ERROR_INVALID_PARAM);
+    initiators[1] = saved;
+
+    for (index = 0; index < SPLIT_BATCH_COUNT; ++index) {
+        noise_handshakestate_free(initiators[index]);
+        noise_handshakestate_free(responders[index]);
+    }
+}
+
 static void handshakestate_check_errors(void)
 {
     NoiseHandshakeState *state;
@@ -719,5 +1213,8 @@ void test_handshakestate(void)
     handshakestate_derive_keys();
     handshakestate_check_protocols();
     handshakestate_check_fallback();
+    handshakestate_check_static_key();
+    handshakestate_check_arena();
+    handshakestate_check_split_batch();
     handshakestate_check_errors();
 }
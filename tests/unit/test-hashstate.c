@@ -25,6 +25,7 @@
 #define MAX_HASH_INPUT  128
 #define MAX_HASH_OUTPUT 64
 #define MAX_BLOCK_LEN   128
+#define HASH_MANY_COUNT 23
 
 /* Check raw hash output against test vectors */
 static void check_hash(int id, size_t hash_len, size_t block_len,
@@ -341,6 +342,157 @@ static void hashstate_check_hkdf(void)
     hashstate_check_hkdf_algorithm(NOISE_HASH_SHA512);
 }
 
+#define HKDF_BATCH_COUNT 19
+
+/* Check that noise_hashstate_hkdf_batch() agrees with noise_hashstate_hkdf()
+   for every batch size, with and without the accelerated hash kernels */
+static void hashstate_check_hkdf_batch_algorithm(int id)
+{
+    static size_t const data_lens[] = {0, 33, 300};
+    static int const features[] = {0, -1};
+    static uint8_t keys[HKDF_BATCH_COUNT][200];
+    static uint8_t data[HKDF_BATCH_COUNT][300];
+    static uint8_t expected1[HKDF_BATCH_COUNT][MAX_HASH_OUTPUT];
+    static uint8_t expected2[HKDF_BATCH_COUNT][MAX_HASH_OUTPUT];
+    static uint8_t output1[HKDF_BATCH_COUNT][MAX_HASH_OUTPUT];
+    static uint8_t output2[HKDF_BATCH_COUNT][MAX_HASH_OUTPUT];
+    const uint8_t *key_ptrs[HKDF_BATCH_COUNT];
+    const uint8_t *data_ptrs[HKDF_BATCH_COUNT];
+    uint8_t *out1_ptrs[HKDF_BATCH_COUNT];
+    uint8_t *out2_ptrs[HKDF_BATCH_COUNT];
+    size_t key_lens[3];
+    NoiseHashState *state;
+    size_t hash_len, index, posn, klen, dlen, feature, count;
+
+    compare(noise_hashstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    hash_len = noise_hashstate_get_hash_length(state);
+    key_lens[0] = hash_len;
+    key_lens[1] = 5;
+    key_lens[2] = sizeof(keys[0]);
+    for (index = 0; index < HKDF_BATCH_COUNT; ++index) {
+        for (posn = 0; posn < sizeof(keys[0]); ++posn)
+            keys[index][posn] = (uint8_t)(index * 17 + posn);
+        for (posn = 0; posn < sizeof(data[0]); ++posn)
+            data[index][posn] = (uint8_t)(index * 5 + posn * 3);
+        key_ptrs[index] = keys[index];
+        data_ptrs[index] = data[index];
+        out1_ptrs[index] = output1[index];
+        out2_ptrs[index] = output2[index];
+    }
+
+    for (klen = 0; klen < 3; ++klen) {
+        for (dlen = 0; dlen < 3; ++dlen) {
+            /* Calculate the expected values one at a time */
+            for (index = 0; index < HKDF_BATCH_COUNT; ++index) {
+                compare(noise_hashstate_hkdf
+                            (state, keys[index], key_lens[klen],
+                             data[index], data_lens[dlen],
+                             expected1[index], hash_len,
+                             expected2[index], hash_len),
+                        NOISE_ERROR_NONE);
+            }
+
+            /* Every batch size must give the same answers */
+            for (feature = 0; feature < 2; ++feature) {
+                compare(noise_set_cpu_features(features[feature]),
+                        NOISE_ERROR_NONE);
+                for (count = 0; count <= HKDF_BATCH_COUNT; ++count) {
+                    memset(output1, 0xE6, sizeof(output1));
+                    memset(output2, 0x6E, sizeof(output2));
+                    compare(noise_hashstate_hkdf_batch
+                                (state, key_ptrs, key_lens[klen],
+                                 data_ptrs, data_lens[dlen],
+                                 out1_ptrs, hash_len, out2_ptrs, hash_len,
+                                 count),
+                            NOISE_ERROR_NONE);
+                    for (index = 0; index < count; ++index) {
+                        compare_blocks(output1[index], hash_len,
+                                       expected1[index], hash_len);
+                        compare_blocks(output2[index], hash_len,
+                                       expected2[index], hash_len);
+                    }
+                    if (count < HKDF_BATCH_COUNT) {
+                        compare(output1[count][0], 0xE6);
+                        compare(output2[count][0], 0x6E);
+                    }
+                }
+            }
+            compare(noise_set_cpu_features(-1), NOISE_ERROR_NONE);
+        }
+    }
+
+    /* Truncated outputs, with the first output replacing the key and
+       the second replacing the data as MixKey() does with the chaining key */
+    memset(output2, 0x6E, sizeof(output2));
+    for (index = 0; index < HKDF_BATCH_COUNT; ++index) {
+        memcpy(output1[index], keys[index], hash_len);
+        key_ptrs[index] = output1[index];
+        data_ptrs[index] = output2[index];
+        compare(noise_hashstate_hkdf
+                    (state, output1[index], hash_len, output2[index], 7,
+                     expected1[index], hash_len, expected2[index], hash_len),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, data_ptrs, 7,
+                 out1_ptrs, hash_len, out2_ptrs, hash_len / 2,
+                 HKDF_BATCH_COUNT),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < HKDF_BATCH_COUNT; ++index) {
+        compare_blocks(output1[index], hash_len, expected1[index], hash_len);
+        compare_blocks(output2[index], hash_len / 2,
+                       expected2[index], hash_len / 2);
+        compare(output2[index][hash_len / 2], 0x6E);
+    }
+
+    /* Check parameter error conditions */
+    compare(noise_hashstate_hkdf_batch
+                (0, key_ptrs, hash_len, data_ptrs, 0,
+                 out1_ptrs, hash_len, out2_ptrs, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hkdf_batch
+                (state, 0, hash_len, data_ptrs, 0,
+                 out1_ptrs, hash_len, out2_ptrs, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, 0, 0,
+                 out1_ptrs, hash_len, out2_ptrs, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, data_ptrs, 0,
+                 0, hash_len, out2_ptrs, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, data_ptrs, 0,
+                 out1_ptrs, hash_len, 0, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, data_ptrs, 0,
+                 out1_ptrs, hash_len + 1, out2_ptrs, hash_len, 1),
+            NOISE_ERROR_INVALID_LENGTH);
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, data_ptrs, 0,
+                 out1_ptrs, hash_len, out2_ptrs, hash_len + 1, 1),
+            NOISE_ERROR_INVALID_LENGTH);
+    out2_ptrs[3] = 0;
+    compare(noise_hashstate_hkdf_batch
+                (state, key_ptrs, hash_len, data_ptrs, 0,
+                 out1_ptrs, hash_len, out2_ptrs, hash_len, 4),
+            NOISE_ERROR_INVALID_PARAM);
+
+    /* Clean up */
+    compare(noise_hashstate_free(state), NOISE_ERROR_NONE);
+}
+
+/* Check the behaviour of the noise_hashstate_hkdf_batch() function */
+static void hashstate_check_hkdf_batch(void)
+{
+    hashstate_check_hkdf_batch_algorithm(NOISE_HASH_BLAKE2s);
+    hashstate_check_hkdf_batch_algorithm(NOISE_HASH_BLAKE2b);
+    hashstate_check_hkdf_batch_algorithm(NOISE_HASH_SHA256);
+    hashstate_check_hkdf_batch_algorithm(NOISE_HASH_SHA512);
+}
+
 /* Check the behaviour of the noise_hashstate_pbkdf2() function */
 static void check_pbkdf2(const char *name, const char *passphrase,
                          const char *salt, size_t iterations,
@@ -421,6 +573,196 @@ static void hashstate_check_pbkdf2(void)
                    "6a272bdebba1d078478f62b397f33c8d");
 }
 
+/* Check that noise_hashstate_hash_many() and the accelerated hash
+   implementations for each CPU feature produce the same output as the
+   portable implementation */
+static void hashstate_check_hash_many_algorithm(int id)
+{
+    static size_t const sizes[HASH_MANY_COUNT] = {
+        0, 1, 31, 32, 63, 64, 65, 127, 128, 129, 255, 256, 257,
+        64, 64, 64, 64, 64, 64, 64, 64, 1000, 33
+    };
+    static int const features[] = {
+        0, NOISE_CPU_SSE41, NOISE_CPU_AVX2, NOISE_CPU_SSE41 | NOISE_CPU_AVX2,
+        NOISE_CPU_SHA | NOISE_CPU_SSE41,
+        NOISE_CPU_SHA | NOISE_CPU_SSE41 | NOISE_CPU_AVX2
+    };
+    static uint8_t input[HASH_MANY_COUNT][1000];
+    static uint8_t expected[HASH_MANY_COUNT][MAX_HASH_OUTPUT];
+    static uint8_t output[HASH_MANY_COUNT][MAX_HASH_OUTPUT];
+    const uint8_t *data[HASH_MANY_COUNT];
+    uint8_t *hashes[HASH_MANY_COUNT];
+    NoiseHashState *state;
+    int supported = noise_get_cpu_features();
+    size_t hash_len, index, posn, feature, count;
+
+    /* Calculate the expected hash values with the portable implementation */
+    compare(noise_hashstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    hash_len = noise_hashstate_get_hash_length(state);
+    compare(noise_set_cpu_features(0), NOISE_ERROR_NONE);
+    for (index = 0; index < HASH_MANY_COUNT; ++index) {
+        for (posn = 0; posn < sizes[index]; ++posn)
+            input[index][posn] = (uint8_t)(index * 31 + posn * 7);
+        data[index] = input[index];
+        hashes[index] = output[index];
+        compare(noise_hashstate_hash_one(state, input[index], sizes[index],
+                                         expected[index], hash_len),
+                NOISE_ERROR_NONE);
+    }
+
+    /* Every implementation must agree for every batch size */
+    for (feature = 0; feature < sizeof(features) / sizeof(features[0]);
+            ++feature) {
+        if ((features[feature] & supported) != features[feature])
+            continue;
+        compare(noise_set_cpu_features(features[feature]), NOISE_ERROR_NONE);
+        for (index = 0; index < HASH_MANY_COUNT; ++index) {
+            compare(noise_hashstate_hash_one
+                        (state, input[index], sizes[index],
+                         output[index], hash_len),
+                    NOISE_ERROR_NONE);
+            compare_blocks(output[index], hash_len, expected[index], hash_len);
+        }
+        for (count = 0; count <= HASH_MANY_COUNT; ++count) {
+            memset(output, 0xAA, sizeof(output));
+            compare(noise_hashstate_hash_many
+                        (state, data, sizes, hashes, hash_len, count),
+                    NOISE_ERROR_NONE);
+            for (index = 0; index < count; ++index) {
+                compare_blocks(output[index], hash_len,
+                               expected[index], hash_len);
+            }
+            if (count < HASH_MANY_COUNT)
+                compare(output[count][0], 0xAA);
+        }
+    }
+    compare(noise_set_cpu_features(-1), NOISE_ERROR_NONE);
+
+    /* Check parameter error conditions */
+    compare(noise_hashstate_hash_many(0, data, sizes, hashes, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hash_many(state, 0, sizes, hashes, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hash_many(state, data, 0, hashes, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hash_many(state, data, sizes, 0, hash_len, 1),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_hash_many(state, data, sizes, hashes, 16, 1),
+            NOISE_ERROR_INVALID_LENGTH);
+    data[1] = 0;
+    compare(noise_hashstate_hash_many(state, data, sizes, hashes, hash_len, 2),
+            NOISE_ERROR_INVALID_PARAM);
+    data[1] = input[1];
+    hashes[1] = 0;
+    compare(noise_hashstate_hash_many(state, data, sizes, hashes, hash_len, 2),
+            NOISE_ERROR_INVALID_PARAM);
+
+    /* Clean up */
+    compare(noise_hashstate_free(state), NOISE_ERROR_NONE);
+}
+
+/* Check the behaviour of the noise_hashstate_hash_many() function */
+static void hashstate_check_hash_many(void)
+{
+    hashstate_check_hash_many_algorithm(NOISE_HASH_BLAKE2s);
+    hashstate_check_hash_many_algorithm(NOISE_HASH_BLAKE2b);
+    hashstate_check_hash_many_algorithm(NOISE_HASH_SHA256);
+    hashstate_check_hash_many_algorithm(NOISE_HASH_SHA512);
+}
+
+/* Check that a hash state can be copied or cloned part-way through */
+static void hashstate_check_clone_algorithm(int id)
+{
+    static uint8_t const prefix[150] = {0x55};
+    static uint8_t const suffix1[] = "first branch";
+    static uint8_t const suffix2[] = "second branch";
+    uint8_t expected[MAX_HASH_OUTPUT];
+    uint8_t output[MAX_HASH_OUTPUT];
+    NoiseHashState *state;
+    NoiseHashState *clone;
+    NoiseHashState *other;
+    size_t hash_len;
+
+    /* Hash a common prefix and then branch off a clone */
+    compare(noise_hashstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    hash_len = noise_hashstate_get_hash_length(state);
+    compare(noise_hashstate_reset(state), NOISE_ERROR_NONE);
+    compare(noise_hashstate_update(state, prefix, sizeof(prefix)),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_clone(&clone, state), NOISE_ERROR_NONE);
+    verify(clone != NULL);
+    compare(noise_hashstate_get_hash_id(clone), id);
+
+    /* Each branch must hash as though it was the only one */
+    compare(noise_hashstate_update(clone, suffix2, sizeof(suffix2)),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_update(state, suffix1, sizeof(suffix1)),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_finalize(state, output, hash_len),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_hash_two(state, prefix, sizeof(prefix),
+                                     suffix1, sizeof(suffix1),
+                                     expected, hash_len),
+            NOISE_ERROR_NONE);
+    compare_blocks(output, hash_len, expected, hash_len);
+    compare(noise_hashstate_finalize(clone, output, hash_len),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_hash_two(state, prefix, sizeof(prefix),
+                                     suffix2, sizeof(suffix2),
+                                     expected, hash_len),
+            NOISE_ERROR_NONE);
+    compare_blocks(output, hash_len, expected, hash_len);
+
+    /* Copy into an existing object, overwriting what it had before */
+    compare(noise_hashstate_reset(state), NOISE_ERROR_NONE);
+    compare(noise_hashstate_update(state, prefix, sizeof(prefix)),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_update(clone, suffix1, sizeof(suffix1)),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_copy(clone, state), NOISE_ERROR_NONE);
+    compare(noise_hashstate_copy(clone, clone), NOISE_ERROR_NONE);
+    compare(noise_hashstate_update(clone, suffix2, sizeof(suffix2)),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_finalize(clone, output, hash_len),
+            NOISE_ERROR_NONE);
+    compare_blocks(output, hash_len, expected, hash_len);
+
+    /* Copying between different algorithms is not allowed */
+    compare(noise_hashstate_new_by_id
+                (&other, id == NOISE_HASH_SHA256 ? NOISE_HASH_SHA512
+                                                 : NOISE_HASH_SHA256),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_copy(other, state), NOISE_ERROR_NOT_APPLICABLE);
+    compare(noise_hashstate_free(other), NOISE_ERROR_NONE);
+
+    /* Clean up */
+    compare(noise_hashstate_free(clone), NOISE_ERROR_NONE);
+    compare(noise_hashstate_free(state), NOISE_ERROR_NONE);
+}
+
+/* Check the behaviour of noise_hashstate_copy() and noise_hashstate_clone() */
+static void hashstate_check_clone(void)
+{
+    NoiseHashState *state;
+    NoiseHashState *clone;
+
+    hashstate_check_clone_algorithm(NOISE_HASH_BLAKE2s);
+    hashstate_check_clone_algorithm(NOISE_HASH_BLAKE2b);
+    hashstate_check_clone_algorithm(NOISE_HASH_SHA256);
+    hashstate_check_clone_algorithm(NOISE_HASH_SHA512);
+
+    /* Check parameter error conditions */
+    compare(noise_hashstate_new_by_id(&state, NOISE_HASH_SHA256),
+            NOISE_ERROR_NONE);
+    compare(noise_hashstate_copy(0, state), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_copy(state, 0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_hashstate_clone(0, state), NOISE_ERROR_INVALID_PARAM);
+    clone = (NoiseHashState *)8;
+    compare(noise_hashstate_clone(&clone, 0), NOISE_ERROR_INVALID_PARAM);
+    verify(clone == NULL);
+    compare(noise_hashstate_free(state), NOISE_ERROR_NONE);
+}
+
 /* Check other error conditions that can be reported by the functions */
 static void hashstate_check_errors(void)
 {
@@ -455,6 +797,9 @@ void test_hashstate(void)
 {
     hashstate_check_test_vectors();
     hashstate_check_hkdf();
+    hashstate_check_hkdf_batch();
     hashstate_check_pbkdf2();
+    hashstate_check_hash_many();
+    hashstate_check_clone();
     hashstate_check_errors();
 }
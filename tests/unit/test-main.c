@@ -40,8 +40,11 @@ int main(int argc, char *argv[])
     }
 
     /* Run all tests */
+    test(allocator);
+    test(certificates);
     test(cipherstate);
     test(dhstate);
+    test(ephemeralpool);
     test(errors);
     test(handshakestate);
     test(hashstate);
@@ -51,6 +54,7 @@ int main(int argc, char *argv[])
     test(randstate);
     test(signstate);
     test(symmetricstate);
+    test(verifycache);
 
     /* Report the results */
     if (!test_failures) {
@@ -1201,6 +1201,53 @@ static void test_protobufs_element(void)
     check_tagged_element(15);
 }
 
+/* Test growing arrays of values, including sizes that would overflow */
+static void test_protobufs_array(void)
+{
+    uint32_t *array = 0;
+    void *ptr;
+    size_t count = 0;
+    size_t max = 0;
+    size_t huge;
+    uint32_t value;
+
+    data_name = 0;
+
+    /* Append and insert values, which grows the array */
+    for (value = 0; value < 10; ++value) {
+        ptr = array;
+        compare(noise_protobuf_add_to_array
+                    (&ptr, &count, &max, &value, sizeof(value)),
+                NOISE_ERROR_NONE);
+        array = (uint32_t *)ptr;
+    }
+    value = 100;
+    ptr = array;
+    compare(noise_protobuf_insert_into_array
+                (&ptr, &count, &max, 3, &value, sizeof(value)),
+            NOISE_ERROR_NONE);
+    array = (uint32_t *)ptr;
+    compare(count, 11);
+    verify(max >= count);
+    compare(array[2], 2);
+    compare(array[3], 100);
+    compare(array[4], 3);
+    compare(array[10], 9);
+
+    /* Growing a full array whose new size would overflow is reported
+       as running out of memory, and the array is left untouched */
+    huge = ((size_t)-1) / sizeof(value);
+    ptr = array;
+    compare(noise_protobuf_add_to_array
+                (&ptr, &huge, &huge, &value, sizeof(value)),
+            NOISE_ERROR_NO_MEMORY);
+    compare(noise_protobuf_insert_into_array
+                (&ptr, &huge, &huge, 0, &value, sizeof(value)),
+            NOISE_ERROR_NO_MEMORY);
+    verify(ptr == array);
+    noise_protobuf_free_memory(array, max * sizeof(value));
+}
+
 void test_protobufs(void)
 {
     test_protobufs_prepare();
@@ -1208,4 +1255,5 @@ void test_protobufs(void)
     test_protobufs_floating_point();
     test_protobufs_string();
     test_protobufs_element();
+    test_protobufs_array();
 }
@@ -376,6 +376,135 @@ static void signstate_check_generate_keypair(void)
     check_dh_generate(NOISE_SIGN_ED25519);
 }
 
+#define BATCH_SIZE 70
+
+/* Check batch verification of signatures from many different signers */
+static void check_verify_batch(int id)
+{
+    static uint8_t pub_keys[BATCH_SIZE][MAX_SIGN_KEY_LEN];
+    static uint8_t msgs[BATCH_SIZE][64];
+    static uint8_t sigs[BATCH_SIZE][MAX_SIGNATURE_LEN];
+    const uint8_t *pub_key_ptrs[BATCH_SIZE];
+    const uint8_t *msg_ptrs[BATCH_SIZE];
+    const uint8_t *sig_ptrs[BATCH_SIZE];
+    size_t msg_lens[BATCH_SIZE];
+    int results[BATCH_SIZE];
+    NoiseSignState *state;
+    size_t public_key_len;
+    size_t signature_len;
+    size_t index;
+
+    /* Sign a different message with a different key for each entry */
+    compare(noise_signstate_new_by_id(&state, id), NOISE_ERROR_NONE);
+    public_key_len = noise_signstate_get_public_key_length(state);
+    signature_len = noise_signstate_get_signature_length(state);
+    for (index = 0; index < BATCH_SIZE; ++index) {
+        compare(noise_signstate_generate_keypair(state), NOISE_ERROR_NONE);
+        compare(noise_signstate_get_public_key
+                    (state, pub_keys[index], public_key_len),
+                NOISE_ERROR_NONE);
+        msg_lens[index] = index % sizeof(msgs[0]);
+        memset(msgs[index], (int)index, msg_lens[index]);
+        compare(noise_signstate_sign
+                    (state, msgs[index], msg_lens[index],
+                     sigs[index], signature_len),
+                NOISE_ERROR_NONE);
+        pub_key_ptrs[index] = pub_keys[index];
+        msg_ptrs[index] = msgs[index];
+        sig_ptrs[index] = sigs[index];
+    }
+
+    /* The state's own key is not used, so clear it */
+    compare(noise_signstate_clear_key(state), NOISE_ERROR_NONE);
+
+    /* All of the signatures are valid, which covers both a full group of
+       64 signatures and the short group that is verified individually.
+       The signatures were made with the scalar SHA-512 implementation,
+       so this checks batch verification through the 4-way AVX2 SHA-512
+       path, where the CPU supports it, against scalar-generated ones */
+    memset(results, 0xAA, sizeof(results));
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 BATCH_SIZE, results),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_SIZE; ++index)
+        compare(results[index], NOISE_ERROR_NONE);
+
+    /* Check that batch verification with the portable SHA-512
+       implementation accepts the same signatures */
+    compare(noise_set_cpu_features(0), NOISE_ERROR_NONE);
+    memset(results, 0xAA, sizeof(results));
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 BATCH_SIZE, results),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < BATCH_SIZE; ++index)
+        compare(results[index], NOISE_ERROR_NONE);
+    compare(noise_set_cpu_features(-1), NOISE_ERROR_NONE);
+
+    /* Mess up some of the signatures and check that they are identified */
+    sigs[5][signature_len / 2] ^= 0x01;
+    msg_ptrs[40] = msgs[41];
+    sigs[BATCH_SIZE - 1][0] ^= 0x01;
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 BATCH_SIZE, results),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    for (index = 0; index < BATCH_SIZE; ++index) {
+        if (index == 5 || index == 40 || index == (BATCH_SIZE - 1))
+            compare(results[index], NOISE_ERROR_INVALID_SIGNATURE);
+        else
+            compare(results[index], NOISE_ERROR_NONE);
+    }
+
+    /* An empty message may be passed as NULL */
+    compare(msg_lens[0], 0);
+    msg_ptrs[0] = 0;
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 BATCH_SIZE, results),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    compare(results[0], NOISE_ERROR_NONE);
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 1, results),
+            NOISE_ERROR_NONE);
+    compare(results[0], NOISE_ERROR_NONE);
+
+    /* A batch with nothing in it trivially succeeds */
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 0, results),
+            NOISE_ERROR_NONE);
+
+    /* NULL parameters */
+    compare(noise_signstate_verify_batch
+                (0, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs, 1, results),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_signstate_verify_batch
+                (state, 0, msg_ptrs, msg_lens, sig_ptrs, 1, results),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs, 1, 0),
+            NOISE_ERROR_INVALID_PARAM);
+    msg_ptrs[1] = 0;
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs, 2, results),
+            NOISE_ERROR_INVALID_PARAM);
+    sig_ptrs[0] = 0;
+    compare(noise_signstate_verify_batch
+                (state, pub_key_ptrs, msg_ptrs, msg_lens, sig_ptrs, 1, results),
+            NOISE_ERROR_INVALID_PARAM);
+
+    compare(noise_signstate_free(state), NOISE_ERROR_NONE);
+}
+
+/* Check batch verification of signatures */
+static void signstate_check_verify_batch(void)
+{
+    check_verify_batch(NOISE_SIGN_ED25519);
+}
+
 /* Check other error conditions that can be reported by the functions */
 static void signstate_check_errors(void)
 {
@@ -414,5 +543,6 @@ void test_signstate(void)
 {
     signstate_check_test_vectors();
     signstate_check_generate_keypair();
+    signstate_check_verify_batch();
     signstate_check_errors();
 }
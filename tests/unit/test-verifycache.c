@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2016 Southern Storm Software, Pty Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "test-helpers.h"
+
+#define NUM_SIGNATURES 20
+
+static uint8_t public_keys[NUM_SIGNATURES][32];
+static uint8_t messages[NUM_SIGNATURES][16];
+static uint8_t signatures[NUM_SIGNATURES][64];
+
+/* Creates a set of signatures from different signers */
+static void create_signatures(void)
+{
+    NoiseSignState *state;
+    int index;
+    compare(noise_signstate_new_by_id(&state, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    for (index = 0; index < NUM_SIGNATURES; ++index) {
+        compare(noise_signstate_generate_keypair(state), NOISE_ERROR_NONE);
+        compare(noise_signstate_get_public_key
+                    (state, public_keys[index], sizeof(public_keys[index])),
+                NOISE_ERROR_NONE);
+        memset(messages[index], index, sizeof(messages[index]));
+        compare(noise_signstate_sign
+                    (state, messages[index], sizeof(messages[index]),
+                     signatures[index], sizeof(signatures[index])),
+                NOISE_ERROR_NONE);
+    }
+    compare(noise_signstate_free(state), NOISE_ERROR_NONE);
+}
+
+/* Verifies one of the signatures with a SignState that uses a cache */
+static int verify_signature(NoiseSignState *state, int index)
+{
+    compare(noise_signstate_set_public_key
+                (state, public_keys[index], sizeof(public_keys[index])),
+            NOISE_ERROR_NONE);
+    return noise_signstate_verify
+        (state, messages[index], sizeof(messages[index]),
+         signatures[index], sizeof(signatures[index]));
+}
+
+/* Checks the statistics for a cache */
+static void check_stats(NoiseVerifyCache *cache, size_t count,
+                        uint64_t hits, uint64_t misses)
+{
+    size_t actual_count = 0;
+    uint64_t actual_hits = 0;
+    uint64_t actual_misses = 0;
+    compare(noise_verify_cache_get_stats
+                (cache, &actual_count, &actual_hits, &actual_misses),
+            NOISE_ERROR_NONE);
+    compare(actual_count, count);
+    compare(actual_hits, hits);
+    compare(actual_misses, misses);
+}
+
+/* Check single signature verification through the cache */
+static void verifycache_check_verify(void)
+{
+    NoiseVerifyCache *cache;
+    NoiseSignState *state;
+
+    compare(noise_verify_cache_new(&cache, 100), NOISE_ERROR_NONE);
+    compare(noise_verify_cache_get_capacity(cache), 128);
+    check_stats(cache, 0, 0, 0);
+    compare(noise_signstate_new_by_id(&state, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_set_verify_cache(state, cache), NOISE_ERROR_NONE);
+
+    /* The first verification misses and the second one hits */
+    compare(verify_signature(state, 0), NOISE_ERROR_NONE);
+    check_stats(cache, 1, 0, 1);
+    compare(verify_signature(state, 0), NOISE_ERROR_NONE);
+    check_stats(cache, 1, 1, 1);
+
+    /* A different message with the same key and signature is not a hit */
+    messages[0][0] ^= 0x01;
+    compare(verify_signature(state, 0), NOISE_ERROR_INVALID_SIGNATURE);
+    check_stats(cache, 1, 1, 2);
+    messages[0][0] ^= 0x01;
+
+    /* Invalid signatures are never cached */
+    signatures[1][5] ^= 0x01;
+    compare(verify_signature(state, 1), NOISE_ERROR_INVALID_SIGNATURE);
+    compare(verify_signature(state, 1), NOISE_ERROR_INVALID_SIGNATURE);
+    check_stats(cache, 1, 1, 4);
+    signatures[1][5] ^= 0x01;
+    compare(verify_signature(state, 1), NOISE_ERROR_NONE);
+    check_stats(cache, 2, 1, 5);
+
+    /* Clearing the cache resets everything */
+    compare(noise_verify_cache_clear(cache), NOISE_ERROR_NONE);
+    check_stats(cache, 0, 0, 0);
+    compare(verify_signature(state, 0), NOISE_ERROR_NONE);
+    check_stats(cache, 1, 0, 1);
+
+    /* Detaching the cache stops it from being consulted */
+    compare(noise_signstate_set_verify_cache(state, 0), NOISE_ERROR_NONE);
+    compare(verify_signature(state, 0), NOISE_ERROR_NONE);
+    check_stats(cache, 1, 0, 1);
+
+    compare(noise_signstate_free(state), NOISE_ERROR_NONE);
+    compare(noise_verify_cache_free(cache), NOISE_ERROR_NONE);
+}
+
+/* Check batch signature verification through the cache */
+static void verifycache_check_verify_batch(void)
+{
+    NoiseVerifyCache *cache;
+    NoiseSignState *state;
+    const uint8_t *key_ptrs[NUM_SIGNATURES];
+    const uint8_t *msg_ptrs[NUM_SIGNATURES];
+    const uint8_t *sig_ptrs[NUM_SIGNATURES];
+    size_t msg_lens[NUM_SIGNATURES];
+    int results[NUM_SIGNATURES];
+    int index;
+
+    compare(noise_verify_cache_new(&cache, 64), NOISE_ERROR_NONE);
+    compare(noise_signstate_new_by_id(&state, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_set_verify_cache(state, cache), NOISE_ERROR_NONE);
+    for (index = 0; index < NUM_SIGNATURES; ++index) {
+        key_ptrs[index] = public_keys[index];
+        msg_ptrs[index] = messages[index];
+        sig_ptrs[index] = signatures[index];
+        msg_lens[index] = sizeof(messages[index]);
+    }
+
+    /* Populate the cache with half of the signatures */
+    compare(noise_signstate_verify_batch
+                (state, key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 NUM_SIGNATURES / 2, results),
+            NOISE_ERROR_NONE);
+    check_stats(cache, NUM_SIGNATURES / 2, 0, NUM_SIGNATURES / 2);
+
+    /* Verify all of them, with one of the uncached ones corrupted */
+    signatures[15][0] ^= 0x01;
+    compare(noise_signstate_verify_batch
+                (state, key_ptrs, msg_ptrs, msg_lens, sig_ptrs,
+                 NUM_SIGNATURES, results),
+            NOISE_ERROR_INVALID_SIGNATURE);
+    for (index = 0; index < NUM_SIGNATURES; ++index) {
+        if (index == 15)
+            compare(results[index], NOISE_ERROR_INVALID_SIGNATURE);
+        else
+            compare(results[index], NOISE_ERROR_NONE);
+    }
+    check_stats(cache, NUM_SIGNATURES - 1, NUM_SIGNATURES / 2,
+                NUM_SIGNATURES);
+    signatures[15][0] ^= 0x01;
+
+    /* Single verification shares the same cache entries */
+    compare(verify_signature(state, 3), NOISE_ERROR_NONE);
+    check_stats(cache, NUM_SIGNATURES - 1, NUM_SIGNATURES / 2 + 1,
+                NUM_SIGNATURES);
+
+    compare(noise_signstate_free(state), NOISE_ERROR_NONE);
+    compare(noise_verify_cache_free(cache), NOISE_ERROR_NONE);
+}
+
+/* Check that CLOCK eviction gives recently used entries a second chance */
+static void verifycache_check_eviction(void)
+{
+    NoiseVerifyCache *cache;
+    NoiseSignState *state;
+    size_t count;
+    int index;
+
+    /* A capacity of 8 gives a single set, so everything competes */
+    compare(noise_verify_cache_new(&cache, 5), NOISE_ERROR_NONE);
+    compare(noise_verify_cache_get_capacity(cache), 8);
+    compare(noise_signstate_new_by_id(&state, NOISE_SIGN_ED25519),
+            NOISE_ERROR_NONE);
+    compare(noise_signstate_set_verify_cache(state, cache), NOISE_ERROR_NONE);
+    for (index = 0; index < 8; ++index)
+        compare(verify_signature(state, index), NOISE_ERROR_NONE);
+    check_stats(cache, 8, 0, 8);
+
+    /* Touch the first entry and then add another signature.  The first
+       entry survives and the second entry is evicted in its place. */
+    compare(verify_signature(state, 0), NOISE_ERROR_NONE);
+    check_stats(cache, 8, 1, 8);
+    compare(verify_signature(state, 8), NOISE_ERROR_NONE);
+    check_stats(cache, 8, 1, 9);
+    compare(verify_signature(state, 0), NOISE_ERROR_NONE);
+    check_stats(cache, 8, 2, 9);
+    compare(verify_signature(state, 1), NOISE_ERROR_NONE);
+    check_stats(cache, 8, 2, 10);
+
+    /* The cache never grows beyond its capacity */
+    for (index = 0; index < NUM_SIGNATURES; ++index) {
+        compare(verify_signature(state, index), NOISE_ERROR_NONE);
+        compare(noise_verify_cache_get_stats(cache, &count, 0, 0),
+                NOISE_ERROR_NONE);
+        compare(count, 8);
+    }
+
+    compare(noise_signstate_free(state), NOISE_ERROR_NONE);
+    compare(noise_verify_cache_free(cache), NOISE_ERROR_NONE);
+}
+
+static void verifycache_check_errors(void)
+{
+    NoiseVerifyCache *cache;
+
+    compare(noise_verify_cache_new(0, 8), NOISE_ERROR_INVALID_PARAM);
+    cache = (NoiseVerifyCache *)8;
+    compare(noise_verify_cache_new(&cache, 0), NOISE_ERROR_INVALID_PARAM);
+    verify(cache == NULL);
+    cache = (NoiseVerifyCache *)8;
+    compare(noise_verify_cache_new(&cache, (1 << 24) + 1),
+            NOISE_ERROR_INVALID_PARAM);
+    verify(cache == NULL);
+    compare(noise_verify_cache_free(0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_verify_cache_clear(0), NOISE_ERROR_INVALID_PARAM);
+    compare(noise_verify_cache_get_capacity(0), 0);
+    compare(noise_verify_cache_get_stats(0, 0, 0, 0),
+            NOISE_ERROR_INVALID_PARAM);
+    compare(noise_signstate_set_verify_cache(0, 0),
+            NOISE_ERROR_INVALID_PARAM);
+}
+
+void test_verifycache(void)
+{
+    create_signatures();
+    verifycache_check_verify();
+    verifycache_check_verify_batch();
+    verifycache_check_eviction();
+    verifycache_check_errors();
+}
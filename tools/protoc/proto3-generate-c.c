@@ -368,6 +368,16 @@ static void type_string_declare_field
     }
 }
 
+/**
+ * \brief Gets the extra bytes that are allocated beyond the size of a
+ * string or bytes field, which must also be passed when it is freed.
+ */
+static const char *type_string_size_extra(Proto3Field *field)
+{
+    /* Strings are allocated with a NUL terminator after the data */
+    return field->type.id == PROTO3_TYPE_STRING ? " + 1" : "";
+}
+
 /**
  * \brief Free a string field.
  */
@@ -381,8 +391,9 @@ static void type_string_free_field
                 field->name.name);
         ++indent_level;
         print_indent();
-        fprintf(output, "noise_protobuf_free_memory(obj->%s[index], obj->%s_size_[index]);\n",
-                field->name.name, field->name.name);
+        fprintf(output, "noise_protobuf_free_memory(obj->%s[index], obj->%s_size_[index]%s);\n",
+                field->name.name, field->name.name,
+                type_string_size_extra(field));
         --indent_level;
         print_indent();
         fprintf(output, "noise_protobuf_free_memory(obj->%s, obj->%s_max_ * sizeof(%s));\n",
@@ -392,8 +403,9 @@ static void type_string_free_field
                 field->name.name, field->name.name);
     } else {
         print_indent();
-        fprintf(output, "noise_protobuf_free_memory(obj->%s, obj->%s_size_);\n",
-                field->name.name, field->name.name);
+        fprintf(output, "noise_protobuf_free_memory(obj->%s, obj->%s_size_%s);\n",
+                field->name.name, field->name.name,
+                type_string_size_extra(field));
     }
 }
 
@@ -470,8 +482,9 @@ static void type_string_read_field
         fprintf(output, "_add_%s(*obj, value, len);\n", field->name.name);
     } else {
         print_indent();
-        fprintf(output, "noise_protobuf_free_memory((*obj)->%s, (*obj)->%s_size_);\n",
-                field->name.name, field->name.name);
+        fprintf(output, "noise_protobuf_free_memory((*obj)->%s, (*obj)->%s_size_%s);\n",
+                field->name.name, field->name.name,
+                type_string_size_extra(field));
         print_indent();
         fprintf(output, "(*obj)->%s = 0;\n", field->name.name);
         print_indent();
@@ -666,7 +679,7 @@ static void type_string_declare_field_ops
             indent_level = 2;
             (*(type->free_field))(type, field);
             if (field->type.id == PROTO3_TYPE_STRING) {
-                fprintf(output, "        obj->%s = (%s)malloc(size + 1);\n",
+                fprintf(output, "        obj->%s = (%s)noise_protobuf_new_memory(size + 1);\n",
                         field->name.name, type->c_name);
                 fprintf(output, "        if (obj->%s) {\n", field->name.name);
                 fprintf(output, "            memcpy(obj->%s, value, size);\n",
@@ -674,7 +687,7 @@ static void type_string_declare_field_ops
                 fprintf(output, "            obj->%s[size] = 0;\n",
                         field->name.name);
             } else {
-                fprintf(output, "        obj->%s = (%s)malloc(size ? size : 1);\n",
+                fprintf(output, "        obj->%s = (%s)noise_protobuf_new_memory(size ? size : 1);\n",
                         field->name.name, type->c_name);
                 fprintf(output, "        if (obj->%s) {\n", field->name.name);
                 fprintf(output, "            memcpy(obj->%s, value, size);\n",
@@ -1492,7 +1505,7 @@ static void generate_implement_ctor(FILE *output, Proto3Message *message)
     fprintf(output, "        return NOISE_ERROR_INVALID_PARAM;\n");
     fprintf(output, "    *obj = (");
     generate_name(output, message->name.name);
-    fprintf(output, " *)calloc(1, sizeof(");
+    fprintf(output, " *)noise_protobuf_new_memory(sizeof(");
     generate_name(output, message->name.name);
     fprintf(output, "));\n");
     fprintf(output, "    if (!(*obj))\n");